@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Numbers are only worth reading when the results agree, so a failed check ends the run
+#define BENCH_CHECK(cond)                                                                  \
+    do {                                                                                   \
+        if (!(cond)) {                                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);       \
+            exit(1);                                                                       \
+        }                                                                                  \
+    } while (0)
+
+static inline double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec * 1000.0 + (double) ts.tv_nsec / 1000000.0;
+}
+
+static inline void bench_report(const char *name, double ms) {
+    printf("  %-48s %10.3f ms\n", name, ms);
+}
+
+static inline void bench_report_rate(const char *name, double bytes, double ms) {
+    printf("  %-48s %10.1f MB/s\n", name, bytes / (1024.0 * 1024.0) / (ms / 1000.0));
+}
+
+// Scratch folder for anything a benchmark writes, removed again by bench_cleanup
+static inline const char *bench_dir(void) {
+    static char dir[64] = "";
+
+    if (!dir[0]) {
+        snprintf(dir, sizeof(dir), "/tmp/mux_bench.XXXXXX");
+        BENCH_CHECK(mkdtemp(dir) != NULL);
+    }
+
+    return dir;
+}
+
+static inline void bench_cleanup(void) {
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf '%s'", bench_dir());
+    BENCH_CHECK(system(command) == 0);
+}
+
+#endif
@@ -0,0 +1,346 @@
+/*
+ * Builds the content catalogue over a generated library on two storage
+ * devices, then checks its search against the content_search walk and
+ * times the updates the watcher runs: a full build, one with nothing
+ * changed, which must not rewrite the file, and one after a new file lands.
+ * Scoping, random picks and core assignments are checked along the way,
+ * including an individual assignment rewritten in place.
+ *
+ * The catalogue and core info live at fixed paths under /run/muos and
+ * /opt/muos. Anything made there is removed again on exit, and the run is
+ * skipped rather than replace a catalogue that is already there.
+ */
+
+#include <errno.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "common.h"
+#include "config.h"
+#include "device.h"
+#include "language.h"
+#include "content_catalogue.h"
+
+#define SYSTEMS 50
+#define FILES 200
+#define MAX_RESULTS 256
+#define MAX_CREATED 16
+
+char mux_module[MAX_BUFFER_SIZE] = "bench";
+
+struct mux_config config;
+struct mux_device device;
+struct mux_lang lang;
+
+typedef struct {
+    char *paths[MAX_RESULTS];
+    size_t count;
+} result_set;
+
+static char *created[MAX_CREATED];
+static int created_count;
+
+#define BENCH_CORE_DIR INFO_COR_PATH "/Bench 02"
+
+static const char *core_dir = BENCH_CORE_DIR;
+static const char *folder_cfg = BENCH_CORE_DIR "/core.cfg";
+static const char *content_cfg = BENCH_CORE_DIR "/Game 2-1.cfg";
+
+int file_exist(char *filename) {
+    return access(filename, F_OK) == 0;
+}
+
+int directory_exist(char *dirname) {
+    struct stat stats;
+    return stat(dirname, &stats) == 0 && S_ISDIR(stats.st_mode);
+}
+
+int should_skip(const char *name, int is_dir) {
+    (void) is_dir;
+    return fnmatch(".*", name, 0) == 0;
+}
+
+const char *friendly_name_lookup(const char *system, const char *name) {
+    (void) system;
+    return strcmp(name, "Game 3-5") == 0 ? "Super Mario Friendly" : NULL;
+}
+
+uint32_t fnv1a_hash_str(const char *str) {
+    uint32_t hash = 2166136261U;
+
+    for (const char *p = str; *p; p++) {
+        hash ^= (uint8_t) (*p);
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+void create_directories(const char *path) {
+    char command[PATH_MAX * 2];
+    snprintf(command, sizeof(command), "mkdir -p '%s'", path);
+    BENCH_CHECK(system(command) == 0);
+}
+
+static const char *arcade_alias(const char *name) {
+    return strcmp(name, "Game 4-4") == 0 ? "Mario Alias" : NULL;
+}
+
+// Creates every missing folder on the way to path, remembering them so they can go again
+static bool make_path(const char *path) {
+    char partial[PATH_MAX];
+    snprintf(partial, sizeof(partial), "%s", path);
+
+    for (char *slash = partial + 1;; slash++) {
+        if (*slash != '/' && *slash != '\0') continue;
+
+        char was = *slash;
+        *slash = '\0';
+
+        if (mkdir(partial, 0755) == 0) {
+            if (created_count == MAX_CREATED) return false;
+            created[created_count++] = strdup(partial);
+        } else if (errno != EEXIST) {
+            return false;
+        }
+
+        if (!was) return true;
+        *slash = was;
+    }
+}
+
+static void remove_system_paths(void) {
+    remove(CONTENT_CATALOGUE_FILE);
+    remove(content_cfg);
+    remove(folder_cfg);
+
+    while (created_count) {
+        rmdir(created[--created_count]);
+        free(created[created_count]);
+    }
+}
+
+static void write_file(const char *path, const char *content) {
+    FILE *file = fopen(path, "w");
+    BENCH_CHECK(file != NULL);
+    fputs(content, file);
+    fclose(file);
+}
+
+static void build_library(const char *base) {
+    char path[PATH_MAX + 64];
+
+    for (int s = 0; s < SYSTEMS; s++) {
+        snprintf(path, sizeof(path), "%s/sd1/ROMS/Bench %02d/Sub", base, s);
+        create_directories(path);
+
+        snprintf(path, sizeof(path), "%s/sd1/ROMS/Bench %02d/Sub/Nested %d.zip", base, s, s);
+        write_file(path, "");
+
+        snprintf(path, sizeof(path), "%s/sd1/ROMS/Bench %02d/.hidden", base, s);
+        write_file(path, "");
+
+        for (int i = 0; i < FILES; i++) {
+            snprintf(path, sizeof(path), "%s/sd1/ROMS/Bench %02d/Game %d-%d.zip", base, s, s, i);
+            write_file(path, "");
+        }
+    }
+
+    // A second device sharing one system folder with the first
+    snprintf(path, sizeof(path), "%s/sd2/ROMS/Bench 03", base);
+    create_directories(path);
+
+    snprintf(path, sizeof(path), "%s/sd2/ROMS/Bench 03/Mario Bros.zip", base);
+    write_file(path, "");
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+static void collect(const content_search_result *result, void *ctx) {
+    result_set *set = ctx;
+    BENCH_CHECK(set->count < MAX_RESULTS);
+
+    char path[PATH_MAX + 64];
+    snprintf(path, sizeof(path), "%s/%s|%s", result->dir, result->file, result->name);
+    set->paths[set->count++] = strdup(path);
+}
+
+static void free_set(result_set *set) {
+    for (size_t i = 0; i < set->count; i++) free(set->paths[i]);
+    set->count = 0;
+}
+
+static void check_same(result_set *a, result_set *b) {
+    qsort(a->paths, a->count, sizeof(char *), compare_paths);
+    qsort(b->paths, b->count, sizeof(char *), compare_paths);
+
+    BENCH_CHECK(a->count == b->count);
+    for (size_t i = 0; i < a->count; i++) BENCH_CHECK(strcmp(a->paths[i], b->paths[i]) == 0);
+}
+
+static size_t scope_count(const content_catalogue *catalogue, const char *query, const char *scope) {
+    static result_set found;
+
+    size_t count = content_catalogue_search(catalogue, query, scope, NULL, collect, &found);
+    BENCH_CHECK(count == found.count);
+
+    free_set(&found);
+    return count;
+}
+
+static bool find_item(const content_catalogue *catalogue, const char *file, content_catalogue_item *item) {
+    for (size_t i = 0; i < content_catalogue_count(catalogue); i++) {
+        BENCH_CHECK(content_catalogue_item_at(catalogue, i, item));
+        if (strcmp(item->file, file) == 0) return true;
+    }
+
+    return false;
+}
+
+static void check_queries(const content_catalogue *catalogue) {
+    BENCH_CHECK(content_catalogue_count(catalogue) == SYSTEMS * (FILES + 1) + 1);
+
+    // Both devices hold a Bench 03, and Game 3-5 is found by its friendly name
+    BENCH_CHECK(scope_count(catalogue, "game 3-", "Bench 03/") == FILES);
+    BENCH_CHECK(scope_count(catalogue, "mario", "Bench 03") == 2);
+    BENCH_CHECK(scope_count(catalogue, "nested", "Bench 03/Sub") == 1);
+    BENCH_CHECK(scope_count(catalogue, "hidden", "") == 0);
+
+    BENCH_CHECK(content_catalogue_covers(catalogue, ""));
+    BENCH_CHECK(content_catalogue_covers(catalogue, "Bench 03"));
+    BENCH_CHECK(content_catalogue_covers(catalogue, "Bench 03/Sub/"));
+    BENCH_CHECK(!content_catalogue_covers(catalogue, "Missing"));
+
+    content_catalogue_item item;
+    for (int i = 0; i < 20; i++) {
+        BENCH_CHECK(content_catalogue_random(catalogue, "Bench 07", &item));
+        BENCH_CHECK(strncmp(item.rel, "Bench 07", 8) == 0);
+    }
+    BENCH_CHECK(!content_catalogue_random(catalogue, "Missing", &item));
+
+    // An individual assignment wins over the folder's
+    BENCH_CHECK(find_item(catalogue, "Game 2-1.zip", &item));
+    BENCH_CHECK(strcmp(item.core, "individual_core") == 0 && strcmp(item.system, "Individual System") == 0);
+    BENCH_CHECK(find_item(catalogue, "Game 2-2.zip", &item));
+    BENCH_CHECK(strcmp(item.core, "folder_core") == 0 && strcmp(item.system, "Folder System") == 0);
+    BENCH_CHECK(find_item(catalogue, "Game 1-2.zip", &item));
+    BENCH_CHECK(!item.core[0] && !item.system[0]);
+}
+
+static double timed_update(const char *const roots[], size_t root_count) {
+    double start = bench_now();
+    BENCH_CHECK(content_catalogue_update(roots, root_count));
+    return bench_now() - start;
+}
+
+static void catalogue_stat(struct stat *st) {
+    BENCH_CHECK(stat(CONTENT_CATALOGUE_FILE, st) == 0);
+}
+
+int main(void) {
+    if (access(CONTENT_CATALOGUE_FILE, F_OK) == 0) {
+        printf("  Skipped, %s already exists\n", CONTENT_CATALOGUE_FILE);
+        return 0;
+    }
+
+    atexit(remove_system_paths);
+
+    if (!make_path(RUN_STORAGE_PATH "info") || !make_path(core_dir)) {
+        printf("  Skipped, unable to create %s and %s\n", RUN_STORAGE_PATH "info", core_dir);
+        return 0;
+    }
+
+    write_file(folder_cfg, "folder_core\nFolder System\ncatalogue\nlookup\nassign\n");
+    write_file(content_cfg, "Game 2-1\nindividual_core\nIndividual System\n");
+
+    const char *base = bench_dir();
+    build_library(base);
+
+    snprintf(device.STORAGE.ROM.MOUNT, sizeof(device.STORAGE.ROM.MOUNT), "%s/sd1", base);
+    snprintf(device.STORAGE.SDCARD.MOUNT, sizeof(device.STORAGE.SDCARD.MOUNT), "%s/sd2", base);
+
+    char sd1[PATH_MAX], sd2[PATH_MAX];
+    snprintf(sd1, sizeof(sd1), "%s/ROMS", device.STORAGE.ROM.MOUNT);
+    snprintf(sd2, sizeof(sd2), "%s/ROMS", device.STORAGE.SDCARD.MOUNT);
+
+    const char *roots[] = {sd1, sd2, "/nonexistent/ROMS"};
+
+    double full_build = timed_update(roots, 3);
+
+    content_catalogue *catalogue = content_catalogue_open();
+    BENCH_CHECK(catalogue != NULL);
+
+    check_queries(catalogue);
+
+    static result_set expected, found;
+
+    double start = bench_now();
+    content_search *search = content_search_start("mario", roots, 3, arcade_alias);
+    BENCH_CHECK(search != NULL);
+
+    while (content_search_drain(search, collect, &expected)) usleep(1000);
+    double walk_time = bench_now() - start;
+    content_search_stop(search);
+
+    start = bench_now();
+    size_t matches = content_catalogue_search(catalogue, "mario", "", arcade_alias, collect, &found);
+    double search_time = bench_now() - start;
+
+    BENCH_CHECK(matches == 3);
+    check_same(&expected, &found);
+
+    free_set(&expected);
+    free_set(&found);
+    content_catalogue_close(catalogue);
+
+    printf("  %d files in %zu folders, search matches the content_search walk\n",
+           SYSTEMS * (FILES + 1) + 1, (size_t) SYSTEMS * 2 + 3);
+
+    // Nothing changed, so the file must be left exactly as it was
+    struct stat before, after;
+    catalogue_stat(&before);
+
+    double no_change = timed_update(roots, 3);
+
+    catalogue_stat(&after);
+    BENCH_CHECK(before.st_ino == after.st_ino && before.st_mtim.tv_nsec == after.st_mtim.tv_nsec);
+
+    char path[PATH_MAX + 32];
+    snprintf(path, sizeof(path), "%s/Bench 09/Game 9-new.zip", sd1);
+    write_file(path, "");
+
+    double one_file = timed_update(roots, 3);
+
+    catalogue = content_catalogue_open();
+    BENCH_CHECK(catalogue != NULL);
+    BENCH_CHECK(content_catalogue_count(catalogue) == SYSTEMS * (FILES + 1) + 2);
+    BENCH_CHECK(scope_count(catalogue, "9-new", "Bench 09") == 1);
+    content_catalogue_close(catalogue);
+
+    // Assignments are rewritten in place, which the folder mtime alone would miss
+    usleep(20000);
+    write_file(content_cfg, "Game 2-1\nrewritten_core\nRewritten System\n");
+    timed_update(roots, 3);
+
+    catalogue = content_catalogue_open();
+    BENCH_CHECK(catalogue != NULL);
+
+    content_catalogue_item item;
+    BENCH_CHECK(find_item(catalogue, "Game 2-1.zip", &item));
+    BENCH_CHECK(strcmp(item.core, "rewritten_core") == 0 && strcmp(item.system, "Rewritten System") == 0);
+    content_catalogue_close(catalogue);
+
+    printf("  Scopes, random picks and core assignments as expected\n");
+    bench_report("content_search walk", walk_time);
+    bench_report("catalogue search", search_time);
+    bench_report("full build", full_build);
+    bench_report("update with nothing changed", no_change);
+    bench_report("update after one new file", one_file);
+
+    bench_cleanup();
+    return 0;
+}
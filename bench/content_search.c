@@ -0,0 +1,185 @@
+/*
+ * Generates a ROM tree and searches it with content_search, checking the
+ * matches against find, which is what the old find.sh walk came down to,
+ * plus the hits only a friendly name or alias can give. Hidden entries stand
+ * in for the skip list, and one name table and one alias stand in for the
+ * friendly name and arcade lookups. A search cancelled mid-walk must stop
+ * and free cleanly.
+ */
+
+#include <fnmatch.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "common.h"
+#include "content_search.h"
+
+#define SYSTEMS 30
+#define FOLDERS 4
+#define FILES 80
+#define MAX_RESULTS 4096
+
+char mux_module[MAX_BUFFER_SIZE] = "bench";
+
+typedef struct {
+    char *paths[MAX_RESULTS];
+    size_t count;
+} result_set;
+
+int directory_exist(char *dirname) {
+    struct stat stats;
+    return stat(dirname, &stats) == 0 && S_ISDIR(stats.st_mode);
+}
+
+int should_skip(const char *name, int is_dir) {
+    (void) is_dir;
+    return fnmatch(".*", name, 0) == 0;
+}
+
+const char *friendly_name_lookup(const char *system, const char *name) {
+    return strcmp(system, "System 07") == 0 && strcmp(name, "Friendly") == 0 ? "Super Mario Friendly" : NULL;
+}
+
+static const char *arcade_alias(const char *name) {
+    return strcmp(name, "Alias") == 0 ? "Mario Alias" : NULL;
+}
+
+static void make_dir(const char *path) {
+    BENCH_CHECK(mkdir(path, 0755) == 0);
+}
+
+static void touch(const char *path) {
+    FILE *file = fopen(path, "w");
+    BENCH_CHECK(file != NULL);
+    fclose(file);
+}
+
+static void build_tree(const char *root) {
+    char path[PATH_MAX + 64];
+    make_dir(root);
+
+    for (int s = 0; s < SYSTEMS; s++) {
+        char system[PATH_MAX + 16];
+        snprintf(system, sizeof(system), "%s/System %02d", root, s);
+        make_dir(system);
+
+        for (int f = 0; f < FOLDERS; f++) {
+            char folder[PATH_MAX + 32];
+            snprintf(folder, sizeof(folder), "%s/%s %d", system, f ? "Disc" : ".hidden", f);
+            make_dir(folder);
+
+            for (int i = 0; i < FILES; i++) {
+                // Every seventh file is a match, in varying case
+                const char *title = i % 7 ? "Game" : (i % 2 ? "MARIO Kart" : "super mario");
+
+                snprintf(path, sizeof(path), "%s/%s %d-%d.zip", folder, title, f, i);
+                touch(path);
+            }
+        }
+
+        // Loose files at the top of the system folder, one of them hidden
+        snprintf(path, sizeof(path), "%s/Friendly.zip", system);
+        touch(path);
+        snprintf(path, sizeof(path), "%s/Alias.zip", system);
+        touch(path);
+        snprintf(path, sizeof(path), "%s/.mario.zip", system);
+        touch(path);
+    }
+}
+
+static int compare_paths(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+static void add_path(result_set *set, const char *path) {
+    BENCH_CHECK(set->count < MAX_RESULTS);
+    set->paths[set->count++] = strdup(path);
+}
+
+static void collect(const content_search_result *result, void *ctx) {
+    char path[PATH_MAX + 64];
+    snprintf(path, sizeof(path), "%s/%s", result->dir, result->file);
+    add_path(ctx, path);
+}
+
+static void find_matches(const char *root, const char *query, result_set *set) {
+    char command[PATH_MAX * 2];
+    snprintf(command, sizeof(command), "find '%s' -name '.*' -prune -o -type f -iname '*%s*' -print", root, query);
+
+    FILE *pipe = popen(command, "r");
+    BENCH_CHECK(pipe != NULL);
+
+    char line[PATH_MAX];
+    while (fgets(line, sizeof(line), pipe)) {
+        line[strcspn(line, "\n")] = '\0';
+        add_path(set, line);
+    }
+
+    BENCH_CHECK(pclose(pipe) == 0);
+}
+
+static void free_set(result_set *set) {
+    for (size_t i = 0; i < set->count; i++) free(set->paths[i]);
+    set->count = 0;
+}
+
+int main(void) {
+    char root[PATH_MAX];
+    snprintf(root, sizeof(root), "%s/ROMS", bench_dir());
+    build_tree(root);
+
+    const char *roots[] = {root, "/nonexistent/ROMS"};
+    static result_set expected, found;
+
+    double start = bench_now();
+    find_matches(root, "mario", &expected);
+    double find_time = bench_now() - start;
+
+    start = bench_now();
+    content_search *search = content_search_start("mario", roots, 2, arcade_alias);
+    BENCH_CHECK(search != NULL);
+
+    while (content_search_drain(search, collect, &found)) usleep(1000);
+    double search_time = bench_now() - start;
+
+    BENCH_CHECK(content_search_found(search) == found.count);
+    content_search_stop(search);
+
+    // The only extras are the friendly name hit in one system and the alias hit in every system
+    char path[PATH_MAX + 64];
+    for (int s = 0; s < SYSTEMS; s++) {
+        if (s == 7) {
+            snprintf(path, sizeof(path), "%s/System %02d/Friendly.zip", root, s);
+            add_path(&expected, path);
+        }
+
+        snprintf(path, sizeof(path), "%s/System %02d/Alias.zip", root, s);
+        add_path(&expected, path);
+    }
+
+    qsort(expected.paths, expected.count, sizeof(char *), compare_paths);
+    qsort(found.paths, found.count, sizeof(char *), compare_paths);
+
+    BENCH_CHECK(found.count == expected.count);
+    for (size_t i = 0; i < found.count; i++) BENCH_CHECK(strcmp(found.paths[i], expected.paths[i]) == 0);
+
+    printf("  %zu matches in %d files, the same as find plus friendly and alias hits\n",
+           found.count, SYSTEMS * (FOLDERS * FILES + 3));
+
+    free_set(&expected);
+    free_set(&found);
+
+    // Cancelling straight after the start must not hang or leak workers
+    search = content_search_start("game", roots, 1, NULL);
+    BENCH_CHECK(search != NULL);
+    usleep(2000);
+    content_search_stop(search);
+
+    printf("  Cancelled search stopped cleanly\n");
+    bench_report("find -iname", find_time);
+    bench_report("content_search, results drained", search_time);
+
+    bench_cleanup();
+    return 0;
+}
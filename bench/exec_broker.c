@@ -0,0 +1,110 @@
+/*
+ * Starts commands through the exec broker and checks that exit codes, the
+ * environment and detached logging come through as they did with fork. It
+ * then times foreground commands both ways from a process that has touched a
+ * large heap, which is what makes forking the frontend slow: every fork has
+ * to copy the page tables behind it while the broker was forked before any
+ * of it existed.
+ */
+
+#include <limits.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "common.h"
+#include "exec_broker.h"
+
+#define HEAP_SIZE (256 * 1024 * 1024)
+#define COMMANDS 50
+
+char mux_module[MAX_BUFFER_SIZE] = "bench";
+
+static int broker_run(const char *const argv[]) {
+    int result_fd;
+    BENCH_CHECK(exec_broker_spawn(argv, 0, NULL, &result_fd));
+
+    int code = -2;
+    BENCH_CHECK(read(result_fd, &code, sizeof(code)) == sizeof(code));
+    close(result_fd);
+
+    return code;
+}
+
+// What run_exec does for a foreground command without the broker
+static int fork_run(const char *const argv[]) {
+    pid_t pid = fork();
+    BENCH_CHECK(pid >= 0);
+
+    if (pid == 0) {
+        execvp(argv[0], (char *const *) argv);
+        _exit(EXIT_FAILURE);
+    }
+
+    int status;
+    BENCH_CHECK(waitpid(pid, &status, 0) == pid);
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void check_broker(void) {
+    const char *succeed[] = {"true", NULL};
+    const char *fail[] = {"sh", "-c", "exit 7", NULL};
+    const char *missing[] = {"/nonexistent/command", NULL};
+    const char *environment[] = {"sh", "-c", "test \"$MUX_BENCH\" = broker", NULL};
+
+    BENCH_CHECK(broker_run(succeed) == 0);
+    BENCH_CHECK(broker_run(fail) == 7);
+    BENCH_CHECK(broker_run(missing) != 0);
+
+    setenv("MUX_BENCH", "broker", 1);
+    BENCH_CHECK(broker_run(environment) == 0);
+
+    char log_file[PATH_MAX];
+    snprintf(log_file, sizeof(log_file), "%s/detached.log", bench_dir());
+
+    const char *detached[] = {"sh", "-c", "echo detached", NULL};
+    BENCH_CHECK(exec_broker_spawn(detached, 1, log_file, NULL));
+
+    // Nothing reports back on a detached command, so wait for its output to land
+    char line[64] = "";
+    for (int tries = 0; tries < 100 && strcmp(line, "detached\n") != 0; tries++) {
+        usleep(20000);
+
+        FILE *file = fopen(log_file, "r");
+        if (!file) continue;
+
+        if (!fgets(line, sizeof(line), file)) line[0] = '\0';
+        fclose(file);
+    }
+
+    BENCH_CHECK(strcmp(line, "detached\n") == 0);
+    printf("  Exit codes, environment and detached logging match fork\n");
+}
+
+int main(void) {
+    BENCH_CHECK(exec_broker_start());
+    check_broker();
+
+    char *heap = malloc(HEAP_SIZE);
+    BENCH_CHECK(heap != NULL);
+    memset(heap, 1, HEAP_SIZE);
+
+    const char *command[] = {"true", NULL};
+
+    double start = bench_now();
+    for (int i = 0; i < COMMANDS; i++) BENCH_CHECK(fork_run(command) == 0);
+    double forked = (bench_now() - start) / COMMANDS;
+
+    start = bench_now();
+    for (int i = 0; i < COMMANDS; i++) BENCH_CHECK(broker_run(command) == 0);
+    double brokered = (bench_now() - start) / COMMANDS;
+
+    printf("  Average of %d foreground commands with %d MiB of touched heap\n", COMMANDS, HEAP_SIZE >> 20);
+    bench_report("fork and exec", forked);
+    bench_report("exec broker", brokered);
+
+    free(heap);
+    bench_cleanup();
+
+    return 0;
+}
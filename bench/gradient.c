@@ -0,0 +1,234 @@
+/*
+ * Checks the themed background gradient and blur against the per pixel
+ * scalar code they replaced and times both. The gradient may differ from the
+ * float interpolation by one step per channel. The blur must match a plain
+ * 3x3 box blur of the unblurred input exactly, whether it ran the NEON
+ * kernels or the portable loops. How far it strays from the old in place
+ * blur, which read pixels it had already blurred in the same pass, is
+ * reported alongside.
+ */
+
+#include <math.h>
+#include "bench.h"
+#include "gradient.h"
+
+#define BLUR_PASSES 3
+#define RUNS 5
+
+static int in_place_difference = 0;
+
+// Every resolution a device can run at
+static const int resolutions[][2] = {
+        {640,  480},
+        {720,  480},
+        {720,  576},
+        {720,  720},
+        {1024, 768},
+        {1280, 720}
+};
+
+// Too small for a full vector, so only the edges and tails run
+static const int edge_sizes[][2] = {
+        {3, 3},
+        {5, 2},
+        {7, 9}
+};
+
+void *lv_mem_alloc(size_t size) {
+    return malloc(size);
+}
+
+void lv_mem_free(void *data) {
+    free(data);
+}
+
+static const int ref_bayer[4][4] = {
+        {0,  8,  2,  10},
+        {12, 4,  14, 6},
+        {3,  11, 1,  9},
+        {15, 7,  13, 5}
+};
+
+static lv_color_t ref_dither_color(lv_color_t color, int x, int y) {
+    int bayer = ref_bayer[y % 4][x % 4] - 7;
+
+    int r = LV_CLAMP(0, LV_COLOR_GET_R(color) + bayer, 255);
+    int g = LV_CLAMP(0, LV_COLOR_GET_G(color) + bayer, 255);
+    int b = LV_CLAMP(0, LV_COLOR_GET_B(color) + bayer, 255);
+
+    return lv_color_make(r, g, b);
+}
+
+// The gradient as it was built before, one float interpolation per pixel
+static void ref_generate(lv_color_t *buf, int width, int height, lv_color_t start_color, lv_color_t end_color,
+                         bool apply_dither, bool vertical, uint8_t main_stop, uint8_t grad_stop) {
+    int start_pos = (int) round(main_stop / 255.0) * (vertical ? height : width);
+    int end_pos = (int) round(grad_stop / 255.0) * (vertical ? height : width);
+
+    if (start_pos >= end_pos) {
+        start_pos = 0;
+        end_pos = vertical ? height : width;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float ratio = (float) ((vertical ? y : x) - start_pos) / (float) (end_pos - start_pos);
+            ratio = LV_CLAMP(0.0f, ratio, 1.0f);
+
+            uint8_t r = (uint8_t) ((1.0f - ratio) * LV_COLOR_GET_R(start_color) + ratio * LV_COLOR_GET_R(end_color));
+            uint8_t g = (uint8_t) ((1.0f - ratio) * LV_COLOR_GET_G(start_color) + ratio * LV_COLOR_GET_G(end_color));
+            uint8_t b = (uint8_t) ((1.0f - ratio) * LV_COLOR_GET_B(start_color) + ratio * LV_COLOR_GET_B(end_color));
+
+            lv_color_t color = lv_color_make(r, g, b);
+            buf[y * width + x] = apply_dither ? ref_dither_color(color, x, y) : color;
+        }
+    }
+}
+
+static lv_color_t box_average(const lv_color_t *buf, int width, int x, int y) {
+    int r = 0, g = 0, b = 0;
+
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            lv_color_t color = buf[(y + dy) * width + x + dx];
+            r += LV_COLOR_GET_R(color);
+            g += LV_COLOR_GET_G(color);
+            b += LV_COLOR_GET_B(color);
+        }
+    }
+
+    return lv_color_make(r / 9, g / 9, b / 9);
+}
+
+// The blur as it was before, writing each pixel back before its neighbours are read
+static void ref_blur_in_place(lv_color_t *buf, int width, int height, int passes) {
+    for (int pass = 0; pass < passes; pass++) {
+        for (int y = 1; y < height - 1; y++) {
+            for (int x = 1; x < width - 1; x++) buf[y * width + x] = box_average(buf, width, x, y);
+        }
+    }
+}
+
+// What blur_gradient is meant to compute, every pass reading only the previous one
+static void ref_blur_box(lv_color_t *buf, int width, int height, int passes) {
+    lv_color_t *input = malloc((size_t) width * height * sizeof(lv_color_t));
+    BENCH_CHECK(input != NULL);
+
+    for (int pass = 0; pass < passes; pass++) {
+        memcpy(input, buf, (size_t) width * height * sizeof(lv_color_t));
+
+        for (int y = 1; y < height - 1; y++) {
+            for (int x = 1; x < width - 1; x++) buf[y * width + x] = box_average(input, width, x, y);
+        }
+    }
+
+    free(input);
+}
+
+static int max_difference(const lv_color_t *a, const lv_color_t *b, int count) {
+    int worst = 0;
+
+    for (int i = 0; i < count; i++) {
+        BENCH_CHECK(a[i].ch.alpha == b[i].ch.alpha);
+
+        worst = LV_MAX(worst, abs(LV_COLOR_GET_R(a[i]) - LV_COLOR_GET_R(b[i])));
+        worst = LV_MAX(worst, abs(LV_COLOR_GET_G(a[i]) - LV_COLOR_GET_G(b[i])));
+        worst = LV_MAX(worst, abs(LV_COLOR_GET_B(a[i]) - LV_COLOR_GET_B(b[i])));
+    }
+
+    return worst;
+}
+
+static void check_size(int width, int height) {
+    int count = width * height;
+    size_t bytes = (size_t) count * sizeof(lv_color_t);
+
+    lv_color_t *expected = malloc(bytes);
+    lv_color_t *actual = malloc(bytes);
+    lv_color_t *in_place = malloc(bytes);
+    BENCH_CHECK(expected && actual && in_place);
+
+    lv_color_t start_color = lv_color_hex(0x102030);
+    lv_color_t end_color = lv_color_hex(0xF0A0FF);
+
+    for (int vertical = 0; vertical < 2; vertical++) {
+        for (int dither = 0; dither < 2; dither++) {
+            ref_generate(expected, width, height, start_color, end_color, dither, vertical, 0, 255);
+            generate_gradient_with_bayer_dither(actual, width, height, start_color, end_color,
+                                                dither, vertical, 0, 255);
+            BENCH_CHECK(max_difference(expected, actual, count) <= 1);
+
+            memcpy(expected, actual, bytes);
+            memcpy(in_place, actual, bytes);
+
+            ref_blur_box(expected, width, height, BLUR_PASSES);
+            ref_blur_in_place(in_place, width, height, BLUR_PASSES);
+            blur_gradient(actual, width, height, BLUR_PASSES);
+
+            BENCH_CHECK(memcmp(expected, actual, bytes) == 0);
+            in_place_difference = LV_MAX(in_place_difference, max_difference(in_place, actual, count));
+        }
+    }
+
+    free(expected);
+    free(actual);
+    free(in_place);
+}
+
+static void time_size(int width, int height) {
+    lv_color_t *buf = malloc((size_t) width * height * sizeof(lv_color_t));
+    BENCH_CHECK(buf != NULL);
+
+    lv_color_t start_color = lv_color_hex(0x000000);
+    lv_color_t end_color = lv_color_hex(0xFFFFFF);
+    double best[4] = {1e9, 1e9, 1e9, 1e9};
+
+    for (int run = 0; run < RUNS; run++) {
+        double start = bench_now();
+        ref_generate(buf, width, height, start_color, end_color, true, false, 0, 255);
+        best[0] = LV_MIN(best[0], bench_now() - start);
+
+        start = bench_now();
+        generate_gradient_with_bayer_dither(buf, width, height, start_color, end_color, true, false, 0, 255);
+        best[1] = LV_MIN(best[1], bench_now() - start);
+
+        start = bench_now();
+        ref_blur_in_place(buf, width, height, 2);
+        best[2] = LV_MIN(best[2], bench_now() - start);
+
+        start = bench_now();
+        blur_gradient(buf, width, height, 2);
+        best[3] = LV_MIN(best[3], bench_now() - start);
+    }
+
+    printf("  %dx%d, best of %d\n", width, height, RUNS);
+    bench_report("dithered gradient, per pixel float", best[0]);
+    bench_report("dithered gradient, repeated rows", best[1]);
+    bench_report("two pass blur, in place", best[2]);
+    bench_report("two pass blur, running sums", best[3]);
+
+    free(buf);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++) {
+        check_size(resolutions[i][0], resolutions[i][1]);
+    }
+    for (size_t i = 0; i < sizeof(edge_sizes) / sizeof(edge_sizes[0]); i++) {
+        check_size(edge_sizes[i][0], edge_sizes[i][1]);
+    }
+
+#if defined(__ARM_NEON)
+    printf("  NEON kernels match the scalar reference\n");
+#else
+    printf("  Portable kernels match the scalar reference\n");
+#endif
+    printf("  %d blur passes differ from the old in place blur by up to %d levels\n",
+           BLUR_PASSES, in_place_difference);
+
+    for (size_t i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++) {
+        time_size(resolutions[i][0], resolutions[i][1]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+/*
+ * Replays random input traces through the hotkey combo and sequence lookups
+ * and checks every answer against the linear scans they replaced, which are
+ * kept below as they were in input.c and muhotkey. The timed replay uses a
+ * hotkey table about the size muhotkey loads and trims the sequence buffer
+ * the way it does.
+ */
+
+#include "bench.h"
+#include "input_match.h"
+
+#define CHECK_ROUNDS 20000
+#define REPLAY_PRESSES 2000000
+#define SEQUENCE_BUFFER 16
+#define SEQUENCE_WIN(count) (400 + 150 * (count))
+
+typedef struct {
+    int is_sequence;
+    int sequence_inputs[INPUT_SEQUENCE_MAX];
+    int sequence_length;
+    uint32_t max_interval;
+} combo_config;
+
+static combo_config combo[MUX_INPUT_COMBO_COUNT];
+static int combo_count;
+
+static struct {
+    int inputs[SEQUENCE_BUFFER];
+    uint32_t time[SEQUENCE_BUFFER];
+    int count;
+} seq_buf;
+
+static input_sequence_trie sequence_trie;
+static input_combo_lookup combo_lookup;
+static volatile int replay_sink;
+
+static int old_match_sequence(void) {
+    for (int i = 0; i < combo_count; ++i) {
+        combo_config *c = &combo[i];
+        if (!c->is_sequence) continue;
+        if (c->sequence_length > seq_buf.count) continue;
+
+        int match = 1;
+        uint32_t prev_time = 0;
+
+        for (int j = 0; j < c->sequence_length; ++j) {
+            int idx = seq_buf.count - c->sequence_length + j;
+
+            if (seq_buf.inputs[idx] != c->sequence_inputs[j]) {
+                match = 0;
+                break;
+            }
+
+            if (c->max_interval && j > 0) {
+                uint32_t delta = seq_buf.time[idx] - prev_time;
+                if (delta > c->max_interval) {
+                    match = 0;
+                    break;
+                }
+            }
+            prev_time = seq_buf.time[idx];
+        }
+
+        if (match) return i;
+    }
+
+    return -1;
+}
+
+static int old_find_combo(const mux_input_combo *combos, uint64_t pressed) {
+    for (int i = 0; i < MUX_INPUT_COMBO_COUNT; ++i) {
+        uint64_t mask = combos[i].type_mask;
+        if (mask && (pressed & mask) == mask) return i;
+    }
+
+    return MUX_INPUT_COMBO_COUNT;
+}
+
+static void compile_sequences(void) {
+    input_sequence_init(&sequence_trie);
+
+    for (int i = 0; i < combo_count; ++i) {
+        const combo_config *c = &combo[i];
+        if (c->is_sequence) input_sequence_add(&sequence_trie, i, c->sequence_inputs, c->sequence_length, c->max_interval);
+    }
+}
+
+// Small alphabets and short gaps so that sequences actually match now and then
+static void check_random(void) {
+    long matched = 0;
+    srand(1);
+
+    for (int round = 0; round < CHECK_ROUNDS; round++) {
+        combo_count = 1 + rand() % MUX_INPUT_COMBO_COUNT;
+
+        for (int i = 0; i < combo_count; i++) {
+            combo[i].is_sequence = rand() % 4 != 0;
+            combo[i].sequence_length = rand() % 200 == 0 ? 0 : 1 + rand() % 4;
+            for (int j = 0; j < combo[i].sequence_length; j++) combo[i].sequence_inputs[j] = rand() % 4;
+            combo[i].max_interval = rand() % 2 ? 0 : 50 + rand() % 300;
+        }
+
+        compile_sequences();
+
+        for (int k = 0; k < 20; k++) {
+            uint32_t tick = 0;
+            seq_buf.count = rand() % (INPUT_SEQUENCE_MAX + 1);
+
+            for (int j = 0; j < seq_buf.count; j++) {
+                tick += rand() % 400;
+                seq_buf.inputs[j] = rand() % 4;
+                seq_buf.time[j] = tick;
+            }
+
+            int expected = old_match_sequence();
+            BENCH_CHECK(input_sequence_match(&sequence_trie, seq_buf.inputs, seq_buf.time, seq_buf.count) == expected);
+            matched += expected != -1;
+        }
+
+        mux_input_combo combos[MUX_INPUT_COMBO_COUNT];
+        memset(combos, 0, sizeof(combos));
+
+        for (int i = 0; i < MUX_INPUT_COMBO_COUNT; i++) {
+            if (rand() % 3) continue;
+            combos[i].type_mask = ((uint64_t) rand() & rand() & 0xff) | ((uint64_t) (rand() % 2) << 40);
+        }
+
+        input_combo_init(&combo_lookup, combos);
+
+        for (int k = 0; k < 50; k++) {
+            uint64_t pressed = (uint64_t) rand() & 0x1ff;
+            if (rand() % 2) pressed |= 1ULL << 40;
+
+            BENCH_CHECK(input_combo_find(&combo_lookup, pressed) == old_find_combo(combos, pressed));
+        }
+    }
+
+    printf("  %d random tables agree with the linear scans, %ld sequence matches\n", CHECK_ROUNDS, matched);
+}
+
+// Same trimming as record_sequence in muhotkey, dropping the oldest press should the buffer fill up
+static void record_sequence(int type, uint32_t tick) {
+    if (seq_buf.count == SEQUENCE_BUFFER) {
+        memmove(seq_buf.inputs, seq_buf.inputs + 1, (SEQUENCE_BUFFER - 1) * sizeof(int));
+        memmove(seq_buf.time, seq_buf.time + 1, (SEQUENCE_BUFFER - 1) * sizeof(uint32_t));
+        seq_buf.count--;
+    }
+
+    seq_buf.inputs[seq_buf.count] = type;
+    seq_buf.time[seq_buf.count] = tick;
+    seq_buf.count++;
+
+    int new_count = 0;
+    for (int i = 0; i < seq_buf.count; ++i) {
+        if (tick - seq_buf.time[i] <= SEQUENCE_WIN(seq_buf.count)) {
+            seq_buf.inputs[new_count] = seq_buf.inputs[i];
+            seq_buf.time[new_count++] = seq_buf.time[i];
+        }
+    }
+    seq_buf.count = new_count;
+}
+
+static double replay_sequences(const int *types, const uint32_t *ticks, bool compiled) {
+    seq_buf.count = 0;
+    int found = 0;
+
+    double start = bench_now();
+    for (int i = 0; i < REPLAY_PRESSES; i++) {
+        record_sequence(types[i], ticks[i]);
+
+        int match = compiled ? input_sequence_match(&sequence_trie, seq_buf.inputs, seq_buf.time, seq_buf.count)
+                             : old_match_sequence();
+        if (match != -1) {
+            found++;
+            seq_buf.count = 0;
+        }
+    }
+    double elapsed = bench_now() - start;
+
+    replay_sink = found;
+    return elapsed;
+}
+
+static double replay_combos(const mux_input_combo *combos, const uint64_t *pressed, bool compiled) {
+    int found = 0;
+
+    double start = bench_now();
+    for (int i = 0; i < REPLAY_PRESSES; i++) {
+        found += compiled ? input_combo_find(&combo_lookup, pressed[i]) : old_find_combo(combos, pressed[i]);
+    }
+    double elapsed = bench_now() - start;
+
+    replay_sink = found;
+    return elapsed;
+}
+
+static void replay(void) {
+    // Twelve sequences of three to six presses and twenty held combos, all over the D-pad and face buttons
+    srand(2);
+    combo_count = MUX_INPUT_COMBO_COUNT;
+
+    mux_input_combo combos[MUX_INPUT_COMBO_COUNT];
+    memset(combos, 0, sizeof(combos));
+
+    for (int i = 0; i < combo_count; i++) {
+        combo[i].is_sequence = i % 8 < 3;
+        combo[i].sequence_length = 3 + rand() % 4;
+        for (int j = 0; j < combo[i].sequence_length; j++) combo[i].sequence_inputs[j] = rand() % 8;
+        combo[i].max_interval = rand() % 3 ? 300 : 0;
+
+        if (!combo[i].is_sequence) combos[i].type_mask = (1ULL << (8 + rand() % 8)) | (1ULL << (rand() % 8));
+    }
+
+    compile_sequences();
+    input_combo_init(&combo_lookup, combos);
+
+    int *types = malloc(REPLAY_PRESSES * sizeof(int));
+    uint32_t *ticks = malloc(REPLAY_PRESSES * sizeof(uint32_t));
+    uint64_t *pressed = malloc(REPLAY_PRESSES * sizeof(uint64_t));
+    BENCH_CHECK(types && ticks && pressed);
+
+    uint32_t tick = 0;
+    for (int i = 0; i < REPLAY_PRESSES; i++) {
+        tick += 40 + rand() % 260;
+        types[i] = rand() % 8;
+        ticks[i] = tick;
+        pressed[i] = (1ULL << (rand() % 16)) | (rand() % 4 ? 0 : 1ULL << (8 + rand() % 8));
+    }
+
+    double old_sequences = replay_sequences(types, ticks, false);
+    int old_found = replay_sink;
+    double new_sequences = replay_sequences(types, ticks, true);
+    BENCH_CHECK(replay_sink == old_found);
+
+    double old_combos = replay_combos(combos, pressed, false);
+    old_found = replay_sink;
+    double new_combos = replay_combos(combos, pressed, true);
+    BENCH_CHECK(replay_sink == old_found);
+
+    printf("  %d presses against %d sequences and %d combos\n", REPLAY_PRESSES,
+           MUX_INPUT_COMBO_COUNT - combo_lookup.list_count, combo_lookup.list_count);
+    bench_report("sequences, scan every combo", old_sequences);
+    bench_report("sequences, trie", new_sequences);
+    bench_report("held combos, scan every mask", old_combos);
+    bench_report("held combos, cached lookup", new_combos);
+
+    free(types);
+    free(ticks);
+    free(pressed);
+}
+
+int main(void) {
+    check_random();
+    replay();
+
+    return 0;
+}
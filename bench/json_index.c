@@ -0,0 +1,146 @@
+/*
+ * Walks a search result document the way muxsearch used to, indexing the
+ * array by position and looking up every key from the start of its object,
+ * and the way it does now with json_array_each and json_object_pick. Both
+ * must copy out the same strings. The second half looks up every key of a
+ * large object through json_index and through json_object_get, covering
+ * escaped keys, missing keys and duplicates where the first one wins.
+ */
+
+#include "bench.h"
+#include "json/json.h"
+#include "json_index.h"
+
+#define RESULTS 5000
+#define KEYS 3000
+#define DOCUMENT_SIZE (4 * 1024 * 1024)
+
+static char *document;
+
+static void build_results(void) {
+    size_t length = 0;
+
+    length += snprintf(document + length, DOCUMENT_SIZE - length,
+                       "{\"lookup\":\"game\",\"directories\":[],\"folders\":{\"/mnt/mmc/ROMS/A\":{\"content\":[");
+
+    for (int i = 0; i < RESULTS; i++) {
+        length += snprintf(document + length, DOCUMENT_SIZE - length,
+                           "%s{\"file\":\"game %d.zip\",\"extra\":[1,{\"a\":2}],\"name\":\"Game \\\"%d\\\"\"}",
+                           i ? "," : "", i, i);
+    }
+
+    snprintf(document + length, DOCUMENT_SIZE - length, "]}}}");
+}
+
+static void check_results(double *indexed, double *walked) {
+    build_results();
+
+    struct json root = json_parse(document);
+    struct json folder = json_object_get(json_object_get(root, "folders"), "/mnt/mmc/ROMS/A");
+    struct json content = json_object_get(folder, "content");
+    BENCH_CHECK(json_array_count(content) == RESULTS);
+
+    static char files[RESULTS][32];
+    static char names[RESULTS][32];
+
+    double start = bench_now();
+    for (size_t i = 0; i < json_array_count(content); i++) {
+        struct json item = json_array_get(content, i);
+
+        json_string_copy(json_object_get(item, "file"), files[i], sizeof(files[i]));
+        json_string_copy(json_object_get(item, "name"), names[i], sizeof(names[i]));
+    }
+    *indexed = bench_now() - start;
+
+    static const char *const keys[] = {"file", "name", "missing"};
+    struct json values[3];
+    size_t i = 0;
+
+    start = bench_now();
+    json_array_each(item, content) {
+        char file[32], name[32];
+
+        json_object_pick(item, keys, values, 3);
+        json_string_copy(values[0], file, sizeof(file));
+        json_string_copy(values[1], name, sizeof(name));
+
+        BENCH_CHECK(i < RESULTS && strcmp(file, files[i]) == 0 && strcmp(name, names[i]) == 0);
+        BENCH_CHECK(!json_exists(values[2]));
+        i++;
+    }
+    *walked = bench_now() - start;
+
+    BENCH_CHECK(i == RESULTS);
+    BENCH_CHECK(strcmp(names[7], "Game \"7\"") == 0);
+}
+
+static void build_object(void) {
+    size_t length = 0;
+    length += snprintf(document + length, DOCUMENT_SIZE - length, "{");
+
+    for (int i = 0; i < KEYS; i++) {
+        length += snprintf(document + length, DOCUMENT_SIZE - length, "%s\"key_%d\":\"v%d\"", i ? "," : "", i, i);
+    }
+
+    snprintf(document + length, DOCUMENT_SIZE - length, ",\"esc\\u0041pe\":\"E\",\"key_5\":\"duplicate\"}");
+}
+
+static void check_index(double *indexed, double *scanned) {
+    build_object();
+
+    struct json root = json_parse(document);
+    json_index index;
+    BENCH_CHECK(json_index_build(&index, root));
+
+    static char expected[KEYS][16];
+    char key[32], value[32];
+
+    double start = bench_now();
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "key_%d", i);
+        json_string_copy(json_object_get(root, key), expected[i], sizeof(expected[i]));
+    }
+    *scanned = bench_now() - start;
+
+    start = bench_now();
+    for (int i = 0; i < KEYS; i++) {
+        snprintf(key, sizeof(key), "key_%d", i);
+        json_string_copy(json_index_get(&index, key), value, sizeof(value));
+
+        BENCH_CHECK(strcmp(value, expected[i]) == 0);
+    }
+    *indexed = bench_now() - start;
+
+    BENCH_CHECK(strcmp(expected[5], "v5") == 0);
+
+    json_string_copy(json_index_get(&index, "escApe"), value, sizeof(value));
+    BENCH_CHECK(strcmp(value, "E") == 0);
+    BENCH_CHECK(!json_exists(json_index_get(&index, "missing")));
+
+    int pairs = 0;
+    json_pair pair;
+    for (bool more = json_pair_first(root, &pair); more; more = json_pair_next(&pair)) pairs++;
+    BENCH_CHECK(pairs == KEYS + 2);
+
+    json_index_free(&index);
+}
+
+int main(void) {
+    document = malloc(DOCUMENT_SIZE);
+    BENCH_CHECK(document != NULL);
+
+    double by_position, by_cursor, by_index, by_scan;
+    check_results(&by_position, &by_cursor);
+    check_index(&by_index, &by_scan);
+
+    printf("  %d search results, two keys each\n", RESULTS);
+    bench_report("json_array_get and json_object_get", by_position);
+    bench_report("json_array_each and json_object_pick", by_cursor);
+
+    printf("  %d lookups on an object of %d keys\n", KEYS, KEYS + 2);
+    bench_report("json_object_get", by_scan);
+    bench_report("json_index_get", by_index);
+
+    free(document);
+    return 0;
+}
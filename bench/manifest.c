@@ -0,0 +1,388 @@
+/*
+ * Lists a generated application folder through the manifest cache and
+ * checks names, grid names and icons against the reads muxapp used to do
+ * for every application on every visit: a probe for its launcher, its
+ * translation file parsed when it has one, otherwise the launcher opened
+ * for its GRID header, and the launcher opened again for its ICON header.
+ * It then times a load with no cache, with a warm one and after two
+ * applications changed, and checks a task folder the same way.
+ *
+ * Cached manifests live under MANIFEST_CACHE_PATH, keyed by folder, so the
+ * ones this makes are its own. They are removed again on exit, along with
+ * any part of that path that had to be created.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "common.h"
+#include "language.h"
+#include "options.h"
+#include "manifest.h"
+#include "mini/mini.h"
+
+#define APPS 150
+#define TASKS 40
+#define FILLER_LINES 60
+#define MAX_CREATED 16
+
+char mux_module[MAX_BUFFER_SIZE] = "bench";
+
+struct mux_lang lang;
+
+typedef struct {
+    char full[MAX_BUFFER_SIZE];
+    char grid[MAX_BUFFER_SIZE];
+    char icon[MAX_BUFFER_SIZE];
+} app_names;
+
+static char *created[MAX_CREATED];
+static int created_count;
+
+static char app_cache[PATH_MAX];
+static char task_cache[PATH_MAX];
+
+uint32_t fnv1a_hash_str(const char *str) {
+    uint32_t hash = 2166136261U;
+
+    for (const char *p = str; *p; p++) {
+        hash ^= (uint8_t) (*p);
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+void create_directories(const char *path) {
+    char command[PATH_MAX * 2];
+    snprintf(command, sizeof(command), "mkdir -p '%s'", path);
+    BENCH_CHECK(system(command) == 0);
+}
+
+char *get_script_value(const char *filename, const char *key, const char *not_found) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) return strdup("");
+
+    char line[MAX_BUFFER_SIZE];
+    char search_key[MAX_BUFFER_SIZE];
+    snprintf(search_key, sizeof(search_key), "# %s: ", key);
+
+    char *value = NULL;
+
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, search_key, strlen(search_key)) == 0) {
+            value = strdup(line + strlen(search_key));
+            if (value) value[strcspn(value, "\n")] = 0;
+            break;
+        }
+    }
+
+    fclose(file);
+
+    if (value == NULL || value[0] == '\0') value = strdup(not_found);
+    return value;
+}
+
+// Creates every missing folder on the way to path, remembering them so they can go again
+static bool make_path(const char *path) {
+    char partial[PATH_MAX];
+    snprintf(partial, sizeof(partial), "%s", path);
+
+    for (char *slash = partial + 1;; slash++) {
+        if (*slash != '/' && *slash != '\0') continue;
+
+        char was = *slash;
+        *slash = '\0';
+
+        if (mkdir(partial, 0755) == 0) {
+            if (created_count == MAX_CREATED) return false;
+            created[created_count++] = strdup(partial);
+        } else if (errno != EEXIST) {
+            return false;
+        }
+
+        if (!was) return true;
+        *slash = was;
+    }
+}
+
+static void remove_cache(void) {
+    if (app_cache[0]) remove(app_cache);
+    if (task_cache[0]) remove(task_cache);
+
+    while (created_count) {
+        rmdir(created[--created_count]);
+        free(created[created_count]);
+    }
+}
+
+static void write_file(const char *path, const char *content) {
+    FILE *file = fopen(path, "w");
+    BENCH_CHECK(file != NULL);
+    fputs(content, file);
+    fclose(file);
+}
+
+static void write_script(const char *path, const char *grid, const char *icon, const char *help) {
+    FILE *file = fopen(path, "w");
+    BENCH_CHECK(file != NULL);
+
+    fputs("#!/bin/sh\n", file);
+    if (grid) fprintf(file, "# GRID: %s\n", grid);
+    if (icon) fprintf(file, "# ICON: %s\n", icon);
+    if (help) fprintf(file, "# HELP: %s\n", help);
+
+    for (int i = 0; i < FILLER_LINES; i++) fputs("# a comment line that is not a header\n", file);
+    fputs("echo\n", file);
+
+    fclose(file);
+}
+
+// Half the applications are translated, every third has no icon and every fifth no grid header
+static void build_apps(const char *apps) {
+    char path[PATH_MAX + 64], value[3][64];
+
+    for (int i = 0; i < APPS; i++) {
+        snprintf(path, sizeof(path), "%s/App%03d", apps, i);
+        BENCH_CHECK(mkdir(path, 0755) == 0);
+
+        snprintf(value[0], sizeof(value[0]), "G%d", i);
+        snprintf(value[1], sizeof(value[1]), "icon%d", i);
+        snprintf(value[2], sizeof(value[2]), "Script help %d", i);
+
+        snprintf(path, sizeof(path), "%s/App%03d/" APP_LAUNCHER, apps, i);
+        write_script(path, i % 5 ? value[0] : NULL, i % 3 ? value[1] : NULL, value[2]);
+
+        if (i % 2) continue;
+
+        char ini[256];
+        snprintf(ini, sizeof(ini), "[full]\nEnglish=Full %d\nFrench=Plein %d\n[grid]\nEnglish=Grid %d\n"
+                                   "[help]\nEnglish=Help for %d\n", i, i, i, i);
+
+        snprintf(path, sizeof(path), "%s/App%03d/" APP_LANGUAGE, apps, i);
+        write_file(path, ini);
+    }
+
+    // A folder without a launcher is not an application
+    snprintf(path, sizeof(path), "%s/NoLauncher", apps);
+    BENCH_CHECK(mkdir(path, 0755) == 0);
+}
+
+static void build_tasks(const char *tasks) {
+    char path[PATH_MAX + 64], icon[32], help[32];
+
+    for (int i = 0; i < TASKS; i++) {
+        snprintf(icon, sizeof(icon), "task%d", i);
+        snprintf(help, sizeof(help), "Task help %d", i);
+
+        snprintf(path, sizeof(path), "%s/Task %d.sh", tasks, i);
+        write_script(path, NULL, i % 4 ? icon : NULL, help);
+    }
+
+    snprintf(path, sizeof(path), "%s/notes.txt", tasks);
+    write_file(path, "not a script\n");
+}
+
+// What create_app_items did for the applications in one base folder
+static size_t old_names(const char *apps, app_names names[]) {
+    char (*found)[NAME_MAX + 1] = malloc(APPS * 2 * sizeof(*found));
+    BENCH_CHECK(found != NULL);
+
+    size_t count = 0;
+
+    DIR *dir = opendir(apps);
+    BENCH_CHECK(dir != NULL);
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_type != DT_DIR || entry->d_name[0] == '.') continue;
+
+        char launcher[PATH_MAX * 2];
+        snprintf(launcher, sizeof(launcher), "%s/%s/" APP_LAUNCHER, apps, entry->d_name);
+        if (access(launcher, F_OK) == 0) snprintf(found[count++], sizeof(found[0]), "%s", entry->d_name);
+    }
+    closedir(dir);
+
+    for (size_t i = 0; i < count; i++) {
+        const char *name = found[i];
+        int app = atoi(name + 3);
+
+        // get_app_base probed for the launcher once more
+        char launcher[PATH_MAX * 2];
+        snprintf(launcher, sizeof(launcher), "%s/%s/" APP_LAUNCHER, apps, name);
+        BENCH_CHECK(access(launcher, F_OK) == 0);
+
+        char language[PATH_MAX * 2];
+        snprintf(language, sizeof(language), "%s/%s/" APP_LANGUAGE, apps, name);
+
+        app_names *names_at = &names[app];
+
+        if (access(language, F_OK) == 0) {
+            mini_t *ini = mini_load(language);
+            snprintf(names_at->full, sizeof(names_at->full), "%s", mini_get_string(ini, "full", "English", name));
+            snprintf(names_at->grid, sizeof(names_at->grid), "%s", mini_get_string(ini, "grid", "English", name));
+            mini_free(ini);
+        } else {
+            snprintf(names_at->full, sizeof(names_at->full), "%s", name);
+
+            char *grid = get_script_value(launcher, "GRID", name);
+            snprintf(names_at->grid, sizeof(names_at->grid), "%s", grid);
+            free(grid);
+        }
+
+        char *icon = get_script_value(launcher, "ICON", "app");
+        snprintf(names_at->icon, sizeof(names_at->icon), "%s", icon);
+        free(icon);
+    }
+
+    free(found);
+    return count;
+}
+
+// The same names resolved the way muxapp now does through the manifest
+static void check_manifest(const manifest *apps, const app_names names[]) {
+    BENCH_CHECK(manifest_count(apps) == APPS);
+
+    for (size_t i = 0; i < manifest_count(apps); i++) {
+        manifest_item item;
+        BENCH_CHECK(manifest_item_at(apps, i, &item));
+
+        const app_names *expected = &names[atoi(item.name + 3)];
+
+        const char *full = manifest_translation(apps, &item, MANIFEST_FULL, "English");
+        const char *grid = manifest_translation(apps, &item, MANIFEST_GRID, "English");
+
+        if (!item.translated) {
+            full = NULL;
+            grid = item.grid[0] ? item.grid : NULL;
+        }
+
+        BENCH_CHECK(strcmp(full ? full : item.name, expected->full) == 0);
+        BENCH_CHECK(strcmp(grid ? grid : item.name, expected->grid) == 0);
+        BENCH_CHECK(strcmp(item.icon[0] ? item.icon : "app", expected->icon) == 0);
+    }
+
+    manifest_item item;
+    BENCH_CHECK(!manifest_find(apps, "NoLauncher", &item));
+
+    BENCH_CHECK(manifest_find(apps, "App004", &item) && item.translated);
+    BENCH_CHECK(strcmp(manifest_translation(apps, &item, MANIFEST_FULL, "French"), "Plein 4") == 0);
+    BENCH_CHECK(strcmp(manifest_translation(apps, &item, MANIFEST_HELP, "English"), "Help for 4") == 0);
+    BENCH_CHECK(manifest_translation(apps, &item, MANIFEST_GRID, "German") == NULL);
+
+    BENCH_CHECK(manifest_find(apps, "App007", &item) && !item.translated);
+    BENCH_CHECK(strcmp(item.help, "Script help 7") == 0);
+}
+
+static void check_tasks(const char *tasks) {
+    manifest *scripts = manifest_load(tasks, MANIFEST_SCRIPTS);
+    BENCH_CHECK(scripts != NULL && manifest_count(scripts) == TASKS);
+
+    for (int i = 0; i < TASKS; i++) {
+        char name[32], path[PATH_MAX + 64];
+        snprintf(name, sizeof(name), "Task %d", i);
+        snprintf(path, sizeof(path), "%s/%s.sh", tasks, name);
+
+        manifest_item item;
+        BENCH_CHECK(manifest_find(scripts, name, &item));
+
+        char *icon = get_script_value(path, "ICON", "");
+        char *help = get_script_value(path, "HELP", "");
+
+        BENCH_CHECK(strcmp(item.icon, icon) == 0 && strcmp(item.help, help) == 0);
+
+        free(icon);
+        free(help);
+    }
+
+    manifest_free(scripts);
+}
+
+static manifest *timed_load(const char *apps, double *elapsed) {
+    double start = bench_now();
+    manifest *loaded = manifest_load(apps, MANIFEST_APPS);
+    *elapsed = bench_now() - start;
+
+    BENCH_CHECK(loaded != NULL);
+    return loaded;
+}
+
+int main(void) {
+    char apps[PATH_MAX], tasks[PATH_MAX];
+    snprintf(apps, sizeof(apps), "%s/application", bench_dir());
+    snprintf(tasks, sizeof(tasks), "%s/task", bench_dir());
+
+    snprintf(app_cache, sizeof(app_cache), "%s/app-%08x.db", MANIFEST_CACHE_PATH, fnv1a_hash_str(apps));
+    snprintf(task_cache, sizeof(task_cache), "%s/script-%08x.db", MANIFEST_CACHE_PATH, fnv1a_hash_str(tasks));
+
+    atexit(remove_cache);
+
+    if (!make_path(MANIFEST_CACHE_PATH)) {
+        printf("  Skipped, unable to create %s\n", MANIFEST_CACHE_PATH);
+        return 0;
+    }
+
+    BENCH_CHECK(mkdir(apps, 0755) == 0 && mkdir(tasks, 0755) == 0);
+    build_apps(apps);
+    build_tasks(tasks);
+
+    static app_names names[APPS];
+
+    double start = bench_now();
+    BENCH_CHECK(old_names(apps, names) == APPS);
+    double old_time = bench_now() - start;
+
+    double cold, warm, changed;
+
+    manifest *loaded = timed_load(apps, &cold);
+    check_manifest(loaded, names);
+    manifest_free(loaded);
+
+    struct stat before, after;
+    BENCH_CHECK(stat(app_cache, &before) == 0);
+
+    loaded = timed_load(apps, &warm);
+    check_manifest(loaded, names);
+    manifest_free(loaded);
+
+    // Nothing changed, so the cache must not have been rewritten
+    BENCH_CHECK(stat(app_cache, &after) == 0);
+    BENCH_CHECK(before.st_ino == after.st_ino && before.st_mtim.tv_nsec == after.st_mtim.tv_nsec);
+
+    printf("  %d applications, names, grid names and icons match the per app reads\n", APPS);
+
+    char path[PATH_MAX + 64];
+    usleep(20000);
+
+    snprintf(path, sizeof(path), "%s/App005/" APP_LAUNCHER, apps);
+    write_script(path, "Changed grid", "changed_icon", NULL);
+
+    snprintf(path, sizeof(path), "%s/App010/" APP_LANGUAGE, apps);
+    write_file(path, "[full]\nEnglish=Changed 10\n");
+
+    loaded = timed_load(apps, &changed);
+
+    manifest_item item;
+    BENCH_CHECK(manifest_find(loaded, "App005", &item));
+    BENCH_CHECK(strcmp(item.grid, "Changed grid") == 0 && strcmp(item.icon, "changed_icon") == 0 && !item.help[0]);
+
+    BENCH_CHECK(manifest_find(loaded, "App010", &item));
+    BENCH_CHECK(strcmp(manifest_translation(loaded, &item, MANIFEST_FULL, "English"), "Changed 10") == 0);
+    BENCH_CHECK(manifest_translation(loaded, &item, MANIFEST_GRID, "English") == NULL);
+    manifest_free(loaded);
+
+    check_tasks(tasks);
+    BENCH_CHECK(manifest_load("/nonexistent/application", MANIFEST_APPS) == NULL);
+
+    printf("  Changed applications read again, %d task scripts match their headers\n", TASKS);
+    bench_report("per app reads", old_time);
+    bench_report("manifest_load, no cache", cold);
+    bench_report("manifest_load, warm cache", warm);
+    bench_report("manifest_load, two apps changed", changed);
+
+    bench_cleanup();
+    return 0;
+}
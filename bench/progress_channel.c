@@ -0,0 +1,198 @@
+/*
+ * Checks how the progress channel parses records and measures how long an
+ * update takes to reach muxmessage. Over the socket a record wakes the epoll
+ * loop as soon as it is sent. The legacy loop it replaced only noticed a new
+ * value in the progress file on its next once a second poll, so a handful of
+ * updates are timed that way too, which takes a few seconds of wall time.
+ */
+
+#include <limits.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "common.h"
+#include "progress_channel.h"
+
+#define SOCKET_RECORDS 100
+#define SOCKET_SPACING_US 2000
+#define LEGACY_RECORDS 4
+#define LEGACY_SPACING_US 1300000
+#define LEGACY_POLL_US 1000000
+
+char mux_module[MAX_BUFFER_SIZE] = "bench";
+
+static double sent_at[SOCKET_RECORDS];
+static char legacy_file[PATH_MAX];
+
+int safe_atoi(const char *str) {
+    if (str == NULL) return 0;
+
+    errno = 0;
+    char *str_ptr;
+    long val = strtol(str, &str_ptr, 10);
+
+    if (str_ptr == str) return 0;
+    if (*str_ptr != '\0') return 0;
+    if ((errno == ERANGE && (val == LONG_MAX || val == LONG_MIN)) || (val > INT_MAX || val < INT_MIN)) return 0;
+
+    return (int) val;
+}
+
+static void check_records(int fd) {
+    BENCH_CHECK(progress_channel_send("progress 142"));
+    BENCH_CHECK(progress_channel_send("progress -3"));
+    BENCH_CHECK(progress_channel_send("message Copying\\nsaves"));
+    BENCH_CHECK(progress_channel_send("rewind"));
+    BENCH_CHECK(progress_channel_send("FINISH"));
+
+    progress_record record;
+
+    BENCH_CHECK(progress_channel_read(fd, &record) && record.type == PROGRESS_VALUE && record.value == 100);
+    BENCH_CHECK(progress_channel_read(fd, &record) && record.type == PROGRESS_VALUE && record.value == 0);
+    BENCH_CHECK(progress_channel_read(fd, &record) && record.type == PROGRESS_MESSAGE);
+    BENCH_CHECK(strcmp(record.message, "Copying\\nsaves") == 0);
+
+    // Unknown records are skipped rather than ending the read
+    BENCH_CHECK(progress_channel_read(fd, &record) && record.type == PROGRESS_FINISH);
+    BENCH_CHECK(!progress_channel_read(fd, &record));
+}
+
+static void *socket_writer(void *arg) {
+    (void) arg;
+
+    for (int i = 0; i < SOCKET_RECORDS; i++) {
+        usleep(SOCKET_SPACING_US);
+
+        char record[32];
+        snprintf(record, sizeof(record), "progress %d", i);
+
+        sent_at[i] = bench_now();
+        BENCH_CHECK(progress_channel_send(record));
+    }
+
+    return NULL;
+}
+
+static void measure_socket(int fd, double *average, double *worst) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    BENCH_CHECK(epoll_fd >= 0);
+
+    struct epoll_event event = {.events = EPOLLIN, .data.fd = fd};
+    BENCH_CHECK(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0);
+
+    pthread_t writer;
+    BENCH_CHECK(pthread_create(&writer, NULL, socket_writer, NULL) == 0);
+
+    int received = 0;
+    double total = 0;
+    *worst = 0;
+
+    while (received < SOCKET_RECORDS) {
+        BENCH_CHECK(epoll_wait(epoll_fd, &event, 1, 5000) == 1);
+
+        progress_record record;
+        while (progress_channel_read(fd, &record)) {
+            double latency = bench_now() - sent_at[record.value];
+
+            BENCH_CHECK(record.type == PROGRESS_VALUE && record.value == received);
+            total += latency;
+            if (latency > *worst) *worst = latency;
+            received++;
+        }
+    }
+
+    pthread_join(writer, NULL);
+    close(epoll_fd);
+
+    *average = total / SOCKET_RECORDS;
+}
+
+static void *legacy_writer(void *arg) {
+    (void) arg;
+
+    for (int i = 1; i <= LEGACY_RECORDS; i++) {
+        usleep(LEGACY_SPACING_US);
+
+        char temp[PATH_MAX + 8];
+        snprintf(temp, sizeof(temp), "%s.tmp", legacy_file);
+
+        FILE *file = fopen(temp, "w");
+        BENCH_CHECK(file != NULL);
+        fprintf(file, "%d\n", i);
+        fclose(file);
+
+        sent_at[i] = bench_now();
+        BENCH_CHECK(rename(temp, legacy_file) == 0);
+    }
+
+    return NULL;
+}
+
+// The loop muxmessage ran before: check the file, read its first line, sleep a second
+static void measure_legacy(double *average, double *worst) {
+    snprintf(legacy_file, sizeof(legacy_file), "%s/msg_progress", bench_dir());
+
+    pthread_t writer;
+    BENCH_CHECK(pthread_create(&writer, NULL, legacy_writer, NULL) == 0);
+
+    int seen = 0;
+    double total = 0;
+    *worst = 0;
+
+    while (seen < LEGACY_RECORDS) {
+        struct stat st;
+
+        if (stat(legacy_file, &st) == 0) {
+            FILE *file = fopen(legacy_file, "r");
+            int value = 0;
+
+            if (file) {
+                if (fscanf(file, "%d", &value) != 1) value = 0;
+                fclose(file);
+            }
+
+            for (; seen < value; seen++) {
+                // Values overwritten before a poll saw them are counted from when they were replaced
+                double latency = bench_now() - sent_at[seen + 1];
+
+                total += latency;
+                if (latency > *worst) *worst = latency;
+            }
+        }
+
+        if (seen < LEGACY_RECORDS) usleep(LEGACY_POLL_US);
+    }
+
+    pthread_join(writer, NULL);
+    *average = total / LEGACY_RECORDS;
+}
+
+int main(void) {
+    int fd = progress_channel_open();
+    BENCH_CHECK(fd >= 0);
+
+    check_records(fd);
+
+    double socket_average, socket_worst;
+    measure_socket(fd, &socket_average, &socket_worst);
+
+    progress_channel_close(fd);
+    BENCH_CHECK(!progress_channel_send("finish"));
+
+    printf("  Records parse as expected, sending with nothing listening fails\n");
+
+    double legacy_average, legacy_worst;
+    measure_legacy(&legacy_average, &legacy_worst);
+
+    printf("  Time from an update being sent to muxmessage reading it\n");
+    bench_report("socket and epoll, average", socket_average);
+    bench_report("socket and epoll, worst", socket_worst);
+    bench_report("legacy file poll, average", legacy_average);
+    bench_report("legacy file poll, worst", legacy_worst);
+
+    bench_cleanup();
+    return 0;
+}
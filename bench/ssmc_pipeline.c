@@ -0,0 +1,346 @@
+/*
+ * Extracts every file of a synthetic multi-variant SSMC archive through the
+ * chunk pipeline at 1 to 4 workers, pinned through MUX_SSMC_WORKERS, and
+ * with the single threaded read, decompress and write loop it replaced,
+ * reporting each as MB/s of output. The variants share most of their chunks
+ * the way regional releases of one game do, so the archive holds each
+ * shared chunk once. The sprite_shrink library is stood in for by a codec
+ * that costs about as much CPU per byte as zstd, so the numbers show how
+ * well the reader, workers and writer overlap rather than the speed of the
+ * real codec.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bench.h"
+#include "archive_ssmc.h"
+#include "sprite_shrink/sprite_shrink.h"
+
+#define CHUNK_SIZE (64 * 1024)
+#define CHUNK_COUNT 256 // Per file
+#define VARIANTS 4
+#define VARIANT_EVERY 8 // Every eighth chunk differs between variants
+#define UNIQUE_CHUNKS (CHUNK_COUNT + VARIANTS * (CHUNK_COUNT / VARIANT_EVERY))
+#define MAX_WORKERS 4
+#define DECOMPRESS_ROUNDS 8
+#define RUNS 3
+
+const uint8_t MAGIC_NUMBER[8] = "SSMCBNCH";
+
+static const char *file_names[VARIANTS] = {
+        "Game (USA).bin", "Game (Europe).bin", "Game (Japan).bin", "Game (USA) (Rev 1).bin",
+};
+
+static FFISSAChunkMeta_u64 chunk_meta[VARIANTS][CHUNK_COUNT];
+static FFIChunkLocation chunk_index[UNIQUE_CHUNKS];
+static volatile uint32_t decompress_sink;
+
+bool archive_helper_is_ext_supported(const char *filename, const char **extensions) {
+    (void) filename;
+    (void) extensions;
+    return true;
+}
+
+// The stand in manifest is the file names, one per line
+FFIResult parse_file_metadata_u64(const uint8_t *manifest, uintptr_t length, FFIParsedManifestArrayU64 **out) {
+    FFIParsedManifestArrayU64 *parsed = calloc(1, sizeof(*parsed));
+    parsed->manifests = calloc(VARIANTS, sizeof(*parsed->manifests));
+
+    const char *name = (const char *) manifest;
+    const char *end = name + length;
+
+    while (name < end && parsed->manifests_len < VARIANTS) {
+        const char *line_end = memchr(name, '\n', (size_t) (end - name));
+        if (!line_end) line_end = end;
+
+        FFIFileManifestParentU64 *file = &parsed->manifests[parsed->manifests_len];
+        file->filename = strndup(name, (size_t) (line_end - name));
+        file->chunk_metadata = chunk_meta[parsed->manifests_len];
+        file->chunk_metadata_len = CHUNK_COUNT;
+
+        parsed->manifests_len++;
+        name = line_end + 1;
+    }
+
+    *out = parsed;
+    return StatusOk;
+}
+
+void free_parsed_manifest_u64(FFIParsedManifestArrayU64 *parsed) {
+    for (uintptr_t i = 0; i < parsed->manifests_len; i++) free(parsed->manifests[i].filename);
+    free(parsed->manifests);
+    free(parsed);
+}
+
+FFIResult prepare_chunk_index_u64(const uint8_t *index, uintptr_t length, void *out) {
+    void *copy = malloc(length);
+    memcpy(copy, index, length);
+
+    *(void **) out = copy;
+    return StatusOk;
+}
+
+void free_chunk_index_u64(void *index) {
+    free(index);
+}
+
+FFIResult lookup_chunk_location_u64(const void *index, uint64_t hash, FFIChunkLocation *location) {
+    *location = ((const FFIChunkLocation *) index)[hash];
+    return StatusOk;
+}
+
+FFIResult decompress_chunk_c(const uint8_t *in, uintptr_t in_length, const uint8_t *dictionary,
+                             uintptr_t dictionary_length, uint8_t *out, uintptr_t out_length) {
+    (void) dictionary_length;
+    if (in_length != out_length) return InternalError;
+
+    uint32_t hash = 0;
+    for (int round = 0; round < DECOMPRESS_ROUNDS; round++) {
+        for (uintptr_t i = 0; i < out_length; i++) hash = hash * 33 + in[i];
+    }
+    decompress_sink = hash;
+
+    for (uintptr_t i = 0; i < out_length; i++) out[i] = in[i] ^ dictionary[0];
+    return StatusOk;
+}
+
+// Only the u64 layout is exercised
+FFIResult parse_file_metadata_u128(const uint8_t *manifest, uintptr_t length, FFIParsedManifestArrayU128 **out) {
+    (void) manifest;
+    (void) length;
+    (void) out;
+    return InternalError;
+}
+
+void free_parsed_manifest_u128(FFIParsedManifestArrayU128 *parsed) {
+    (void) parsed;
+}
+
+FFIResult prepare_chunk_index_u128(const uint8_t *index, uintptr_t length, void *out) {
+    (void) index;
+    (void) length;
+    (void) out;
+    return InternalError;
+}
+
+void free_chunk_index_u128(void *index) {
+    (void) index;
+}
+
+FFIResult lookup_chunk_location_u128(const void *index, const uint8_t *hash, FFIChunkLocation *location) {
+    (void) index;
+    (void) hash;
+    (void) location;
+    return InternalError;
+}
+
+static bool variant_chunk(size_t chunk) {
+    return chunk % VARIANT_EVERY == 0;
+}
+
+static uint64_t chunk_hash(int variant, size_t chunk) {
+    if (!variant_chunk(chunk)) return chunk;
+    return CHUNK_COUNT + (uint64_t) variant * (CHUNK_COUNT / VARIANT_EVERY) + chunk / VARIANT_EVERY;
+}
+
+static uint8_t content_byte(int variant, size_t offset) {
+    uint8_t shared = (uint8_t) (offset * 131 + (offset >> 9));
+    return variant_chunk(offset / CHUNK_SIZE) ? (uint8_t) (shared + variant * 17 + 1) : shared;
+}
+
+static void write_archive(const char *path, FileHeader *header) {
+    const uint8_t dictionary = 0x5a;
+
+    char manifest[256] = "";
+    for (int v = 0; v < VARIANTS; v++) {
+        strcat(manifest, file_names[v]);
+        if (v + 1 < VARIANTS) strcat(manifest, "\n");
+    }
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic_num, MAGIC_NUMBER, sizeof(header->magic_num));
+    header->hash_type = 1;
+    header->man_offset = sizeof(FileHeader);
+    header->man_length = strlen(manifest);
+    header->dict_offset = header->man_offset + header->man_length;
+    header->dict_length = 1;
+    header->chunk_index_offset = header->dict_offset + header->dict_length;
+    header->chunk_index_length = sizeof(chunk_index);
+    header->data_offset = header->chunk_index_offset + header->chunk_index_length;
+
+    // Every unique chunk is stored once, in the order it is first used
+    uint64_t stored = 0;
+    bool placed[UNIQUE_CHUNKS] = {false};
+
+    for (int v = 0; v < VARIANTS; v++) {
+        for (size_t c = 0; c < CHUNK_COUNT; c++) {
+            uint64_t hash = chunk_hash(v, c);
+            chunk_meta[v][c] = (FFISSAChunkMeta_u64) {hash, (uint64_t) c * CHUNK_SIZE, CHUNK_SIZE};
+
+            if (placed[hash]) continue;
+            placed[hash] = true;
+            chunk_index[hash] = (FFIChunkLocation) {stored++ * CHUNK_SIZE, CHUNK_SIZE};
+        }
+    }
+
+    FILE *file = fopen(path, "wb");
+    BENCH_CHECK(file != NULL);
+
+    fwrite(header, sizeof(*header), 1, file);
+    fwrite(manifest, header->man_length, 1, file);
+    fwrite(&dictionary, 1, 1, file);
+    fwrite(chunk_index, sizeof(chunk_index), 1, file);
+
+    uint8_t *chunk = malloc(CHUNK_SIZE);
+    memset(placed, 0, sizeof(placed));
+
+    for (int v = 0; v < VARIANTS; v++) {
+        for (size_t c = 0; c < CHUNK_COUNT; c++) {
+            uint64_t hash = chunk_hash(v, c);
+            if (placed[hash]) continue;
+            placed[hash] = true;
+
+            for (size_t b = 0; b < CHUNK_SIZE; b++) chunk[b] = content_byte(v, c * CHUNK_SIZE + b) ^ dictionary;
+            BENCH_CHECK(fseek(file, (long) (header->data_offset + chunk_index[hash].offset), SEEK_SET) == 0);
+            fwrite(chunk, CHUNK_SIZE, 1, file);
+        }
+    }
+
+    free(chunk);
+    BENCH_CHECK(fclose(file) == 0);
+}
+
+// What extraction did before the pipeline: one chunk at a time on the calling thread
+static void extract_serial(const char *archive, const FileHeader *header, int variant, const char *output) {
+    int in = open(archive, O_RDONLY);
+    int out = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    BENCH_CHECK(in >= 0 && out >= 0);
+
+    uint8_t dictionary;
+    BENCH_CHECK(pread(in, &dictionary, 1, (off_t) header->dict_offset) == 1);
+
+    uint8_t *compressed = malloc(CHUNK_SIZE);
+    uint8_t *decompressed = malloc(CHUNK_SIZE);
+
+    for (int i = 0; i < CHUNK_COUNT; i++) {
+        const FFISSAChunkMeta_u64 *meta = &chunk_meta[variant][i];
+        off_t offset = (off_t) (header->data_offset + chunk_index[meta->hash].offset);
+
+        BENCH_CHECK(pread(in, compressed, CHUNK_SIZE, offset) == CHUNK_SIZE);
+        BENCH_CHECK(decompress_chunk_c(compressed, CHUNK_SIZE, &dictionary, 1, decompressed, CHUNK_SIZE) == StatusOk);
+        BENCH_CHECK(pwrite(out, decompressed, CHUNK_SIZE, (off_t) meta->offset) == CHUNK_SIZE);
+    }
+
+    free(compressed);
+    free(decompressed);
+    close(in);
+    close(out);
+}
+
+static void check_output(const char *path, int variant) {
+    FILE *file = fopen(path, "rb");
+    BENCH_CHECK(file != NULL);
+
+    uint8_t *chunk = malloc(CHUNK_SIZE);
+    for (size_t i = 0; i < CHUNK_COUNT; i++) {
+        BENCH_CHECK(fread(chunk, CHUNK_SIZE, 1, file) == 1);
+        for (size_t b = 0; b < CHUNK_SIZE; b++) BENCH_CHECK(chunk[b] == content_byte(variant, i * CHUNK_SIZE + b));
+    }
+
+    BENCH_CHECK(fgetc(file) == EOF);
+    free(chunk);
+    fclose(file);
+}
+
+static double time_serial(const char *archive, const FileHeader *header) {
+    char output[PATH_MAX];
+    double best = 1e9;
+
+    for (int run = 0; run < RUNS; run++) {
+        double elapsed = 0;
+
+        for (int v = 0; v < VARIANTS; v++) {
+            snprintf(output, sizeof(output), "%s/serial.bin", bench_dir());
+
+            double start = bench_now();
+            extract_serial(archive, header, v, output);
+            elapsed += bench_now() - start;
+
+            check_output(output, v);
+        }
+
+        if (elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+// Lists the archive and extracts every entry by index, as the frontend does
+static double time_pipeline(const char *archive, int workers) {
+    char count[8];
+    snprintf(count, sizeof(count), "%d", workers);
+    BENCH_CHECK(setenv("MUX_SSMC_WORKERS", count, 1) == 0);
+
+    ArchiveVTable *handler = get_ssmc_archive_handler();
+    double best = 1e9;
+
+    for (int run = 0; run < RUNS; run++) {
+        int entry_count = 0;
+        ArchiveEntry *entries = handler->list_contents(archive, &entry_count);
+        BENCH_CHECK(entries != NULL && entry_count == VARIANTS);
+
+        double elapsed = 0;
+
+        for (int i = 0; i < entry_count; i++) {
+            BENCH_CHECK(strcmp(entries[i].path, file_names[i]) == 0);
+
+            double start = bench_now();
+            char *extracted = handler->extract_file(archive, NULL, entries[i].index, bench_dir());
+            elapsed += bench_now() - start;
+
+            BENCH_CHECK(extracted != NULL);
+            check_output(extracted, i);
+
+            remove(extracted);
+            free(extracted);
+            free(entries[i].path);
+        }
+
+        free(entries);
+        if (elapsed < best) best = elapsed;
+    }
+
+    return best;
+}
+
+int main(void) {
+    char archive[PATH_MAX];
+    FileHeader header;
+
+    snprintf(archive, sizeof(archive), "%s/bench.ssmc", bench_dir());
+    write_archive(archive, &header);
+
+    double extracted = (double) VARIANTS * CHUNK_COUNT * CHUNK_SIZE;
+    double serial = time_serial(archive, &header);
+
+    double pipeline[MAX_WORKERS + 1];
+    for (int workers = 1; workers <= MAX_WORKERS; workers++) pipeline[workers] = time_pipeline(archive, workers);
+
+    printf("  %d variants of %d MiB sharing %d of every %d chunks, %d unique chunks stored\n",
+           VARIANTS, CHUNK_COUNT * CHUNK_SIZE >> 20, VARIANT_EVERY - 1, VARIANT_EVERY, UNIQUE_CHUNKS - CHUNK_COUNT / VARIANT_EVERY);
+    printf("  Every file extracted and checked, %ld online CPUs, best of %d\n", sysconf(_SC_NPROCESSORS_ONLN), RUNS);
+
+    bench_report_rate("single thread", extracted, serial);
+
+    for (int workers = 1; workers <= MAX_WORKERS; workers++) {
+        char name[64];
+        snprintf(name, sizeof(name), "chunk pipeline, %d worker%s", workers, workers > 1 ? "s" : "");
+        bench_report_rate(name, extracted, pipeline[workers]);
+    }
+
+    bench_cleanup();
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Samples the host through the telemetry module and checks what it reads
+ * against the shell commands muxsysinfo and muxnetinfo used to run, on the
+ * interface carrying the default route. It then times one refresh worth of
+ * those commands against a first sample, netlink setup included, and against
+ * the snapshot copy the UI timer now does on every tick. Commands missing on
+ * the host, such as iw on a wired machine, still cost their fork and simply
+ * leave that value unchecked.
+ */
+
+#include <stdio.h>
+#include "bench.h"
+#include "common.h"
+#include "device.h"
+#include "telemetry.h"
+
+#define REFRESHES 10
+#define SNAPSHOT_COPIES 1000
+
+char mux_module[MAX_BUFFER_SIZE] = "bench";
+struct mux_device device;
+
+// Every command one refresh of the two screens ran, with {if} standing in for the interface
+static const char *old_commands[] = {
+        "lscpu | grep 'Model name:' | awk -F: '{print $2}'",
+        "lscpu | grep '^CPU(s):' | awk '{print $2}'",
+        "free -m | awk '/^Mem:/ {printf \"%.2f MB / %.2f MB\", $3, $2}'",
+        "cat /sys/class/net/{if}/address",
+        "ip addr show {if} | awk '/inet / {print $2}' | cut -d/ -f1",
+        "iw dev {if} link | awk -F': ' '/SSID/ {print $2}'",
+        "ip route | awk '/default/ {print $3}'",
+        "awk '/nameserver/ {print $2}' /etc/resolv.conf | xargs",
+        "iw dev {if} link | awk '/signal/ {print $2}'",
+        "iw dev {if} link | awk '/freq:/ {print $2}'",
+};
+
+static void expand(const char *command, char *out, size_t size) {
+    const char *slot = strstr(command, "{if}");
+
+    if (slot) {
+        snprintf(out, size, "%.*s%s%s", (int) (slot - command), command, device.NETWORK.INTERFACE, slot + 4);
+    } else {
+        snprintf(out, size, "%s", command);
+    }
+}
+
+// First line of output like get_execute_result gave, empty when the command printed nothing
+static void run(const char *command, char *out, size_t size) {
+    char expanded[512];
+    expand(command, expanded, sizeof(expanded));
+
+    char shell[600];
+    snprintf(shell, sizeof(shell), "exec 2>/dev/null; %s", expanded);
+
+    FILE *pipe = popen(shell, "r");
+    BENCH_CHECK(pipe != NULL);
+
+    out[0] = '\0';
+    char line[512];
+
+    for (int first = 1; fgets(line, sizeof(line), pipe); first = 0) {
+        if (first) snprintf(out, size, "%.*s", (int) strcspn(line, "\n"), line);
+    }
+
+    pclose(pipe);
+}
+
+static void check_against(const char *command, const char *value) {
+    char expected[256];
+    run(command, expected, sizeof(expected));
+    if (!expected[0]) return;
+
+    if (strcmp(expected, value) != 0) fprintf(stderr, "%s\n  gave '%s', telemetry read '%s'\n", command, expected, value);
+    BENCH_CHECK(strcmp(expected, value) == 0);
+}
+
+static void pick_interface(void) {
+    snprintf(device.NETWORK.INTERFACE, sizeof(device.NETWORK.INTERFACE), "lo");
+
+    FILE *routes = fopen("/proc/net/route", "r");
+    if (routes) {
+        char line[256], name[64];
+        unsigned long destination;
+
+        while (fgets(line, sizeof(line), routes)) {
+            if (sscanf(line, "%63s %lx", name, &destination) == 2 && destination == 0) {
+                snprintf(device.NETWORK.INTERFACE, sizeof(device.NETWORK.INTERFACE), "%s", name);
+                break;
+            }
+        }
+
+        fclose(routes);
+    }
+
+    snprintf(device.NETWORK.STATE, sizeof(device.NETWORK.STATE), "/sys/class/net/%s/operstate",
+             device.NETWORK.INTERFACE);
+    snprintf(device.CPU.GOVERNOR, sizeof(device.CPU.GOVERNOR),
+             "/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+}
+
+int main(void) {
+    pick_interface();
+
+    double start = bench_now();
+    telemetry_start(TELEMETRY_SYSTEM | TELEMETRY_NETWORK);
+    double first_sample = bench_now() - start;
+
+    telemetry_sample sample;
+    telemetry_get(&sample);
+
+    char value[64];
+    snprintf(value, sizeof(value), "%d", sample.cpu_count);
+    check_against("getconf _NPROCESSORS_CONF", value);
+
+    snprintf(value, sizeof(value), "%ld", sample.mem_total_kb);
+    check_against("awk '/^MemTotal:/ {print $2}' /proc/meminfo", value);
+
+    check_against(old_commands[3], sample.mac);
+    check_against(old_commands[4], sample.ip);
+    check_against(old_commands[6], sample.gateway);
+    check_against(old_commands[7], sample.dns);
+
+    printf("  %s: %s, %s, gateway %s, dns %s\n", device.NETWORK.INTERFACE, sample.mac, sample.ip,
+           sample.gateway, sample.dns);
+    printf("  %s (%d), %ld of %ld MiB used\n", sample.cpu_model, sample.cpu_count,
+           sample.mem_used_kb / 1024, sample.mem_total_kb / 1024);
+
+    char output[256];
+    start = bench_now();
+    for (int i = 0; i < REFRESHES; i++) {
+        for (size_t c = 0; c < sizeof(old_commands) / sizeof(old_commands[0]); c++) {
+            run(old_commands[c], output, sizeof(output));
+        }
+    }
+    double commands = (bench_now() - start) / REFRESHES;
+
+    start = bench_now();
+    for (int i = 0; i < SNAPSHOT_COPIES; i++) telemetry_get(&sample);
+    double copies = bench_now() - start;
+
+    telemetry_stop();
+
+    bench_report("one refresh of shell commands", commands);
+    bench_report("first telemetry sample", first_sample);
+
+    char name[64];
+    snprintf(name, sizeof(name), "%d snapshot copies on the UI timer", SNAPSHOT_COPIES);
+    bench_report(name, copies);
+
+    return 0;
+}
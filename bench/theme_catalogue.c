@@ -0,0 +1,224 @@
+/*
+ * Loads a generated theme data file through theme_catalogue_load and checks
+ * it against the way muxthemedown used to build its list: a parse of the
+ * whole file, a copy of every name and url, a sort that duplicated both
+ * names on every compare and a stat per theme for its downloaded state.
+ * Both must list the same themes with the same features in the same order.
+ * Loading again must come from the cache until the file changes.
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <limits.h>
+#include <unistd.h>
+#include "bench.h"
+#include "common.h"
+#include "collection_theme.h"
+#include "json/json.h"
+#include "json_index.h"
+#include "text_file.h"
+
+#define THEMES 3000
+#define CACHED_LOADS 1000
+
+char mux_module[MAX_BUFFER_SIZE] = "bench";
+
+static const int downloaded_themes[] = {5, 17, 100, 2999};
+
+static const char *const theme_keys[] = {
+        "grid", "hdmi", "language",
+        "resolution640x480", "resolution720x480", "resolution720x720",
+        "resolution1024x768", "resolution1280x720",
+        "name", "url",
+};
+
+uint32_t fnv1a_hash_str(const char *str) {
+    uint32_t hash = 2166136261U;
+
+    for (const char *p = str; *p; p++) {
+        hash ^= (uint8_t) (*p);
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+int file_exist(char *filename) {
+    return access(filename, F_OK) == 0;
+}
+
+char *read_all_char_from(const char *filename) {
+    TextFile *tf = text_file_acquire(filename);
+    if (!tf) return "";
+
+    size_t length = tf->length;
+    if (length > 0 && tf->data[length - 1] == '\n') length--;
+
+    char *text = malloc(length + 1);
+    if (text != NULL) {
+        memcpy(text, tf->data, length);
+        text[length] = '\0';
+    }
+
+    text_file_release(tf);
+    return text;
+}
+
+static char *lower_dup(const char *text) {
+    char *result = strdup(text);
+
+    for (char *ptr = result; *ptr; ptr++) *ptr = (char) tolower((unsigned char) *ptr);
+    return result;
+}
+
+// The compare sort_theme_items used, minus the leak it had
+static int old_compare(const void *a, const void *b) {
+    char *lower_a = lower_dup(((const theme_item *) a)->name);
+    char *lower_b = lower_dup(((const theme_item *) b)->name);
+
+    int result = strverscmp(lower_a, lower_b);
+
+    free(lower_a);
+    free(lower_b);
+    return result;
+}
+
+static void write_data(const char *path, int themes) {
+    FILE *file = fopen(path, "w");
+    BENCH_CHECK(file != NULL);
+
+    fputc('[', file);
+    for (int i = 0; i < themes; i++) {
+        // Mixed case and an escaped quote exercise the sort and the string copy
+        fprintf(file, "%s{\"name\": \"%s %d%s\", \"url\": \"https://example.com/%d.muxthm\"",
+                i ? ", " : "", i % 3 ? "Theme" : "theme", i, i % 250 ? "" : " \\\"Classic\\\"", i);
+
+        for (int k = 0; k < 8; k++) fprintf(file, ", \"%s\": %s", theme_keys[k], (i >> k) & 1 ? "true" : "false");
+
+        fprintf(file, ", \"credits\": \"%0*d\"}", 200, 0);
+    }
+    fputs("]\n", file);
+
+    fclose(file);
+}
+
+static void write_downloads(const char *dir) {
+    char path[PATH_MAX + 64];
+
+    for (size_t i = 0; i < A_SIZE(downloaded_themes); i++) {
+        int n = downloaded_themes[i];
+        snprintf(path, sizeof(path), "%s/%s %d.muxthm", dir, n % 3 ? "Theme" : "theme", n);
+
+        FILE *file = fopen(path, "w");
+        BENCH_CHECK(file != NULL);
+        fclose(file);
+    }
+
+    snprintf(path, sizeof(path), "%s/other.txt", dir);
+    FILE *file = fopen(path, "w");
+    BENCH_CHECK(file != NULL);
+    fclose(file);
+}
+
+// What create_content_items did before the catalogue, with no filter set
+static void old_load(const char *path, const char *dir, theme_item **items, size_t *count, bool downloaded[]) {
+    char *json_str = read_all_char_from(path);
+    BENCH_CHECK(json_valid(json_str));
+
+    struct json root = json_parse(json_str);
+    struct json values[A_SIZE(theme_keys)];
+
+    json_array_each(entry, root) {
+        json_object_pick(entry, theme_keys, values, A_SIZE(theme_keys));
+
+        uint32_t features = 0;
+        for (int k = 0; k < 8; k++) {
+            if (json_bool(values[k])) features |= 1u << k;
+        }
+
+        char name[MAX_BUFFER_SIZE];
+        json_string_copy(values[8], name, sizeof(name));
+        char url[MAX_BUFFER_SIZE];
+        json_string_copy(values[9], url, sizeof(url));
+
+        add_theme_item(items, count, name, url, features);
+    }
+    free(json_str);
+
+    qsort(*items, *count, sizeof(theme_item), old_compare);
+
+    for (size_t i = 0; i < *count; i++) {
+        char theme_path[PATH_MAX + MAX_BUFFER_SIZE];
+        snprintf(theme_path, sizeof(theme_path), "%s/%s.muxthm", dir, (*items)[i].name);
+        downloaded[i] = file_exist(theme_path);
+    }
+}
+
+int main(void) {
+    char data[PATH_MAX];
+    snprintf(data, sizeof(data), "%s/data.json", bench_dir());
+    write_data(data, THEMES);
+
+    const char *dir = bench_dir();
+    write_downloads(dir);
+
+    static bool old_downloaded[THEMES], new_downloaded[THEMES];
+    static const theme_item *view[THEMES];
+
+    theme_item *old_items = NULL;
+    size_t old_count = 0;
+
+    double start = bench_now();
+    old_load(data, dir, &old_items, &old_count, old_downloaded);
+    double old_time = bench_now() - start;
+
+    start = bench_now();
+    const theme_catalogue *catalogue = theme_catalogue_load(data);
+    double first_load = bench_now() - start;
+
+    BENCH_CHECK(catalogue != NULL && catalogue->count == THEMES && old_count == THEMES);
+
+    for (size_t i = 0; i < catalogue->count; i++) view[i] = &catalogue->items[i];
+
+    start = bench_now();
+    theme_catalogue_downloaded(view, catalogue->count, dir, new_downloaded);
+    double scan = bench_now() - start;
+
+    size_t downloaded = 0;
+    for (size_t i = 0; i < THEMES; i++) {
+        BENCH_CHECK(strcmp(catalogue->items[i].name, old_items[i].name) == 0);
+        BENCH_CHECK(strcmp(catalogue->items[i].url, old_items[i].url) == 0);
+        BENCH_CHECK(catalogue->items[i].features == old_items[i].features);
+        BENCH_CHECK(new_downloaded[i] == old_downloaded[i]);
+        downloaded += new_downloaded[i];
+    }
+    BENCH_CHECK(downloaded == A_SIZE(downloaded_themes));
+
+    printf("  %d themes, same order, features and downloads as before\n", THEMES);
+
+    start = bench_now();
+    for (int i = 0; i < CACHED_LOADS; i++) BENCH_CHECK(theme_catalogue_load(data) == catalogue);
+    double cached = (bench_now() - start) / CACHED_LOADS;
+
+    // A rewritten file must be parsed again, and a missing one gives nothing
+    usleep(20000);
+    write_data(data, THEMES + 1);
+    catalogue = theme_catalogue_load(data);
+    BENCH_CHECK(catalogue != NULL && catalogue->count == THEMES + 1);
+
+    BENCH_CHECK(remove(data) == 0);
+    BENCH_CHECK(theme_catalogue_load(data) == NULL);
+
+    printf("  Reloaded after the file changed and gone once it was removed\n");
+
+    free_theme_items(&old_items, &old_count);
+
+    bench_report("old parse, sort and stat per theme", old_time);
+    bench_report("theme_catalogue_load, first", first_load);
+    bench_report("theme_catalogue_load, cached", cached);
+    bench_report("theme_catalogue_downloaded", scan);
+
+    bench_cleanup();
+    return 0;
+}
@@ -1,15 +1,111 @@
 #include "archive.h"
 #include "archive_ssmc.h"
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define MAX_HANDLERS 50
-#define MAX_ARCHIVE_DISPLAY_ITEMS 255
+#define MAX_EXTENSION_LENGTH 16
+#define EXTENSION_TABLE_SIZE 128 //Power of two, kept well above the extension count
+#define LISTING_CACHE_MAGIC "ARCLIST1"
 static ArchiveVTable* archive_handlers[MAX_HANDLERS];
 static int handler_count = 0;
 
+typedef struct {
+    char extension[MAX_EXTENSION_LENGTH];
+    ArchiveVTable* handler;
+} ExtensionSlot;
+
+static ExtensionSlot extension_table[EXTENSION_TABLE_SIZE];
+static int extension_count = 0;
+
+/*The filtered listing of the most recently browsed archive. Paging through an
+archive hits this instead of asking the handler to parse the manifest again.*/
+typedef struct {
+    char path[PATH_MAX];
+    int64_t size;
+    int64_t mtime;
+    ArchiveEntry *entries;
+    int count;
+} ListingCache;
+
+static ListingCache listing_cache;
+static char listing_cache_dir[PATH_MAX] = "";
+
+uint64_t archive_hash(uint64_t hash, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static bool lower_extension(const char *ext, char *buf, size_t buf_size) {
+    size_t len = strlen(ext);
+    if (len == 0 || len >= buf_size) return false;
+
+    for (size_t i = 0; i <= len; i++) {
+        buf[i] = (char) tolower((unsigned char) ext[i]);
+    }
+
+    return true;
+}
+
+//Lowercases the extension of filename (including the dot) into buf.
+static bool extension_key(const char *filename, char *buf, size_t buf_size) {
+    const char *file_ext = strrchr(filename, '.');
+    if (!file_ext || file_ext == filename) return false;
+
+    return lower_extension(file_ext, buf, buf_size);
+}
+
+static size_t extension_slot(const char *key) {
+    uint64_t hash = archive_hash(ARCHIVE_HASH_SEED, key, strlen(key));
+    size_t slot = (size_t) hash & (EXTENSION_TABLE_SIZE - 1);
+
+    while (extension_table[slot].handler && strcmp(extension_table[slot].extension, key) != 0) {
+        slot = (slot + 1) & (EXTENSION_TABLE_SIZE - 1);
+    }
+
+    return slot;
+}
+
+/*Earlier registrations win, matching the first-match behaviour of walking
+the handler list in registration order.*/
+static void add_handler_extensions(ArchiveVTable* handler) {
+    if (!handler->get_supported_extensions) return;
+
+    const char** exts = handler->get_supported_extensions();
+    for (int i = 0; exts && exts[i] != NULL; i++) {
+        char key[MAX_EXTENSION_LENGTH];
+        if (!lower_extension(exts[i], key, sizeof(key))) continue;
+
+        //Keep the table at most half full so probes stay short
+        if (extension_count >= EXTENSION_TABLE_SIZE / 2) {
+            //Todo: Log error, extension table full.
+            return;
+        }
+
+        size_t slot = extension_slot(key);
+        if (extension_table[slot].handler) continue;
+
+        snprintf(extension_table[slot].extension, MAX_EXTENSION_LENGTH, "%s", key);
+        extension_table[slot].handler = handler;
+        extension_count++;
+    }
+}
+
 void register_archive_handler(ArchiveVTable* handler) {
     if (!handler) {
         // TODO: Log error, attempt to register a NULL handler
@@ -28,6 +124,7 @@ void register_archive_handler(ArchiveVTable* handler) {
     }
 
     archive_handlers[handler_count++] = handler;
+    add_handler_extensions(handler);
     // TODO: Log msg, successfully registered {name of handler} handler
 }
 
@@ -40,8 +137,16 @@ ArchiveVTable* get_handler_for_file(const char *filename) {
         return NULL;
     }
 
+    char key[MAX_EXTENSION_LENGTH];
+    if (extension_key(filename, key, sizeof(key))) {
+        ExtensionSlot *slot = &extension_table[extension_slot(key)];
+        if (slot->handler) return slot->handler;
+    }
+
+    //Handlers that do not advertise their extensions still get asked directly
     for (int i = 0; i < handler_count; i++) {
-        if (archive_handlers[i]->is_supported(filename)) {
+        if (!archive_handlers[i]->get_supported_extensions &&
+            archive_handlers[i]->is_supported(filename)) {
             return archive_handlers[i];
         }
     }
@@ -69,87 +174,262 @@ bool archive_helper_is_ext_supported(const char *filename, const char **extensio
     return false;
 }
 
-ArchiveEntry* archive_list_contents(const char *archive_path, int *count) {
-    ArchiveVTable* handler = get_handler_for_file(archive_path);
+static void free_entries(ArchiveEntry *entries, int count) {
+    if (!entries) return;
+
+    for (int i = 0; i < count; i++) {
+        free(entries[i].path);
+    }
+    free(entries);
+}
+
+static void listing_cache_reset(void) {
+    free_entries(listing_cache.entries, listing_cache.count);
+    memset(&listing_cache, 0, sizeof(ListingCache));
+}
+
+static void listing_cache_file(const char *archive_path, char *buf, size_t buf_size) {
+    uint64_t hash = archive_hash(ARCHIVE_HASH_SEED, archive_path, strlen(archive_path));
+    snprintf(buf, buf_size, "%s/%016" PRIx64 ".lst", listing_cache_dir, hash);
+}
+
+/*Listing cache files are plain text: a header line with the magic, archive
+size, modification time and entry count, followed by one "index<TAB>path"
+line per entry.*/
+static ArchiveEntry* listing_cache_load(const char *archive_path, int64_t size, int64_t mtime, int *count) {
+    char cache_file[PATH_MAX];
+    listing_cache_file(archive_path, cache_file, sizeof(cache_file));
+
+    FILE *file = fopen(cache_file, "r");
+    if (!file) return NULL;
+
+    char magic[16];
+    int64_t cached_size;
+    int64_t cached_mtime;
+    int cached_count;
+    ArchiveEntry *entries = NULL;
+    int loaded = 0;
+    char *line = NULL;
+    size_t line_size = 0;
+
+    if (fscanf(file, "%15s %" SCNd64 " %" SCNd64 " %d\n",
+               magic, &cached_size, &cached_mtime, &cached_count) != 4 ||
+        strcmp(magic, LISTING_CACHE_MAGIC) != 0 ||
+        cached_size != size || cached_mtime != mtime || cached_count <= 0) {
+        goto cleanup;
+    }
+
+    entries = calloc(cached_count, sizeof(ArchiveEntry));
+    if (!entries) goto cleanup;
+
+    while (loaded < cached_count && getline(&line, &line_size, file) > 0) {
+        char *tab = strchr(line, '\t');
+        if (!tab) break;
+
+        tab[strcspn(tab, "\n")] = '\0';
+        entries[loaded].path = strdup(tab + 1);
+        if (!entries[loaded].path) break;
+
+        entries[loaded].index = atoi(line);
+        entries[loaded].type = ARCHIVE_ENTRY_FILE;
+        loaded++;
+    }
+
+    cleanup:
+        free(line);
+        fclose(file);
+
+        if (entries && loaded != cached_count) {
+            //Todo: Log warning, listing cache truncated, rebuilding.
+            free_entries(entries, loaded);
+            return NULL;
+        }
+
+        if (entries) *count = loaded;
+        return entries;
+}
+
+//The listing cache lives on the SD card so it outlasts a reboot, the folder may not be there yet.
+static bool make_listing_cache_dir(void) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", listing_cache_dir);
+
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) return false;
+        *p = '/';
+    }
+
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static void listing_cache_save(const char *archive_path, int64_t size, int64_t mtime,
+                               const ArchiveEntry *entries, int count) {
+    char cache_file[PATH_MAX];
+    char temp_file[PATH_MAX + 4];
+    listing_cache_file(archive_path, cache_file, sizeof(cache_file));
+    snprintf(temp_file, sizeof(temp_file), "%s.tmp", cache_file);
+
+    if (!make_listing_cache_dir()) {
+        //Todo: Log warning, unable to create listing cache directory.
+        return;
+    }
+
+    FILE *file = fopen(temp_file, "w");
+    if (!file) {
+        //Todo: Log warning, unable to write listing cache.
+        return;
+    }
+
+    bool ok = fprintf(file, "%s %" PRId64 " %" PRId64 " %d\n", LISTING_CACHE_MAGIC, size, mtime, count) > 0;
+    for (int i = 0; ok && i < count; i++) {
+        ok = fprintf(file, "%d\t%s\n", entries[i].index, entries[i].path) > 0;
+    }
+
+    if (fclose(file) != 0) ok = false;
+
+    if (!ok || rename(temp_file, cache_file) != 0) remove(temp_file);
+}
+
+static int compare_entry_path(const void *a, const void *b) {
+    return strcasecmp(((const ArchiveEntry *) a)->path, ((const ArchiveEntry *) b)->path);
+}
+
+/*Asks the handler for the full listing and keeps only the files at the root,
+ordered by name so each page follows on from the one before it.*/
+static ArchiveEntry* build_listing(ArchiveVTable* handler, const char *archive_path, int *count) {
     ArchiveEntry *entries = NULL;
-    ArchiveEntry *working_list = NULL;
     ArchiveEntry *final_list = NULL;
     int valid_item_count = 0;
     int handler_raw_count = 0;
 
-    if(!handler || !handler->list_contents){
-        //Todo: Log warning, extension not supported or list_contents not
-        // implemented.
-        return NULL;
-    }
-
     entries = handler->list_contents(archive_path, &handler_raw_count);
     if(!entries){
         //Todo: Log error, handler failed to list contents.
         return NULL;
     }
 
-    working_list = malloc(MAX_ARCHIVE_DISPLAY_ITEMS * sizeof(ArchiveEntry));
-    if(!working_list){
-        //Todo: Log error: Memory allocation for final_list failed.
-        goto cleanup;
-    }
-    memset(working_list, 0, MAX_ARCHIVE_DISPLAY_ITEMS * sizeof(ArchiveEntry));
-
     for (int i = 0; i < handler_raw_count; i++){
-        if (valid_item_count >= MAX_ARCHIVE_DISPLAY_ITEMS){
-            //Todo: Log warning, archive contains more than the supported 255
-            // items. List contains first 255 valid items.
-            break;
-        }
-
         bool is_file = (entries[i].type == ARCHIVE_ENTRY_FILE);
         bool is_root = (strchr(entries[i].path, '/') == NULL);
 
         if (is_file && is_root){
-            working_list[valid_item_count].path = strdup(entries[i].path);
-            working_list[valid_item_count].index = entries[i].index;
-            if(!working_list[valid_item_count].path){
-                //Todo: Log error, strdup failed for item path/filename
-                goto cleanup;
-            }
-            valid_item_count++;
+            //Compact in place, taking ownership of the path
+            ArchiveEntry entry = entries[i];
+            entries[i].path = NULL;
+            entries[valid_item_count++] = entry;
+        } else {
+            free(entries[i].path);
+            entries[i].path = NULL;
         }
     }
+
+    if (valid_item_count == 0) {
+        free(entries);
+        return NULL;
+    }
+
+    final_list = realloc(entries, valid_item_count * sizeof(ArchiveEntry));
+    if (!final_list) final_list = entries;
+
+    qsort(final_list, valid_item_count, sizeof(ArchiveEntry), compare_entry_path);
+
     *count = valid_item_count;
+    return final_list;
+}
 
-    if (valid_item_count > 0) {
-        ArchiveEntry* shrunk_list = realloc(
-            working_list,
-            valid_item_count * sizeof(ArchiveEntry)
-        );
-        if(!shrunk_list){
-            //Todo: Log error, shrunk list reallocation failed.
-            goto cleanup;
-        }
-        final_list = shrunk_list;
-        working_list = NULL;
+/*Makes sure the listing cache holds archive_path, going to the on-disk cache
+and then the handler only when the archive is new or has changed.*/
+static bool load_listing(const char *archive_path) {
+    ArchiveVTable* handler = get_handler_for_file(archive_path);
+    if(!handler || !handler->list_contents){
+        //Todo: Log warning, extension not supported or list_contents not
+        // implemented.
+        return false;
     }
 
-    cleanup:
-        if(entries){
-            for (int i = 0; i < handler_raw_count; i++){
-                if(entries[i].path){
-                    free(entries[i].path);
-                }
-            }
-            free(entries);
-        }
-        if(working_list){
-            for(int i = 0; i < valid_item_count; i++){
-                if(working_list[i].path){
-                    free(working_list[i].path);
-                }
-            }
-            free(working_list);
+    struct stat st;
+    if (stat(archive_path, &st) != 0) {
+        //Todo: Log error, failed to stat archive.
+        return false;
+    }
+
+    int64_t size = (int64_t) st.st_size;
+    int64_t mtime = (int64_t) st.st_mtime;
+
+    if (listing_cache.entries &&
+        strcmp(listing_cache.path, archive_path) == 0 &&
+        listing_cache.size == size && listing_cache.mtime == mtime) {
+        return true;
+    }
+
+    listing_cache_reset();
+
+    int count = 0;
+    ArchiveEntry *entries = NULL;
+    bool use_disk = listing_cache_dir[0] != '\0';
+
+    if (use_disk) entries = listing_cache_load(archive_path, size, mtime, &count);
+    if (!entries) {
+        entries = build_listing(handler, archive_path, &count);
+        if (!entries) return false;
+
+        if (use_disk) listing_cache_save(archive_path, size, mtime, entries, count);
+    }
+
+    snprintf(listing_cache.path, sizeof(listing_cache.path), "%s", archive_path);
+    listing_cache.size = size;
+    listing_cache.mtime = mtime;
+    listing_cache.entries = entries;
+    listing_cache.count = count;
+
+    return true;
+}
+
+void archive_set_listing_cache_dir(const char *cache_dir) {
+    snprintf(listing_cache_dir, sizeof(listing_cache_dir), "%s", cache_dir ? cache_dir : "");
+}
+
+ArchiveEntry* archive_list_page(const char *archive_path, int offset, int limit, int *count, int *total) {
+    *count = 0;
+    if (total) *total = 0;
+
+    if (!archive_path || offset < 0 || limit <= 0) return NULL;
+    if (!load_listing(archive_path)) return NULL;
+
+    if (total) *total = listing_cache.count;
+    if (offset >= listing_cache.count) return NULL;
+
+    int page_count = listing_cache.count - offset;
+    if (page_count > limit) page_count = limit;
+
+    ArchiveEntry *page = calloc(page_count, sizeof(ArchiveEntry));
+    if (!page) {
+        //Todo: Log error, memory allocation for page failed.
+        return NULL;
+    }
+
+    for (int i = 0; i < page_count; i++) {
+        const ArchiveEntry *source = &listing_cache.entries[offset + i];
+
+        page[i].path = strdup(source->path);
+        if (!page[i].path) {
+            //Todo: Log error, strdup failed for item path/filename
+            free_entries(page, i);
+            return NULL;
         }
+        page[i].type = source->type;
+        page[i].index = source->index;
+    }
 
-        return final_list;
+    *count = page_count;
+    return page;
+}
+
+ArchiveEntry* archive_list_contents(const char *archive_path, int *count) {
+    return archive_list_page(archive_path, 0, INT_MAX, count, NULL);
 }
 
 char* archive_extract_file(
@@ -165,11 +445,59 @@ char* archive_extract_file(
     return NULL;
 }
 
+bool archive_extract_stream(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    ArchiveStreamCallback write_cb,
+    void *user_data
+) {
+    ArchiveVTable* handler = get_handler_for_file(archive_path);
+    if (!handler || !handler->extract_stream) {
+        //Todo: Log warning, extension not supported or extract_stream not
+        // implemented.
+        return false;
+    }
+
+    return handler->extract_stream(archive_path, file_inside_archive, file_index, write_cb, user_data);
+}
+
+static int fd_stream_writer(const uint8_t *data, size_t length, uint64_t offset, void *user_data) {
+    (void) offset;
+    int fd = *(int *) user_data;
+
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1; //Reader has gone away or the write failed
+
+        data += n;
+        length -= (size_t) n;
+    }
+
+    return 0;
+}
+
+bool archive_extract_to_fd(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    int fd
+) {
+    if (fd < 0) return false;
+    return archive_extract_stream(archive_path, file_inside_archive, file_index, fd_stream_writer, &fd);
+}
+
 void archive_system_shutdown(void) {
     for (int i = 0; i < handler_count; i++) {
         archive_handlers[i] = NULL;
     }
     handler_count = 0;
+
+    memset(extension_table, 0, sizeof(extension_table));
+    extension_count = 0;
+
+    listing_cache_reset();
 }
 
 SupportedExtensionInfo* archive_get_all_supported_info(int *count) {
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARCHIVE_HASH_SEED 14695981039346656037ULL
 
 typedef struct SupportedExtensionInfo {
     char* extension;
@@ -20,6 +24,16 @@ typedef struct ArchiveEntry {
     int index;
 } ArchiveEntry;
 
+/*Receives decompressed data during a streaming extraction. Chunks are
+delivered in file order, offset is where the data sits in the extracted file.
+Return 0 to continue or any other value to cancel the extraction.*/
+typedef int (*ArchiveStreamCallback)(
+    const uint8_t *data,
+    size_t length,
+    uint64_t offset,
+    void *user_data
+);
+
 typedef struct ArchiveVTable {
     //Returns true if the handler supports this file extension
     bool (*is_supported)(const char *filename);
@@ -44,6 +58,20 @@ typedef struct ArchiveVTable {
         const char *temp_dir
     );
 
+    /*Extract a single file from the archive without materialising it.
+    Data is handed to write_cb in file order as it is decompressed.
+    Return true if the whole file was delivered, false on failure or if
+    write_cb cancelled the extraction.
+
+    Optional, handlers that can not stream leave this NULL.*/
+    bool (*extract_stream)(
+        const char *archive_path,
+        const char *file_inside_archive,
+        int file_index,
+        ArchiveStreamCallback write_cb,
+        void *user_data
+    );
+
     const char* (*get_handler_name)(void);
     const char** (*get_supported_extensions)(void);
 } ArchiveVTable;
@@ -65,9 +93,10 @@ void register_archive_handler(ArchiveVTable* handler);
 
 /** @brief Finds the first registered handler that supports a given file.
  *
- * @details This function iterates through the list of registered archive handlers
- * and calls the `is_supported` method for each one. It returns the first
- * handler that returns `true`.
+ * @details The lowercased extension of `filename` is looked up in a hash table
+ * built from each handler's `get_supported_extensions` as it is registered, so
+ * the cost does not grow with the number of handlers. Handlers that do not
+ * advertise their extensions fall back to having `is_supported` called.
  *
  * @param filename The path to the archive file to check. Must be a valid,
  *                 non-NULL string.
@@ -107,6 +136,44 @@ bool archive_helper_is_ext_supported(
     const char **extensions
 );
 
+/**
+ * @brief Computes a 64-bit FNV-1a hash, continuing from `hash`.
+ * @param hash The running hash, start with `ARCHIVE_HASH_SEED`.
+ * @param data The bytes to hash.
+ * @param length The number of bytes to hash.
+ * @return The updated hash.
+ */
+uint64_t archive_hash(uint64_t hash, const void *data, size_t length);
+
+/**
+ * @brief Sets the directory used to persist archive listings.
+ *
+ * @details Listings are stored per archive and reused for as long as the
+ * archive size and modification time match, so reopening an archive does not
+ * need its manifest parsed again. Passing NULL or an empty string disables
+ * the on-disk cache, the most recent listing is still kept in memory.
+ *
+ * @param cache_dir The directory to store listings in.
+ */
+void archive_set_listing_cache_dir(const char *cache_dir);
+
+/**
+ * @brief Lists a page of the root level files in a given archive file.
+ *
+ * @details The full listing is built once and cached, so walking an archive
+ * page by page only costs the copies of the requested entries.
+ *
+ * @param archive_path The path to the archive.
+ * @param offset The index of the first entry to return.
+ * @param limit The maximum number of entries to return.
+ * @param count A pointer to an integer to store the number of entries returned.
+ * @param total An optional pointer to store the total number of entries.
+ * @return A dynamically allocated array of ArchiveEntry structs on success,
+ *         or NULL on failure or past the end of the listing. The caller is
+ *         responsible for freeing each path string and then the array itself.
+ */
+ArchiveEntry* archive_list_page(const char *archive_path, int offset, int limit, int *count, int *total);
+
 /**
  * @brief Lists the contents of a given archive file.
  * @param archive_path The path to the archive.
@@ -132,10 +199,55 @@ char* archive_extract_file(
     const char *temp_dir
 );
 
+/**
+ * @brief Streams a file from an archive to a callback.
+ *
+ * @details The file is never written to disk by the archive system, each
+ * decompressed chunk is handed to `write_cb` in file order.
+ *
+ * @param archive_path The path to the archive.
+ * @param file_inside_archive The name of the file to extract (if index is not used).
+ * @param file_index The index of the file to extract.
+ * @param write_cb Callback receiving the decompressed data.
+ * @param user_data Opaque pointer handed back to `write_cb`.
+ * @return `true` if the whole file was delivered, `false` on failure, if the
+ *         handler can not stream or if `write_cb` cancelled the extraction.
+ */
+bool archive_extract_stream(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    ArchiveStreamCallback write_cb,
+    void *user_data
+);
+
+/**
+ * @brief Streams a file from an archive into a file descriptor.
+ *
+ * @details Intended for pipes and FIFOs, data is written sequentially so the
+ * reader on the other end can consume it while decompression is still running.
+ * The descriptor is not closed. Callers writing to a pipe should ignore
+ * `SIGPIPE` so a reader going away cancels the extraction instead of killing
+ * the process.
+ *
+ * @param archive_path The path to the archive.
+ * @param file_inside_archive The name of the file to extract (if index is not used).
+ * @param file_index The index of the file to extract.
+ * @param fd The file descriptor to write into.
+ * @return `true` if the whole file was written, `false` otherwise.
+ */
+bool archive_extract_to_fd(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    int fd
+);
+
 /**
  * @brief Resets the archive handler system.
- * @details This function clears the list of registered handlers. It should be
- *          called on application shutdown if cleanup is required.
+ * @details This function clears the list of registered handlers, the extension
+ *          table and the in-memory listing. It should be called on application
+ *          shutdown if cleanup is required.
  */
 void archive_system_shutdown(void);
 
@@ -0,0 +1,285 @@
+#include "archive_cache.h"
+#include "archive.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#define CACHE_STAGING_SUFFIX ".part"
+#define CACHE_FREE_RESERVE (256ULL * 1024 * 1024) //Always leave this much free
+
+typedef struct {
+    char name[NAME_MAX + 1];
+    time_t last_used;
+    uint64_t size;
+} CacheEntry;
+
+/*An archive is identified by its path, size and modification time. Hashing
+the contents would mean reading the whole archive, which is exactly the
+work the cache is trying to avoid.*/
+static bool cache_entry_key(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    char *key,
+    size_t key_size
+) {
+    struct stat st;
+    if (stat(archive_path, &st) != 0) {
+        //Todo: Log error, failed to stat archive
+        return false;
+    }
+
+    uint64_t hash = ARCHIVE_HASH_SEED;
+    int64_t size = (int64_t) st.st_size;
+    int64_t mtime = (int64_t) st.st_mtime;
+
+    hash = archive_hash(hash, archive_path, strlen(archive_path));
+    hash = archive_hash(hash, &size, sizeof(size));
+    hash = archive_hash(hash, &mtime, sizeof(mtime));
+
+    //Name lookups all share an index of -1 so the name has to be part of the key
+    if (file_index < 0) {
+        if (!file_inside_archive) return false;
+        hash = archive_hash(hash, file_inside_archive, strlen(file_inside_archive));
+    }
+
+    return snprintf(key, key_size, "%016" PRIx64 "-%d", hash, file_index) < (int) key_size;
+}
+
+static bool is_dot_entry(const char *name) {
+    return strcmp(name, ".") == 0 || strcmp(name, "..") == 0;
+}
+
+//Cache entries are flat directories, only ever holding the extracted file.
+static uint64_t cache_entry_size(const char *entry_dir) {
+    DIR *dir = opendir(entry_dir);
+    if (!dir) return 0;
+
+    uint64_t size = 0;
+    struct dirent *ent;
+    char path[PATH_MAX];
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (is_dot_entry(ent->d_name)) continue;
+
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", entry_dir, ent->d_name);
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) size += (uint64_t) st.st_size;
+    }
+
+    closedir(dir);
+    return size;
+}
+
+static void cache_entry_remove(const char *entry_dir) {
+    DIR *dir = opendir(entry_dir);
+    if (dir) {
+        struct dirent *ent;
+        char path[PATH_MAX];
+
+        while ((ent = readdir(dir)) != NULL) {
+            if (is_dot_entry(ent->d_name)) continue;
+
+            snprintf(path, sizeof(path), "%s/%s", entry_dir, ent->d_name);
+            remove(path);
+        }
+
+        closedir(dir);
+    }
+
+    rmdir(entry_dir);
+}
+
+static char* cache_entry_file(const char *entry_dir) {
+    DIR *dir = opendir(entry_dir);
+    if (!dir) return NULL;
+
+    char *file_path = NULL;
+    struct dirent *ent;
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (is_dot_entry(ent->d_name)) continue;
+
+        struct stat st;
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", entry_dir, ent->d_name);
+
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            file_path = strdup(path);
+            break;
+        }
+    }
+
+    closedir(dir);
+    return file_path;
+}
+
+static bool make_cache_dir(const char *cache_dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s", cache_dir);
+
+    for (char *p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) return false;
+        *p = '/';
+    }
+
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static uint64_t cache_free_space(const char *cache_dir) {
+    struct statvfs vfs;
+    if (statvfs(cache_dir, &vfs) != 0) return UINT64_MAX;
+
+    return (uint64_t) vfs.f_bavail * vfs.f_frsize;
+}
+
+static int compare_last_used(const void *a, const void *b) {
+    const CacheEntry *entry_a = a;
+    const CacheEntry *entry_b = b;
+
+    if (entry_a->last_used < entry_b->last_used) return -1;
+    if (entry_a->last_used > entry_b->last_used) return 1;
+
+    return 0;
+}
+
+void archive_cache_trim(const char *cache_dir, uint64_t budget, const char *keep_key) {
+    DIR *dir = opendir(cache_dir);
+    if (!dir) return;
+
+    CacheEntry *entries = NULL;
+    size_t entry_count = 0;
+    size_t capacity = 0;
+    uint64_t total = 0;
+
+    struct dirent *ent;
+    char path[PATH_MAX];
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (is_dot_entry(ent->d_name)) continue;
+
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, ent->d_name);
+        if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+
+        //Leftover from an extraction that never finished
+        size_t name_len = strlen(ent->d_name);
+        size_t suffix_len = strlen(CACHE_STAGING_SUFFIX);
+        if (name_len > suffix_len &&
+            strcmp(ent->d_name + name_len - suffix_len, CACHE_STAGING_SUFFIX) == 0) {
+            cache_entry_remove(path);
+            continue;
+        }
+
+        if (entry_count >= capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            CacheEntry *grown = realloc(entries, capacity * sizeof(CacheEntry));
+            if (!grown) {
+                //Todo: Log error, memory allocation failure
+                break;
+            }
+            entries = grown;
+        }
+
+        CacheEntry *entry = &entries[entry_count++];
+        snprintf(entry->name, sizeof(entry->name), "%s", ent->d_name);
+        entry->last_used = st.st_mtime;
+        entry->size = cache_entry_size(path);
+        total += entry->size;
+    }
+
+    closedir(dir);
+    if (!entries) return;
+
+    qsort(entries, entry_count, sizeof(CacheEntry), compare_last_used);
+
+    uint64_t free_space = cache_free_space(cache_dir);
+    for (size_t i = 0; i < entry_count; i++) {
+        if (total <= budget && free_space >= CACHE_FREE_RESERVE) break;
+        if (keep_key && strcmp(entries[i].name, keep_key) == 0) continue;
+
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, entries[i].name);
+        cache_entry_remove(path);
+
+        total -= entries[i].size;
+        free_space += entries[i].size;
+    }
+
+    free(entries);
+}
+
+char* archive_cache_extract(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    const char *cache_dir,
+    uint64_t budget
+) {
+    char key[64];
+    char entry_dir[PATH_MAX];
+    char staging_dir[PATH_MAX + sizeof(CACHE_STAGING_SUFFIX)];
+
+    if (!archive_path || !cache_dir) return NULL;
+    if (!cache_entry_key(archive_path, file_inside_archive, file_index, key, sizeof(key))) return NULL;
+
+    snprintf(entry_dir, sizeof(entry_dir), "%s/%s", cache_dir, key);
+    snprintf(staging_dir, sizeof(staging_dir), "%s" CACHE_STAGING_SUFFIX, entry_dir);
+
+    char *cached_path = cache_entry_file(entry_dir);
+    if (cached_path) {
+        //Bump the entry to most recently used
+        utimensat(AT_FDCWD, entry_dir, NULL, 0);
+        return cached_path;
+    }
+
+    if (!make_cache_dir(cache_dir)) {
+        //Todo: Log error, failed to create cache directory
+        return NULL;
+    }
+
+    //Either of these may be left over from an interrupted run
+    cache_entry_remove(staging_dir);
+    cache_entry_remove(entry_dir);
+
+    if (mkdir(staging_dir, 0755) != 0) {
+        //Todo: Log error, failed to create staging directory
+        return NULL;
+    }
+
+    char *extracted_path = archive_extract_file(archive_path, file_inside_archive, file_index, staging_dir);
+    if (!extracted_path) {
+        cache_entry_remove(staging_dir);
+        return NULL;
+    }
+
+    const char *file_name = strrchr(extracted_path, '/');
+    file_name = file_name ? file_name + 1 : extracted_path;
+
+    size_t path_len = strlen(entry_dir) + 1 + strlen(file_name) + 1;
+    cached_path = malloc(path_len);
+    if (cached_path) snprintf(cached_path, path_len, "%s/%s", entry_dir, file_name);
+    free(extracted_path);
+
+    if (!cached_path || rename(staging_dir, entry_dir) != 0) {
+        //Todo: Log error, failed to move extracted file into cache
+        cache_entry_remove(staging_dir);
+        free(cached_path);
+        return NULL;
+    }
+
+    utimensat(AT_FDCWD, entry_dir, NULL, 0);
+    archive_cache_trim(cache_dir, budget, key);
+
+    return cached_path;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Extracts a file from an archive through the extraction cache.
+ *
+ * @details Entries are keyed by a hash of the archive identity (path, size and
+ * modification time) and the member index, and live in their own directory
+ * under `cache_dir` so the extracted file keeps its original name. A cache hit
+ * returns the existing file without touching the archive and marks the entry
+ * as most recently used.
+ *
+ * On a miss the file is extracted into a staging directory which is only
+ * renamed into place once extraction succeeded, so an interrupted extraction
+ * is never mistaken for a complete one. Least recently used entries are then
+ * evicted until the cache fits within `budget` bytes and the filesystem keeps
+ * a small reserve of free space. The entry that was just requested is never
+ * evicted, even if it alone is larger than the budget.
+ *
+ * @param archive_path The path to the archive.
+ * @param file_inside_archive The name of the file to extract (if index is not used).
+ * @param file_index The index of the file to extract.
+ * @param cache_dir The directory holding the cache, created if missing.
+ * @param budget The maximum size of the cache in bytes.
+ * @return The full path to the extracted file on success, NULL on failure.
+ *         The caller is responsible for freeing the returned path string.
+ */
+char* archive_cache_extract(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    const char *cache_dir,
+    uint64_t budget
+);
+
+/**
+ * @brief Evicts least recently used entries until the cache fits the budget.
+ *
+ * @details Also removes any staging directories left behind by extractions
+ * that never completed.
+ *
+ * @param cache_dir The directory holding the cache.
+ * @param budget The maximum size of the cache in bytes.
+ * @param keep_key Name of an entry that must not be evicted, or NULL.
+ */
+void archive_cache_trim(const char *cache_dir, uint64_t budget, const char *keep_key);
@@ -1,73 +1,675 @@
+//Archives run to several gigabytes, offsets past 2 GiB need a 64-bit off_t on the 32-bit targets
+#define _FILE_OFFSET_BITS 64
+
 #include "sprite_shrink/sprite_shrink.h"
 
 #include "archive.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Span of chunk data mapped at once, small enough to always fit in a 32-bit address space
+#define SSMC_DATA_WINDOW (32 * 1024 * 1024)
 
 static const char* ssmc_extensions[] = { ".ssmc", NULL };
 
 typedef struct ChunkIndexHandleU64 ChunkIndexHandleU64;
 typedef struct ChunkIndexHandleU128 ChunkIndexHandleU128;
 
-static bool ssmc_is_supported(const char *filename) {
-    return archive_helper_is_ext_supported(filename, ssmc_extensions);
+/*A bounded range of the archive. It is mapped when the address space allows
+and read into memory when the mapping fails. Chunk windows are shared by every
+chunk slot sliced out of them and go away with the last reference.*/
+typedef struct {
+    const uint8_t *data; //Start of the range asked for
+    uint64_t offset;
+    uint64_t length;     //How much of the archive from offset is covered
+    void *block;         //Mapping or heap buffer behind data
+    size_t block_size;
+    bool mapped;
+    atomic_int refs;
+} SsmcWindow;
+
+//A read-only view of an archive. Only the sections in use are ever mapped.
+typedef struct {
+    int fd;
+    uint64_t size;
+    FileHeader header;
+    SsmcWindow *manifest;
+    SsmcWindow *chunk_index;
+    SsmcWindow *dictionary;
+} SsmcArchiveMap;
+
+static bool ssmc_section_valid(const SsmcArchiveMap *map, uint64_t offset, uint64_t length) {
+    return offset <= map->size && length <= map->size - offset;
 }
 
-ArchiveEntry* ssmc_list_contents(const char *archive_path, int *count){
-    *count = 0;
-    ArchiveEntry *item_list = NULL;
+static bool pread_full(int fd, uint8_t *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
 
-    FILE *archive_file = NULL;
-    uint8_t *manifest_buffer = NULL;
-    FFIParsedManifestArrayU64 *parsed_manifest64 = NULL;
-    FFIParsedManifestArrayU128 *parsed_manifest128 = NULL;
+        buf += n;
+        len -= (size_t) n;
+        offset += n;
+    }
 
-    void *generic_parsed_manifest = NULL;
-    uintptr_t manifest_len = 0;
+    return true;
+}
+
+/**
+ * @brief Opens a window onto part of an archive.
+ *
+ * @details Maps `span` bytes from `offset` so neighbouring reads can share the
+ * window. When the mapping fails only the `length` bytes asked for are read.
+ *
+ * @param map Pointer to the archive.
+ * @param offset Start of the range in the archive.
+ * @param length Bytes that must be readable from `offset`.
+ * @param span Bytes worth mapping from `offset`, at least `length`.
+ * @return The window holding one reference, or NULL on failure.
+ */
+static SsmcWindow *ssmc_window_open(const SsmcArchiveMap *map, uint64_t offset, uint64_t length, uint64_t span) {
+    if (!ssmc_section_valid(map, offset, length)) return NULL;
+    if (length > SIZE_MAX / 2) return NULL;
+    if (span < length || !ssmc_section_valid(map, offset, span)) span = map->size - offset;
+    if (span > SIZE_MAX / 2) span = length;
+
+    SsmcWindow *window = calloc(1, sizeof(SsmcWindow));
+    if (!window) return NULL;
+
+    uint64_t page_mask = (uint64_t) sysconf(_SC_PAGESIZE) - 1;
+    uint64_t aligned = offset & ~page_mask;
+    size_t block_size = (size_t) (span + (offset - aligned));
+
+    void *block = block_size ? mmap(NULL, block_size, PROT_READ, MAP_PRIVATE, map->fd, (off_t) aligned) : MAP_FAILED;
+    if (block != MAP_FAILED) {
+        window->block = block;
+        window->block_size = block_size;
+        window->data = (const uint8_t *) block + (offset - aligned);
+        window->length = span;
+        window->mapped = true;
+    } else {
+        //Todo: Log warning, falling back to reading the range.
+        window->block = malloc(length ? (size_t) length : 1);
+        if (!window->block || !pread_full(map->fd, window->block, (size_t) length, (off_t) offset)) {
+            free(window->block);
+            free(window);
+            return NULL;
+        }
+        window->block_size = (size_t) length;
+        window->data = window->block;
+        window->length = length;
+    }
+
+    window->offset = offset;
+    atomic_init(&window->refs, 1);
+
+    return window;
+}
+
+static void ssmc_window_retain(SsmcWindow *window) {
+    atomic_fetch_add_explicit(&window->refs, 1, memory_order_relaxed);
+}
+
+static void ssmc_window_release(SsmcWindow *window) {
+    if (!window || atomic_fetch_sub_explicit(&window->refs, 1, memory_order_acq_rel) != 1) return;
+
+    if (window->mapped) {
+        munmap(window->block, window->block_size);
+    } else {
+        free(window->block);
+    }
+    free(window);
+}
+
+static bool ssmc_window_covers(const SsmcWindow *window, uint64_t offset, uint64_t length) {
+    return window && offset >= window->offset && offset - window->offset <= window->length &&
+           length <= window->length - (offset - window->offset);
+}
+
+//madvise requires a page aligned address so round the start of the range down.
+static void ssmc_advise(const SsmcWindow *window, uint64_t offset, uint64_t length, int advice) {
+    if (length == 0 || !window->mapped || !ssmc_window_covers(window, offset, length)) return;
+
+    uintptr_t page_mask = (uintptr_t) sysconf(_SC_PAGESIZE) - 1;
+    uintptr_t start = (uintptr_t) (window->data + (offset - window->offset));
+    uintptr_t aligned = start & ~page_mask;
+
+    madvise((void *) aligned, (size_t) (length + (start - aligned)), advice);
+}
+
+static void ssmc_unmap_archive(SsmcArchiveMap *map) {
+    ssmc_window_release(map->manifest);
+    ssmc_window_release(map->chunk_index);
+    ssmc_window_release(map->dictionary);
+    if (map->fd >= 0) close(map->fd);
+
+    map->manifest = NULL;
+    map->chunk_index = NULL;
+    map->dictionary = NULL;
+    map->fd = -1;
+}
 
-    archive_file = fopen(archive_path, "rb");
-    if (!archive_file) {
+/**
+ * @brief Opens an SSMC archive read-only and validates its header.
+ *
+ * @details The header is read from the file, checked against the magic number
+ * and every section it describes is bounds checked against the file size.
+ * Nothing is mapped yet, callers open windows onto the sections they need.
+ *
+ * @param archive_path The full path to the SSMC archive file.
+ * @param map Pointer to the map structure to fill in.
+ * @return `true` on success, `false` otherwise. On failure nothing is left
+ *         mapped or open.
+ */
+static bool ssmc_map_archive(const char *archive_path, SsmcArchiveMap *map) {
+    struct stat st;
+
+    memset(map, 0, sizeof(SsmcArchiveMap));
+    map->fd = open(archive_path, O_RDONLY | O_CLOEXEC);
+    if (map->fd < 0) {
         //Todo: Log error, failed to open file.
-        goto cleanup;
+        return false;
     }
 
-    FileHeader header;
-    if (fread(&header, sizeof(FileHeader), 1, archive_file) != 1) {
-        //Todo: Log error, failed to read file.
-        goto cleanup;
+    if (fstat(map->fd, &st) != 0 || st.st_size < (off_t) sizeof(FileHeader)) {
+        //Todo: Log error, failed to stat file or file too small.
+        goto fail;
+    }
+    map->size = (uint64_t) st.st_size;
+
+    if (!pread_full(map->fd, (uint8_t *) &map->header, sizeof(FileHeader), 0)) {
+        //Todo: Log error, failed to read archive header.
+        goto fail;
     }
 
     if (memcmp(
-        header.magic_num,
+        map->header.magic_num,
         MAGIC_NUMBER,
-        sizeof(header.magic_num)
+        sizeof(map->header.magic_num)
     ) != 0) {
         //Todo: Log error, magic number check failed. Likely unsupported
         // archive.
-        goto cleanup;
+        goto fail;
     }
 
-    manifest_buffer = malloc(header.man_length);
-    if (!manifest_buffer) {
-        //Todo: Log error, memory allocation failure
-        goto cleanup;
+    if (!ssmc_section_valid(map, map->header.man_offset, map->header.man_length) ||
+        !ssmc_section_valid(map, map->header.dict_offset, map->header.dict_length) ||
+        !ssmc_section_valid(map, map->header.chunk_index_offset, map->header.chunk_index_length) ||
+        map->header.data_offset > map->size) {
+        //Todo: Log error, header sections out of bounds. Likely malformed.
+        goto fail;
     }
 
-    if (fseek(archive_file, header.man_offset, SEEK_SET) != 0) {
-        //Todo: Log error, file seek failure
-        goto cleanup;
+    return true;
+
+    fail:
+        ssmc_unmap_archive(map);
+        return false;
+}
+
+//Opens a window over exactly one header section and asks for it to be paged in.
+static SsmcWindow *ssmc_map_section(const SsmcArchiveMap *map, uint64_t offset, uint64_t length) {
+    SsmcWindow *window = ssmc_window_open(map, offset, length, length);
+    if (window) ssmc_advise(window, offset, length, MADV_WILLNEED);
+
+    return window;
+}
+
+#define SSMC_MAX_WORKERS 4
+#define SSMC_QUEUE_DEPTH 2 //Slots per worker in each pipeline queue
+#define SSMC_WORKERS_ENV "MUX_SSMC_WORKERS" //Pins the worker count, used by the benchmark
+
+/*A single unit of work in the extraction pipeline. Chunk locations are
+resolved up front so the threads never touch the chunk index handle.*/
+typedef struct {
+    uint64_t src_offset;
+    uint64_t out_offset;
+    uint32_t comp_len;
+    uint32_t out_len;
+} ChunkJob;
+
+//All chunks making up a single file, in manifest order.
+typedef struct {
+    char *filename;
+    ChunkJob *jobs;
+    size_t count;
+} ChunkList;
+
+typedef struct {
+    const ChunkJob *job;
+    SsmcWindow *window;      //Holds a reference while comp_buf is in use
+    const uint8_t *comp_buf; //Slice of the window
+    uint8_t *out_buf;
+} ChunkSlot;
+
+typedef struct {
+    ChunkSlot *slots;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    bool closed;
+    bool aborted;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} ChunkQueue;
+
+typedef struct {
+    const SsmcArchiveMap *map;
+    const uint8_t *dictionary_buf;
+    const ChunkJob *jobs;
+    size_t job_count;
+    int active_workers;
+    ChunkQueue read_queue;
+    ChunkQueue write_queue;
+} ChunkPipeline;
+
+static bool chunk_queue_init(ChunkQueue *queue, size_t capacity) {
+    memset(queue, 0, sizeof(ChunkQueue));
+
+    queue->slots = calloc(capacity, sizeof(ChunkSlot));
+    if (!queue->slots) return false;
+
+    queue->capacity = capacity;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    return true;
+}
+
+static void chunk_queue_destroy(ChunkQueue *queue) {
+    if (!queue->slots) return;
+
+    //Anything left behind is the result of an aborted extraction
+    for (size_t i = 0; i < queue->count; i++) {
+        ChunkSlot *slot = &queue->slots[(queue->head + i) % queue->capacity];
+        ssmc_window_release(slot->window);
+        free(slot->out_buf);
+    }
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+static bool chunk_queue_push(ChunkQueue *queue, const ChunkSlot *slot) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->capacity && !queue->aborted) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
     }
-    if (fread(
-        manifest_buffer,
-        1,
-        header.man_length,
-        archive_file
-    ) != header.man_length) {
-        //Todo: Log error, failed to read manifest from archive.
-        // Likely malformed.
+
+    if (queue->aborted) {
+        pthread_mutex_unlock(&queue->lock);
+        return false;
+    }
+
+    queue->slots[(queue->head + queue->count) % queue->capacity] = *slot;
+    queue->count++;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+
+    return true;
+}
+
+//Returns false once the queue is drained and closed, or has been aborted.
+static bool chunk_queue_pop(ChunkQueue *queue, ChunkSlot *slot) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0 && !queue->closed && !queue->aborted) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+
+    if (queue->aborted || queue->count == 0) {
+        pthread_mutex_unlock(&queue->lock);
+        return false;
+    }
+
+    *slot = queue->slots[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+
+    return true;
+}
+
+static void chunk_queue_close(ChunkQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void chunk_queue_abort(ChunkQueue *queue) {
+    if (!queue->slots) return;
+
+    pthread_mutex_lock(&queue->lock);
+    queue->aborted = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void chunk_pipeline_abort(ChunkPipeline *pipeline) {
+    chunk_queue_abort(&pipeline->read_queue);
+    chunk_queue_abort(&pipeline->write_queue);
+}
+
+static bool pwrite_full(int fd, const uint8_t *buf, size_t len, off_t offset) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+
+        buf += n;
+        len -= (size_t) n;
+        offset += n;
+    }
+
+    return true;
+}
+
+/*Reader stage. Hands out slices of the chunk data in manifest order and asks
+the kernel to page each one in ahead of the workers, so the archive is read
+mostly sequentially regardless of how many workers are decompressing. Only a
+bounded window of the data is mapped at a time, a new one is opened whenever
+a chunk falls outside the current one.*/
+static void *chunk_reader_thread(void *arg) {
+    ChunkPipeline *pipeline = arg;
+    const SsmcArchiveMap *map = pipeline->map;
+    SsmcWindow *window = NULL;
+    size_t i;
+
+    for (i = 0; i < pipeline->job_count; i++) {
+        const ChunkJob *job = &pipeline->jobs[i];
+        ChunkSlot slot = { .job = job };
+        uint64_t src = map->header.data_offset + job->src_offset;
+
+        if (job->src_offset > map->size || !ssmc_section_valid(map, src, job->comp_len)) {
+            //Todo: Log error, chunk lies outside of archive. Likely malformed.
+            chunk_pipeline_abort(pipeline);
+            break;
+        }
+
+        if (!ssmc_window_covers(window, src, job->comp_len)) {
+            ssmc_window_release(window);
+
+            window = ssmc_window_open(map, src, job->comp_len, SSMC_DATA_WINDOW);
+            if (!window) {
+                //Todo: Log error, unable to read chunk data.
+                chunk_pipeline_abort(pipeline);
+                break;
+            }
+            ssmc_advise(window, src, window->length, MADV_SEQUENTIAL);
+        }
+
+        ssmc_advise(window, src, job->comp_len, MADV_WILLNEED);
+        ssmc_window_retain(window);
+        slot.window = window;
+        slot.comp_buf = window->data + (src - window->offset);
+
+        if (!chunk_queue_push(&pipeline->read_queue, &slot)) {
+            ssmc_window_release(window);
+            break;
+        }
+    }
+
+    ssmc_window_release(window);
+    if (i == pipeline->job_count) chunk_queue_close(&pipeline->read_queue);
+
+    return NULL;
+}
+
+//Last worker out lets the writer know nothing else is coming.
+static void chunk_worker_done(ChunkPipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->write_queue.lock);
+    bool last_worker = (--pipeline->active_workers == 0);
+    pthread_mutex_unlock(&pipeline->write_queue.lock);
+
+    if (last_worker) chunk_queue_close(&pipeline->write_queue);
+}
+
+//Decompression stage, one per worker thread.
+static void *chunk_worker_thread(void *arg) {
+    ChunkPipeline *pipeline = arg;
+    ChunkSlot slot;
+
+    while (chunk_queue_pop(&pipeline->read_queue, &slot)) {
+        slot.out_buf = malloc(slot.job->out_len);
+        if (!slot.out_buf) {
+            //Todo: Log error, memory allocation failure
+            ssmc_window_release(slot.window);
+            chunk_pipeline_abort(pipeline);
+            break;
+        }
+
+        FFIResult res = decompress_chunk_c(
+            slot.comp_buf,
+            slot.job->comp_len,
+            pipeline->dictionary_buf,
+            pipeline->map->header.dict_length,
+            slot.out_buf,
+            slot.job->out_len
+        );
+
+        //The compressed data is done with, let the window go as soon as possible
+        ssmc_window_release(slot.window);
+        slot.window = NULL;
+        slot.comp_buf = NULL;
+
+        if (res != StatusOk) {
+            //Todo: Log error, chunk decompression failure
+            free(slot.out_buf);
+            chunk_pipeline_abort(pipeline);
+            break;
+        }
+
+        if (!chunk_queue_push(&pipeline->write_queue, &slot)) {
+            free(slot.out_buf);
+            break;
+        }
+    }
+
+    chunk_worker_done(pipeline);
+    return NULL;
+}
+
+static int get_chunk_worker_count(size_t job_count) {
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = cpu_count > 0 ? (int) cpu_count : 1;
+
+    const char *pinned = getenv(SSMC_WORKERS_ENV);
+    if (pinned && *pinned) {
+        long requested = strtol(pinned, NULL, 10);
+        if (requested > 0) workers = requested < SSMC_MAX_WORKERS ? (int) requested : SSMC_MAX_WORKERS;
+    }
+
+    if (workers > SSMC_MAX_WORKERS) workers = SSMC_MAX_WORKERS;
+    if ((size_t) workers > job_count) workers = (int) job_count;
+
+    return workers > 0 ? workers : 1;
+}
+
+/**
+ * @brief Decompresses a list of chunks and hands them to a sink.
+ *
+ * @details Runs a three stage pipeline: a reader thread that pages in the
+ * compressed chunks in order through bounded windows, a pool of worker threads that decompress them
+ * against the shared dictionary, and the calling thread which passes each
+ * decompressed chunk to the sink. File extraction writes each chunk at its own
+ * output offset so does not care in which order workers finish. Streaming
+ * consumers set `ordered` and chunks are held back until all earlier chunks
+ * have been delivered.
+ *
+ * @param map Pointer to the mapped archive.
+ * @param dictionary_buf Buffer containing the decompression dictionary.
+ * @param jobs Array of resolved chunk jobs for the target file.
+ * @param job_count Number of entries in `jobs`.
+ * @param ordered Deliver chunks to the sink strictly in manifest order.
+ * @param sink Callback receiving each decompressed chunk.
+ * @param sink_data Opaque pointer handed back to `sink`.
+ * @return `true` if every chunk was decompressed and delivered, `false`
+ *         otherwise.
+ */
+static bool run_chunk_pipeline(
+    const SsmcArchiveMap *map,
+    const uint8_t *dictionary_buf,
+    const ChunkJob *jobs,
+    size_t job_count,
+    bool ordered,
+    ArchiveStreamCallback sink,
+    void *sink_data
+) {
+    ChunkPipeline pipeline = {
+        .map = map,
+        .dictionary_buf = dictionary_buf,
+        .jobs = jobs,
+        .job_count = job_count,
+    };
+
+    pthread_t reader;
+    pthread_t workers[SSMC_MAX_WORKERS];
+    ChunkSlot *pending = NULL;
+    int worker_count = get_chunk_worker_count(job_count);
+    int started_workers = 0;
+    bool reader_started = false;
+    bool success = false;
+
+    if (job_count == 0) return true;
+
+    size_t depth = (size_t) worker_count * SSMC_QUEUE_DEPTH;
+    if (!chunk_queue_init(&pipeline.read_queue, depth)) goto cleanup;
+    if (!chunk_queue_init(&pipeline.write_queue, depth)) goto cleanup;
+
+    if (ordered) {
+        pending = calloc(job_count, sizeof(ChunkSlot));
+        if (!pending) {
+            //Todo: Log error, memory allocation failure
+            goto cleanup;
+        }
+    }
+
+    pipeline.active_workers = worker_count;
+
+    if (pthread_create(&reader, NULL, chunk_reader_thread, &pipeline) != 0) {
+        //Todo: Log error, failed to start reader thread
         goto cleanup;
     }
+    reader_started = true;
+
+    for (int i = 0; i < worker_count; i++) {
+        if (pthread_create(
+            &workers[started_workers],
+            NULL,
+            chunk_worker_thread,
+            &pipeline
+        ) != 0) {
+            //Todo: Log error, failed to start worker thread
+            //Account for it so the write queue still closes
+            chunk_worker_done(&pipeline);
+            continue;
+        }
+        started_workers++;
+    }
+
+    if (started_workers == 0) goto cleanup;
+
+    size_t written = 0;
+    ChunkSlot slot;
+    while (chunk_queue_pop(&pipeline.write_queue, &slot)) {
+        if (ordered) {
+            pending[slot.job - jobs] = slot;
+
+            //Flush everything that is now contiguous with what has been sent
+            bool ok = true;
+            while (written < job_count && pending[written].out_buf) {
+                ChunkSlot *next = &pending[written];
+                ok = sink(next->out_buf, next->job->out_len, next->job->out_offset, sink_data) == 0;
+
+                free(next->out_buf);
+                next->out_buf = NULL;
+
+                if (!ok) break;
+                written++;
+            }
+
+            if (!ok) {
+                //Todo: Log error, stream consumer failure
+                chunk_pipeline_abort(&pipeline);
+                break;
+            }
+            continue;
+        }
+
+        bool ok = sink(slot.out_buf, slot.job->out_len, slot.job->out_offset, sink_data) == 0;
+        free(slot.out_buf);
+
+        if (!ok) {
+            //Todo: Log error, output write failure
+            chunk_pipeline_abort(&pipeline);
+            break;
+        }
+        written++;
+    }
+
+    success = (written == job_count);
+
+    cleanup:
+        if (!success) chunk_pipeline_abort(&pipeline);
+
+        if (reader_started) pthread_join(reader, NULL);
+        for (int i = 0; i < started_workers; i++) {
+            pthread_join(workers[i], NULL);
+        }
+
+        chunk_queue_destroy(&pipeline.read_queue);
+        chunk_queue_destroy(&pipeline.write_queue);
+
+        if (pending) {
+            for (size_t i = 0; i < job_count; i++) free(pending[i].out_buf);
+            free(pending);
+        }
+
+        return success;
+}
+
+static bool ssmc_is_supported(const char *filename) {
+    return archive_helper_is_ext_supported(filename, ssmc_extensions);
+}
+
+ArchiveEntry* ssmc_list_contents(const char *archive_path, int *count){
+    *count = 0;
+    ArchiveEntry *item_list = NULL;
+
+    SsmcArchiveMap map = { .fd = -1 };
+    FFIParsedManifestArrayU64 *parsed_manifest64 = NULL;
+    FFIParsedManifestArrayU128 *parsed_manifest128 = NULL;
+
+    void *generic_parsed_manifest = NULL;
+    uintptr_t manifest_len = 0;
+
+    //Only the manifest is needed to list, the dictionary, chunk index and
+    // chunk data are never touched so they are never mapped.
+    if (!ssmc_map_archive(archive_path, &map)) goto cleanup;
+
+    FileHeader header = map.header;
+    map.manifest = ssmc_map_section(&map, header.man_offset, header.man_length);
+    if (!map.manifest) goto cleanup;
+
+    const uint8_t *manifest_buffer = map.manifest->data;
 
     FFIResult result;
 
@@ -149,12 +751,7 @@ ArchiveEntry* ssmc_list_contents(const char *archive_path, int *count){
             item_list = NULL;
         }
 
-        if (archive_file) {
-            fclose(archive_file);
-        }
-        if (manifest_buffer) {
-            free(manifest_buffer);
-        }
+        ssmc_unmap_archive(&map);
         if (parsed_manifest64) {
             free_parsed_manifest_u64(parsed_manifest64);
         }
@@ -166,37 +763,31 @@ ArchiveEntry* ssmc_list_contents(const char *archive_path, int *count){
 }
 
 /**
- * @brief Extracts a file from an SSMC archive using 64-bit hashes.
+ * @brief Resolves the chunks of a file in an SSMC archive using 64-bit hashes.
  *
- * @details This helper function encapsulates the logic for extracting a file
- * from an archive that uses xxhash3_64. It handles parsing the manifest,
- * looking up chunks, and decompressing data.
+ * @details This helper function encapsulates the logic for locating a file in
+ * an archive that uses xxhash3_64. It handles parsing the manifest and looking
+ * up the archive location of every chunk so the decompression pipeline can run
+ * without touching the chunk index.
  *
- * @param archive_file Pointer to the open archive file.
  * @param header Pointer to the archive's file header.
  * @param manifest_buf Buffer containing the manifest data.
  * @param chunk_index_buf Buffer containing the chunk index data.
- * @param dictionary_buf Buffer containing the decompression dictionary.
  * @param file_inside_archive The name of the file to extract.
  * @param file_index Index of the file to extract.
- * @param target_dir The directory to extract the file to.
- * @return A dynamically allocated string containing the full path to the
- *         extracted file on success, or NULL on failure.
+ * @param list Pointer to the chunk list to fill in.
+ * @return `true` on success, `false` otherwise.
  */
-static char* extract_u64(
-    FILE *archive_file,
+static bool resolve_u64(
     const FileHeader *header,
     const uint8_t *manifest_buf,
     const uint8_t *chunk_index_buf,
-    const uint8_t *dictionary_buf,
     const char *file_inside_archive,
     int file_index,
-    const char *target_dir
+    ChunkList *list
 ) {
     FFIParsedManifestArrayU64 *p_manifest64 = NULL;
     ChunkIndexHandleU64 *chunk_index_handle64 = NULL;
-    char *output_path = NULL;
-    FILE *out_file = NULL;
     bool success = false;
 
     if (parse_file_metadata_u64(
@@ -236,14 +827,14 @@ static char* extract_u64(
 
     if (!target_manifest) goto cleanup;
 
-    output_path = malloc(
-        strlen(target_dir) + 1 + strlen(target_manifest->filename) + 1
-    );
-    if (!output_path) goto cleanup;
-    sprintf(output_path, "%s/%s", target_dir, target_manifest->filename);
+    list->filename = strdup(target_manifest->filename);
+    if (!list->filename) goto cleanup;
 
-    out_file = fopen(output_path, "wb");
-    if (!out_file) goto cleanup;
+    list->jobs = malloc(target_manifest->chunk_metadata_len * sizeof(ChunkJob));
+    if (!list->jobs && target_manifest->chunk_metadata_len > 0) {
+        //Todo: Log error, memory allocation failure
+        goto cleanup;
+    }
 
     for (uintptr_t i = 0; i < target_manifest->chunk_metadata_len; i++) {
         const FFISSAChunkMeta_u64 *chunk_meta = &target_manifest->chunk_metadata[i];
@@ -257,117 +848,47 @@ static char* extract_u64(
             goto cleanup;
         }
 
-        uint8_t *comp_buf = malloc(location.length);
-        if (!comp_buf) {
-            //Todo: Log error, memory allocation failure
-            goto cleanup;
-        }
-        uint8_t *decomp_buf = malloc(chunk_meta->length);
-        if (!decomp_buf) {
-            //Todo: Log error, memory allocation failure
-            free(comp_buf);
-            goto cleanup;
-        }
-
-        if (fseek(
-            archive_file,
-            header->data_offset + location.offset,
-            SEEK_SET
-        ) != 0){
-            //Todo: Log error, archive seek failure
-            free(comp_buf);
-            free(decomp_buf);
-            goto cleanup;
-        }
-        if (fread(
-            comp_buf,
-            1,
-            location.length,
-            archive_file
-        ) != location.length){
-            //Todo: Log error, archive read failure
-            free(comp_buf);
-            free(decomp_buf);
-            goto cleanup;
-        }
-
-        FFIResult res = decompress_chunk_c(
-            comp_buf,
-            location.length,
-            dictionary_buf,
-            header->dict_length,
-            decomp_buf,
-            chunk_meta->length
-        );
-
-        if (res == StatusOk){
-            if (fwrite(
-                decomp_buf, 1,
-                chunk_meta->length,
-                out_file
-            ) != chunk_meta->length) {
-                //Todo: Log error, archive read failure
-                free(comp_buf);
-                free(decomp_buf);
-                goto cleanup;
-            }
-        }
-
-        free(comp_buf);
-        free(decomp_buf);
-        if (res != StatusOk) goto cleanup;
+        list->jobs[i].src_offset = location.offset;
+        list->jobs[i].comp_len = location.length;
+        list->jobs[i].out_offset = chunk_meta->offset;
+        list->jobs[i].out_len = chunk_meta->length;
     }
-    //Todo: Log msg, file scuessfully decompressed.
+    list->count = target_manifest->chunk_metadata_len;
+
     success = true;
 
     cleanup:
-        if (out_file) fclose(out_file);
         if (p_manifest64) free_parsed_manifest_u64(p_manifest64);
         if (chunk_index_handle64) free_chunk_index_u64(chunk_index_handle64);
 
-        if(success) {
-            return output_path;
-        } else {
-            if (output_path) {
-                remove(output_path);
-                free(output_path);
-            }
-            return NULL;
-        }
+        return success;
 }
 
 /**
- * @brief Extracts a file from an SSMC archive using 128-bit hashes.
+ * @brief Resolves the chunks of a file in an SSMC archive using 128-bit hashes.
  *
- * This helper function encapsulates the logic for extracting a file from an
- * archive that uses xxhash3_128. It handles parsing the manifest, looking up
- * chunks, and decompressing data.
+ * This helper function encapsulates the logic for locating a file in an
+ * archive that uses xxhash3_128. It handles parsing the manifest and looking
+ * up the archive location of every chunk.
  *
- * @param archive_file Pointer to the open archive file.
  * @param header Pointer to the archive's file header.
  * @param manifest_buf Buffer containing the manifest data.
  * @param chunk_index_buf Buffer containing the chunk index data.
- * @param dictionary_buf Buffer containing the decompression dictionary.
  * @param file_inside_archive The name of the file to extract.
  * @param file_index: Index of the file to extract.
- * @param out_file Pointer to the open output file.
- * * @return A dynamically allocated string containing the full path to the
- *           extracted file on success, or NULL on failure.
+ * @param list Pointer to the chunk list to fill in.
+ * @return `true` on success, `false` otherwise.
  */
-static char* extract_u128(
-    FILE *archive_file,
+static bool resolve_u128(
     const FileHeader *header,
     const uint8_t *manifest_buf,
     const uint8_t *chunk_index_buf,
-    const uint8_t *dictionary_buf,
     const char *file_inside_archive,
     int file_index,
-    const char *target_dir
+    ChunkList *list
 ) {
     FFIParsedManifestArrayU128 *p_manifest128 = NULL;
     ChunkIndexHandleU128 *chunk_index_handle128 = NULL;
-    char *output_path = NULL;
-    FILE *out_file = NULL;
     bool success = false;
 
     if (parse_file_metadata_u128(
@@ -406,14 +927,14 @@ static char* extract_u128(
 
     if (!target_manifest) goto cleanup;
 
-    output_path = malloc(
-        strlen(target_dir) + 1 + strlen(target_manifest->filename) + 1
-    );
-    if (!output_path) goto cleanup;
-    sprintf(output_path, "%s/%s", target_dir, target_manifest->filename);
+    list->filename = strdup(target_manifest->filename);
+    if (!list->filename) goto cleanup;
 
-    out_file = fopen(output_path, "wb");
-    if (!out_file) goto cleanup;
+    list->jobs = malloc(target_manifest->chunk_metadata_len * sizeof(ChunkJob));
+    if (!list->jobs && target_manifest->chunk_metadata_len > 0) {
+        //Todo: Log error, memory allocation failure
+        goto cleanup;
+    }
 
     for (uintptr_t i = 0; i < target_manifest->chunk_metadata_len; i++) {
         const FFISSAChunkMeta_U128Bytes *chunk_meta = &target_manifest->chunk_metadata[i];
@@ -427,202 +948,211 @@ static char* extract_u128(
             goto cleanup;
         }
 
-        uint8_t *comp_buf = malloc(location.length);
-        if (!comp_buf) {
-            //Todo: Log error, memory allocation failure
-            goto cleanup;
-        }
-        uint8_t *decomp_buf = malloc(chunk_meta->length);
-        if (!decomp_buf) {
-            //Todo: Log error, memory allocation failure
-            free(comp_buf);
-            goto cleanup;
-        }
-
-        if (fseek(
-            archive_file,
-            header->data_offset + location.offset,
-            SEEK_SET
-        ) != 0){
-            //Todo: Log error, archive seek failure
-            free(comp_buf);
-            free(decomp_buf);
-            goto cleanup;
-        }
-        if (fread(
-            comp_buf,
-            1,
-            location.length,
-            archive_file
-        ) != location.length){
-            //Todo: Log error, archive read failure
-            free(comp_buf);
-            free(decomp_buf);
-            goto cleanup;
-        }
-
-        FFIResult res = decompress_chunk_c(
-            comp_buf,
-            location.length,
-            dictionary_buf,
-            header->dict_length,
-            decomp_buf,
-            chunk_meta->length
-        );
-
-        if (res == StatusOk){
-            if (fwrite(
-                decomp_buf, 1,
-                chunk_meta->length,
-                out_file
-            ) != chunk_meta->length) {
-                //Todo: Log error, archive read failure
-                free(comp_buf);
-                free(decomp_buf);
-                goto cleanup;
-            }
-        }
-
-        free(comp_buf);
-        free(decomp_buf);
-        if (res != StatusOk) goto cleanup;
+        list->jobs[i].src_offset = location.offset;
+        list->jobs[i].comp_len = location.length;
+        list->jobs[i].out_offset = chunk_meta->offset;
+        list->jobs[i].out_len = chunk_meta->length;
     }
-    //Todo: Log msg, file scuessfully decompressed.
+    list->count = target_manifest->chunk_metadata_len;
+
     success = true;
 
     cleanup:
-        if (out_file) fclose(out_file);
         if (p_manifest128) free_parsed_manifest_u128(p_manifest128);
         if (chunk_index_handle128) free_chunk_index_u128(chunk_index_handle128);
 
-        if(success) {
-            return output_path;
-        } else {
-            if (output_path) {
-                remove(output_path);
-                free(output_path);
-            }
-            return NULL;
-        }
-
+        return success;
 }
 
+static void free_chunk_list(ChunkList *list) {
+    free(list->filename);
+    free(list->jobs);
+    memset(list, 0, sizeof(ChunkList));
+}
 
 /**
- * @brief Extracts a single file from an SSMC archive to a target directory.
+ * @brief Maps an SSMC archive and resolves the chunks of a single file.
  *
- * This is the main extraction function. It reads the archive header, allocates
- * memory for the main data sections (manifest, chunk index, dictionary), and
- * then delegates to the appropriate helper function (extract_u64 or
- * extract_u128) based on the hash type specified in the header.
+ * @details Maps the manifest, chunk index and dictionary in windows of their
+ * own and delegates to the appropriate helper function (resolve_u64 or resolve_u128)
+ * based on the hash type specified in the header.
  *
  * @param archive_path The full path to the SSMC archive file.
  * @param file_inside_archive The name of the file to extract (can be NULL if
  *        using index).
  * @param file_index The index of the file to extract (use -1 if using name).
- * @param target_dir The directory to extract the file to.
- * @return A dynamically allocated string containing the full path to the
- *         extracted file on success, or NULL on failure.
+ * @param map Pointer to the map structure to fill in.
+ * @param list Pointer to the chunk list to fill in.
+ * @return `true` on success, `false` otherwise. On failure the archive is
+ *         unmapped and the list is empty.
  */
-static char* ssmc_extract_file(
+static bool ssmc_open_file(
     const char *archive_path,
     const char *file_inside_archive,
     int file_index,
-    const char *target_dir
-){
-    FILE *archive_file = NULL;
-    uint8_t *manifest_buf = NULL;
-    uint8_t *chunk_index_buf = NULL;
-    uint8_t*dictionary_buf = NULL;
-    char *result_path = NULL;
+    SsmcArchiveMap *map,
+    ChunkList *list
+) {
+    bool success = false;
 
-    archive_file = fopen(archive_path, "rb");
-    if (!archive_file) goto cleanup;
+    memset(list, 0, sizeof(ChunkList));
+    if (!ssmc_map_archive(archive_path, map)) return false;
 
-    FileHeader header;
-    if (fread(&header, sizeof(FileHeader), 1, archive_file) != 1) goto cleanup;
-    if (memcmp(
-        header.magic_num,
-        MAGIC_NUMBER,
-        sizeof(header.magic_num)
-    ) != 0) goto cleanup;
-
-    manifest_buf = malloc(header.man_length);
-    if (!manifest_buf) goto cleanup;
-    if (fseek(
-        archive_file,
-        header.man_offset,
-        SEEK_SET
-    ) != 0) goto cleanup;
-    if (fread(
-        manifest_buf, 1,
-        header.man_length,
-        archive_file
-    ) != header.man_length) goto cleanup;
-
-    chunk_index_buf = malloc(header.chunk_index_length);
-    if (!chunk_index_buf) goto cleanup;
-    if (fseek(
-        archive_file,
-        header.chunk_index_offset,
-        SEEK_SET
-    ) != 0) goto cleanup;
-    if (fread(
-        chunk_index_buf,
-        1,
-        header.chunk_index_length,
-        archive_file
-    ) != header.chunk_index_length) goto cleanup;
-
-    dictionary_buf = malloc(header.dict_length);
-    if (!dictionary_buf) goto cleanup;
-    if (fseek(
-        archive_file,
-        header.dict_offset,
-        SEEK_SET
-    ) != 0) goto cleanup;
-    if (fread(
-        dictionary_buf,
-        1,
-        header.dict_length,
-        archive_file
-    ) != header.dict_length) goto cleanup;
-
-    if (header.hash_type == 1) {
-        result_path = extract_u64(
-            archive_file,
-            &header,
+    const FileHeader *header = &map->header;
+
+    map->manifest = ssmc_map_section(map, header->man_offset, header->man_length);
+    map->chunk_index = ssmc_map_section(map, header->chunk_index_offset, header->chunk_index_length);
+    map->dictionary = ssmc_map_section(map, header->dict_offset, header->dict_length);
+
+    const uint8_t *manifest_buf = map->manifest ? map->manifest->data : NULL;
+    const uint8_t *chunk_index_buf = map->chunk_index ? map->chunk_index->data : NULL;
+
+    if (!manifest_buf || !chunk_index_buf || !map->dictionary) {
+        //Todo: Log error, unable to read archive sections.
+    } else if (header->hash_type == 1) {
+        success = resolve_u64(
+            header,
             manifest_buf,
             chunk_index_buf,
-            dictionary_buf,
             file_inside_archive,
             file_index,
-            target_dir
+            list
         );
-    } else if (header.hash_type == 2) {
-        result_path = extract_u128(
-            archive_file,
-            &header,
+    } else if (header->hash_type == 2) {
+        success = resolve_u128(
+            header,
             manifest_buf,
             chunk_index_buf,
-            dictionary_buf,
             file_inside_archive,
             file_index,
-            target_dir
+            list
         );
     } else {
         //Todo: Log error, unsupported hash type
-        goto cleanup;
     }
 
+    if (!success) {
+        free_chunk_list(list);
+        ssmc_unmap_archive(map);
+    }
+
+    return success;
+}
+
+static int pwrite_sink(const uint8_t *data, size_t length, uint64_t offset, void *user_data) {
+    int out_fd = *(int *) user_data;
+    return pwrite_full(out_fd, data, length, (off_t) offset) ? 0 : -1;
+}
+
+/**
+ * @brief Extracts a single file from an SSMC archive to a target directory.
+ *
+ * This is the main extraction function. It maps the archive read-only,
+ * resolves the chunks of the requested file and runs them through the
+ * decompression pipeline, writing each chunk at its output offset.
+ *
+ * @param archive_path The full path to the SSMC archive file.
+ * @param file_inside_archive The name of the file to extract (can be NULL if
+ *        using index).
+ * @param file_index The index of the file to extract (use -1 if using name).
+ * @param target_dir The directory to extract the file to.
+ * @return A dynamically allocated string containing the full path to the
+ *         extracted file on success, or NULL on failure.
+ */
+static char* ssmc_extract_file(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    const char *target_dir
+){
+    SsmcArchiveMap map = { .fd = -1 };
+    ChunkList list;
+    char *output_path = NULL;
+    int out_fd = -1;
+    bool success = false;
+
+    if (!ssmc_open_file(archive_path, file_inside_archive, file_index, &map, &list)) {
+        return NULL;
+    }
+
+    output_path = malloc(strlen(target_dir) + 1 + strlen(list.filename) + 1);
+    if (!output_path) goto cleanup;
+    sprintf(output_path, "%s/%s", target_dir, list.filename);
+
+    out_fd = open(output_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) goto cleanup;
+
+    if (!run_chunk_pipeline(
+        &map,
+        map.dictionary->data,
+        list.jobs,
+        list.count,
+        false,
+        pwrite_sink,
+        &out_fd
+    )) goto cleanup;
+
+    //Todo: Log msg, file scuessfully decompressed.
+    success = true;
+
     cleanup:
-        if (archive_file) fclose(archive_file);
+        if (out_fd >= 0) close(out_fd);
+        free_chunk_list(&list);
+        ssmc_unmap_archive(&map);
+
+        if (!success && output_path) {
+            remove(output_path);
+            free(output_path);
+            output_path = NULL;
+        }
+
+        return output_path;
+}
+
+/**
+ * @brief Streams a single file from an SSMC archive to a callback.
+ *
+ * @details Runs the same decompression pipeline as `ssmc_extract_file` but
+ * delivers each decompressed chunk to `write_cb` strictly in file order, so
+ * the consumer can start on the data before the whole file is decompressed.
+ *
+ * @param archive_path The full path to the SSMC archive file.
+ * @param file_inside_archive The name of the file to extract (can be NULL if
+ *        using index).
+ * @param file_index The index of the file to extract (use -1 if using name).
+ * @param write_cb Callback receiving each chunk in order.
+ * @param user_data Opaque pointer handed back to `write_cb`.
+ * @return `true` if the whole file was delivered, `false` otherwise.
+ */
+static bool ssmc_extract_stream(
+    const char *archive_path,
+    const char *file_inside_archive,
+    int file_index,
+    ArchiveStreamCallback write_cb,
+    void *user_data
+) {
+    SsmcArchiveMap map = { .fd = -1 };
+    ChunkList list;
+
+    if (!write_cb) return false;
+    if (!ssmc_open_file(archive_path, file_inside_archive, file_index, &map, &list)) {
+        return false;
+    }
+
+    bool success = run_chunk_pipeline(
+        &map,
+        map.dictionary->data,
+        list.jobs,
+        list.count,
+        true,
+        write_cb,
+        user_data
+    );
 
-        if (manifest_buf) free(manifest_buf);
-        if (chunk_index_buf) free(chunk_index_buf);
-        if (dictionary_buf) free(dictionary_buf);
+    free_chunk_list(&list);
+    ssmc_unmap_archive(&map);
 
-        return result_path;
+    return success;
 }
 
 static const char* ssmc_get_handler_name(void) {
@@ -637,6 +1167,7 @@ static ArchiveVTable arc_ssmc_vtable = {
     .is_supported = ssmc_is_supported,
     .list_contents = ssmc_list_contents,
     .extract_file = ssmc_extract_file,
+    .extract_stream = ssmc_extract_stream,
     .get_handler_name = ssmc_get_handler_name,
     .get_supported_extensions = ssmc_get_supported_extensions,
 };
@@ -0,0 +1,258 @@
+#include "catalogue_index.h"
+#include "common.h"
+#include <dirent.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+typedef struct {
+    uint32_t hash;
+    uint32_t name; // Offset into names, 0 is an empty slot
+} CatalogueSlot;
+
+typedef struct {
+    char path[PATH_MAX];
+    uint32_t hash;
+
+    bool exists;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+
+    CatalogueSlot *slots;
+    uint32_t slot_count;
+    char *names;
+
+    uint64_t checked_ms;
+    uint64_t last_used;
+} CatalogueDir;
+
+static pthread_mutex_t index_lock = PTHREAD_MUTEX_INITIALIZER;
+static CatalogueDir dirs[CATALOGUE_INDEX_CACHE_SIZE];
+static size_t dir_count = 0;
+static uint64_t use_counter = 0;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
+
+static void dir_unload(CatalogueDir *dir) {
+    free(dir->slots);
+    free(dir->names);
+
+    dir->slots = NULL;
+    dir->names = NULL;
+    dir->slot_count = 0;
+    dir->exists = false;
+}
+
+static void slot_insert(CatalogueDir *dir, uint32_t hash, uint32_t name) {
+    uint32_t mask = dir->slot_count - 1;
+    uint32_t pos = hash & mask;
+
+    while (dir->slots[pos].name) pos = (pos + 1) & mask;
+
+    dir->slots[pos].hash = hash;
+    dir->slots[pos].name = name;
+}
+
+static bool dir_load(CatalogueDir *dir) {
+    DIR *handle = opendir(dir->path);
+    if (!handle) return false;
+
+    // The names region starts with a nul so offset 0 can mark an empty slot
+    size_t names_size = 1;
+    size_t names_capacity = 4096;
+    uint32_t name_count = 0;
+    char *names = malloc(names_capacity);
+    if (!names) {
+        closedir(handle);
+        return false;
+    }
+    names[0] = '\0';
+
+    struct dirent *entry;
+    while ((entry = readdir(handle))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        size_t length = strlen(entry->d_name) + 1;
+        if (names_size + length > names_capacity) {
+            while (names_size + length > names_capacity) names_capacity *= 2;
+
+            char *grown = realloc(names, names_capacity);
+            if (!grown) {
+                free(names);
+                closedir(handle);
+                return false;
+            }
+            names = grown;
+        }
+
+        memcpy(names + names_size, entry->d_name, length);
+        names_size += length;
+        name_count++;
+    }
+    closedir(handle);
+
+    uint32_t slot_count = 8;
+    while (slot_count < name_count * 2) slot_count *= 2;
+
+    dir->slots = calloc(slot_count, sizeof(CatalogueSlot));
+    if (!dir->slots) {
+        free(names);
+        return false;
+    }
+
+    dir->names = names;
+    dir->slot_count = slot_count;
+
+    for (size_t offset = 1; offset < names_size; offset += strlen(names + offset) + 1) {
+        slot_insert(dir, fnv1a_hash_str(names + offset), (uint32_t) offset);
+    }
+
+    return true;
+}
+
+static CatalogueDir *dir_slot(const char *path, uint32_t hash) {
+    CatalogueDir *dir;
+
+    if (dir_count < CATALOGUE_INDEX_CACHE_SIZE) {
+        dir = &dirs[dir_count++];
+    } else {
+        dir = &dirs[0];
+        for (size_t i = 1; i < dir_count; i++) {
+            if (dirs[i].last_used < dir->last_used) dir = &dirs[i];
+        }
+        dir_unload(dir);
+    }
+
+    memset(dir, 0, sizeof(CatalogueDir));
+    snprintf(dir->path, sizeof(dir->path), "%s", path);
+    dir->hash = hash;
+
+    return dir;
+}
+
+static CatalogueDir *dir_get(const char *path) {
+    uint64_t now = now_ms();
+    uint32_t hash = fnv1a_hash_str(path);
+    CatalogueDir *dir = NULL;
+
+    for (size_t i = 0; i < dir_count; i++) {
+        if (dirs[i].hash == hash && strcmp(dirs[i].path, path) == 0) {
+            dir = &dirs[i];
+            break;
+        }
+    }
+
+    if (dir && now - dir->checked_ms < CATALOGUE_INDEX_RECHECK_MS) {
+        dir->last_used = ++use_counter;
+        return dir;
+    }
+
+    struct stat st;
+    bool exists = stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+
+    if (dir && dir->exists == exists &&
+        (!exists || (dir->dev == st.st_dev && dir->ino == st.st_ino &&
+                     dir->mtime.tv_sec == st.st_mtim.tv_sec &&
+                     dir->mtime.tv_nsec == st.st_mtim.tv_nsec))) {
+        dir->checked_ms = now;
+        dir->last_used = ++use_counter;
+        return dir;
+    }
+
+    if (dir) {
+        dir_unload(dir);
+    } else {
+        dir = dir_slot(path, hash);
+    }
+
+    dir->checked_ms = now;
+    dir->last_used = ++use_counter;
+
+    if (exists) {
+        dir->dev = st.st_dev;
+        dir->ino = st.st_ino;
+        dir->mtime = st.st_mtim;
+        dir->exists = dir_load(dir);
+    }
+
+    return dir;
+}
+
+static bool dir_has(const CatalogueDir *dir, const char *name) {
+    if (!dir->exists || !dir->slot_count) return false;
+
+    uint32_t hash = fnv1a_hash_str(name);
+    uint32_t mask = dir->slot_count - 1;
+
+    for (uint32_t probe = 0, pos = hash & mask; probe < dir->slot_count; probe++, pos = (pos + 1) & mask) {
+        const CatalogueSlot *slot = &dir->slots[pos];
+
+        if (slot->name == 0) return false;
+        if (slot->hash == hash && strcmp(dir->names + slot->name, name) == 0) return true;
+    }
+
+    return false;
+}
+
+// Drop trailing slashes so "box/" and "box" share a listing
+static size_t trim_dir(char *path, size_t length) {
+    while (length > 1 && path[length - 1] == '/') path[--length] = '\0';
+    return length;
+}
+
+bool catalogue_index_file_exists(const char *path) {
+    if (!path || !*path) return false;
+
+    const char *slash = strrchr(path, '/');
+    if (!slash || slash == path || !slash[1]) return file_exist((char *) path);
+
+    char dir_path[PATH_MAX];
+    size_t length = (size_t) (slash - path);
+    if (length >= sizeof(dir_path)) return file_exist((char *) path);
+
+    memcpy(dir_path, path, length);
+    dir_path[length] = '\0';
+    trim_dir(dir_path, length);
+
+    pthread_mutex_lock(&index_lock);
+    bool found = dir_has(dir_get(dir_path), slash + 1);
+    pthread_mutex_unlock(&index_lock);
+
+    return found;
+}
+
+bool catalogue_index_dir_exists(const char *dir) {
+    if (!dir || !*dir) return false;
+
+    char dir_path[PATH_MAX];
+    int length = snprintf(dir_path, sizeof(dir_path), "%s", dir);
+    if (length < 0 || (size_t) length >= sizeof(dir_path)) return directory_exist((char *) dir);
+
+    trim_dir(dir_path, (size_t) length);
+
+    pthread_mutex_lock(&index_lock);
+    bool exists = dir_get(dir_path)->exists;
+    pthread_mutex_unlock(&index_lock);
+
+    return exists;
+}
+
+void catalogue_index_invalidate(void) {
+    pthread_mutex_lock(&index_lock);
+
+    for (size_t i = 0; i < dir_count; i++) dir_unload(&dirs[i]);
+    dir_count = 0;
+
+    pthread_mutex_unlock(&index_lock);
+}
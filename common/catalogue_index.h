@@ -0,0 +1,26 @@
+#pragma once
+
+#ifndef CATALOGUE_INDEX_H
+#define CATALOGUE_INDEX_H
+
+#include <stdbool.h>
+
+// How many directory listings are kept in memory per process
+#define CATALOGUE_INDEX_CACHE_SIZE 64
+
+// Minimum time between checks of a listing against its directory mtime
+#define CATALOGUE_INDEX_RECHECK_MS 1000
+
+/*
+ * Answers "does this catalogue image exist" from an in memory listing of its
+ * directory instead of a filesystem lookup per candidate path. Each directory
+ * is read once and re-read when its mtime changes, which is exactly when an
+ * entry is added, removed or renamed. Safe to call from any thread.
+ */
+bool catalogue_index_file_exists(const char *path);
+
+bool catalogue_index_dir_exists(const char *dir);
+
+void catalogue_index_invalidate(void);
+
+#endif
@@ -1,15 +1,27 @@
 #define _GNU_SOURCE
 
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "collection_theme.h"
 #include "common.h"
+#include "log.h"
+#include "json/json.h"
+#include "json_index.h"
+#include "text_file.h"
+
+#define THEME_EXTENSION ".muxthm"
+
+static theme_catalogue catalogue;
+static bool catalogue_loaded = false;
+static struct stat catalogue_stat;
 
 theme_item *add_theme_item(theme_item **theme_items, size_t *count, const char *name, const char *url,
-                           bool grid_enabled, bool hdmi_enabled, bool language_enabled, bool resolution640x480,
-                           bool resolution720x480, bool resolution720x720, bool resolution1024x768,
-                           bool resolution1280x720) {
+                           uint32_t features) {
 
     if (*theme_items == NULL) {
         *theme_items = malloc(sizeof(theme_item));
@@ -19,26 +31,34 @@ theme_item *add_theme_item(theme_item **theme_items, size_t *count, const char *
 
     (*theme_items)[*count].name = strdup(name);
     (*theme_items)[*count].url = strdup(url);
-    (*theme_items)[*count].grid_enabled = grid_enabled;
-    (*theme_items)[*count].hdmi_enabled = hdmi_enabled;
-    (*theme_items)[*count].language_enabled = language_enabled;
-    (*theme_items)[*count].resolution640x480 = resolution640x480;
-    (*theme_items)[*count].resolution720x480 = resolution720x480;
-    (*theme_items)[*count].resolution720x720 = resolution720x720;
-    (*theme_items)[*count].resolution1024x768 = resolution1024x768;
-    (*theme_items)[*count].resolution1280x720 = resolution1280x720;
+    (*theme_items)[*count].features = features;
 
     (*count)++;
 
     return &(*theme_items)[*count - 1];
 }
 
+static void lower_copy(char *dest, size_t dest_size, const char *src) {
+    size_t len = 0;
+
+    while (src[len] && len + 1 < dest_size) {
+        dest[len] = (char) tolower((unsigned char) src[len]);
+        len++;
+    }
+    dest[len] = '\0';
+}
+
 int theme_item_compare(const void *a, const void *b) {
     theme_item *itemA = (theme_item *) a;
     theme_item *itemB = (theme_item *) b;
 
+    char lowerA[NAME_MAX + 1];
+    char lowerB[NAME_MAX + 1];
+    lower_copy(lowerA, sizeof(lowerA), itemA->name);
+    lower_copy(lowerB, sizeof(lowerB), itemB->name);
+
     // Use strverscmp for natural sorting on sort_name
-    return strverscmp(str_tolower(itemA->name), str_tolower(itemB->name));
+    return strverscmp(lowerA, lowerB);
 }
 
 int theme_item_exists(theme_item *theme_items, size_t count, const char *name) {
@@ -65,3 +85,204 @@ void free_theme_items(theme_item **theme_items, size_t *count) {
     *theme_items = NULL; // Set the pointer to NULL
     *count = 0; // Set the count to 0
 }
+
+void theme_catalogue_invalidate(void) {
+    free(catalogue.items);
+    free(catalogue.strings);
+
+    catalogue = (theme_catalogue) {0};
+    catalogue_loaded = false;
+}
+
+// Copies a json string onto the end of the string block, returning its offset or -1 when out of memory
+static ssize_t append_json_string(char **strings, size_t *size, size_t *capacity, struct json value) {
+    bool is_string = json_type(value) == JSON_STRING;
+
+    for (;;) {
+        size_t available = *capacity - *size;
+        size_t needed = *size + 1;
+
+        if (available) {
+            size_t length = 0;
+
+            if (is_string) {
+                length = json_string_copy(value, *strings + *size, available);
+            } else {
+                (*strings)[*size] = '\0';
+            }
+
+            if (length < available) {
+                ssize_t offset = (ssize_t) *size;
+                *size += length + 1;
+                return offset;
+            }
+
+            needed += length;
+        }
+
+        size_t grown = *capacity ? *capacity * 2 : 4096;
+        while (grown < needed) grown *= 2;
+
+        char *resized = realloc(*strings, grown);
+        if (!resized) return -1;
+
+        *strings = resized;
+        *capacity = grown;
+    }
+}
+
+static bool catalogue_parse(const char *json_str) {
+    enum {
+        THEME_KEY_GRID, THEME_KEY_HDMI, THEME_KEY_LANGUAGE,
+        THEME_KEY_640X480, THEME_KEY_720X480, THEME_KEY_720X720, THEME_KEY_1024X768, THEME_KEY_1280X720,
+        THEME_KEY_NAME, THEME_KEY_URL, THEME_KEY_COUNT
+    };
+
+    static const char *const theme_keys[THEME_KEY_COUNT] = {
+            [THEME_KEY_GRID] = "grid",
+            [THEME_KEY_HDMI] = "hdmi",
+            [THEME_KEY_LANGUAGE] = "language",
+            [THEME_KEY_640X480] = "resolution640x480",
+            [THEME_KEY_720X480] = "resolution720x480",
+            [THEME_KEY_720X720] = "resolution720x720",
+            [THEME_KEY_1024X768] = "resolution1024x768",
+            [THEME_KEY_1280X720] = "resolution1280x720",
+            [THEME_KEY_NAME] = "name",
+            [THEME_KEY_URL] = "url",
+    };
+
+    // Feature bit for each of the boolean keys above, in the same order
+    static const uint32_t theme_features[] = {
+            THEME_FEATURE_GRID, THEME_FEATURE_HDMI, THEME_FEATURE_LANGUAGE,
+            THEME_FEATURE_640X480, THEME_FEATURE_720X480, THEME_FEATURE_720X720,
+            THEME_FEATURE_1024X768, THEME_FEATURE_1280X720,
+    };
+
+    struct json root = json_parse(json_str);
+    if (json_type(root) != JSON_ARRAY) return false;
+
+    size_t capacity = 0;
+    size_t strings_size = 0;
+    size_t strings_capacity = 0;
+
+    struct json theme_values[THEME_KEY_COUNT];
+
+    json_array_each(theme_entry, root) {
+        if (json_type(theme_entry) != JSON_OBJECT) continue;
+        json_object_pick(theme_entry, theme_keys, theme_values, THEME_KEY_COUNT);
+
+        if (catalogue.count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+
+            theme_item *items = realloc(catalogue.items, capacity * sizeof(theme_item));
+            if (!items) return false;
+
+            catalogue.items = items;
+        }
+
+        ssize_t name = append_json_string(&catalogue.strings, &strings_size, &strings_capacity,
+                                          theme_values[THEME_KEY_NAME]);
+        ssize_t url = append_json_string(&catalogue.strings, &strings_size, &strings_capacity,
+                                         theme_values[THEME_KEY_URL]);
+        if (name < 0 || url < 0) return false;
+
+        uint32_t features = 0;
+        for (size_t i = 0; i < A_SIZE(theme_features); i++) {
+            if (json_bool(theme_values[i])) features |= theme_features[i];
+        }
+
+        // Offsets for now, the string block can still move
+        catalogue.items[catalogue.count++] = (theme_item) {
+                .name = (char *) (uintptr_t) name,
+                .url = (char *) (uintptr_t) url,
+                .features = features,
+        };
+    }
+
+    for (size_t i = 0; i < catalogue.count; i++) {
+        catalogue.items[i].name = catalogue.strings + (uintptr_t) catalogue.items[i].name;
+        catalogue.items[i].url = catalogue.strings + (uintptr_t) catalogue.items[i].url;
+    }
+
+    sort_theme_items(catalogue.items, catalogue.count);
+    return true;
+}
+
+const theme_catalogue *theme_catalogue_load(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        theme_catalogue_invalidate();
+        return NULL;
+    }
+
+    if (catalogue_loaded &&
+        st.st_dev == catalogue_stat.st_dev && st.st_ino == catalogue_stat.st_ino &&
+        st.st_size == catalogue_stat.st_size &&
+        st.st_mtim.tv_sec == catalogue_stat.st_mtim.tv_sec &&
+        st.st_mtim.tv_nsec == catalogue_stat.st_mtim.tv_nsec) {
+        return &catalogue;
+    }
+
+    theme_catalogue_invalidate();
+
+    char *json_str = text_file_read_all(path);
+    if (!json_str) return NULL;
+
+    bool parsed = json_valid(json_str) && catalogue_parse(json_str);
+    free(json_str);
+
+    if (!parsed) {
+        LOG_ERROR(mux_module, "Unable to parse theme data: %s", path)
+        theme_catalogue_invalidate();
+        return NULL;
+    }
+
+    catalogue_stat = st;
+    catalogue_loaded = true;
+
+    return &catalogue;
+}
+
+void theme_catalogue_downloaded(const theme_item *const items[], size_t count, const char *dir, bool downloaded[]) {
+    for (size_t i = 0; i < count; i++) downloaded[i] = false;
+    if (!count) return;
+
+    size_t slot_count = 64;
+    while (slot_count < count * 2) slot_count *= 2;
+
+    // Item index + 1 by name hash, 0 is empty
+    size_t *slots = calloc(slot_count, sizeof(size_t));
+    if (!slots) return;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t at = fnv1a_hash_str(items[i]->name) & (slot_count - 1);
+        while (slots[at]) at = (at + 1) & (slot_count - 1);
+        slots[at] = i + 1;
+    }
+
+    DIR *theme_dir = opendir(dir);
+    if (theme_dir) {
+        size_t extension_length = strlen(THEME_EXTENSION);
+        struct dirent *entry;
+
+        while ((entry = readdir(theme_dir))) {
+            size_t length = strlen(entry->d_name);
+            if (length <= extension_length ||
+                strcmp(entry->d_name + length - extension_length, THEME_EXTENSION) != 0) {
+                continue;
+            }
+
+            entry->d_name[length - extension_length] = '\0';
+
+            // Every item of that name, the data file is not guaranteed to be free of duplicates
+            for (size_t at = fnv1a_hash_str(entry->d_name) & (slot_count - 1); slots[at];
+                 at = (at + 1) & (slot_count - 1)) {
+                if (strcmp(items[slots[at] - 1]->name, entry->d_name) == 0) downloaded[slots[at] - 1] = true;
+            }
+        }
+
+        closedir(theme_dir);
+    }
+
+    free(slots);
+}
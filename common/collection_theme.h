@@ -2,24 +2,35 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+#define THEME_FEATURE_GRID       (1 << 0)
+#define THEME_FEATURE_HDMI       (1 << 1)
+#define THEME_FEATURE_LANGUAGE   (1 << 2)
+#define THEME_FEATURE_640X480    (1 << 3)
+#define THEME_FEATURE_720X480    (1 << 4)
+#define THEME_FEATURE_720X720    (1 << 5)
+#define THEME_FEATURE_1024X768   (1 << 6)
+#define THEME_FEATURE_1280X720   (1 << 7)
 
 typedef struct {
     char *name;
     char *url;
-    bool grid_enabled;
-    bool hdmi_enabled;
-    bool language_enabled;
-    bool resolution640x480;
-    bool resolution720x480;
-    bool resolution720x720;
-    bool resolution1024x768;
-    bool resolution1280x720;
+    uint32_t features; // THEME_FEATURE_* the theme supports
 } theme_item;
 
+/*
+ * Every theme in a theme data file, sorted by name. Names and urls share one
+ * allocation owned by the catalogue.
+ */
+typedef struct {
+    theme_item *items;
+    size_t count;
+    char *strings;
+} theme_catalogue;
+
 theme_item *add_theme_item(theme_item **theme_items, size_t *count, const char *name, const char *url,
-                           bool grid_enabled, bool hdmi_enabled, bool language_enabled, bool resolution640x480,
-                           bool resolution720x480, bool resolution720x720, bool resolution1024x768,
-                           bool resolution1280x720);
+                           uint32_t features);
 
 int theme_item_exists(theme_item *theme_items, size_t count, const char *name);
 
@@ -28,3 +39,19 @@ void sort_theme_items(theme_item *theme_items, size_t count);
 theme_item get_theme_item_by_index(theme_item *items, size_t index);
 
 void free_theme_items(theme_item **theme_items, size_t *count);
+
+/*
+ * Parses the theme data in a single pass over the array and keeps the result
+ * until the file changes on disk, so going back and forth between the list
+ * and the filter screen does not parse it again. The catalogue belongs to
+ * this module and stays valid until the next load or invalidate.
+ */
+const theme_catalogue *theme_catalogue_load(const char *path);
+
+void theme_catalogue_invalidate(void);
+
+/*
+ * Marks which of items have a downloaded .muxthm in dir from one listing of
+ * that folder, rather than a lookup per item.
+ */
+void theme_catalogue_downloaded(const theme_item *const items[], size_t count, const char *dir, bool downloaded[]);
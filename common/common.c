@@ -26,6 +26,7 @@
 #include "miniz/miniz.h"
 #include "img/nothing.h"
 #include "json/json.h"
+#include "json_index.h"
 #include "init.h"
 #include "common.h"
 #include "ui_common.h"
@@ -37,7 +38,12 @@
 #include "kiosk.h"
 #include "input/list_nav.h"
 #include "theme.h"
+#include "screen_cache.h"
 #include "mini/mini.h"
+#include "text_file.h"
+#include "catalogue_index.h"
+#include "exec_broker.h"
+#include "thumbnail.h"
 #include "../module/muxshare.h"
 
 char mux_module[MAX_BUFFER_SIZE];
@@ -48,6 +54,10 @@ int fe_snd;
 int fe_bgm;
 struct json translation_generic;
 struct json translation_specific;
+
+static char *language_data = NULL;
+static json_index translation_generic_index;
+static json_index translation_specific_index;
 struct pattern skip_pattern_list = {NULL, 0, 0};
 int battery_capacity = 100;
 lv_anim_t animation;
@@ -603,30 +613,21 @@ char *read_battery_voltage(void) {
 }
 
 char *read_all_char_from(const char *filename) {
-    char *text = NULL;
-    FILE *file = fopen(filename, "r");
-
-    if (file == NULL) return "";
-
-    fseek(file, 0, SEEK_END);
-    long fileSize = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    TextFile *tf = text_file_acquire(filename);
+    if (!tf) return "";
 
-    text = (char *) malloc(fileSize + 1);
+    size_t length = tf->length;
+    if (length > 0 && tf->data[length - 1] == '\n') length--;
 
+    char *text = malloc(length + 1);
     if (text != NULL) {
-        size_t bytesRead = fread(text, 1, fileSize, file);
-
-        if (bytesRead > 0 && text[bytesRead - 1] == '\n') {
-            text[bytesRead - 1] = '\0';
-        } else {
-            text[bytesRead] = '\0';
-        }
+        memcpy(text, tf->data, length);
+        text[length] = '\0';
     } else {
         LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
     }
 
-    fclose(file);
+    text_file_release(tf);
     return text;
 }
 
@@ -636,73 +637,44 @@ char *read_line_char_from(const char *filename, size_t line_number) {
         return "";
     }
 
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
+    TextFile *tf = text_file_acquire(filename);
+    if (!tf) {
         LOG_ERROR(mux_module, "%s: %s", lang.SYSTEM.FAIL_FILE_OPEN, filename)
         return "";
     }
 
-    char *line = (char *) malloc(MAX_BUFFER_SIZE);
-    if (!line) {
-        LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
-        fclose(file);
-        return "";
-    }
-
-    size_t current_line = 0;
-    while (fgets(line, MAX_BUFFER_SIZE, file) != NULL) {
-        current_line++;
-        if (current_line == line_number) {
-            size_t length = strlen(line);
+    char *line = text_file_line_dup(tf, line_number, MAX_BUFFER_SIZE - 1);
+    text_file_release(tf);
 
-            if (length > 0 && line[length - 1] == '\n') line[length - 1] = '\0';
-
-            fclose(file);
-            return line;
-        }
-    }
-
-    free(line);
-    fclose(file);
-
-    return "";
+    return line ? line : "";
 }
 
 int read_all_int_from(const char *filename, size_t buffer) {
-    FILE *file = fopen(filename, "r");
-    if (!file) return 0;
+    TextFile *tf = text_file_acquire(filename);
+    if (!tf) return 0;
 
+    // Only the first buffer - 1 characters were ever considered
     char line[buffer];
-    size_t buf_size = sizeof(line);
-    if (buf_size > INT_MAX) buf_size = INT_MAX;
+    size_t length = tf->length < buffer - 1 ? tf->length : buffer - 1;
 
-    if (!fgets(line, (int) buf_size, file)) {
-        fclose(file);
-        return 0;
-    }
+    memcpy(line, tf->data, length);
+    line[length] = '\0';
+    line[strcspn(line, "\n")] = '\0';
+
+    text_file_release(tf);
 
-    fclose(file);
     long value = strtol(line, NULL, 10);
     return (value > INT_MAX || value < INT_MIN) ? 0 : (int) value;
 }
 
 int read_line_int_from(const char *filename, size_t line_number) {
-    char line[MAX_BUFFER_SIZE];
-    FILE *file = fopen(filename, "r");
-    if (!file) return 0;
+    TextFile *tf = text_file_acquire(filename);
+    if (!tf) return 0;
 
-    for (size_t i = 1; i <= line_number && fgets(line, sizeof(line), file); i++) {
-        if (i == line_number) {
-            line[strcspn(line, "\n")] = '\0';
-            errno = 0;
-            long value = strtol(line, NULL, 10);
-            fclose(file);
-            return (errno == ERANGE) ? 0 : (int) value;
-        }
-    }
+    int value = text_file_line_int(tf, line_number, 0);
+    text_file_release(tf);
 
-    fclose(file);
-    return 0;
+    return value;
 }
 
 unsigned long long read_all_long_from(const char *filename) {
@@ -802,6 +774,8 @@ void write_text_to_file(const char *filename, const char *mode, int type, ...) {
 
     va_end(args);
     fclose(file);
+
+    text_file_invalidate(filename);
 }
 
 void create_directories(const char *path) {
@@ -1061,7 +1035,7 @@ int load_element_image_specifics(const char *theme_base, const char *mux_dimensi
                         break;
                 }
 
-                if (written >= 0 && file_exist(image_path)) return 1;
+                if (written >= 0 && catalogue_index_file_exists(image_path)) return 1;
             }
         }
     }
@@ -1106,7 +1080,7 @@ int load_image_specifics(const char *theme_base, const char *mux_dimension, cons
                 break;
         }
 
-        if (written >= 0 && file_exist(image_path)) return 1;
+        if (written >= 0 && catalogue_index_file_exists(image_path)) return 1;
     }
 
     return 0;
@@ -1139,7 +1113,7 @@ int load_image_catalogue(const char *catalogue_name, const char *program, const
 
     const char *path_format = "%s/%s/%s/%s%s.png";
     const bool skip_theme_catalogue =
-            !directory_exist(THEME_CAT_PATH) || !is_supported_theme_catalogue(catalogue_name, image_type);
+            !is_supported_theme_catalogue(catalogue_name, image_type) || !catalogue_index_dir_exists(THEME_CAT_PATH);
 
     struct {
         enum catalogue_kind kind;
@@ -1170,7 +1144,7 @@ int load_image_catalogue(const char *catalogue_name, const char *program, const
         int written;
         written = snprintf(image_path, path_size, path_format, args[i].catalogue_path, catalogue_name,
                            image_type, args[i].dimension, args[i].program);
-        if (written >= 0 && file_exist(image_path)) return 1;
+        if (written >= 0 && catalogue_index_file_exists(image_path)) return 1;
     }
 
     return 0;
@@ -1261,7 +1235,7 @@ void load_wallpaper(lv_obj_t *ui_screen, lv_group_t *ui_group, lv_obj_t *ui_pnlW
                                              new_wall);
                         break;
                     default:
-                        lv_img_set_src(ui_imgWall, new_wall);
+                        screen_cache_set_image(ui_imgWall, new_wall);
                         break;
                 }
             }
@@ -1500,9 +1474,7 @@ int get_font_size(void) {
     }
 }
 
-lv_font_t *get_language_font(void) {
-    int font_size = get_font_size();
-    size_t cache_size = 1024 * 10;
+static lv_font_t *create_language_font(int font_size, size_t cache_size) {
     lv_font_t * font;
     if (strcasecmp(config.SETTINGS.GENERAL.LANGUAGE, "Chinese (Simplified)") == 0) {
         font = lv_tiny_ttf_create_data_ex(&notosans_sc_medium_ttf, notosans_medium_ttf_len, font_size, cache_size);
@@ -1520,52 +1492,66 @@ lv_font_t *get_language_font(void) {
     return font;
 }
 
-void load_font_text_from_file(const char *filepath, lv_obj_t *element) {
-    char theme_font_text_fs[MAX_BUFFER_SIZE];
-    snprintf(theme_font_text_fs, sizeof(theme_font_text_fs), "M:%s", filepath);
-    lv_font_t * font = lv_font_load(theme_font_text_fs);
-    font->fallback = get_language_font();
-    lv_obj_set_style_text_font(element, font, MU_OBJ_MAIN_DEFAULT);
+lv_font_t *get_language_font(void) {
+    int font_size = get_font_size();
+    size_t cache_size = 1024 * 10;
+
+    // Shared by every screen until the language changes, rather than created anew each time
+    lv_font_t * font = screen_cache_language_font(config.SETTINGS.GENERAL.LANGUAGE, font_size);
+    if (!font) {
+        font = create_language_font(font_size, cache_size);
+        screen_cache_add_language_font(font, config.SETTINGS.GENERAL.LANGUAGE, font_size, cache_size);
+    }
+
+    return font;
 }
 
-void load_font_text(lv_obj_t *screen) {
-    lv_font_t * language_font = get_language_font();
+void load_font_text_from_file(const char *filepath, lv_obj_t *element) {
+    lv_font_t * font = screen_cache_font_file(filepath, get_language_font());
+    if (font) lv_obj_set_style_text_font(element, font, MU_OBJ_MAIN_DEFAULT);
+}
 
-    if (config.SETTINGS.ADVANCED.FONT) {
-        char theme_font_text_default[MAX_BUFFER_SIZE];
-        char theme_font_text[MAX_BUFFER_SIZE];
+int get_theme_font_path(const char *module, char *font_path, size_t font_path_size) {
+    if (!config.SETTINGS.ADVANCED.FONT || !theme_compat()) return 0;
 
-        char *dimensions[15] = {mux_dimension, ""};
-        char *theme_location = config.BOOT.FACTORY_RESET ? INTERNAL_THEME : STORAGE_THEME;
+    char *dimensions[15] = {mux_dimension, ""};
+    char *theme_location = config.BOOT.FACTORY_RESET ? INTERNAL_THEME : STORAGE_THEME;
 
-        if (theme_compat()) {
-            for (int i = 0; i < 2; i++) {
-                if ((snprintf(theme_font_text, sizeof(theme_font_text),
-                              "%s/%sfont/%s/%s.bin", theme_location, dimensions[i],
-                              config.SETTINGS.GENERAL.LANGUAGE, mux_module) >= 0 &&
-                     file_exist(theme_font_text)) ||
-
-                    (snprintf(theme_font_text, sizeof(theme_font_text_default),
-                              "%s/%sfont/%s/default.bin", theme_location, dimensions[i],
-                              config.SETTINGS.GENERAL.LANGUAGE) >= 0 &&
-                     file_exist(theme_font_text)) ||
-
-                    (snprintf(theme_font_text, sizeof(theme_font_text),
-                              "%s/%sfont/%s.bin", theme_location, dimensions[i], mux_module) >= 0 &&
-                     file_exist(theme_font_text)) ||
-
-                    (snprintf(theme_font_text, sizeof(theme_font_text_default),
-                              "%s/%sfont/default.bin", theme_location, dimensions[i]) >= 0 &&
-                     file_exist(theme_font_text))) {
-
-                    LOG_INFO(mux_module, "Loading Main Theme Font: %s", theme_font_text)
-                    load_font_text_from_file(theme_font_text, screen);
-                    return;
-                }
-            }
+    for (int i = 0; i < 2; i++) {
+        if ((snprintf(font_path, font_path_size,
+                      "%s/%sfont/%s/%s.bin", theme_location, dimensions[i],
+                      config.SETTINGS.GENERAL.LANGUAGE, module) >= 0 &&
+             file_exist(font_path)) ||
+
+            (snprintf(font_path, font_path_size,
+                      "%s/%sfont/%s/default.bin", theme_location, dimensions[i],
+                      config.SETTINGS.GENERAL.LANGUAGE) >= 0 &&
+             file_exist(font_path)) ||
+
+            (snprintf(font_path, font_path_size,
+                      "%s/%sfont/%s.bin", theme_location, dimensions[i], module) >= 0 &&
+             file_exist(font_path)) ||
+
+            (snprintf(font_path, font_path_size,
+                      "%s/%sfont/default.bin", theme_location, dimensions[i]) >= 0 &&
+             file_exist(font_path))) {
+            return 1;
         }
     }
 
+    return 0;
+}
+
+void load_font_text(lv_obj_t *screen) {
+    lv_font_t * language_font = get_language_font();
+
+    char theme_font_text[MAX_BUFFER_SIZE];
+    if (get_theme_font_path(mux_module, theme_font_text, sizeof(theme_font_text))) {
+        LOG_INFO(mux_module, "Loading Main Theme Font: %s", theme_font_text)
+        load_font_text_from_file(theme_font_text, screen);
+        return;
+    }
+
     LOG_INFO(mux_module, "Loading Default Language Font")
     lv_obj_set_style_text_font(screen, language_font, MU_OBJ_MAIN_DEFAULT);
 }
@@ -1833,7 +1819,16 @@ void update_image(lv_obj_t *ui_imgobj, struct ImageSettings image_settings) {
         char image_path[MAX_BUFFER_SIZE];
         snprintf(image_path, sizeof(image_path), "M:%s", image_settings.image_path);
 
-        if (image_settings.max_height > 0 && image_settings.max_width > 0) {
+        char thumbnail[MAX_BUFFER_SIZE];
+        if (image_settings.max_height > 0 && image_settings.max_width > 0 &&
+            thumbnail_get(image_settings.image_path, image_settings.max_width, image_settings.max_height,
+                          thumbnail, sizeof(thumbnail))) {
+            // Already scaled to fit, so LVGL only has to blit it
+            snprintf(image_path, sizeof(image_path), "M:%s", thumbnail);
+
+            lv_img_set_size_mode(ui_imgobj, LV_IMG_SIZE_MODE_REAL);
+            lv_img_set_zoom(ui_imgobj, LV_IMG_ZOOM_NONE);
+        } else if (image_settings.max_height > 0 && image_settings.max_width > 0) {
             lv_img_header_t img_header;
             lv_img_decoder_get_info(image_path, &img_header);
 
@@ -1919,14 +1914,29 @@ void load_language_file(const char *module) {
     snprintf(language_file, sizeof(language_file), STORAGE_LANG "/%s.json",
              config.SETTINGS.GENERAL.LANGUAGE);
 
-    if (json_valid(read_all_char_from(language_file))) {
-        translation_specific = json_object_get(json_parse(read_all_char_from(language_file)), module);
-        translation_generic = json_object_get(json_parse(read_all_char_from(language_file)), "generic");
+    char *data = text_file_read_all(language_file);
+    if (!data || !json_valid(data)) {
+        free(data);
+        return;
     }
+
+    // The translations point into the file contents, so the previous ones go with it
+    json_index_free(&translation_specific_index);
+    json_index_free(&translation_generic_index);
+    free(language_data);
+    language_data = data;
+
+    struct json root = json_parse(language_data);
+    translation_specific = json_object_get(root, module);
+    translation_generic = json_object_get(root, "generic");
+
+    // Every label on a screen is a lookup, index the keys rather than scanning for each one
+    json_index_build(&translation_specific_index, translation_specific);
+    json_index_build(&translation_generic_index, translation_generic);
 }
 
 char *translate_generic(char *key) {
-    struct json translation_generic_json = json_object_get(translation_generic, key);
+    struct json translation_generic_json = json_index_get(&translation_generic_index, key);
     if (json_exists(translation_generic_json)) {
         char translation[MAX_BUFFER_SIZE];
         json_string_copy(translation_generic_json, translation, sizeof(translation));
@@ -1937,7 +1947,7 @@ char *translate_generic(char *key) {
 }
 
 char *translate_specific(char *key) {
-    struct json translation_specific_json = json_object_get(translation_specific, key);
+    struct json translation_specific_json = json_index_get(&translation_specific_index, key);
     if (json_exists(translation_specific_json)) {
         char translation[MAX_BUFFER_SIZE];
         json_string_copy(translation_specific_json, translation, sizeof(translation));
@@ -2514,11 +2524,17 @@ void update_grid_image_paths(int index) {
     items[index].grid_image_focused = strdup(grid_image_focused);
 }
 
+void set_grid_image_src(lv_obj_t *cell, char *image_path) {
+    char grid_image[MAX_BUFFER_SIZE];
+
+    // Grid art is drawn at its own size, nothing to gain from a thumbnail
+    snprintf(grid_image, sizeof(grid_image), "M:%s", image_path);
+    lv_img_set_src(cell, grid_image);
+}
+
 static void update_grid_image(lv_obj_t *cell, char *image_path) {
     if (file_exist(image_path)) {
-        char grid_image[MAX_BUFFER_SIZE];
-        snprintf(grid_image, sizeof(grid_image), "M:%s", image_path);
-        lv_img_set_src(cell, grid_image);
+        set_grid_image_src(cell, image_path);
     } else {
         lv_img_set_src(cell, &ui_image_Nothing);
     }
@@ -2701,8 +2717,49 @@ void kiosk_denied(void) {
 }
 
 static pid_t pending_exec_pid = -1;
+static int pending_exec_fd = -1;
 static exec_callback pending_exec_cb = NULL;
 
+static int read_exit_code(int fd) {
+    int exit_code = -1;
+    ssize_t r;
+
+    do {
+        r = read(fd, &exit_code, sizeof(exit_code));
+    } while (r < 0 && errno == EINTR);
+
+    return r == sizeof(exit_code) ? exit_code : -1;
+}
+
+static void clear_pending_exec(void) {
+    if (pending_exec_fd >= 0) close(pending_exec_fd);
+
+    pending_exec_pid = -1;
+    pending_exec_fd = -1;
+    pending_exec_cb = NULL;
+}
+
+// Hands the command to the exec broker if it is running, returns 0 when the caller has to fork
+static int broker_exec(const char *san[], int background, const char *log_file, exec_callback cb) {
+    int detach = background && cb == NULL;
+    int result_fd = -1;
+
+    if (!exec_broker_spawn(san, detach, log_file, detach ? NULL : &result_fd)) return 0;
+
+    if (!background) {
+        read_exit_code(result_fd);
+        close(result_fd);
+    } else if (!detach) {
+        clear_pending_exec();
+        fcntl(result_fd, F_SETFL, O_NONBLOCK);
+
+        pending_exec_fd = result_fd;
+        pending_exec_cb = cb;
+    }
+
+    return 1;
+}
+
 void run_exec(const char *args[], size_t size, int background, int turbo, const char *log_file, exec_callback cb) {
     const char *san[size];
 
@@ -2724,6 +2781,11 @@ void run_exec(const char *args[], size_t size, int background, int turbo, const
  *  }
 */
 
+    if (broker_exec(san, background, log_file, cb)) {
+        if (turbo) turbo_time(0, 0);
+        return;
+    }
+
     pid_t pid = fork();
     if (pid == 0) {
         if (background && cb == NULL) {
@@ -2765,6 +2827,7 @@ void run_exec(const char *args[], size_t size, int background, int turbo, const
         if (!background) {
             waitpid(pid, NULL, 0);
         } else {
+            clear_pending_exec();
             pending_exec_pid = pid;
             pending_exec_cb = cb;
         }
@@ -2774,6 +2837,18 @@ void run_exec(const char *args[], size_t size, int background, int turbo, const
 }
 
 void exec_watch_task() {
+    if (pending_exec_fd >= 0) {
+        int exit_code = -1;
+        ssize_t r = read(pending_exec_fd, &exit_code, sizeof(exit_code));
+        if (r < 0 && (errno == EAGAIN || errno == EINTR)) return;
+
+        exec_callback cb = pending_exec_cb;
+        clear_pending_exec();
+
+        if (cb) cb(r == sizeof(exit_code) ? exit_code : -1);
+        return;
+    }
+
     if (pending_exec_pid <= 0) return;
 
     int status;
@@ -2795,7 +2870,7 @@ void exec_watch_task() {
 }
 
 char *get_content_line(char *dir, char *name, char *ext, size_t line) {
-    static char path[MAX_BUFFER_SIZE];
+    char path[MAX_BUFFER_SIZE];
     char *subdir = get_last_subdir(dir, '/', 4);
 
     if (name == NULL) {
@@ -3016,13 +3091,13 @@ void apply_app_glyph(const char *app_folder, const char *glyph_name, lv_obj_t *u
 
 void get_app_grid_glyph(const char *app_folder, const char *glyph_name, const char *fallback_name,
                         char *glyph_image_path, size_t glyph_image_path_size) {
-    if (file_exist(glyph_image_path) && strstr(glyph_image_path, fallback_name) == 0) return;
+    if (catalogue_index_file_exists(glyph_image_path) && strstr(glyph_image_path, fallback_name) == 0) return;
 
     char image_path[MAX_BUFFER_SIZE];
     if ((snprintf(image_path, sizeof(image_path), "%s/grid/%s%s.png", app_folder, mux_dimension, glyph_name) >= 0 &&
-         file_exist(image_path)) ||
+         catalogue_index_file_exists(image_path)) ||
         (snprintf(image_path, sizeof(image_path), "%s/grid/%s.png", app_folder, glyph_name) >= 0 &&
-         file_exist(image_path))
+         catalogue_index_file_exists(image_path))
             ) {
         snprintf(glyph_image_path, glyph_image_path_size, "%s", image_path);
     }
@@ -3393,25 +3468,36 @@ char *load_content_core(int force, int run_quit, char *sys_dir, char *file_name)
 
 char *build_core(char core_path[MAX_BUFFER_SIZE], int line_core, int line_system,
                  int line_catalogue, int line_lookup, int line_launch) {
-    const char *core_line = read_line_char_from(core_path, line_core) ?: "unknown";
-    const char *system_line = read_line_char_from(core_path, line_system) ?: "unknown";
-    const char *catalogue_line = read_line_char_from(core_path, line_catalogue) ?: "unknown";
-    const char *lookup_line = read_line_char_from(core_path, line_lookup) ?: "unknown";
-    const char *launch_line = read_line_char_from(core_path, line_launch) ?: "unknown";
+    TextFile *tf = text_file_acquire(core_path);
+    if (!tf) {
+        LOG_ERROR(mux_module, "%s: %s", lang.SYSTEM.FAIL_FILE_OPEN, core_path)
+        return NULL;
+    }
 
-    size_t required_size = snprintf(NULL, 0, "%s\n%s\n%s\n%s\n%s",
-                                    core_line, system_line, catalogue_line,
-                                    lookup_line, launch_line) + 1;
+    TextLine lines[5];
+    const int line_numbers[5] = {line_core, line_system, line_catalogue, line_lookup, line_launch};
+
+    size_t required_size = 0;
+    for (size_t i = 0; i < A_SIZE(lines); i++) {
+        if (!text_file_line(tf, line_numbers[i], &lines[i])) lines[i] = (TextLine) {"", 0};
+        required_size += lines[i].length + 1; // newline separator or terminator
+    }
 
     char *b_core = malloc(required_size);
     if (!b_core) {
         LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
+        text_file_release(tf);
         return NULL;
     }
 
-    snprintf(b_core, required_size, "%s\n%s\n%s\n%s\n%s",
-             core_line, system_line, catalogue_line, lookup_line, launch_line);
+    char *pos = b_core;
+    for (size_t i = 0; i < A_SIZE(lines); i++) {
+        memcpy(pos, lines[i].data, lines[i].length);
+        pos += lines[i].length;
+        *pos++ = (i + 1 < A_SIZE(lines)) ? '\n' : '\0';
+    }
 
+    text_file_release(tf);
     return b_core;
 }
 
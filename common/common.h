@@ -288,6 +288,9 @@ void load_image_animation(lv_obj_t *ui_imgWall, int animation_time, int repeat_c
 
 void unload_image_animation();
 
+// Theme font a module would be drawn with, 0 when it falls back on the language font
+int get_theme_font_path(const char *module, char *font_path, size_t font_path_size);
+
 void load_font_text(lv_obj_t *screen);
 
 void load_font_section(const char *section, lv_obj_t *element);
@@ -363,6 +366,8 @@ int get_grid_row_item_count(int current_item_index);
 
 void update_grid_image_paths(int index);
 
+void set_grid_image_src(lv_obj_t *cell, char *image_path);
+
 void update_grid_items(int direction);
 
 void update_grid(int direction);
@@ -0,0 +1,823 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "config.h"
+#include "device.h"
+#include "language.h"
+#include "log.h"
+#include "catalogue_index.h"
+#include "friendly_name.h"
+#include "text_file.h"
+#include "content_catalogue.h"
+
+struct content_catalogue {
+    uint8_t *base;
+    size_t length;
+
+    const ContentCatalogueHeader *header;
+    const ContentCatalogueDir *dirs;
+    const ContentCatalogueEntry *entries;
+    const char *strings;
+};
+
+// A folder waiting to be visited, with its record in the previous catalogue if it had one
+typedef struct {
+    char *path;
+    size_t root_length;
+    uint32_t parent;
+    uint32_t previous;
+} pending_dir;
+
+typedef struct {
+    const content_catalogue *catalogue;
+    bool reusable;      // Built with the same naming rules, so unchanged folders can be carried over
+
+    uint32_t *slots;    // Directory index + 1 by path hash, 0 is empty
+    size_t slot_count;
+
+    uint32_t *first_child;
+    uint32_t *next_sibling;
+} previous_catalogue;
+
+typedef struct {
+    ContentCatalogueDir *dirs;
+    size_t dir_count;
+    size_t dir_capacity;
+
+    ContentCatalogueEntry *entries;
+    size_t entry_count;
+    size_t entry_capacity;
+
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+
+    uint32_t *interned; // String offset + 1 by hash, systems and cores repeat on every entry
+    size_t interned_count;
+    size_t interned_capacity;
+
+    pending_dir *pending;
+    size_t pending_head;
+    size_t pending_count;
+    size_t pending_capacity;
+
+    size_t dirs_read;
+    bool failed;
+} catalogue_builder;
+
+static const char *string_at(const content_catalogue *catalogue, uint32_t offset) {
+    // The string region always ends in a terminator, so any offset inside it is a valid string
+    return offset < catalogue->header->strings_size ? catalogue->strings + offset : "";
+}
+
+static bool catalogue_valid(const uint8_t *base, size_t length) {
+    if (length < sizeof(ContentCatalogueHeader)) return false;
+
+    const ContentCatalogueHeader *header = (const ContentCatalogueHeader *) base;
+    if (memcmp(header->magic, CONTENT_CATALOGUE_MAGIC, sizeof(header->magic)) != 0) return false;
+    if (header->strings_size == 0) return false;
+
+    if (sizeof(ContentCatalogueHeader) + (uint64_t) header->dir_count * sizeof(ContentCatalogueDir) +
+        (uint64_t) header->entry_count * sizeof(ContentCatalogueEntry) + header->strings_size != length) {
+        return false;
+    }
+
+    const char *strings = (const char *) base + length - header->strings_size;
+    if (strings[0] != '\0' || strings[header->strings_size - 1] != '\0') return false;
+
+    const ContentCatalogueDir *dirs = (const ContentCatalogueDir *) (base + sizeof(ContentCatalogueHeader));
+
+    for (uint32_t i = 0; i < header->dir_count; i++) {
+        if ((uint64_t) dirs[i].first_entry + dirs[i].entry_count > header->entry_count) return false;
+        if (dirs[i].parent != CONTENT_CATALOGUE_NONE && dirs[i].parent >= i) return false;
+    }
+
+    return true;
+}
+
+content_catalogue *content_catalogue_open(void) {
+    int fd = open(CONTENT_CATALOGUE_FILE, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(ContentCatalogueHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) return NULL;
+
+    if (!catalogue_valid(base, (size_t) st.st_size)) {
+        LOG_WARN(mux_module, "Ignoring invalid content catalogue: %s", CONTENT_CATALOGUE_FILE)
+        munmap(base, (size_t) st.st_size);
+        return NULL;
+    }
+
+    content_catalogue *catalogue = calloc(1, sizeof(content_catalogue));
+    if (!catalogue) {
+        munmap(base, (size_t) st.st_size);
+        return NULL;
+    }
+
+    catalogue->base = base;
+    catalogue->length = (size_t) st.st_size;
+    catalogue->header = base;
+    catalogue->dirs = (const ContentCatalogueDir *) (catalogue->base + sizeof(ContentCatalogueHeader));
+    catalogue->entries = (const ContentCatalogueEntry *) (catalogue->dirs + catalogue->header->dir_count);
+    catalogue->strings = (const char *) (catalogue->base + catalogue->length - catalogue->header->strings_size);
+
+    return catalogue;
+}
+
+void content_catalogue_close(content_catalogue *catalogue) {
+    if (!catalogue) return;
+
+    munmap(catalogue->base, catalogue->length);
+    free(catalogue);
+}
+
+size_t content_catalogue_count(const content_catalogue *catalogue) {
+    return catalogue->header->entry_count;
+}
+
+static void fill_item(const content_catalogue *catalogue, const ContentCatalogueDir *dir,
+                      const ContentCatalogueEntry *entry, content_catalogue_item *item) {
+    *item = (content_catalogue_item) {
+            .dir = string_at(catalogue, dir->path),
+            .rel = string_at(catalogue, dir->rel),
+            .file = string_at(catalogue, entry->file),
+            .name = string_at(catalogue, entry->name),
+            .system = string_at(catalogue, entry->system),
+            .core = string_at(catalogue, entry->core),
+            .mtime = entry->mtime,
+    };
+}
+
+bool content_catalogue_item_at(const content_catalogue *catalogue, size_t index, content_catalogue_item *item) {
+    if (index >= catalogue->header->entry_count) return false;
+
+    const ContentCatalogueEntry *entry = &catalogue->entries[index];
+    if (entry->dir >= catalogue->header->dir_count) return false;
+
+    fill_item(catalogue, &catalogue->dirs[entry->dir], entry, item);
+    return true;
+}
+
+size_t content_catalogue_folder_count(const content_catalogue *catalogue) {
+    return catalogue->header->dir_count;
+}
+
+bool content_catalogue_folder_at(const content_catalogue *catalogue, size_t index, const char **dir, const char **rel) {
+    if (index >= catalogue->header->dir_count) return false;
+
+    *dir = string_at(catalogue, catalogue->dirs[index].path);
+    *rel = string_at(catalogue, catalogue->dirs[index].rel);
+
+    return true;
+}
+
+static size_t scope_length(const char *scope) {
+    size_t length = scope ? strlen(scope) : 0;
+    while (length && scope[length - 1] == '/') length--;
+
+    return length;
+}
+
+static bool in_scope(const char *rel, const char *scope, size_t length) {
+    if (!length) return true;
+
+    return strncmp(rel, scope, length) == 0 && (rel[length] == '\0' || rel[length] == '/');
+}
+
+const char *content_catalogue_scope(const char *union_dir) {
+    size_t length = strlen(STORAGE_PATH);
+    if (strncmp(union_dir, STORAGE_PATH, length) != 0) return NULL;
+
+    if (union_dir[length] == '/') return union_dir + length + 1;
+    return union_dir[length] == '\0' ? union_dir + length : NULL;
+}
+
+bool content_catalogue_covers(const content_catalogue *catalogue, const char *rel) {
+    size_t length = scope_length(rel);
+
+    for (uint32_t i = 0; i < catalogue->header->dir_count; i++) {
+        const char *dir_rel = string_at(catalogue, catalogue->dirs[i].rel);
+        if (strlen(dir_rel) == length && strncmp(dir_rel, rel, length) == 0) return true;
+    }
+
+    return false;
+}
+
+size_t content_catalogue_search(const content_catalogue *catalogue, const char *query, const char *scope,
+                                content_search_alias alias, content_search_handler handler, void *ctx) {
+    size_t length = scope_length(scope);
+    size_t found = 0;
+
+    for (uint32_t i = 0; i < catalogue->header->dir_count; i++) {
+        const ContentCatalogueDir *dir = &catalogue->dirs[i];
+        if (!dir->entry_count || !in_scope(string_at(catalogue, dir->rel), scope, length)) continue;
+
+        const char *path = string_at(catalogue, dir->path);
+
+        for (uint32_t j = dir->first_entry; j < dir->first_entry + dir->entry_count; j++) {
+            const char *file = string_at(catalogue, catalogue->entries[j].file);
+            const char *friendly = string_at(catalogue, catalogue->entries[j].name);
+
+            char stripped[MAX_BUFFER_SIZE];
+            snprintf(stripped, sizeof(stripped), "%s", file);
+
+            char *ext = strrchr(stripped, '.');
+            if (ext && ext != stripped) *ext = '\0';
+
+            const char *name = NULL;
+
+            if (friendly[0] && strcasestr(friendly, query)) {
+                name = friendly;
+            } else if (strcasestr(file, query)) {
+                name = friendly[0] ? friendly : stripped;
+            } else {
+                const char *alias_name = alias ? alias(stripped) : NULL;
+                if (alias_name && strcasestr(alias_name, query)) name = friendly[0] ? friendly : alias_name;
+            }
+
+            if (!name) continue;
+
+            found++;
+            if (handler) {
+                content_search_result result = {(char *) path, (char *) file, (char *) name};
+                handler(&result, ctx);
+            }
+        }
+    }
+
+    return found;
+}
+
+bool content_catalogue_random(const content_catalogue *catalogue, const char *scope, content_catalogue_item *item) {
+    size_t length = scope_length(scope);
+    size_t total = 0;
+
+    for (uint32_t i = 0; i < catalogue->header->dir_count; i++) {
+        const ContentCatalogueDir *dir = &catalogue->dirs[i];
+        if (in_scope(string_at(catalogue, dir->rel), scope, length)) total += dir->entry_count;
+    }
+
+    if (!total) return false;
+
+    size_t pick = (size_t) random() % total;
+
+    for (uint32_t i = 0; i < catalogue->header->dir_count; i++) {
+        const ContentCatalogueDir *dir = &catalogue->dirs[i];
+        if (!in_scope(string_at(catalogue, dir->rel), scope, length)) continue;
+
+        if (pick < dir->entry_count) {
+            fill_item(catalogue, dir, &catalogue->entries[dir->first_entry + pick], item);
+            return true;
+        }
+
+        pick -= dir->entry_count;
+    }
+
+    return false;
+}
+
+static int64_t stat_mtime(const struct stat *st) {
+    return (int64_t) st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+static int64_t path_mtime(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? stat_mtime(&st) : 0;
+}
+
+static int64_t newest(int64_t a, int64_t b) {
+    return a > b ? a : b;
+}
+
+// Assignments are rewritten in place, which leaves the folder's own mtime alone, so every cfg in it counts
+static int64_t core_dir_mtime(const char *core_dir) {
+    int64_t stamp = path_mtime(core_dir);
+
+    DIR *dir = opendir(core_dir);
+    if (!dir) return stamp;
+
+    struct dirent *entry;
+    struct stat st;
+
+    while ((entry = readdir(dir))) {
+        const char *extension = strrchr(entry->d_name, '.');
+        if (!extension || strcasecmp(extension, ".cfg") != 0) continue;
+
+        if (fstatat(dirfd(dir), entry->d_name, &st, 0) == 0) stamp = newest(stamp, stat_mtime(&st));
+    }
+
+    closedir(dir);
+    return stamp;
+}
+
+// Anything that changes which files are listed or what they are called forces every folder to be read again
+static int64_t rules_mtime(void) {
+    int64_t stamp = path_mtime(INFO_NAM_PATH);
+
+    DIR *dir = opendir(INFO_NAM_PATH);
+    if (dir) {
+        struct dirent *entry;
+        struct stat st;
+
+        while ((entry = readdir(dir))) {
+            if (fstatat(dirfd(dir), entry->d_name, &st, 0) == 0) stamp = newest(stamp, stat_mtime(&st));
+        }
+
+        closedir(dir);
+    }
+
+    const char *mounts[] = {device.STORAGE.SDCARD.MOUNT, device.STORAGE.ROM.MOUNT};
+    for (size_t i = 0; i < A_SIZE(mounts); i++) {
+        char skip_ini[PATH_MAX];
+        snprintf(skip_ini, sizeof(skip_ini), "%s/%s/skip.ini", mounts[i], MUOS_INFO_PATH);
+        stamp = newest(stamp, path_mtime(skip_ini));
+    }
+
+    return stamp;
+}
+
+static void *reserve(void *items, size_t *capacity, size_t needed, size_t item_size) {
+    if (needed <= *capacity) return items;
+
+    size_t grown = *capacity ? *capacity : 64;
+    while (grown < needed) grown *= 2;
+
+    void *resized = realloc(items, grown * item_size);
+    if (resized) *capacity = grown;
+
+    return resized;
+}
+
+static uint32_t add_string(catalogue_builder *builder, const char *str) {
+    if (!str[0]) return 0;
+
+    size_t length = strlen(str) + 1;
+
+    if (builder->strings_size + length > UINT32_MAX) {
+        builder->failed = true;
+        return 0;
+    }
+
+    char *strings = reserve(builder->strings, &builder->strings_capacity, builder->strings_size + length, 1);
+    if (!strings) {
+        builder->failed = true;
+        return 0;
+    }
+
+    builder->strings = strings;
+
+    uint32_t offset = (uint32_t) builder->strings_size;
+    memcpy(builder->strings + offset, str, length);
+    builder->strings_size += length;
+
+    return offset;
+}
+
+static bool intern_grow(catalogue_builder *builder) {
+    size_t capacity = builder->interned_capacity ? builder->interned_capacity * 2 : 256;
+
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (!slots) return false;
+
+    for (size_t i = 0; i < builder->interned_capacity; i++) {
+        uint32_t slot = builder->interned[i];
+        if (!slot) continue;
+
+        size_t at = fnv1a_hash_str(builder->strings + slot - 1) & (capacity - 1);
+        while (slots[at]) at = (at + 1) & (capacity - 1);
+        slots[at] = slot;
+    }
+
+    free(builder->interned);
+    builder->interned = slots;
+    builder->interned_capacity = capacity;
+
+    return true;
+}
+
+static uint32_t intern_string(catalogue_builder *builder, const char *str) {
+    if (!str[0]) return 0;
+
+    if (builder->interned_count * 2 >= builder->interned_capacity && !intern_grow(builder)) {
+        builder->failed = true;
+        return 0;
+    }
+
+    size_t mask = builder->interned_capacity - 1;
+    size_t at = fnv1a_hash_str(str) & mask;
+
+    while (builder->interned[at]) {
+        uint32_t offset = builder->interned[at] - 1;
+        if (strcmp(builder->strings + offset, str) == 0) return offset;
+
+        at = (at + 1) & mask;
+    }
+
+    uint32_t offset = add_string(builder, str);
+    if (builder->failed) return 0;
+
+    builder->interned[at] = offset + 1;
+    builder->interned_count++;
+
+    return offset;
+}
+
+static void queue_dir(catalogue_builder *builder, char *path, size_t root_length, uint32_t parent, uint32_t previous) {
+    if (!path) {
+        builder->failed = true;
+        return;
+    }
+
+    // Visited entries at the front are dropped before the queue grows
+    if (builder->pending_head && builder->pending_count == builder->pending_capacity) {
+        memmove(builder->pending, builder->pending + builder->pending_head,
+                (builder->pending_count - builder->pending_head) * sizeof(pending_dir));
+        builder->pending_count -= builder->pending_head;
+        builder->pending_head = 0;
+    }
+
+    pending_dir *pending = reserve(builder->pending, &builder->pending_capacity, builder->pending_count + 1,
+                                   sizeof(pending_dir));
+    if (!pending) {
+        free(path);
+        builder->failed = true;
+        return;
+    }
+
+    builder->pending = pending;
+    builder->pending[builder->pending_count++] = (pending_dir) {path, root_length, parent, previous};
+}
+
+static void previous_free(previous_catalogue *previous) {
+    free(previous->slots);
+    free(previous->first_child);
+    free(previous->next_sibling);
+}
+
+static bool previous_index(previous_catalogue *previous, const content_catalogue *catalogue) {
+    *previous = (previous_catalogue) {.catalogue = catalogue};
+    if (!catalogue) return true;
+
+    uint32_t count = catalogue->header->dir_count;
+
+    previous->slot_count = 64;
+    while (previous->slot_count < (size_t) count * 2) previous->slot_count *= 2;
+
+    previous->slots = calloc(previous->slot_count, sizeof(uint32_t));
+    previous->first_child = malloc(((size_t) count + 1) * sizeof(uint32_t));
+    previous->next_sibling = malloc(((size_t) count + 1) * sizeof(uint32_t));
+
+    if (!previous->slots || !previous->first_child || !previous->next_sibling) {
+        previous_free(previous);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++) previous->first_child[i] = CONTENT_CATALOGUE_NONE;
+
+    // Walked backwards so the sibling lists come out in the original order
+    for (uint32_t i = count; i-- > 0;) {
+        const ContentCatalogueDir *dir = &catalogue->dirs[i];
+
+        size_t at = fnv1a_hash_str(string_at(catalogue, dir->path)) & (previous->slot_count - 1);
+        while (previous->slots[at]) at = (at + 1) & (previous->slot_count - 1);
+        previous->slots[at] = i + 1;
+
+        if (dir->parent == CONTENT_CATALOGUE_NONE) {
+            previous->next_sibling[i] = CONTENT_CATALOGUE_NONE;
+            continue;
+        }
+
+        previous->next_sibling[i] = previous->first_child[dir->parent];
+        previous->first_child[dir->parent] = i;
+    }
+
+    return true;
+}
+
+static uint32_t previous_find(const previous_catalogue *previous, const char *path) {
+    if (!previous->slots) return CONTENT_CATALOGUE_NONE;
+
+    size_t mask = previous->slot_count - 1;
+
+    for (size_t at = fnv1a_hash_str(path) & mask; previous->slots[at]; at = (at + 1) & mask) {
+        uint32_t index = previous->slots[at] - 1;
+        if (strcmp(string_at(previous->catalogue, previous->catalogue->dirs[index].path), path) == 0) return index;
+    }
+
+    return CONTENT_CATALOGUE_NONE;
+}
+
+// Same files load_content_core reads, the ROMS root has its own at the top of the core info
+static void core_paths(const char *rel, char *core_dir, size_t dir_size, char *core_cfg, size_t cfg_size) {
+    if (rel[0]) {
+        snprintf(core_dir, dir_size, INFO_COR_PATH "/%s", rel);
+    } else {
+        snprintf(core_dir, dir_size, INFO_COR_PATH);
+    }
+
+    snprintf(core_cfg, cfg_size, "%s/core.cfg", core_dir);
+}
+
+static void read_assignment(const char *cfg, int core_line, int system_line,
+                            char *core, size_t core_size, char *system, size_t system_size) {
+    TextFile *tf = text_file_acquire(cfg);
+    if (!tf) return;
+
+    TextLine line;
+
+    if (text_file_line(tf, core_line, &line)) {
+        snprintf(core, core_size, "%.*s", (int) line.length, line.data);
+    }
+
+    if (text_file_line(tf, system_line, &line)) {
+        snprintf(system, system_size, "%.*s", (int) line.length, line.data);
+    }
+
+    text_file_release(tf);
+}
+
+static void add_entry(catalogue_builder *builder, uint32_t dir, uint32_t file, uint32_t name,
+                      uint32_t system, uint32_t core, int64_t mtime) {
+    ContentCatalogueEntry *entries = reserve(builder->entries, &builder->entry_capacity, builder->entry_count + 1,
+                                             sizeof(ContentCatalogueEntry));
+    if (!entries) {
+        builder->failed = true;
+        return;
+    }
+
+    builder->entries = entries;
+    builder->entries[builder->entry_count++] = (ContentCatalogueEntry) {
+            .dir = dir,
+            .file = file,
+            .name = name,
+            .system = system,
+            .core = core,
+            .mtime = mtime,
+    };
+}
+
+static void carry_over(catalogue_builder *builder, const previous_catalogue *previous,
+                       const pending_dir *pending, uint32_t index) {
+    const content_catalogue *catalogue = previous->catalogue;
+    const ContentCatalogueDir *old = &catalogue->dirs[pending->previous];
+
+    builder->dirs[index].system = intern_string(builder, string_at(catalogue, old->system));
+    builder->dirs[index].core = intern_string(builder, string_at(catalogue, old->core));
+
+    for (uint32_t i = old->first_entry; i < old->first_entry + old->entry_count && !builder->failed; i++) {
+        const ContentCatalogueEntry *entry = &catalogue->entries[i];
+
+        add_entry(builder, index,
+                  add_string(builder, string_at(catalogue, entry->file)),
+                  add_string(builder, string_at(catalogue, entry->name)),
+                  intern_string(builder, string_at(catalogue, entry->system)),
+                  intern_string(builder, string_at(catalogue, entry->core)),
+                  entry->mtime);
+    }
+
+    for (uint32_t child = previous->first_child[pending->previous];
+         child != CONTENT_CATALOGUE_NONE; child = previous->next_sibling[child]) {
+        queue_dir(builder, strdup(string_at(catalogue, catalogue->dirs[child].path)),
+                  pending->root_length, index, child);
+    }
+}
+
+static void read_folder(catalogue_builder *builder, const previous_catalogue *previous,
+                        const pending_dir *pending, uint32_t index, const char *core_dir, const char *core_cfg) {
+    char dir_core[MAX_BUFFER_SIZE] = "";
+    char dir_system[MAX_BUFFER_SIZE] = "";
+    read_assignment(core_cfg, GLOBAL_CORE, GLOBAL_SYSTEM, dir_core, sizeof(dir_core), dir_system, sizeof(dir_system));
+
+    builder->dirs[index].system = intern_string(builder, dir_system);
+    builder->dirs[index].core = intern_string(builder, dir_core);
+    builder->dirs_read++;
+
+    DIR *dir = opendir(pending->path);
+    if (!dir) return;
+
+    // Friendly name tables are keyed on the folder the content sits in
+    const char *system = strrchr(pending->path, '/');
+    system = system ? system + 1 : pending->path;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) && !builder->failed) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        // The mtime is wanted either way, and symlinked folders are not followed
+        struct stat st;
+        if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+
+        int is_dir = S_ISDIR(st.st_mode);
+        if (should_skip(name, is_dir)) continue;
+
+        if (is_dir) {
+            char *child = NULL;
+            if (asprintf(&child, "%s/%s", pending->path, name) < 0) child = NULL;
+
+            queue_dir(builder, child, pending->root_length, index,
+                      child ? previous_find(previous, child) : CONTENT_CATALOGUE_NONE);
+            continue;
+        }
+
+        char stripped[MAX_BUFFER_SIZE];
+        snprintf(stripped, sizeof(stripped), "%s", name);
+
+        char *ext = strrchr(stripped, '.');
+        if (ext && ext != stripped) *ext = '\0';
+
+        const char *friendly = friendly_name_lookup(system, stripped);
+
+        char core[MAX_BUFFER_SIZE];
+        char assigned_system[MAX_BUFFER_SIZE];
+        snprintf(core, sizeof(core), "%s", dir_core);
+        snprintf(assigned_system, sizeof(assigned_system), "%s", dir_system);
+
+        // Individual assignments are few, the folder listing answers most of these without a stat
+        char content_cfg[PATH_MAX];
+        snprintf(content_cfg, sizeof(content_cfg), "%s/%s.cfg", core_dir, stripped);
+
+        if (catalogue_index_file_exists(content_cfg)) {
+            read_assignment(content_cfg, CONTENT_CORE, CONTENT_SYSTEM,
+                            core, sizeof(core), assigned_system, sizeof(assigned_system));
+        }
+
+        add_entry(builder, index,
+                  add_string(builder, name),
+                  add_string(builder, friendly ? friendly : ""),
+                  intern_string(builder, assigned_system),
+                  intern_string(builder, core),
+                  stat_mtime(&st));
+    }
+
+    closedir(dir);
+}
+
+static void visit_dir(catalogue_builder *builder, const previous_catalogue *previous, const pending_dir *pending) {
+    struct stat st;
+    if (stat(pending->path, &st) != 0 || !S_ISDIR(st.st_mode)) return;
+
+    if (builder->dir_count >= CONTENT_CATALOGUE_NONE) {
+        builder->failed = true;
+        return;
+    }
+
+    ContentCatalogueDir *dirs = reserve(builder->dirs, &builder->dir_capacity, builder->dir_count + 1,
+                                        sizeof(ContentCatalogueDir));
+    if (!dirs) {
+        builder->failed = true;
+        return;
+    }
+
+    builder->dirs = dirs;
+
+    const char *rel = pending->path + pending->root_length;
+    if (*rel == '/') rel++;
+
+    char core_dir[PATH_MAX];
+    char core_cfg[PATH_MAX];
+    core_paths(rel, core_dir, sizeof(core_dir), core_cfg, sizeof(core_cfg));
+
+    uint32_t index = (uint32_t) builder->dir_count++;
+    uint32_t path = add_string(builder, pending->path);
+
+    builder->dirs[index] = (ContentCatalogueDir) {
+            .path = path,
+            .rel = path + (uint32_t) (rel - pending->path),
+            .parent = pending->parent,
+            .first_entry = (uint32_t) builder->entry_count,
+            .mtime = stat_mtime(&st),
+            .core_mtime = core_dir_mtime(core_dir),
+    };
+
+    const ContentCatalogueDir *old = pending->previous != CONTENT_CATALOGUE_NONE
+                                     ? &previous->catalogue->dirs[pending->previous] : NULL;
+
+    if (previous->reusable && old && old->mtime == builder->dirs[index].mtime &&
+        old->core_mtime == builder->dirs[index].core_mtime) {
+        carry_over(builder, previous, pending, index);
+    } else {
+        read_folder(builder, previous, pending, index, core_dir, core_cfg);
+    }
+
+    builder->dirs[index].entry_count = (uint32_t) (builder->entry_count - builder->dirs[index].first_entry);
+}
+
+static bool write_catalogue(const catalogue_builder *builder, const ContentCatalogueHeader *header) {
+    char temp_path[PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d", CONTENT_CATALOGUE_FILE, (int) getpid());
+
+    create_directories(RUN_STORAGE_PATH "info");
+
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        LOG_ERROR(mux_module, "%s: %s", lang.SYSTEM.FAIL_FILE_OPEN, temp_path)
+        return false;
+    }
+
+    bool written = fwrite(header, sizeof(*header), 1, file) == 1 &&
+                   fwrite(builder->dirs, sizeof(ContentCatalogueDir), builder->dir_count, file) == builder->dir_count &&
+                   fwrite(builder->entries, sizeof(ContentCatalogueEntry), builder->entry_count, file) == builder->entry_count &&
+                   fwrite(builder->strings, 1, builder->strings_size, file) == builder->strings_size;
+
+    // Readers map the file, so it is only ever replaced whole
+    if (fclose(file) != 0 || !written || rename(temp_path, CONTENT_CATALOGUE_FILE) != 0) {
+        LOG_ERROR(mux_module, "Unable to write content catalogue: %s", CONTENT_CATALOGUE_FILE)
+        remove(temp_path);
+        return false;
+    }
+
+    return true;
+}
+
+bool content_catalogue_update(const char *const roots[], size_t root_count) {
+    ContentCatalogueHeader header = {
+            .rules_mtime = rules_mtime(),
+            .flags = config.SETTINGS.GENERAL.HIDDEN ? CONTENT_CATALOGUE_HIDDEN : 0,
+    };
+    memcpy(header.magic, CONTENT_CATALOGUE_MAGIC, sizeof(header.magic));
+
+    content_catalogue *existing = content_catalogue_open();
+
+    previous_catalogue previous;
+    if (!previous_index(&previous, existing)) {
+        content_catalogue_close(existing);
+        existing = NULL;
+        previous = (previous_catalogue) {0};
+    }
+
+    previous.reusable = existing && existing->header->rules_mtime == header.rules_mtime &&
+                        existing->header->flags == header.flags;
+
+    catalogue_builder builder = {0};
+
+    // Offset 0 is the empty string every missing name and assignment points at
+    builder.strings = malloc(1);
+    if (builder.strings) {
+        builder.strings[0] = '\0';
+        builder.strings_size = builder.strings_capacity = 1;
+    } else {
+        builder.failed = true;
+    }
+
+    for (size_t i = 0; i < root_count && !builder.failed; i++) {
+        if (!roots[i] || !directory_exist((char *) roots[i])) continue;
+
+        queue_dir(&builder, strdup(roots[i]), strlen(roots[i]), CONTENT_CATALOGUE_NONE,
+                  previous_find(&previous, roots[i]));
+    }
+
+    while (builder.pending_head < builder.pending_count) {
+        pending_dir pending = builder.pending[builder.pending_head++];
+
+        if (!builder.failed) visit_dir(&builder, &previous, &pending);
+        free(pending.path);
+    }
+
+    bool changed = !previous.reusable || builder.dirs_read ||
+                   builder.dir_count != existing->header->dir_count ||
+                   builder.entry_count != existing->header->entry_count;
+
+    bool success = !builder.failed;
+
+    if (builder.failed) {
+        LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
+    } else if (changed) {
+        header.dir_count = (uint32_t) builder.dir_count;
+        header.entry_count = (uint32_t) builder.entry_count;
+        header.strings_size = (uint32_t) builder.strings_size;
+
+        success = write_catalogue(&builder, &header);
+
+        LOG_INFO(mux_module, "Content Catalogue: %zu folders (%zu read), %zu files",
+                 builder.dir_count, builder.dirs_read, builder.entry_count)
+    }
+
+    previous_free(&previous);
+    content_catalogue_close(existing);
+
+    free(builder.dirs);
+    free(builder.entries);
+    free(builder.strings);
+    free(builder.interned);
+    free(builder.pending);
+
+    return success;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#ifndef CONTENT_CATALOGUE_H
+#define CONTENT_CATALOGUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "content_search.h"
+#include "options.h"
+
+#define CONTENT_CATALOGUE_FILE RUN_STORAGE_PATH "info/content.db"
+
+#define CONTENT_CATALOGUE_MAGIC "MUXCDB01"
+
+// Index value for "no directory", used as the parent of every root
+#define CONTENT_CATALOGUE_NONE UINT32_MAX
+
+// How long the watcher waits for storage to go quiet before updating
+#define CONTENT_CATALOGUE_SETTLE_MS 2000
+
+// How often the watcher checks for removed media and a departed frontend
+#define CONTENT_CATALOGUE_CHECK_MS 5000
+
+// Fallback update interval when inotify runs out of watches
+#define CONTENT_CATALOGUE_RESCAN_MS 60000
+
+#define CONTENT_CATALOGUE_HIDDEN (1 << 0) // Built with hidden content shown
+
+/*
+ * Catalogue layout as stored in CONTENT_CATALOGUE_FILE:
+ *   ContentCatalogueHeader
+ *   ContentCatalogueDir[dir_count]      (parents always before children)
+ *   ContentCatalogueEntry[entry_count]  (grouped by directory)
+ *   char strings[strings_size]          (nul terminated, offset 0 is "")
+ *
+ * Every directory is stored with its full path, while rel points into the
+ * same string just past the ROMS root. That is the part shared by the union
+ * mount and the core info folders, so "NES/Hacks" scopes a query on every
+ * storage device at once.
+ */
+typedef struct {
+    char magic[8];
+    int64_t rules_mtime; // Newest of the name tables and skip.ini when built
+    uint32_t flags;
+    uint32_t dir_count;
+    uint32_t entry_count;
+    uint32_t strings_size;
+} ContentCatalogueHeader;
+
+typedef struct {
+    uint32_t path;
+    uint32_t rel;
+    uint32_t parent;
+    uint32_t system;     // From core.cfg, empty when the folder is unassigned
+    uint32_t core;
+    uint32_t first_entry;
+    uint32_t entry_count;
+    uint32_t reserved;
+    int64_t mtime;
+    int64_t core_mtime;  // Newest of the core info folder and every cfg in it
+} ContentCatalogueDir;
+
+typedef struct {
+    uint32_t dir;
+    uint32_t file;
+    uint32_t name;       // Friendly name, empty when the table has none
+    uint32_t system;     // Individual assignment first, then the folder's
+    uint32_t core;
+    uint32_t reserved;
+    int64_t mtime;
+} ContentCatalogueEntry;
+
+typedef struct content_catalogue content_catalogue;
+
+typedef struct {
+    const char *dir;
+    const char *rel;
+    const char *file;
+    const char *name;
+    const char *system;
+    const char *core;
+    int64_t mtime;
+} content_catalogue_item;
+
+/*
+ * Maps the catalogue read only. Returns NULL when it has not been built yet
+ * or does not validate, in which case callers walk storage themselves. A
+ * mapping stays valid after the file is replaced, it just goes stale.
+ */
+content_catalogue *content_catalogue_open(void);
+
+void content_catalogue_close(content_catalogue *catalogue);
+
+size_t content_catalogue_count(const content_catalogue *catalogue);
+
+bool content_catalogue_item_at(const content_catalogue *catalogue, size_t index, content_catalogue_item *item);
+
+size_t content_catalogue_folder_count(const content_catalogue *catalogue);
+
+bool content_catalogue_folder_at(const content_catalogue *catalogue, size_t index, const char **dir, const char **rel);
+
+// Folder relative to ROMS for a path on the union mount, NULL for anything outside of it
+const char *content_catalogue_scope(const char *union_dir);
+
+// True when the catalogue holds a folder at rel, "" being the ROMS root
+bool content_catalogue_covers(const content_catalogue *catalogue, const char *rel);
+
+/*
+ * Same matching as content_search, a file name, friendly name or alias that
+ * contains query, over everything at or below scope (relative to ROMS, ""
+ * for all of it). Results go straight to handler and are only valid for the
+ * duration of the call. Returns how many matched.
+ */
+size_t content_catalogue_search(const content_catalogue *catalogue, const char *query, const char *scope,
+                                content_search_alias alias, content_search_handler handler, void *ctx);
+
+// Picks any content at or below scope, false when there is none
+bool content_catalogue_random(const content_catalogue *catalogue, const char *scope, content_catalogue_item *item);
+
+/*
+ * Brings the catalogue up to date with every root and replaces the file.
+ * Folders whose own mtime, core info and the naming rules are unchanged are
+ * carried over without being read, so an update of an untouched library is a
+ * stat per folder.
+ */
+bool content_catalogue_update(const char *const roots[], size_t root_count);
+
+#endif
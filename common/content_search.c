@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "log.h"
+#include "friendly_name.h"
+#include "content_search.h"
+
+// Directories waiting to be read by one worker. The owner pops from the top,
+// thieves take from the bottom where the shallowest and largest subtrees sit.
+typedef struct {
+    pthread_mutex_t lock;
+    char **dirs;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} dir_stack;
+
+typedef struct {
+    content_search *search;
+    int index;
+} search_worker;
+
+struct content_search {
+    char query[MAX_BUFFER_SIZE];
+    content_search_alias alias;
+
+    int worker_count;
+    pthread_t threads[CONTENT_SEARCH_MAX_WORKERS];
+    bool started[CONTENT_SEARCH_MAX_WORKERS];
+    search_worker workers[CONTENT_SEARCH_MAX_WORKERS];
+    dir_stack stacks[CONTENT_SEARCH_MAX_WORKERS];
+
+    atomic_size_t outstanding; // Directories queued or being read
+    atomic_int cancelled;
+    atomic_int running_workers;
+    atomic_size_t found;
+
+    pthread_mutex_t result_lock;
+    content_search_result *results;
+    size_t result_count;
+    size_t result_capacity;
+};
+
+static bool stack_push(dir_stack *stack, char *dir) {
+    pthread_mutex_lock(&stack->lock);
+
+    if (stack->count == stack->capacity) {
+        size_t capacity = stack->capacity ? stack->capacity * 2 : 64;
+        char **dirs = realloc(stack->dirs, capacity * sizeof(char *));
+
+        if (!dirs) {
+            pthread_mutex_unlock(&stack->lock);
+            LOG_ERROR(mux_module, "Search out of memory, skipping '%s'", dir)
+            free(dir);
+            return false;
+        }
+
+        stack->dirs = dirs;
+        stack->capacity = capacity;
+    }
+
+    stack->dirs[stack->count++] = dir;
+    pthread_mutex_unlock(&stack->lock);
+
+    return true;
+}
+
+static char *stack_take(dir_stack *stack, int steal) {
+    char *dir = NULL;
+
+    pthread_mutex_lock(&stack->lock);
+
+    if (stack->head < stack->count) {
+        dir = steal ? stack->dirs[stack->head++] : stack->dirs[--stack->count];
+        if (stack->head == stack->count) stack->head = stack->count = 0;
+    }
+
+    pthread_mutex_unlock(&stack->lock);
+    return dir;
+}
+
+static char *next_dir(content_search *search, int index) {
+    char *dir = stack_take(&search->stacks[index], 0);
+    if (dir) return dir;
+
+    for (int i = 1; i < search->worker_count; i++) {
+        dir = stack_take(&search->stacks[(index + i) % search->worker_count], 1);
+        if (dir) return dir;
+    }
+
+    return NULL;
+}
+
+static void queue_dir(content_search *search, int index, char *dir) {
+    // Counted before it is visible so the walk never looks finished while it is queued
+    atomic_fetch_add(&search->outstanding, 1);
+    if (!stack_push(&search->stacks[index], dir)) atomic_fetch_sub(&search->outstanding, 1);
+}
+
+static void add_result(content_search *search, const char *dir, const char *file, const char *name) {
+    content_search_result result = {
+            .dir = strdup(dir),
+            .file = strdup(file),
+            .name = strdup(name),
+    };
+
+    if (!result.dir || !result.file || !result.name) goto fail;
+
+    pthread_mutex_lock(&search->result_lock);
+
+    if (search->result_count == search->result_capacity) {
+        size_t capacity = search->result_capacity ? search->result_capacity * 2 : 64;
+        content_search_result *results = realloc(search->results, capacity * sizeof(content_search_result));
+
+        if (!results) {
+            pthread_mutex_unlock(&search->result_lock);
+            goto fail;
+        }
+
+        search->results = results;
+        search->result_capacity = capacity;
+    }
+
+    search->results[search->result_count++] = result;
+    pthread_mutex_unlock(&search->result_lock);
+
+    atomic_fetch_add(&search->found, 1);
+    return;
+
+    fail:
+    free(result.dir);
+    free(result.file);
+    free(result.name);
+}
+
+static void match_file(content_search *search, const char *dir, const char *system, const char *file) {
+    char stripped[MAX_BUFFER_SIZE];
+    snprintf(stripped, sizeof(stripped), "%s", file);
+
+    char *ext = strrchr(stripped, '.');
+    if (ext && ext != stripped) *ext = '\0';
+
+    char friendly[MAX_BUFFER_SIZE] = "";
+
+    const char *friendly_name = friendly_name_lookup(system, stripped);
+    if (friendly_name) snprintf(friendly, sizeof(friendly), "%s", friendly_name);
+
+    if (friendly[0] && strcasestr(friendly, search->query)) {
+        add_result(search, dir, file, friendly);
+        return;
+    }
+
+    if (strcasestr(file, search->query)) {
+        add_result(search, dir, file, friendly[0] ? friendly : stripped);
+        return;
+    }
+
+    const char *alias = search->alias ? search->alias(stripped) : NULL;
+    if (alias && strcasestr(alias, search->query)) add_result(search, dir, file, friendly[0] ? friendly : alias);
+}
+
+static void read_dir(content_search *search, int index, const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) return;
+
+    // Friendly name tables are keyed on the folder the content sits in
+    const char *system = strrchr(path, '/');
+    system = system ? system + 1 : path;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) && !atomic_load_explicit(&search->cancelled, memory_order_relaxed)) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+        int is_dir = entry->d_type == DT_DIR;
+
+        // Some filesystems do not fill in the type, symlinked folders are not followed either way
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+            is_dir = S_ISDIR(st.st_mode);
+        }
+
+        if (should_skip(name, is_dir)) continue;
+
+        if (!is_dir) {
+            match_file(search, path, system, name);
+            continue;
+        }
+
+        size_t length = strlen(path) + strlen(name) + 2;
+        char *child = malloc(length);
+        if (!child) continue;
+
+        snprintf(child, length, "%s/%s", path, name);
+        queue_dir(search, index, child);
+    }
+
+    closedir(dir);
+}
+
+static void *search_thread(void *arg) {
+    search_worker *worker = arg;
+    content_search *search = worker->search;
+
+    while (!atomic_load(&search->cancelled)) {
+        char *dir = next_dir(search, worker->index);
+
+        if (!dir) {
+            if (atomic_load(&search->outstanding) == 0) break;
+
+            // Someone else is still reading a folder that may yet hand out work
+            struct timespec pause = {.tv_nsec = 1000000};
+            nanosleep(&pause, NULL);
+            continue;
+        }
+
+        read_dir(search, worker->index, dir);
+        free(dir);
+
+        atomic_fetch_sub(&search->outstanding, 1);
+    }
+
+    atomic_fetch_sub(&search->running_workers, 1);
+    return NULL;
+}
+
+content_search *content_search_start(const char *query, const char *const roots[], size_t root_count,
+                                     content_search_alias alias) {
+    content_search *search = calloc(1, sizeof(content_search));
+    if (!search) return NULL;
+
+    snprintf(search->query, sizeof(search->query), "%s", query);
+    search->alias = alias;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    search->worker_count = cpus < 1 ? 1 : (cpus > CONTENT_SEARCH_MAX_WORKERS ? CONTENT_SEARCH_MAX_WORKERS : (int) cpus);
+
+    pthread_mutex_init(&search->result_lock, NULL);
+    for (int i = 0; i < search->worker_count; i++) pthread_mutex_init(&search->stacks[i].lock, NULL);
+
+    // Spread the roots out so every worker starts on something of its own
+    for (size_t i = 0; i < root_count; i++) {
+        if (!roots[i] || !directory_exist((char *) roots[i])) continue;
+
+        char *root = strdup(roots[i]);
+        if (root) queue_dir(search, (int) (i % search->worker_count), root);
+    }
+
+    int started = 0;
+
+    atomic_store(&search->running_workers, search->worker_count);
+
+    for (int i = 0; i < search->worker_count; i++) {
+        search->workers[i] = (search_worker) {.search = search, .index = i};
+
+        if (pthread_create(&search->threads[i], NULL, search_thread, &search->workers[i]) != 0) {
+            // The workers that did start steal whatever was queued for this one
+            atomic_fetch_sub(&search->running_workers, 1);
+            continue;
+        }
+
+        search->started[i] = true;
+        started++;
+    }
+
+    if (!started) {
+        LOG_ERROR(mux_module, "Unable to start content search")
+        content_search_stop(search);
+        return NULL;
+    }
+
+    return search;
+}
+
+bool content_search_drain(content_search *search, content_search_handler handler, void *ctx) {
+    // Checked first, results are always in place before a worker counts itself out
+    int finished = atomic_load(&search->running_workers) == 0;
+
+    pthread_mutex_lock(&search->result_lock);
+
+    content_search_result *results = search->results;
+    size_t count = search->result_count;
+
+    search->results = NULL;
+    search->result_count = 0;
+    search->result_capacity = 0;
+
+    pthread_mutex_unlock(&search->result_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        if (handler) handler(&results[i], ctx);
+
+        free(results[i].dir);
+        free(results[i].file);
+        free(results[i].name);
+    }
+
+    free(results);
+
+    return !finished;
+}
+
+size_t content_search_found(content_search *search) {
+    return atomic_load(&search->found);
+}
+
+void content_search_stop(content_search *search) {
+    if (!search) return;
+
+    atomic_store(&search->cancelled, 1);
+
+    for (int i = 0; i < search->worker_count; i++) {
+        if (search->started[i]) pthread_join(search->threads[i], NULL);
+    }
+
+    content_search_drain(search, NULL, NULL);
+
+    for (int i = 0; i < search->worker_count; i++) {
+        dir_stack *stack = &search->stacks[i];
+
+        for (size_t j = stack->head; j < stack->count; j++) free(stack->dirs[j]);
+        free(stack->dirs);
+
+        pthread_mutex_destroy(&stack->lock);
+    }
+
+    pthread_mutex_destroy(&search->result_lock);
+    free(search);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef CONTENT_SEARCH_H
+#define CONTENT_SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Upper bound on directory reader threads, storage rarely benefits from more
+#define CONTENT_SEARCH_MAX_WORKERS 4
+
+typedef struct content_search content_search;
+
+typedef struct {
+    char *dir;  // Directory the match was found in
+    char *file; // File name within dir
+    char *name; // Name to display, the friendly or alias name when that is what matched
+} content_search_result;
+
+// Optional alternative name for a file (without extension), such as the arcade lookup table
+typedef const char *(*content_search_alias)(const char *name);
+
+typedef void (*content_search_handler)(const content_search_result *result, void *ctx);
+
+/*
+ * Walks every root in the background looking for content whose file name,
+ * friendly name or alias contains query (case insensitive). Each reader
+ * thread keeps its own stack of directories to visit and steals from the
+ * others once it runs dry, so one deep folder does not leave the rest idle.
+ * Anything should_skip rejects is neither matched nor descended into.
+ */
+content_search *content_search_start(const char *query, const char *const roots[], size_t root_count,
+                                     content_search_alias alias);
+
+/*
+ * Hands every result found since the last call to handler, on the calling
+ * thread. Returns false once the walk has finished and everything found has
+ * been handed over.
+ */
+bool content_search_drain(content_search *search, content_search_handler handler, void *ctx);
+
+size_t content_search_found(content_search *search);
+
+// Stops the walk if it is still going and frees the search
+void content_search_stop(content_search *search);
+
+#endif
@@ -0,0 +1,237 @@
+#include "event_bus.h"
+#include "common.h"
+#include "log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#define EVENT_BUS_DIR_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE)
+
+typedef struct {
+    char path[PATH_MAX];
+    int wd; // -1 once the directory watch is gone
+} bus_dir;
+
+typedef struct {
+    char path[PATH_MAX];
+    const char *name;
+    int dir;
+    bool exists;
+    uint32_t generation;
+} bus_flag;
+
+static bus_dir dirs[EVENT_BUS_MAX_DIRS];
+static int dir_count = 0;
+
+static bus_flag flags[EVENT_BUS_MAX_FLAGS];
+static int flag_count = 0;
+
+static int bus_initialised = 0;
+static int epoll_fd = -1;
+static int inotify_fd = -1;
+static int wake_pipe[2] = {-1, -1};
+
+static void bus_init(void) {
+    if (bus_initialised) return;
+    bus_initialised = 1;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        LOG_WARN(mux_module, "Event bus unavailable, flag files will be polled")
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd != -1) {
+        ev.data.fd = inotify_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &ev);
+    } else {
+        LOG_WARN(mux_module, "inotify unavailable, flag files will be polled")
+    }
+
+    if (pipe(wake_pipe) == 0) {
+        for (int i = 0; i < 2; i++) {
+            fcntl(wake_pipe[i], F_SETFL, O_NONBLOCK);
+            fcntl(wake_pipe[i], F_SETFD, FD_CLOEXEC);
+        }
+
+        ev.data.fd = wake_pipe[0];
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_pipe[0], &ev);
+    } else {
+        wake_pipe[0] = -1;
+        wake_pipe[1] = -1;
+    }
+}
+
+static int watch_dir(const char *path) {
+    for (int i = 0; i < dir_count; i++) {
+        if (strcmp(dirs[i].path, path) == 0) return i;
+    }
+
+    if (dir_count >= EVENT_BUS_MAX_DIRS) return -1;
+
+    bus_dir *dir = &dirs[dir_count];
+    snprintf(dir->path, sizeof(dir->path), "%s", path);
+
+    dir->wd = inotify_fd == -1 ? -1 : inotify_add_watch(inotify_fd, path, EVENT_BUS_DIR_MASK | IN_ONLYDIR);
+    if (dir->wd == -1) LOG_WARN(mux_module, "Unable to watch '%s', flag files will be polled", path)
+
+    return dir_count++;
+}
+
+static bool flag_watched(const bus_flag *flag) {
+    return flag->dir >= 0 && dirs[flag->dir].wd != -1;
+}
+
+int event_bus_watch(const char *path) {
+    bus_init();
+
+    for (int i = 0; i < flag_count; i++) {
+        if (strcmp(flags[i].path, path) == 0) return i;
+    }
+
+    if (flag_count >= EVENT_BUS_MAX_FLAGS) {
+        LOG_ERROR(mux_module, "Too many event bus flags, cannot watch '%s'", path)
+        return -1;
+    }
+
+    bus_flag *flag = &flags[flag_count];
+    snprintf(flag->path, sizeof(flag->path), "%s", path);
+
+    char *slash = strrchr(flag->path, '/');
+    flag->name = slash ? slash + 1 : flag->path;
+    flag->dir = -1;
+
+    if (slash && slash != flag->path) {
+        *slash = '\0';
+        flag->dir = watch_dir(flag->path);
+        *slash = '/';
+    }
+
+    // The watch is in place first so nothing between it and this check is missed
+    flag->exists = file_exist(flag->path);
+    flag->generation = 1;
+
+    return flag_count++;
+}
+
+bool event_bus_watched(int flag) {
+    if (flag < 0 || flag >= flag_count) return false;
+    return flag_watched(&flags[flag]);
+}
+
+bool event_bus_exists(int flag) {
+    if (flag < 0 || flag >= flag_count) return false;
+    if (!flag_watched(&flags[flag])) return file_exist(flags[flag].path);
+
+    return flags[flag].exists;
+}
+
+uint32_t event_bus_generation(int flag) {
+    if (flag < 0 || flag >= flag_count) return 0;
+
+    // Unwatched flags always look changed so callers keep re-reading them
+    if (!flag_watched(&flags[flag])) return ++flags[flag].generation;
+
+    return flags[flag].generation;
+}
+
+bool event_bus_consume(int flag) {
+    if (!event_bus_exists(flag)) return false;
+
+    // Cleared now rather than when the delete event arrives so it is only seen once
+    flags[flag].exists = false;
+    flags[flag].generation++;
+
+    remove(flags[flag].path);
+    return true;
+}
+
+int event_bus_fd(void) {
+    bus_init();
+    return epoll_fd;
+}
+
+static void rescan_flags(void) {
+    for (int i = 0; i < flag_count; i++) {
+        flags[i].exists = file_exist(flags[i].path);
+        flags[i].generation++;
+    }
+}
+
+static void handle_inotify(const struct inotify_event *event) {
+    if (event->mask & IN_Q_OVERFLOW) {
+        rescan_flags();
+        return;
+    }
+
+    for (int i = 0; i < dir_count; i++) {
+        if (dirs[i].wd != event->wd) continue;
+
+        // The directory itself is gone, anything in it goes back to being polled
+        if (event->mask & IN_IGNORED) {
+            dirs[i].wd = -1;
+            return;
+        }
+
+        if (!event->len) return;
+
+        for (int j = 0; j < flag_count; j++) {
+            if (flags[j].dir != i || strcmp(flags[j].name, event->name) != 0) continue;
+
+            if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                flags[j].exists = false;
+            } else {
+                flags[j].exists = true;
+            }
+
+            flags[j].generation++;
+        }
+
+        return;
+    }
+}
+
+void event_bus_dispatch(void) {
+    if (inotify_fd != -1) {
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length;
+
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char *ptr = buffer; ptr < buffer + length;) {
+                const struct inotify_event *event = (const struct inotify_event *) ptr;
+                handle_inotify(event);
+                ptr += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+
+    if (wake_pipe[0] != -1) {
+        char buffer[64];
+        while (read(wake_pipe[0], buffer, sizeof(buffer)) > 0) {}
+    }
+}
+
+void event_bus_poll(void) {
+    if (bus_initialised) event_bus_dispatch();
+}
+
+void event_bus_wake(void) {
+    int saved_errno = errno;
+
+    if (wake_pipe[1] != -1) {
+        unsigned char b = 1;
+        (void) write(wake_pipe[1], &b, 1);
+    }
+
+    errno = saved_errno;
+}
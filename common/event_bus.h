@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How many flag files a process can watch
+#define EVENT_BUS_MAX_FLAGS 16
+
+// How many distinct directories those flag files can live in
+#define EVENT_BUS_MAX_DIRS 8
+
+/*
+ * Flag files (/tmp/safe_quit, /tmp/mux_blank and friends) are watched through
+ * inotify on their parent directory and their state is cached, so asking about
+ * a flag costs nothing until something actually changes. The bus descriptor is
+ * part of the mux_input_task epoll set, which dispatches pending changes as
+ * they arrive and then runs the idle handler. Without inotify every query falls
+ * back to checking the filesystem directly.
+ *
+ * Everything here except event_bus_wake belongs to the input thread.
+ */
+int event_bus_watch(const char *path);
+
+bool event_bus_exists(int flag);
+
+// Whether changes to the flag arrive on the bus, otherwise the caller has to poll
+bool event_bus_watched(int flag);
+
+// Changes every time the flag file is created, removed or rewritten
+uint32_t event_bus_generation(int flag);
+
+// Removes the flag file if it is present, returning whether it was
+bool event_bus_consume(int flag);
+
+int event_bus_fd(void);
+
+void event_bus_dispatch(void);
+
+// Dispatches anything pending without waiting, for use outside the input loop
+void event_bus_poll(void);
+
+// Async signal safe, wakes the input loop so the idle handler runs promptly
+void event_bus_wake(void);
+
+#endif
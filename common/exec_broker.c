@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "common.h"
+#include "log.h"
+#include "exec_broker.h"
+
+extern char **environ;
+
+#define BROKER_DETACH 1
+
+/*
+ * Request layout, sent as a single packet:
+ *   broker_request
+ *   char strings[]  (log file, argv and then environment, each nul terminated)
+ * A result pipe, when wanted, travels alongside as SCM_RIGHTS.
+ */
+typedef struct {
+    uint32_t flags;
+    uint32_t argc;
+    uint32_t envc;
+} broker_request;
+
+typedef struct {
+    pid_t pid;
+    int fd;
+} broker_watch;
+
+static int broker_fd = -1;
+
+static void report_exit(int fd, int exit_code) {
+    if (fd < 0) return;
+
+    (void) write(fd, &exit_code, sizeof(exit_code));
+    close(fd);
+}
+
+static pid_t broker_launch(const broker_request *req, char *strings, size_t length) {
+    char *argv[req->argc + 1];
+    char *envp[req->envc + 1];
+
+    char *log_file = strings;
+    char *next = log_file + strlen(log_file) + 1;
+
+    for (uint32_t i = 0; i < req->argc + req->envc; i++) {
+        if (next >= strings + length) return -1;
+
+        if (i < req->argc) {
+            argv[i] = next;
+        } else {
+            envp[i - req->argc] = next;
+        }
+
+        next += strlen(next) + 1;
+    }
+
+    argv[req->argc] = NULL;
+    envp[req->envc] = NULL;
+
+    if (!req->argc) return -1;
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+
+    // The broker blocks SIGCHLD for its signalfd, children should not inherit that
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGCHLD);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+
+    if (req->flags & BROKER_DETACH) {
+#ifdef POSIX_SPAWN_SETSID
+        flags |= POSIX_SPAWN_SETSID;
+#endif
+        const char *target = *log_file ? log_file : "/dev/null";
+        int mode = *log_file ? O_WRONLY | O_CREAT | O_APPEND : O_RDWR;
+
+        // Same as the fork path, a log file that cannot be opened falls back to /dev/null
+        if (*log_file) {
+            int probe = open(log_file, mode | O_CLOEXEC, 0644);
+            if (probe < 0) {
+                target = "/dev/null";
+                mode = O_RDWR;
+            } else {
+                close(probe);
+            }
+        }
+
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, target, mode, 0644);
+        posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, STDIN_FILENO, STDERR_FILENO);
+    }
+
+    posix_spawnattr_setflags(&attr, flags);
+
+    pid_t pid;
+    int error = posix_spawnp(&pid, argv[0], &actions, &attr, argv, envp);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    return error ? -1 : pid;
+}
+
+static void broker_reap(broker_watch *watches, int *watch_count) {
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < *watch_count; i++) {
+            if (watches[i].pid != pid) continue;
+
+            report_exit(watches[i].fd, WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+            watches[i] = watches[--(*watch_count)];
+            break;
+        }
+    }
+}
+
+static void broker_main(int sock, pid_t parent) {
+    // The broker has no reason to outlive the process it serves, the commands it started do
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != parent) _exit(EXIT_SUCCESS);
+
+    // Handlers inherited from the frontend would act on its state, not ours
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGUSR1, SIG_DFL);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int child_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (child_fd < 0) _exit(EXIT_FAILURE);
+
+    static char buffer[EXEC_BROKER_MAX_REQUEST];
+    broker_watch watches[EXEC_BROKER_MAX_WATCH];
+    int watch_count = 0;
+
+    struct pollfd fds[2] = {
+            {.fd = sock, .events = POLLIN},
+            {.fd = child_fd, .events = POLLIN},
+    };
+
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            _exit(EXIT_FAILURE);
+        }
+
+        if (fds[1].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(child_fd, &info, sizeof(info)) > 0) {}
+
+            broker_reap(watches, &watch_count);
+        }
+
+        if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+        char control[CMSG_SPACE(sizeof(int))];
+        struct iovec iov = {.iov_base = buffer, .iov_len = sizeof(buffer)};
+        struct msghdr msg = {
+                .msg_iov = &iov,
+                .msg_iovlen = 1,
+                .msg_control = control,
+                .msg_controllen = sizeof(control),
+        };
+
+        ssize_t length = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+        if (length < 0 && errno == EINTR) continue;
+
+        // The frontend closed its end or went away
+        if (length <= 0) _exit(EXIT_SUCCESS);
+
+        int result_fd = -1;
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&result_fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+
+        if ((size_t) length <= sizeof(broker_request) || buffer[length - 1] != '\0') {
+            report_exit(result_fd, -1);
+            continue;
+        }
+
+        broker_request req;
+        memcpy(&req, buffer, sizeof(req));
+
+        pid_t pid = broker_launch(&req, buffer + sizeof(req), (size_t) length - sizeof(req));
+
+        if (pid < 0) {
+            report_exit(result_fd, -1);
+        } else if (result_fd >= 0) {
+            if (watch_count < EXEC_BROKER_MAX_WATCH) {
+                watches[watch_count++] = (broker_watch) {.pid = pid, .fd = result_fd};
+            } else {
+                // Still started, it just can't be reported on
+                report_exit(result_fd, -1);
+            }
+        }
+
+        // Catch anything that finished before it was being watched
+        broker_reap(watches, &watch_count);
+    }
+}
+
+int exec_broker_start(void) {
+    if (broker_fd >= 0) return 1;
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) != 0) {
+        LOG_WARN(mux_module, "Exec broker unavailable, commands will fork")
+        return 0;
+    }
+
+    pid_t parent = getpid();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        LOG_WARN(mux_module, "Exec broker unavailable, commands will fork")
+        return 0;
+    }
+
+    if (pid == 0) {
+        close(sv[0]);
+        broker_main(sv[1], parent);
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(sv[1]);
+    broker_fd = sv[0];
+
+    return 1;
+}
+
+static int append_string(char *buffer, size_t *length, const char *str) {
+    size_t size = strlen(str) + 1;
+    if (*length + size > EXEC_BROKER_MAX_REQUEST) return 0;
+
+    memcpy(buffer + *length, str, size);
+    *length += size;
+
+    return 1;
+}
+
+int exec_broker_spawn(const char *const argv[], int detach, const char *log_file, int *result_fd) {
+    if (broker_fd < 0 || !argv || !argv[0]) return 0;
+
+    char *buffer = malloc(EXEC_BROKER_MAX_REQUEST);
+    if (!buffer) return 0;
+
+    broker_request req = {.flags = detach ? BROKER_DETACH : 0};
+    size_t length = sizeof(req);
+
+    int fits = append_string(buffer, &length, detach && log_file ? log_file : "");
+    for (; fits && argv[req.argc]; req.argc++) fits = append_string(buffer, &length, argv[req.argc]);
+    for (; fits && environ && environ[req.envc]; req.envc++) fits = append_string(buffer, &length, environ[req.envc]);
+
+    if (!fits) {
+        free(buffer);
+        return 0;
+    }
+
+    memcpy(buffer, &req, sizeof(req));
+
+    int result[2] = {-1, -1};
+    if (!detach && result_fd && pipe(result) != 0) {
+        free(buffer);
+        return 0;
+    }
+
+    struct iovec iov = {.iov_base = buffer, .iov_len = length};
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1};
+    char control[CMSG_SPACE(sizeof(int))];
+
+    if (result[1] >= 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &result[1], sizeof(int));
+    }
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(broker_fd, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+
+    free(buffer);
+
+    if (result[1] >= 0) close(result[1]);
+
+    if (sent != (ssize_t) length) {
+        if (result[0] >= 0) close(result[0]);
+
+        // A broker that has gone away is not coming back, stop trying it
+        if (sent < 0 && (errno == EPIPE || errno == ECONNRESET)) {
+            close(broker_fd);
+            broker_fd = -1;
+        }
+
+        return 0;
+    }
+
+    if (result_fd) *result_fd = result[0];
+    return 1;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef EXEC_BROKER_H
+#define EXEC_BROKER_H
+
+// Largest request (argv, environment and log file) that can be sent to the broker
+#define EXEC_BROKER_MAX_REQUEST 65536
+
+// Children of the broker it can report exit codes for at once
+#define EXEC_BROKER_MAX_WATCH 64
+
+/*
+ * Forking the frontend for every command copies the page tables of the LVGL
+ * heap and framebuffers, which is slow on low memory devices. The broker is a
+ * small helper forked before any of that exists. It receives commands over a
+ * Unix socket and starts them with posix_spawn.
+ *
+ * Call exec_broker_start as early as possible in main, before the display or
+ * anything else large is initialised. If it was never started or has gone
+ * away, exec_broker_spawn returns 0 and the caller falls back to fork.
+ */
+int exec_broker_start(void);
+
+/*
+ * Starts argv[0] (looked up in PATH) with the current environment.
+ *
+ * A detached command gets its own session with stdin, stdout and stderr on
+ * log_file (or /dev/null), and nothing is reported back.
+ *
+ * Otherwise, if result_fd is given, it receives the read end of a pipe. Once
+ * the command finishes, that pipe yields its exit code as an int: -1 if it
+ * did not exit normally or could not be started.
+ */
+int exec_broker_spawn(const char *const argv[], int detach, const char *log_file, int *result_fd);
+
+#endif
@@ -0,0 +1,455 @@
+#include "friendly_name.h"
+#include "common.h"
+#include "log.h"
+#include "options.h"
+#include "text_file.h"
+#include "json/json.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    char system[PATH_MAX];
+    char source[PATH_MAX];
+    bool has_source;
+    off_t source_size;
+    struct timespec source_mtime;
+
+    uint8_t *base;
+    size_t length;
+    bool mapped;
+
+    uint64_t checked_ms;
+    uint64_t last_used;
+} FriendlyTable;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t key;
+    uint32_t value;
+} FriendlyEntry;
+
+static FriendlyTable tables[FRIENDLY_NAME_CACHE_SIZE];
+static size_t table_count = 0;
+static uint64_t use_counter = 0;
+static pthread_mutex_t table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
+
+static size_t lower_copy(char *dest, size_t dest_size, const char *src) {
+    size_t len = 0;
+
+    while (src[len] && len + 1 < dest_size) {
+        dest[len] = (char) tolower((unsigned char) src[len]);
+        len++;
+    }
+    dest[len] = '\0';
+
+    return len;
+}
+
+static void table_unload(FriendlyTable *table) {
+    if (table->base) {
+        if (table->mapped) {
+            munmap(table->base, table->length);
+        } else {
+            free(table->base);
+        }
+    }
+
+    table->base = NULL;
+    table->length = 0;
+    table->mapped = false;
+}
+
+// A path is used as is, anything else is a system name with a global fallback
+static bool resolve_source(const char *system, char *source, size_t source_size, struct stat *st) {
+    if (system[0] == '/') {
+        snprintf(source, source_size, "%s", system);
+        return stat(source, st) == 0 && S_ISREG(st->st_mode);
+    }
+
+    char system_lower[NAME_MAX + 1];
+    lower_copy(system_lower, sizeof(system_lower), system);
+
+    snprintf(source, source_size, INFO_NAM_PATH "/%s.json", system_lower);
+    if (stat(source, st) == 0 && S_ISREG(st->st_mode)) return true;
+
+    snprintf(source, source_size, INFO_NAM_PATH "/global.json");
+    return stat(source, st) == 0 && S_ISREG(st->st_mode);
+}
+
+static bool header_valid(const uint8_t *base, size_t length, off_t size, const struct timespec *mtime) {
+    if (length < sizeof(FriendlyNameHeader)) return false;
+
+    const FriendlyNameHeader *header = (const FriendlyNameHeader *) base;
+    if (memcmp(header->magic, FRIENDLY_NAME_MAGIC, sizeof(header->magic)) != 0) return false;
+
+    if (header->source_size != (uint64_t) size ||
+        header->source_mtime_sec != (int64_t) mtime->tv_sec ||
+        header->source_mtime_nsec != (int64_t) mtime->tv_nsec) {
+        return false;
+    }
+
+    uint32_t slots = header->slot_count;
+    if (slots == 0 || (slots & (slots - 1)) != 0) return false;
+    if (header->strings_size == 0) return false;
+
+    if (sizeof(FriendlyNameHeader) + (uint64_t) slots * sizeof(FriendlyNameSlot) +
+        header->strings_size != length) {
+        return false;
+    }
+
+    // Every lookup ends in a strcmp, so the string region has to be terminated
+    return base[length - 1] == '\0';
+}
+
+static void compiled_path(const char *source, char *path, size_t path_size) {
+    snprintf(path, path_size, FRIENDLY_CACHE_PATH "/%08x.fnt", fnv1a_hash_str(source));
+}
+
+static bool map_compiled(const char *path, FriendlyTable *table) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(FriendlyNameHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void *base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (base == MAP_FAILED) return false;
+
+    if (!header_valid(base, (size_t) st.st_size, table->source_size, &table->source_mtime)) {
+        munmap(base, (size_t) st.st_size);
+        return false;
+    }
+
+    table->base = base;
+    table->length = (size_t) st.st_size;
+    table->mapped = true;
+
+    return true;
+}
+
+static bool append_string(char **strings, size_t *size, size_t *capacity, const char *str, uint32_t *offset) {
+    size_t len = strlen(str) + 1;
+
+    if (*size + len > UINT32_MAX) return false;
+
+    if (*size + len > *capacity) {
+        size_t grown_capacity = *capacity ? *capacity * 2 : 4096;
+        while (grown_capacity < *size + len) grown_capacity *= 2;
+
+        char *grown = realloc(*strings, grown_capacity);
+        if (!grown) return false;
+
+        *strings = grown;
+        *capacity = grown_capacity;
+    }
+
+    memcpy(*strings + *size, str, len);
+    *offset = (uint32_t) *size;
+    *size += len;
+
+    return true;
+}
+
+static uint8_t *compile_source(const char *source, size_t *length, off_t *source_size,
+                               struct timespec *source_mtime) {
+    TextFile *tf = text_file_load(source);
+    if (!tf) return NULL;
+
+    uint8_t *table = NULL;
+    FriendlyEntry *entries = NULL;
+    char *strings = NULL;
+
+    size_t entry_count = 0;
+    size_t entry_capacity = 0;
+    size_t strings_size = 0;
+    size_t strings_capacity = 0;
+    uint32_t empty_offset;
+
+    *source_size = tf->size;
+    *source_mtime = tf->mtime;
+
+    if (!json_validn(tf->data, tf->length)) {
+        LOG_WARN(mux_module, "Invalid Friendly Name: %s", source)
+        goto cleanup;
+    }
+
+    struct json root = json_parsen(tf->data, tf->length);
+    if (json_type(root) != JSON_OBJECT) {
+        LOG_WARN(mux_module, "Invalid Friendly Name: %s", source)
+        goto cleanup;
+    }
+
+    // Offset 0 marks an empty slot so the string region starts with a spare nul
+    if (!append_string(&strings, &strings_size, &strings_capacity, "", &empty_offset)) goto cleanup;
+
+    for (struct json key = json_first(root); json_exists(key); key = json_next(key)) {
+        struct json value = json_next(key);
+        if (!json_exists(value)) break;
+
+        char key_buf[MAX_BUFFER_SIZE];
+        char value_buf[MAX_BUFFER_SIZE];
+
+        if (json_type(value) == JSON_STRING &&
+            json_string_copy(key, key_buf, sizeof(key_buf)) < sizeof(key_buf) &&
+            json_string_copy(value, value_buf, sizeof(value_buf)) < sizeof(value_buf)) {
+            lower_copy(key_buf, sizeof(key_buf), key_buf);
+
+            if (entry_count == entry_capacity) {
+                entry_capacity = entry_capacity ? entry_capacity * 2 : 256;
+                FriendlyEntry *grown = realloc(entries, entry_capacity * sizeof(FriendlyEntry));
+                if (!grown) goto cleanup;
+                entries = grown;
+            }
+
+            FriendlyEntry *entry = &entries[entry_count];
+            entry->hash = fnv1a_hash_str(key_buf);
+
+            if (!append_string(&strings, &strings_size, &strings_capacity, key_buf, &entry->key) ||
+                !append_string(&strings, &strings_size, &strings_capacity, value_buf, &entry->value)) {
+                goto cleanup;
+            }
+
+            entry_count++;
+        }
+
+        key = value;
+    }
+
+    // Keep the load factor at or below one half so probes stay short
+    uint32_t slot_count = 8;
+    while (slot_count < entry_count * 2) slot_count <<= 1;
+
+    *length = sizeof(FriendlyNameHeader) + (size_t) slot_count * sizeof(FriendlyNameSlot) + strings_size;
+    table = calloc(1, *length);
+    if (!table) goto cleanup;
+
+    FriendlyNameHeader *header = (FriendlyNameHeader *) table;
+    FriendlyNameSlot *slots = (FriendlyNameSlot *) (table + sizeof(FriendlyNameHeader));
+    char *table_strings = (char *) (slots + slot_count);
+
+    memcpy(header->magic, FRIENDLY_NAME_MAGIC, sizeof(header->magic));
+    header->source_size = (uint64_t) tf->size;
+    header->source_mtime_sec = (int64_t) tf->mtime.tv_sec;
+    header->source_mtime_nsec = (int64_t) tf->mtime.tv_nsec;
+    header->slot_count = slot_count;
+    header->strings_size = (uint32_t) strings_size;
+    memcpy(table_strings, strings, strings_size);
+
+    uint32_t mask = slot_count - 1;
+    for (size_t i = 0; i < entry_count; i++) {
+        uint32_t pos = entries[i].hash & mask;
+
+        // Duplicate keys keep their first value, as json_object_get did
+        while (slots[pos].key != 0) {
+            if (slots[pos].hash == entries[i].hash &&
+                strcmp(table_strings + slots[pos].key, table_strings + entries[i].key) == 0) {
+                break;
+            }
+            pos = (pos + 1) & mask;
+        }
+
+        if (slots[pos].key != 0) continue;
+
+        slots[pos].hash = entries[i].hash;
+        slots[pos].key = entries[i].key;
+        slots[pos].value = entries[i].value;
+        header->entry_count++;
+    }
+
+    cleanup:
+    free(entries);
+    free(strings);
+    text_file_release(tf);
+
+    return table;
+}
+
+static void write_compiled(const char *path, const uint8_t *table, size_t length) {
+    char temp_path[PATH_MAX + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d", path, (int) getpid());
+
+    create_directories(FRIENDLY_CACHE_PATH);
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(fd, table + written, length - written);
+        if (n <= 0) break;
+        written += (size_t) n;
+    }
+
+    close(fd);
+
+    if (written != length || rename(temp_path, path) != 0) remove(temp_path);
+}
+
+static bool table_load(FriendlyTable *table) {
+    char path[PATH_MAX];
+    compiled_path(table->source, path, sizeof(path));
+
+    if (map_compiled(path, table)) return true;
+
+    size_t length = 0;
+    uint8_t *compiled = compile_source(table->source, &length, &table->source_size, &table->source_mtime);
+    if (!compiled) return false;
+
+    LOG_SUCCESS(mux_module, "Using Friendly Name: %s", table->source)
+
+    // Later runs map the compiled table, this one keeps what it just built
+    write_compiled(path, compiled, length);
+
+    table->base = compiled;
+    table->length = length;
+    table->mapped = false;
+
+    return true;
+}
+
+static FriendlyTable *table_find(const char *system) {
+    for (size_t i = 0; i < table_count; i++) {
+        if (strcmp(tables[i].system, system) == 0) return &tables[i];
+    }
+
+    return NULL;
+}
+
+static FriendlyTable *table_slot(const char *system) {
+    FriendlyTable *table;
+
+    if (table_count < FRIENDLY_NAME_CACHE_SIZE) {
+        table = &tables[table_count++];
+    } else {
+        table = &tables[0];
+        for (size_t i = 1; i < table_count; i++) {
+            if (tables[i].last_used < table->last_used) table = &tables[i];
+        }
+        table_unload(table);
+    }
+
+    memset(table, 0, sizeof(FriendlyTable));
+    snprintf(table->system, sizeof(table->system), "%s", system);
+
+    return table;
+}
+
+static FriendlyTable *table_get(const char *system) {
+    uint64_t now = now_ms();
+    FriendlyTable *table = table_find(system);
+
+    // Paths such as the search results are rewritten in place, so always check them
+    if (table && system[0] != '/' && now - table->checked_ms < FRIENDLY_NAME_RECHECK_MS) return table;
+
+    char source[PATH_MAX];
+    struct stat st;
+    bool has_source = resolve_source(system, source, sizeof(source), &st);
+
+    if (table && table->has_source == has_source &&
+        (!has_source || (strcmp(table->source, source) == 0 &&
+                         table->source_size == st.st_size &&
+                         table->source_mtime.tv_sec == st.st_mtim.tv_sec &&
+                         table->source_mtime.tv_nsec == st.st_mtim.tv_nsec))) {
+        table->checked_ms = now;
+        return table;
+    }
+
+    if (table) {
+        table_unload(table);
+    } else {
+        table = table_slot(system);
+    }
+
+    snprintf(table->source, sizeof(table->source), "%s", source);
+    table->has_source = has_source;
+    table->source_size = st.st_size;
+    table->source_mtime = st.st_mtim;
+    table->checked_ms = now;
+
+    if (!has_source) {
+        LOG_WARN(mux_module, "Friendly Name does not exist: %s", source)
+    } else if (!table_load(table)) {
+        // Remember the failure against the current source so it is not retried per item
+        table_unload(table);
+    }
+
+    return table;
+}
+
+// Expects table_lock to be held, the result points into the mapped table
+static const char *table_lookup(const char *system, const char *name) {
+    FriendlyTable *table = table_get(system);
+    if (!table) return NULL;
+
+    table->last_used = ++use_counter;
+    if (!table->base) return NULL;
+
+    char key[MAX_BUFFER_SIZE];
+    lower_copy(key, sizeof(key), name);
+
+    const FriendlyNameHeader *header = (const FriendlyNameHeader *) table->base;
+    const FriendlyNameSlot *slots = (const FriendlyNameSlot *) (table->base + sizeof(FriendlyNameHeader));
+    const char *strings = (const char *) (slots + header->slot_count);
+
+    uint32_t hash = fnv1a_hash_str(key);
+    uint32_t mask = header->slot_count - 1;
+
+    for (uint32_t probe = 0, pos = hash & mask; probe < header->slot_count; probe++, pos = (pos + 1) & mask) {
+        const FriendlyNameSlot *slot = &slots[pos];
+
+        if (slot->key == 0) return NULL;
+        if (slot->key >= header->strings_size || slot->value >= header->strings_size) return NULL;
+
+        if (slot->hash == hash && strcmp(strings + slot->key, key) == 0) return strings + slot->value;
+    }
+
+    return NULL;
+}
+
+const char *friendly_name_lookup(const char *system, const char *name) {
+    static __thread char result[MAX_BUFFER_SIZE];
+    if (!system || !name || !*system) return NULL;
+
+    pthread_mutex_lock(&table_lock);
+    const char *value = table_lookup(system, name);
+    if (value) snprintf(result, sizeof(result), "%s", value);
+    pthread_mutex_unlock(&table_lock);
+
+    return value ? result : NULL;
+}
+
+void friendly_name_invalidate(const char *system) {
+    if (!system) return;
+
+    pthread_mutex_lock(&table_lock);
+    FriendlyTable *table = table_find(system);
+    if (table) {
+        table_unload(table);
+        table->has_source = false;
+        table->source[0] = '\0';
+        table->checked_ms = 0;
+    }
+    pthread_mutex_unlock(&table_lock);
+}
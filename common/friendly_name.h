@@ -0,0 +1,47 @@
+#pragma once
+
+#ifndef FRIENDLY_NAME_H
+#define FRIENDLY_NAME_H
+
+#include <stdint.h>
+
+// How many compiled name tables are kept open per process
+#define FRIENDLY_NAME_CACHE_SIZE 16
+
+// Minimum time between checks of a system table against its source json
+#define FRIENDLY_NAME_RECHECK_MS 1000
+
+#define FRIENDLY_NAME_MAGIC "MUXFNT01"
+
+/*
+ * Compiled table layout as stored in FRIENDLY_CACHE_PATH:
+ *   FriendlyNameHeader
+ *   FriendlyNameSlot[slot_count]  (open addressed, key offset 0 is empty)
+ *   char strings[strings_size]    (nul terminated keys and values)
+ */
+typedef struct {
+    char magic[8];
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint32_t slot_count;
+    uint32_t entry_count;
+    uint32_t strings_size;
+    uint32_t reserved;
+} FriendlyNameHeader;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t key;
+    uint32_t value;
+} FriendlyNameSlot;
+
+/*
+ * Safe to call from any thread. The result is a copy held per thread, valid
+ * until that thread's next lookup.
+ */
+const char *friendly_name_lookup(const char *system, const char *name);
+
+void friendly_name_invalidate(const char *system);
+
+#endif
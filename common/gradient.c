@@ -0,0 +1,203 @@
+#include "../lvgl/lvgl.h"
+#include <math.h>
+#include <string.h>
+#include "gradient.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// 4x4 Bayer Ordered Dithering Matrix (Normalized to 0-16)
+static const int bayerMatrix[4][4] = {
+        {0,  8,  2,  10},
+        {12, 4,  14, 6},
+        {3,  11, 1,  9},
+        {15, 7,  13, 5}
+};
+
+// Improved dithering function using Bayer matrix
+static lv_color_t dither_color(lv_color_t color, int x, int y) {
+    // Get matrix value (normalized to range -4 to +4)
+    int bayerValue = bayerMatrix[y % 4][x % 4] - 7;
+
+    int r = LV_COLOR_GET_R(color) + bayerValue;
+    int g = LV_COLOR_GET_G(color) + bayerValue;
+    int b = LV_COLOR_GET_B(color) + bayerValue;
+
+    // Clamp values
+    r = LV_CLAMP(0, r, 255);
+    g = LV_CLAMP(0, g, 255);
+    b = LV_CLAMP(0, b, 255);
+
+    return lv_color_make(r, g, b);
+}
+
+// Sums a pixel and its left and right neighbours per channel, edges are left untouched
+static void blur_row_sum(const lv_color_t *row, uint16_t *sum, int width) {
+    int x = 1;
+
+#if LV_COLOR_DEPTH == 32
+    const uint8_t *bytes = (const uint8_t *) row;
+
+#if defined(__ARM_NEON)
+    for (; x + 2 <= width - 1; x += 2) {
+        uint16x8_t total = vaddl_u8(vld1_u8(bytes + (x - 1) * 4), vld1_u8(bytes + x * 4));
+        total = vaddw_u8(total, vld1_u8(bytes + (x + 1) * 4));
+        vst1q_u16(sum + x * 4, total);
+    }
+#endif
+
+    for (int i = x * 4; i < (width - 1) * 4; i++) sum[i] = bytes[i - 4] + bytes[i] + bytes[i + 4];
+#else
+    for (; x < width - 1; x++) {
+        sum[x * 4 + 0] = LV_COLOR_GET_R(row[x - 1]) + LV_COLOR_GET_R(row[x]) + LV_COLOR_GET_R(row[x + 1]);
+        sum[x * 4 + 1] = LV_COLOR_GET_G(row[x - 1]) + LV_COLOR_GET_G(row[x]) + LV_COLOR_GET_G(row[x + 1]);
+        sum[x * 4 + 2] = LV_COLOR_GET_B(row[x - 1]) + LV_COLOR_GET_B(row[x]) + LV_COLOR_GET_B(row[x + 1]);
+    }
+#endif
+}
+
+/*
+ * Averages three row sums into the 3x3 box. (sum * 7282) >> 16 equals sum / 9
+ * for any sum of nine bytes, and an opaque alpha channel averages back to 255.
+ */
+static void blur_row_average(const uint16_t *above, const uint16_t *middle, const uint16_t *below,
+                             lv_color_t *row, int width) {
+    int x = 1;
+
+#if LV_COLOR_DEPTH == 32
+    uint8_t *bytes = (uint8_t *) row;
+
+#if defined(__ARM_NEON)
+    for (; x + 2 <= width - 1; x += 2) {
+        uint16x8_t total = vaddq_u16(vaddq_u16(vld1q_u16(above + x * 4), vld1q_u16(middle + x * 4)),
+                                     vld1q_u16(below + x * 4));
+
+        uint16x4_t low = vshrn_n_u32(vmull_n_u16(vget_low_u16(total), 7282), 16);
+        uint16x4_t high = vshrn_n_u32(vmull_n_u16(vget_high_u16(total), 7282), 16);
+
+        vst1_u8(bytes + x * 4, vmovn_u16(vcombine_u16(low, high)));
+    }
+#endif
+
+    for (int i = x * 4; i < (width - 1) * 4; i++) {
+        bytes[i] = (uint8_t) ((uint32_t) (above[i] + middle[i] + below[i]) * 7282 >> 16);
+    }
+#else
+    for (; x < width - 1; x++) {
+        const uint16_t *a = above + x * 4;
+        const uint16_t *m = middle + x * 4;
+        const uint16_t *b = below + x * 4;
+
+        row[x] = lv_color_make((a[0] + m[0] + b[0]) * 7282 >> 16,
+                               (a[1] + m[1] + b[1]) * 7282 >> 16,
+                               (a[2] + m[2] + b[2]) * 7282 >> 16);
+    }
+#endif
+}
+
+/*
+ * 3x3 box blur done as two running sums: every row is summed horizontally once
+ * and the three sums around a row are added to give the box. The sum of the
+ * row below is always taken before the row above it is overwritten, so each
+ * pass reads the same unblurred input the box would.
+ */
+void blur_gradient(lv_color_t *buf, int width, int height, int blur_strength) {
+    if (blur_strength <= 0 || width < 3 || height < 3) return;
+
+    uint16_t *sums = lv_mem_alloc((size_t) width * 4 * 3 * sizeof(uint16_t));
+    if (!sums) {
+        LV_LOG_ERROR("Failed to allocate memory for gradient blur!");
+        return;
+    }
+
+    uint16_t *rows[3] = {sums, sums + width * 4, sums + width * 8};
+
+    for (int pass = 0; pass < blur_strength; pass++) {
+        blur_row_sum(&buf[0], rows[0], width);
+        blur_row_sum(&buf[width], rows[1], width);
+
+        for (int y = 1; y < height - 1; y++) {
+            uint16_t *above = rows[(y - 1) % 3];
+            uint16_t *middle = rows[y % 3];
+            uint16_t *below = rows[(y + 1) % 3];
+
+            blur_row_sum(&buf[(y + 1) * width], below, width);
+            blur_row_average(above, middle, below, &buf[y * width], width);
+        }
+    }
+
+    lv_mem_free(sums);
+}
+
+// Interpolates in 16.16 fixed point instead of per pixel floats
+static lv_color_t gradient_color(lv_color_t start_color, lv_color_t end_color, int pos, int start_pos, int end_pos) {
+    int32_t ratio = (int32_t) (((int64_t) (pos - start_pos) << 16) / (end_pos - start_pos));
+    ratio = LV_CLAMP(0, ratio, 1 << 16);
+
+    uint32_t inverse = (1 << 16) - ratio;
+
+    return lv_color_make((LV_COLOR_GET_R(start_color) * inverse + LV_COLOR_GET_R(end_color) * ratio) >> 16,
+                         (LV_COLOR_GET_G(start_color) * inverse + LV_COLOR_GET_G(end_color) * ratio) >> 16,
+                         (LV_COLOR_GET_B(start_color) * inverse + LV_COLOR_GET_B(end_color) * ratio) >> 16);
+}
+
+// Fills a row with a pattern that repeats every four pixels, doubling each copy
+static void fill_row_pattern(lv_color_t *row, int width, const lv_color_t pattern[4]) {
+    int filled = LV_MIN(width, 4);
+    memcpy(row, pattern, filled * sizeof(lv_color_t));
+
+    while (filled < width) {
+        int count = LV_MIN(filled, width - filled);
+        memcpy(row + filled, row, count * sizeof(lv_color_t));
+        filled += count;
+    }
+}
+
+/*
+ * A gradient only changes along one axis and the Bayer matrix repeats every
+ * four pixels, so only a handful of distinct rows ever exist. Vertical
+ * gradients build each row from one four pixel pattern, horizontal gradients
+ * build the first four rows and copy them down the rest of the buffer.
+ */
+void generate_gradient_with_bayer_dither(lv_color_t *buf, int width, int height,
+                                         lv_color_t start_color, lv_color_t end_color,
+                                         bool apply_dither, bool vertical,
+                                         uint8_t main_stop, uint8_t grad_stop) {
+    // Convert gradient stop values (0-255) to pixel positions
+    int start_pos = (int) round(main_stop / 255.0) * (vertical ? height : width);
+    int end_pos = (int) round(grad_stop / 255.0) * (vertical ? height : width);
+
+    // Prevent invalid cases where start is beyond end
+    if (start_pos >= end_pos) {
+        start_pos = 0;
+        end_pos = vertical ? height : width;
+    }
+
+    if (end_pos <= start_pos) return;
+
+    if (vertical) {
+        for (int y = 0; y < height; y++) {
+            lv_color_t color = gradient_color(start_color, end_color, y, start_pos, end_pos);
+
+            lv_color_t pattern[4];
+            for (int x = 0; x < 4; x++) pattern[x] = apply_dither ? dither_color(color, x, y) : color;
+
+            fill_row_pattern(&buf[y * width], width, pattern);
+        }
+        return;
+    }
+
+    int pattern_rows = apply_dither ? LV_MIN(height, 4) : LV_MIN(height, 1);
+
+    for (int y = 0; y < pattern_rows; y++) {
+        for (int x = 0; x < width; x++) {
+            lv_color_t color = gradient_color(start_color, end_color, x, start_pos, end_pos);
+            buf[y * width + x] = apply_dither ? dither_color(color, x, y) : color;
+        }
+    }
+
+    for (int y = pattern_rows; y < height; y++) {
+        memcpy(&buf[y * width], &buf[(y % pattern_rows) * width], width * sizeof(lv_color_t));
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#ifndef GRADIENT_H
+#define GRADIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../lvgl/lvgl.h"
+
+// Fills the buffer with the theme gradient between the two stops, optionally Bayer dithered
+void generate_gradient_with_bayer_dither(lv_color_t *buf, int width, int height,
+                                         lv_color_t start_color, lv_color_t end_color,
+                                         bool apply_dither, bool vertical,
+                                         uint8_t main_stop, uint8_t grad_stop);
+
+// Runs a 3x3 box blur over everything but the outer edge, once per strength step
+void blur_gradient(lv_color_t *buf, int width, int height, int blur_strength);
+
+#endif
@@ -0,0 +1,357 @@
+#include "../lvgl/lvgl.h"
+#include "../lvgl/src/extra/libs/png/lodepng.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "log.h"
+#include "image_prefetch.h"
+
+#define PREFETCH_JOB_COUNT (IMAGE_PREFETCH_DISTANCE * 2)
+#define PREFETCH_MAX_DIMENSION 2047 // lv_img_header_t stores 11 bit sizes
+
+typedef struct {
+    char path[PATH_MAX];
+    uint32_t hash;
+    lv_img_dsc_t dsc;
+    size_t bytes;
+    uint64_t last_used;
+    int pins;
+} prefetch_entry;
+
+typedef struct {
+    int index;
+    char image_type[32];
+} prefetch_job;
+
+typedef struct {
+    lv_obj_t *img;
+    prefetch_entry *entry;
+} prefetch_pin;
+
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t prefetch_thread;
+static int prefetch_running = 0;
+static image_prefetch_resolver prefetch_resolve = NULL;
+
+static prefetch_job jobs[PREFETCH_JOB_COUNT];
+static int job_count = 0;
+static int job_next = 0;
+
+static prefetch_entry *entries[IMAGE_PREFETCH_MAX_ENTRIES];
+static int entry_count = 0;
+static size_t entry_bytes = 0;
+static uint64_t use_counter = 0;
+
+static prefetch_pin pins[IMAGE_PREFETCH_MAX_PINS];
+
+static prefetch_entry *entry_find(const char *path) {
+    uint32_t hash = fnv1a_hash_str(path);
+
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i]->hash == hash && strcmp(entries[i]->path, path) == 0) return entries[i];
+    }
+
+    return NULL;
+}
+
+static void entry_free(prefetch_entry *entry) {
+    if (!entry) return;
+
+    if (entry->dsc.data) lv_mem_free((void *) entry->dsc.data);
+    free(entry);
+}
+
+static int is_png(const char *path) {
+    const char *ext = strrchr(path, '.');
+    return ext && strcasecmp(ext, ".png") == 0;
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    uint8_t *data = malloc((size_t) st.st_size);
+    size_t length = 0;
+
+    while (data && length < (size_t) st.st_size) {
+        ssize_t n = read(fd, data + length, (size_t) st.st_size - length);
+        if (n <= 0) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        length += (size_t) n;
+    }
+
+    close(fd);
+
+    *size = length;
+    return data;
+}
+
+/*
+ * Decodes a PNG the same way the LVGL PNG decoder does, but into an image
+ * descriptor that can be handed to lv_img_set_src as is. Unlike the decoder
+ * this never touches LVGL state, so it is safe to run off the UI thread.
+ */
+int image_decode_png(const char *path, lv_img_dsc_t *dsc) {
+    size_t png_size = 0;
+    uint8_t *png_data = read_file(path, &png_size);
+    if (!png_data) return 0;
+
+    unsigned char *img_data = NULL;
+    unsigned width = 0;
+    unsigned height = 0;
+
+    unsigned error = lodepng_decode32(&img_data, &width, &height, png_data, png_size);
+    free(png_data);
+
+    if (error || width > PREFETCH_MAX_DIMENSION || height > PREFETCH_MAX_DIMENSION) {
+        if (img_data) lv_mem_free(img_data);
+        return 0;
+    }
+
+    // lodepng gives RGBA, a 32 bit lv_color_t is BGRA in memory
+    size_t pixel_count = (size_t) width * height;
+    for (size_t i = 0; i < pixel_count; i++) {
+        uint8_t red = img_data[i * 4];
+        img_data[i * 4] = img_data[i * 4 + 2];
+        img_data[i * 4 + 2] = red;
+    }
+
+    memset(dsc, 0, sizeof(*dsc));
+    dsc->header.always_zero = 0;
+    dsc->header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+    dsc->header.w = width;
+    dsc->header.h = height;
+    dsc->data_size = (uint32_t) (pixel_count * LV_IMG_PX_SIZE_ALPHA_BYTE);
+    dsc->data = img_data;
+
+    return 1;
+}
+
+static prefetch_entry *decode_entry(const char *path) {
+    prefetch_entry *entry = calloc(1, sizeof(prefetch_entry));
+    if (!entry) return NULL;
+
+    snprintf(entry->path, sizeof(entry->path), "%s", path);
+    entry->hash = fnv1a_hash_str(path);
+
+    if (image_decode_png(path, &entry->dsc)) entry->bytes = entry->dsc.data_size;
+
+    return entry;
+}
+
+// Only ever called on the UI thread as LVGL may still hold the image in its cache
+static void entry_remove(int index) {
+    prefetch_entry *entry = entries[index];
+
+    entries[index] = entries[--entry_count];
+    entry_bytes -= entry->bytes;
+
+    lv_img_cache_invalidate_src(&entry->dsc);
+    entry_free(entry);
+}
+
+static void trim_entries(void) {
+    // Leave room for a full round of prefetching, the worker cannot evict
+    while (entry_bytes > IMAGE_PREFETCH_BUDGET ||
+           entry_count > IMAGE_PREFETCH_MAX_ENTRIES - PREFETCH_JOB_COUNT) {
+        int oldest = -1;
+
+        for (int i = 0; i < entry_count; i++) {
+            if (entries[i]->pins) continue;
+            if (oldest < 0 || entries[i]->last_used < entries[oldest]->last_used) oldest = i;
+        }
+
+        if (oldest < 0) break;
+        entry_remove(oldest);
+    }
+}
+
+static void *prefetch_worker(void *arg) {
+    (void) arg;
+
+    pthread_mutex_lock(&prefetch_lock);
+    while (prefetch_running) {
+        if (job_next >= job_count) {
+            pthread_cond_wait(&prefetch_cond, &prefetch_lock);
+            continue;
+        }
+
+        prefetch_job job = jobs[job_next++];
+        pthread_mutex_unlock(&prefetch_lock);
+
+        char image[PATH_MAX];
+        int has_image = prefetch_resolve(job.index, job.image_type, image, sizeof(image)) &&
+                        is_png(image) && file_exist(image);
+
+        pthread_mutex_lock(&prefetch_lock);
+        if (!has_image || entry_find(image)) continue;
+        pthread_mutex_unlock(&prefetch_lock);
+
+        prefetch_entry *entry = decode_entry(image);
+
+        pthread_mutex_lock(&prefetch_lock);
+        if (!entry) continue;
+
+        // Never displayed yet, so it can be dropped without telling LVGL
+        if (entry_count >= IMAGE_PREFETCH_MAX_ENTRIES || entry_find(image)) {
+            entry_free(entry);
+            continue;
+        }
+
+        entry->last_used = ++use_counter;
+        entries[entry_count++] = entry;
+        entry_bytes += entry->bytes;
+    }
+    pthread_mutex_unlock(&prefetch_lock);
+
+    return NULL;
+}
+
+void image_prefetch_start(image_prefetch_resolver resolver) {
+    if (prefetch_running || !resolver) return;
+
+    prefetch_resolve = resolver;
+    job_count = 0;
+    job_next = 0;
+    prefetch_running = 1;
+
+    if (pthread_create(&prefetch_thread, NULL, prefetch_worker, NULL) != 0) {
+        LOG_WARN(mux_module, "Artwork prefetch unavailable")
+        prefetch_running = 0;
+    }
+}
+
+void image_prefetch_stop(void) {
+    if (!prefetch_running) return;
+
+    pthread_mutex_lock(&prefetch_lock);
+    prefetch_running = 0;
+    job_count = 0;
+    job_next = 0;
+    pthread_cond_broadcast(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
+
+    pthread_join(prefetch_thread, NULL);
+
+    // The screen is still alive at this point so detach anything showing a decoded image
+    for (int i = 0; i < IMAGE_PREFETCH_MAX_PINS; i++) {
+        if (pins[i].img && lv_obj_is_valid(pins[i].img)) lv_img_set_src(pins[i].img, NULL);
+        pins[i].img = NULL;
+        pins[i].entry = NULL;
+    }
+
+    while (entry_count > 0) entry_remove(entry_count - 1);
+    prefetch_resolve = NULL;
+}
+
+static void queue_job(int index, const char *image_type) {
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].index == index) return;
+    }
+
+    jobs[job_count].index = index;
+    snprintf(jobs[job_count].image_type, sizeof(jobs[job_count].image_type), "%s", image_type);
+    job_count++;
+}
+
+void image_prefetch_around(int index, int item_count, const char *image_type) {
+    if (!prefetch_running || item_count < 2) return;
+
+    pthread_mutex_lock(&prefetch_lock);
+
+    // Anything still queued is for where the cursor used to be
+    job_count = 0;
+    job_next = 0;
+
+    for (int distance = 1; distance <= IMAGE_PREFETCH_DISTANCE; distance++) {
+        int next = (index + distance) % item_count;
+        int prev = ((index - distance) % item_count + item_count) % item_count;
+
+        if (next != index) queue_job(next, image_type);
+        if (prev != index) queue_job(prev, image_type);
+    }
+
+    trim_entries();
+
+    pthread_cond_signal(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_lock);
+}
+
+static prefetch_pin *find_pin(lv_obj_t *img, int create) {
+    prefetch_pin *free_pin = NULL;
+
+    for (int i = 0; i < IMAGE_PREFETCH_MAX_PINS; i++) {
+        if (pins[i].img == img) return &pins[i];
+        if (!pins[i].img && !free_pin) free_pin = &pins[i];
+    }
+
+    if (create && free_pin) free_pin->img = img;
+    return create ? free_pin : NULL;
+}
+
+static void unpin(prefetch_pin *pin) {
+    if (!pin) return;
+
+    if (pin->entry) pin->entry->pins--;
+    pin->img = NULL;
+    pin->entry = NULL;
+}
+
+int image_prefetch_set_src(lv_obj_t *img, const char *path) {
+    pthread_mutex_lock(&prefetch_lock);
+
+    prefetch_entry *entry = entry_find(path);
+    if (entry && !entry->dsc.data) entry = NULL;
+
+    unpin(find_pin(img, 0));
+
+    if (entry) {
+        prefetch_pin *pin = find_pin(img, 1);
+
+        // Without a free pin the image could be evicted while on screen
+        if (pin) {
+            pin->entry = entry;
+            entry->pins++;
+            entry->last_used = ++use_counter;
+        } else {
+            entry = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&prefetch_lock);
+
+    if (entry) {
+        lv_img_set_src(img, &entry->dsc);
+        return 1;
+    }
+
+    char image_embed[PATH_MAX + 2];
+    snprintf(image_embed, sizeof(image_embed), "M:%s", path);
+    lv_img_set_src(img, image_embed);
+
+    return 0;
+}
+
+void image_prefetch_release(lv_obj_t *img) {
+    pthread_mutex_lock(&prefetch_lock);
+    unpin(find_pin(img, 0));
+    pthread_mutex_unlock(&prefetch_lock);
+}
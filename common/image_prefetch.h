@@ -0,0 +1,42 @@
+#pragma once
+
+#ifndef IMAGE_PREFETCH_H
+#define IMAGE_PREFETCH_H
+
+#include <stddef.h>
+#include "../lvgl/lvgl.h"
+
+// Decoded images kept around for list and grid navigation
+#define IMAGE_PREFETCH_BUDGET (32 * 1024 * 1024)
+
+// Items either side of the cursor that are decoded ahead of time
+#define IMAGE_PREFETCH_DISTANCE 3
+
+#define IMAGE_PREFETCH_MAX_ENTRIES 128
+#define IMAGE_PREFETCH_MAX_PINS 8
+
+/*
+ * Resolves the artwork path of an item. It runs on the prefetch thread, so
+ * it must only read the item list and use thread safe helpers. Returns 0 if
+ * the item has no artwork of that type.
+ */
+typedef int (*image_prefetch_resolver)(int index, const char *image_type, char *image, size_t image_size);
+
+void image_prefetch_start(image_prefetch_resolver resolver);
+
+void image_prefetch_stop(void);
+
+void image_prefetch_around(int index, int item_count, const char *image_type);
+
+int image_prefetch_set_src(lv_obj_t *img, const char *path);
+
+void image_prefetch_release(lv_obj_t *img);
+
+/*
+ * Decodes a PNG into a descriptor lv_img_set_src takes as is. The pixels are
+ * allocated with lv_mem_alloc and belong to the caller. Returns 0 when the
+ * file cannot be read or decoded.
+ */
+int image_decode_png(const char *path, lv_img_dsc_t *dsc);
+
+#endif
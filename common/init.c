@@ -18,6 +18,7 @@
 #include "config.h"
 #include "device.h"
 #include "theme.h"
+#include "thumbnail.h"
 
 __thread uint64_t start_ms = 0;
 static struct dt_task_param dt_par;
@@ -86,6 +87,7 @@ void init_module(char *module) {
 
 void init_display(int full_refresh) {
     lv_init();
+    thumbnail_init();
     sdl_init();
 
     static lv_disp_drv_t disp_drv;
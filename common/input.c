@@ -19,7 +19,10 @@
 #include "config.h"
 #include "controller_profile.h"
 #include "device.h"
+#include "event_bus.h"
+#include "input_match.h"
 #include "log.h"
+#include "screen_preload.h"
 
 #define INPUT_PATH "/dev/input/by-id/"
 
@@ -509,6 +512,9 @@ static void process_usb_keyboard_arrow_keys(const mux_input_options *opts, struc
 static void dispatch_input(const mux_input_options *opts,
                            mux_input_type mux_type,
                            mux_input_action action) {
+    // Anything warming the next screen gives way while the user is busy with this one
+    screen_preload_cancel();
+
     // Remap input mux_types when using left stick as D-pad. (We still track pressed and held status for
     // the stick and D-pad inputs separately to avoid unintuitive hold behavior.)
     if (opts->stick_nav) {
@@ -602,6 +608,8 @@ static void handle_inputs(const mux_input_options *opts) {
     }
 }
 
+static input_combo_lookup combo_lookup;
+
 static void handle_combos(const mux_input_options *opts) {
     // Delay (millis) before invoking hold handler again.
     static uint32_t hold_delay = 0;
@@ -638,21 +646,17 @@ static void handle_combos(const mux_input_options *opts) {
         // Sometimes, a single evdev event can result in us registering both a release and a press
         // (e.g., when transitioning from POWER_SHORT to POWER_LONG), so we have to check this even
         // if a combo was previously active at the start of the function.
-        for (int i = 0; i < MUX_INPUT_COMBO_COUNT; ++i) {
-            uint64_t mask = opts->combo[i].type_mask;
+        int combo = input_combo_find(&combo_lookup, pressed);
 
-            if (mask && (pressed & mask) == mask) {
-                // Pressed & not held: Invoke "press" handler.
-                dispatch_combo(opts, i, MUX_INPUT_PRESS);
+        // Only one combo can be active at a time.
+        if (combo != MUX_INPUT_COMBO_COUNT) {
+            // Pressed & not held: Invoke "press" handler.
+            dispatch_combo(opts, combo, MUX_INPUT_PRESS);
 
-                // Initial repeat delay
-                hold_delay = config.SETTINGS.ADVANCED.REPEAT_DELAY;
-                hold_tick = tick;
-                active_combo = i;
-
-                // Only one combo can be active at a time.
-                break;
-            }
+            // Initial repeat delay
+            hold_delay = config.SETTINGS.ADVANCED.REPEAT_DELAY;
+            hold_tick = tick;
+            active_combo = combo;
         }
     }
 }
@@ -863,6 +867,7 @@ bool is_switch_held(int fd) {
 void mux_input_task(const mux_input_options *opts) {
     init_defaults();
     swap_axis = opts->swap_axis;
+    input_combo_init(&combo_lookup, opts->combo);
 
     int epoll_fd = epoll_create1(0);
     if (epoll_fd == -1) {
@@ -914,6 +919,15 @@ void mux_input_task(const mux_input_options *opts) {
         goto out_close_epoll;
     }
 
+    // Flag file changes and wake requests arrive as events so the idle handler can skip polling
+    int bus_fd = event_bus_fd();
+    if (bus_fd != -1) {
+        ev.data.fd = bus_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, bus_fd, &ev) == -1) {
+            LOG_WARN("input", "Failed to add event bus to epoll")
+        }
+    }
+
     // Launch USB joystick & keyboard threads
     mux_input_options joystick_opts = *opts;
     pthread_create(&joystick_thread, NULL, joystick_handler, &joystick_opts);
@@ -969,6 +983,11 @@ void mux_input_task(const mux_input_options *opts) {
                 break;
             }
 
+            if (fd == bus_fd) {
+                event_bus_dispatch();
+                continue;
+            }
+
             struct input_event event;
             ssize_t r = read(fd, &event, sizeof(event));
 
@@ -0,0 +1,119 @@
+#include <string.h>
+#include "input_match.h"
+
+static int new_sequence_node(input_sequence_trie *trie) {
+    input_sequence_node *node = &trie->nodes[trie->node_count];
+
+    memset(node->next, 0, sizeof(node->next));
+    node->terminal = -1;
+    node->window = 0;
+
+    return trie->node_count++;
+}
+
+void input_sequence_init(input_sequence_trie *trie) {
+    trie->node_count = 0;
+    new_sequence_node(trie);
+}
+
+void input_sequence_add(input_sequence_trie *trie, int combo, const int *inputs, int length, uint32_t max_interval) {
+    // No interval limit means the sequence matches however far apart the inputs are
+    uint32_t window = max_interval ? max_interval : UINT32_MAX;
+
+    int node = 0;
+    if (window > trie->nodes[node].window) trie->nodes[node].window = window;
+
+    for (int j = length - 1; j >= 0; --j) {
+        int type = inputs[j];
+        if (!trie->nodes[node].next[type]) trie->nodes[node].next[type] = (int16_t) new_sequence_node(trie);
+
+        node = trie->nodes[node].next[type];
+        if (window > trie->nodes[node].window) trie->nodes[node].window = window;
+    }
+
+    // Combos are added in order, so appending keeps each chain sorted by priority
+    trie->max_interval[combo] = max_interval;
+    trie->next_terminal[combo] = -1;
+
+    if (trie->nodes[node].terminal == -1) {
+        trie->nodes[node].terminal = (int16_t) combo;
+    } else {
+        int last = trie->nodes[node].terminal;
+        while (trie->next_terminal[last] != -1) last = trie->next_terminal[last];
+        trie->next_terminal[last] = (int16_t) combo;
+    }
+}
+
+static int sequence_terminal(const input_sequence_trie *trie, int node, uint32_t gap) {
+    for (int i = trie->nodes[node].terminal; i != -1; i = trie->next_terminal[i]) {
+        if (!trie->max_interval[i] || gap <= trie->max_interval[i]) return i;
+    }
+
+    return -1;
+}
+
+int input_sequence_match(const input_sequence_trie *trie, const int *inputs, const uint32_t *times, int count) {
+    int node = 0;
+    uint32_t gap = 0; // Largest time between consecutive inputs walked so far
+    int best = sequence_terminal(trie, node, gap);
+
+    for (int i = count - 1; i >= 0; --i) {
+        int next = trie->nodes[node].next[inputs[i]];
+        if (!next) break;
+
+        if (i < count - 1) {
+            uint32_t delta = times[i + 1] - times[i];
+            if (delta > gap) gap = delta;
+        }
+
+        // Nothing further down this branch allows inputs this far apart
+        if (gap > trie->nodes[next].window) break;
+
+        node = next;
+
+        int found = sequence_terminal(trie, node, gap);
+        if (found != -1 && (best == -1 || found < best)) best = found;
+    }
+
+    return best;
+}
+
+void input_combo_init(input_combo_lookup *lookup, const mux_input_combo *combo) {
+    lookup->list_count = 0;
+    lookup->inputs = 0;
+
+    for (int i = 0; i < MUX_INPUT_COMBO_COUNT; ++i) {
+        uint64_t mask = combo[i].type_mask;
+
+        lookup->mask[i] = mask;
+        if (!mask) continue;
+
+        lookup->list[lookup->list_count++] = i;
+        lookup->inputs |= mask;
+    }
+
+    for (int i = 0; i < INPUT_COMBO_CACHE_SIZE; ++i) lookup->cache[i].combo = -1;
+}
+
+int input_combo_find(input_combo_lookup *lookup, uint64_t pressed) {
+    uint64_t key = pressed & lookup->inputs;
+    if (!key) return MUX_INPUT_COMBO_COUNT;
+
+    int slot = (int) ((key * 0x9E3779B97F4A7C15ULL) >> 58);
+    if (lookup->cache[slot].combo != -1 && lookup->cache[slot].pressed == key) return lookup->cache[slot].combo;
+
+    int found = MUX_INPUT_COMBO_COUNT;
+    for (int i = 0; i < lookup->list_count; ++i) {
+        uint64_t mask = lookup->mask[lookup->list[i]];
+
+        if ((key & mask) == mask) {
+            found = lookup->list[i];
+            break;
+        }
+    }
+
+    lookup->cache[slot].pressed = key;
+    lookup->cache[slot].combo = found;
+
+    return found;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef INPUT_MATCH_H
+#define INPUT_MATCH_H
+
+#include <stdint.h>
+#include "input.h"
+
+// Longest input sequence a hotkey combo can be made of
+#define INPUT_SEQUENCE_MAX 12
+
+#define INPUT_SEQUENCE_NODES (MUX_INPUT_COMBO_COUNT * INPUT_SEQUENCE_MAX + 1)
+
+// Direct mapped cache of the first combo matching a set of pressed inputs
+#define INPUT_COMBO_CACHE_SIZE 64
+
+typedef struct {
+    int16_t next[MUX_INPUT_COUNT]; // Child node per input, 0 when there is none
+    int16_t terminal; // First combo (lowest index) whose sequence ends here, -1 when none
+    uint32_t window; // Largest max_interval of any combo at or below this node
+} input_sequence_node;
+
+// Sequence combos compiled into a trie of their inputs read newest first, so a single walk back
+// through the recent inputs finds every sequence ending on the latest press.
+typedef struct {
+    input_sequence_node nodes[INPUT_SEQUENCE_NODES];
+    int node_count;
+    int16_t next_terminal[MUX_INPUT_COMBO_COUNT];
+    uint32_t max_interval[MUX_INPUT_COMBO_COUNT];
+} input_sequence_trie;
+
+// Only inputs that appear in some combo are part of the cache key, so unrelated buttons share entries.
+typedef struct {
+    struct {
+        uint64_t pressed;
+        int combo; // -1 for an empty slot
+    } cache[INPUT_COMBO_CACHE_SIZE];
+
+    // Indexes of the combos in use, in priority order, and every input any of them involves
+    uint64_t mask[MUX_INPUT_COMBO_COUNT];
+    int list[MUX_INPUT_COMBO_COUNT];
+    int list_count;
+    uint64_t inputs;
+} input_combo_lookup;
+
+void input_sequence_init(input_sequence_trie *trie);
+
+// Sequences must be added in priority order, lowest combo index first
+void input_sequence_add(input_sequence_trie *trie, int combo, const int *inputs, int length, uint32_t max_interval);
+
+// Returns the highest priority sequence combo the given inputs end with, or -1
+int input_sequence_match(const input_sequence_trie *trie, const int *inputs, const uint32_t *times, int count);
+
+// Must be rerun whenever the combo masks change
+void input_combo_init(input_combo_lookup *lookup, const mux_input_combo *combo);
+
+// Returns the first combo whose inputs are all pressed, or MUX_INPUT_COMBO_COUNT if there is none
+int input_combo_find(input_combo_lookup *lookup, uint64_t pressed);
+
+#endif
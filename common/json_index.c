@@ -0,0 +1,119 @@
+#include "json_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct json json_array_first(struct json array) {
+    if (json_type(array) != JSON_ARRAY) return (struct json) {0};
+    return json_first(array);
+}
+
+bool json_pair_first(struct json object, json_pair *pair) {
+    if (json_type(object) != JSON_OBJECT) return false;
+
+    pair->key = json_first(object);
+    pair->value = json_next(pair->key);
+
+    return json_exists(pair->key) && json_exists(pair->value);
+}
+
+bool json_pair_next(json_pair *pair) {
+    pair->key = json_next(pair->value);
+    pair->value = json_next(pair->key);
+
+    return json_exists(pair->key) && json_exists(pair->value);
+}
+
+static uint32_t hash_bytes(const char *data, size_t length) {
+    uint32_t hash = 2166136261u;
+
+    if (length > JSON_INDEX_HASH_PREFIX) length = JSON_INDEX_HASH_PREFIX;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t) data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static uint32_t hash_key(struct json key) {
+    // Plain keys are hashed in place, only escaped ones need unescaping first
+    if (!json_string_is_escaped(key)) return hash_bytes(json_raw(key) + 1, json_raw_length(key) - 2);
+
+    char buffer[JSON_INDEX_HASH_PREFIX + 1];
+    size_t length = json_string_copy(key, buffer, sizeof(buffer));
+
+    return hash_bytes(buffer, length < sizeof(buffer) ? length : sizeof(buffer) - 1);
+}
+
+void json_object_pick(struct json object, const char *const keys[], struct json values[], size_t count) {
+    size_t remaining = count;
+    for (size_t i = 0; i < count; i++) values[i] = (struct json) {0};
+
+    json_pair pair;
+    for (bool more = json_pair_first(object, &pair); more && remaining; more = json_pair_next(&pair)) {
+        for (size_t i = 0; i < count; i++) {
+            if (!json_exists(values[i]) && json_string_compare(pair.key, keys[i]) == 0) {
+                values[i] = pair.value;
+                remaining--;
+                break;
+            }
+        }
+    }
+}
+
+bool json_index_build(json_index *index, struct json object) {
+    memset(index, 0, sizeof(*index));
+    if (json_type(object) != JSON_OBJECT) return false;
+
+    // Counting first keeps it to one allocation, json_ensure means the second walk is cheap
+    object = json_ensure(object);
+
+    size_t entry_count = 0;
+    json_pair pair;
+    for (bool more = json_pair_first(object, &pair); more; more = json_pair_next(&pair)) entry_count++;
+
+    uint32_t slot_count = 16;
+    while (slot_count < entry_count * 2) slot_count <<= 1;
+
+    index->slots = calloc(slot_count, sizeof(json_index_slot));
+    if (!index->slots) return false;
+
+    index->slot_count = slot_count;
+
+    uint32_t mask = slot_count - 1;
+    for (bool more = json_pair_first(object, &pair); more; more = json_pair_next(&pair)) {
+        uint32_t hash = hash_key(pair.key);
+        uint32_t pos = hash & mask;
+
+        // Duplicates are kept, the first sits earlier on the probe sequence so it is the one
+        // found, just as json_object_get would find it
+        while (json_exists(index->slots[pos].key)) pos = (pos + 1) & mask;
+
+        index->slots[pos].hash = hash;
+        index->slots[pos].key = pair.key;
+        index->slots[pos].value = pair.value;
+        index->entry_count++;
+    }
+
+    return true;
+}
+
+struct json json_index_get(const json_index *index, const char *key) {
+    if (!index->slots) return (struct json) {0};
+
+    uint32_t hash = hash_bytes(key, strlen(key));
+    uint32_t mask = index->slot_count - 1;
+
+    for (uint32_t pos = hash & mask; json_exists(index->slots[pos].key); pos = (pos + 1) & mask) {
+        if (index->slots[pos].hash == hash && json_string_compare(index->slots[pos].key, key) == 0) {
+            return index->slots[pos].value;
+        }
+    }
+
+    return (struct json) {0};
+}
+
+void json_index_free(json_index *index) {
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#ifndef JSON_INDEX_H
+#define JSON_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "json/json.h"
+
+// Only this much of a key is hashed, the rest is settled by comparing
+#define JSON_INDEX_HASH_PREFIX 64
+
+/*
+ * json_array_get and json_object_get both walk their parent from the start on
+ * every call, so a loop over json_array_count calling json_array_get is
+ * quadratic. These walk each array or object once.
+ *
+ *   json_array_each(item, array) {
+ *       ...
+ *   }
+ */
+#define json_array_each(item, array) \
+    for (struct json item = json_array_first(array); json_exists(item); item = json_next(item))
+
+typedef struct {
+    struct json key;
+    struct json value;
+} json_pair;
+
+// First element of an array, or a non-existent value for anything else
+struct json json_array_first(struct json array);
+
+// Iterates the key and value pairs of an object, returning false once there are none left
+bool json_pair_first(struct json object, json_pair *pair);
+
+bool json_pair_next(json_pair *pair);
+
+/*
+ * Looks up several keys in a single pass over an object, values[i] receiving
+ * the value for keys[i]. Keys that are missing come back as non-existent
+ * values, and as with json_object_get the first of any duplicates wins.
+ */
+void json_object_pick(struct json object, const char *const keys[], struct json values[], size_t count);
+
+typedef struct {
+    uint32_t hash;
+    struct json key;
+    struct json value;
+} json_index_slot;
+
+typedef struct {
+    json_index_slot *slots;
+    uint32_t slot_count;
+    uint32_t entry_count;
+} json_index;
+
+/*
+ * Builds a hash index over the keys of an object for when the same object is
+ * queried many times, the language strings for example. The index points into
+ * the json text so it must not outlive it.
+ */
+bool json_index_build(json_index *index, struct json object);
+
+struct json json_index_get(const json_index *index, const char *key);
+
+void json_index_free(json_index *index);
+
+#endif
@@ -0,0 +1,300 @@
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "log.h"
+
+// Records waiting to be written, must be a power of two
+#define LOG_RING_SIZE 256
+
+// Longer messages skip the ring and are written straight away
+#define LOG_MESSAGE_SIZE 256
+
+#define LOG_OUTPUT_SIZE 8192
+
+/*
+ * Each record is formatted into its slot by the thread that logs it. Stamping,
+ * prefixing and writing happen later on the drain thread, so a LOG call costs
+ * a level check, two vDSO clock reads and a vsnprintf.
+ *
+ * The ring is a bounded multi-producer queue. A producer claims a slot by
+ * advancing enqueue_pos and publishes it through the slot sequence. Only the
+ * drain side, serialised by drain_lock, ever consumes.
+ */
+typedef struct {
+    atomic_uint sequence;
+    uint32_t level;
+    const char *symbol;
+    struct timespec uptime;
+    time_t wall;
+    char module[20];
+    char message[LOG_MESSAGE_SIZE];
+} log_record;
+
+volatile uint32_t log_mask = LOG_COMPILE_MASK;
+
+static log_record ring[LOG_RING_SIZE];
+static atomic_uint enqueue_pos;
+static unsigned dequeue_pos = 0;
+
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static sem_t drain_sem;
+static atomic_int drain_waiting;
+static atomic_int drain_started;
+
+static time_t prefix_second = -1;
+static char prefix_time[20];
+
+static void log_child_reset(void) {
+    // Only the forking thread survives, so nothing can be holding the lock or waiting, and
+    // whatever was still queued belongs to the parent
+    for (unsigned i = 0; i < LOG_RING_SIZE; i++) atomic_init(&ring[i].sequence, i);
+    atomic_init(&enqueue_pos, 0);
+    dequeue_pos = 0;
+
+    pthread_mutex_init(&drain_lock, NULL);
+    sem_init(&drain_sem, 0, 0);
+    atomic_store(&drain_waiting, 0);
+    atomic_store(&drain_started, 0);
+}
+
+__attribute__((constructor))
+static void log_init(void) {
+    for (unsigned i = 0; i < LOG_RING_SIZE; i++) atomic_init(&ring[i].sequence, i);
+
+    sem_init(&drain_sem, 0, 0);
+    pthread_atfork(NULL, NULL, log_child_reset);
+    atexit(log_flush);
+
+    const char *level = getenv("MUX_LOG_LEVEL");
+    if (!level || !*level) return;
+
+    if (strcasecmp(level, "info") == 0) {
+        log_set_mask(LOG_BIT_ALL & ~LOG_BIT_DEBUG);
+    } else if (strcasecmp(level, "warn") == 0) {
+        log_set_mask(LOG_BIT_WARN | LOG_BIT_ERROR);
+    } else if (strcasecmp(level, "error") == 0) {
+        log_set_mask(LOG_BIT_ERROR);
+    } else if (strcasecmp(level, "none") == 0) {
+        log_set_mask(0);
+    }
+}
+
+void log_set_mask(uint32_t mask) {
+    log_mask = mask & LOG_COMPILE_MASK;
+}
+
+static void write_all(const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(STDERR_FILENO, data, length);
+        if (n <= 0) return;
+
+        data += n;
+        length -= (size_t) n;
+    }
+}
+
+static const char *wall_prefix(time_t wall) {
+    if (wall != prefix_second) {
+        struct tm timeinfo;
+        localtime_r(&wall, &timeinfo);
+        strftime(prefix_time, sizeof(prefix_time), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+        prefix_second = wall;
+    }
+
+    return prefix_time;
+}
+
+static size_t format_line(char *out, size_t size, const struct timespec *uptime, time_t wall,
+                          const char *symbol, const char *module, const char *message) {
+    int length = snprintf(out, size, "[%.2f]\t[%s] [%s] [%s]\t%s\n",
+                          uptime->tv_sec + uptime->tv_nsec / 1000000000.0,
+                          wall_prefix(wall), symbol, module, message);
+
+    if (length < 0) return 0;
+    return (size_t) length < size ? (size_t) length : size - 1;
+}
+
+// Caller holds drain_lock
+static void drain_ring(void) {
+    char output[LOG_OUTPUT_SIZE];
+    size_t used = 0;
+
+    while (1) {
+        log_record *record = &ring[dequeue_pos & (LOG_RING_SIZE - 1)];
+        if (atomic_load(&record->sequence) != dequeue_pos + 1) break;
+
+        // Records with no level stand in for messages that were written directly
+        char line[LOG_MESSAGE_SIZE + 96];
+        size_t length = record->level ? format_line(line, sizeof(line), &record->uptime, record->wall,
+                                                    record->symbol, record->module, record->message) : 0;
+
+        atomic_store_explicit(&record->sequence, dequeue_pos + LOG_RING_SIZE, memory_order_release);
+        dequeue_pos++;
+
+        if (used + length > sizeof(output)) {
+            write_all(output, used);
+            used = 0;
+        }
+
+        memcpy(output + used, line, length);
+        used += length;
+    }
+
+    if (used) write_all(output, used);
+}
+
+void log_flush(void) {
+    pthread_mutex_lock(&drain_lock);
+    drain_ring();
+    pthread_mutex_unlock(&drain_lock);
+}
+
+static int ring_empty(void) {
+    log_record *record = &ring[dequeue_pos & (LOG_RING_SIZE - 1)];
+    return atomic_load(&record->sequence) != dequeue_pos + 1;
+}
+
+static void *drain_thread(void *arg) {
+    (void) arg;
+
+    while (1) {
+        log_flush();
+
+        // Announce the wait before the final check so a producer publishing now sees it
+        atomic_store(&drain_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        pthread_mutex_lock(&drain_lock);
+        int empty = ring_empty();
+        pthread_mutex_unlock(&drain_lock);
+
+        if (!empty) {
+            atomic_store(&drain_waiting, 0);
+            continue;
+        }
+
+        while (sem_wait(&drain_sem) != 0) {}
+    }
+
+    return NULL;
+}
+
+static void start_drain(void) {
+    if (atomic_exchange(&drain_started, 1)) return;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, 64 * 1024);
+
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, drain_thread, NULL) != 0) atomic_store(&drain_started, 0);
+
+    pthread_attr_destroy(&attr);
+}
+
+static void wake_drain(void) {
+    // Pairs with the fence in drain_thread, either it sees the new record or we see it waiting
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange(&drain_waiting, 0)) sem_post(&drain_sem);
+}
+
+static log_record *claim_record(void) {
+    unsigned pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+
+    while (1) {
+        log_record *record = &ring[pos & (LOG_RING_SIZE - 1)];
+        int diff = (int) (atomic_load_explicit(&record->sequence, memory_order_acquire) - pos);
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                return record;
+            }
+        } else if (diff < 0) {
+            return NULL; // Full
+        } else {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+static void write_direct(const char *symbol, const char *mux_module, const char *msg, va_list args) {
+    struct timespec uptime;
+    clock_gettime(CLOCK_MONOTONIC, &uptime);
+    time_t wall = time(NULL);
+
+    char module[20];
+    snprintf(module, sizeof(module), "%.19s", mux_module);
+
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, msg, copy);
+    va_end(copy);
+
+    char *message = length >= 0 ? malloc((size_t) length + 1) : NULL;
+    if (!message) return;
+    vsnprintf(message, (size_t) length + 1, msg, args);
+
+    // Keep ordering with anything already queued
+    pthread_mutex_lock(&drain_lock);
+    drain_ring();
+
+    size_t size = (size_t) length + 128;
+    char *line = malloc(size);
+    if (line) {
+        write_all(line, format_line(line, size, &uptime, wall, symbol, module, message));
+        free(line);
+    }
+
+    pthread_mutex_unlock(&drain_lock);
+    free(message);
+}
+
+void log_write(uint32_t level, const char *symbol, const char *mux_module, const char *msg, ...) {
+    va_list args;
+    va_start(args, msg);
+
+    // Rather than lose messages in a burst, a producer that finds the ring full empties it itself.
+    // A slot can only stay unpublished for the length of a vsnprintf, so this always gets through.
+    log_record *record;
+    while (!(record = claim_record())) {
+        log_flush();
+        sched_yield();
+    }
+
+    unsigned pos = atomic_load_explicit(&record->sequence, memory_order_relaxed);
+
+    clock_gettime(CLOCK_MONOTONIC, &record->uptime);
+    record->wall = time(NULL);
+    record->level = level;
+    record->symbol = symbol;
+    snprintf(record->module, sizeof(record->module), "%.19s", mux_module);
+
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(record->message, sizeof(record->message), msg, copy);
+    va_end(copy);
+
+    // Too long for a slot, the record is released empty and the full message written directly
+    if (length >= (int) sizeof(record->message)) record->level = 0;
+
+    atomic_store_explicit(&record->sequence, pos + 1, memory_order_release);
+
+    if (length >= (int) sizeof(record->message)) {
+        write_direct(symbol, mux_module, msg, args);
+    } else if (level & LOG_BIT_ERROR) {
+        // Errors are often the last thing before a crash, do not leave them sitting in the ring
+        log_flush();
+    } else {
+        start_drain();
+        wake_drain();
+    }
+
+    va_end(args);
+}
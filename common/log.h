@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <time.h>
@@ -18,24 +19,32 @@
 #define SUCCESS_SYMBOL GREEN  "+" RESET
 #define DEBUG_SYMBOL   ORANGE "?" RESET
 
-#define LOG(level, symbol, mux_module, msg, ...) {         \
-    struct timespec ts;                                    \
-    clock_gettime(CLOCK_MONOTONIC, &ts);                   \
-    double uptime = ts.tv_sec + ts.tv_nsec / 1000000000.0; \
-                                                           \
-    time_t now = time(NULL);                               \
-    struct tm *timeinfo = localtime(&now);                 \
-    char time_buffer[20];                                  \
-    strftime(time_buffer, sizeof(time_buffer),             \
-             "%Y-%m-%d %H:%M:%S", timeinfo);               \
-                                                           \
-    char truncated_module[20];                             \
-    snprintf(truncated_module, sizeof(truncated_module),   \
-             "%.19s", mux_module);                         \
-                                                           \
-    fprintf(stderr, "[%.2f]\t[%s] [%s] [%s]\t" msg "\n",   \
-        uptime, time_buffer, symbol, truncated_module,     \
-        ##__VA_ARGS__);                                    \
+#define LOG_BIT_DEBUG   (1u << 0)
+#define LOG_BIT_INFO    (1u << 1)
+#define LOG_BIT_SUCCESS (1u << 2)
+#define LOG_BIT_WARN    (1u << 3)
+#define LOG_BIT_ERROR   (1u << 4)
+#define LOG_BIT_ALL     0x1Fu
+
+// Levels left out of this mask at build time are compiled out entirely (-DLOG_COMPILE_MASK=...)
+#ifndef LOG_COMPILE_MASK
+#define LOG_COMPILE_MASK LOG_BIT_ALL
+#endif
+
+// Levels currently written, taken from MUX_LOG_LEVEL (debug, info, warn, error or none) at startup
+extern volatile uint32_t log_mask;
+
+void log_set_mask(uint32_t mask);
+
+void log_write(uint32_t level, const char *symbol, const char *mux_module, const char *msg, ...)
+        __attribute__((format(printf, 4, 5)));
+
+// Writes out everything logged so far, called automatically at exit and after every error
+void log_flush(void);
+
+#define LOG(level, symbol, mux_module, msg, ...) {                                      \
+    if ((LOG_COMPILE_MASK & LOG_BIT_##level) && (log_mask & LOG_BIT_##level))           \
+        log_write(LOG_BIT_##level, symbol, mux_module, msg, ##__VA_ARGS__);             \
 }
 
 #define LOG_INFO(mux_module, msg, ...)    LOG(INFO,    INFO_SYMBOL,    mux_module, msg, ##__VA_ARGS__)
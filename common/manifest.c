@@ -0,0 +1,614 @@
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common.h"
+#include "language.h"
+#include "log.h"
+#include "options.h"
+#include "mini/mini.h"
+#include "manifest.h"
+
+#define SCRIPT_EXTENSION ".sh"
+
+struct manifest {
+    uint8_t *base;
+    size_t length;
+
+    const ManifestHeader *header;
+    const ManifestEntry *entries;
+    const ManifestText *texts;
+    const char *strings;
+};
+
+// Something in the folder as it is right now, file being the script relative to the folder
+typedef struct {
+    char *name;
+    char *file;
+    int64_t script_mtime;
+    int64_t lang_mtime;
+} manifest_source;
+
+typedef struct {
+    ManifestEntry *entries;
+    size_t entry_count;
+    size_t entry_capacity;
+
+    ManifestText *texts;
+    size_t text_count;
+    size_t text_capacity;
+
+    char *strings;
+    size_t strings_size;
+    size_t strings_capacity;
+
+    size_t read;
+    bool failed;
+} manifest_builder;
+
+// Translation file sections, in manifest_text order
+static const char *const lang_sections[MANIFEST_TEXT_COUNT] = {
+        [MANIFEST_FULL] = "full",
+        [MANIFEST_GRID] = "grid",
+        [MANIFEST_HELP] = "help",
+};
+
+static const char *string_at(const manifest *manifest, uint32_t offset) {
+    return offset < manifest->header->strings_size ? manifest->strings + offset : "";
+}
+
+static bool manifest_valid(const uint8_t *base, size_t length, const char *dir, manifest_kind kind) {
+    if (length < sizeof(ManifestHeader)) return false;
+
+    const ManifestHeader *header = (const ManifestHeader *) base;
+    if (memcmp(header->magic, MANIFEST_MAGIC, sizeof(header->magic)) != 0) return false;
+    if (header->kind != (uint32_t) kind || header->strings_size == 0) return false;
+
+    if (sizeof(ManifestHeader) + (uint64_t) header->entry_count * sizeof(ManifestEntry) +
+        (uint64_t) header->text_count * sizeof(ManifestText) + header->strings_size != length) {
+        return false;
+    }
+
+    const char *strings = (const char *) base + length - header->strings_size;
+    if (strings[0] != '\0' || strings[header->strings_size - 1] != '\0') return false;
+
+    // Cache files are named by a hash of the folder, so make sure it is the right one
+    if (header->dir >= header->strings_size || strcmp(strings + header->dir, dir) != 0) return false;
+
+    const ManifestEntry *entries = (const ManifestEntry *) (base + sizeof(ManifestHeader));
+    for (uint32_t i = 0; i < header->entry_count; i++) {
+        if ((uint64_t) entries[i].first_text + entries[i].text_count > header->text_count) return false;
+    }
+
+    return true;
+}
+
+static manifest *manifest_wrap(uint8_t *base, size_t length) {
+    manifest *result = calloc(1, sizeof(manifest));
+    if (!result) {
+        free(base);
+        return NULL;
+    }
+
+    result->base = base;
+    result->length = length;
+    result->header = (const ManifestHeader *) base;
+    result->entries = (const ManifestEntry *) (base + sizeof(ManifestHeader));
+    result->texts = (const ManifestText *) (result->entries + result->header->entry_count);
+    result->strings = (const char *) (base + length - result->header->strings_size);
+
+    return result;
+}
+
+static manifest *manifest_read(const char *path, const char *dir, manifest_kind kind) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(ManifestHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t) st.st_size;
+    uint8_t *base = malloc(length);
+
+    bool complete = base && read(fd, base, length) == (ssize_t) length;
+    close(fd);
+
+    if (!complete || !manifest_valid(base, length, dir, kind)) {
+        if (base) LOG_WARN(mux_module, "Ignoring invalid manifest: %s", path)
+        free(base);
+        return NULL;
+    }
+
+    return manifest_wrap(base, length);
+}
+
+void manifest_free(manifest *manifest) {
+    if (!manifest) return;
+
+    free(manifest->base);
+    free(manifest);
+}
+
+size_t manifest_count(const manifest *manifest) {
+    return manifest ? manifest->header->entry_count : 0;
+}
+
+bool manifest_item_at(const manifest *manifest, size_t index, manifest_item *item) {
+    if (index >= manifest_count(manifest)) return false;
+
+    const ManifestEntry *entry = &manifest->entries[index];
+    *item = (manifest_item) {
+            .index = index,
+            .name = string_at(manifest, entry->name),
+            .icon = string_at(manifest, entry->icon),
+            .grid = string_at(manifest, entry->grid),
+            .help = string_at(manifest, entry->help),
+            .translated = entry->lang_mtime != MANIFEST_NO_LANGUAGE,
+    };
+
+    return true;
+}
+
+bool manifest_find(const manifest *manifest, const char *name, manifest_item *item) {
+    size_t low = 0;
+    size_t high = manifest_count(manifest);
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int order = strcmp(string_at(manifest, manifest->entries[mid].name), name);
+
+        if (order == 0) return manifest_item_at(manifest, mid, item);
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return false;
+}
+
+const char *manifest_translation(const manifest *manifest, const manifest_item *item, manifest_text text,
+                                 const char *language) {
+    if (!item || item->index >= manifest_count(manifest)) return NULL;
+
+    const ManifestEntry *entry = &manifest->entries[item->index];
+
+    for (uint32_t i = entry->first_text; i < entry->first_text + entry->text_count; i++) {
+        if (manifest->texts[i].text == (uint32_t) text &&
+            strcmp(string_at(manifest, manifest->texts[i].language), language) == 0) {
+            return string_at(manifest, manifest->texts[i].value);
+        }
+    }
+
+    return NULL;
+}
+
+static int64_t stat_mtime(const struct stat *st) {
+    return (int64_t) st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+}
+
+static void cache_path(const char *dir, manifest_kind kind, char *path, size_t path_size) {
+    snprintf(path, path_size, "%s/%s-%08x.db", MANIFEST_CACHE_PATH,
+             kind == MANIFEST_APPS ? "app" : "script", fnv1a_hash_str(dir));
+}
+
+static void *reserve(void *items, size_t *capacity, size_t needed, size_t item_size) {
+    if (needed <= *capacity) return items;
+
+    size_t grown = *capacity ? *capacity : 16;
+    while (grown < needed) grown *= 2;
+
+    void *resized = realloc(items, grown * item_size);
+    if (resized) *capacity = grown;
+
+    return resized;
+}
+
+static int source_compare(const void *a, const void *b) {
+    return strcmp(((const manifest_source *) a)->name, ((const manifest_source *) b)->name);
+}
+
+static void free_sources(manifest_source *sources, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(sources[i].name);
+        free(sources[i].file);
+    }
+
+    free(sources);
+}
+
+// Lists what the folder holds right now, the same checks the modules made on every visit
+static bool list_sources(const char *dir, manifest_kind kind, manifest_source **sources, size_t *count) {
+    DIR *folder = opendir(dir);
+    if (!folder) return false;
+
+    size_t capacity = 0;
+    size_t extension_length = strlen(SCRIPT_EXTENSION);
+
+    *sources = NULL;
+    *count = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(folder))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        manifest_source source = {.lang_mtime = MANIFEST_NO_LANGUAGE};
+        struct stat st;
+
+        if (kind == MANIFEST_APPS) {
+            if (entry->d_type != DT_DIR) continue;
+
+            char file[PATH_MAX];
+            snprintf(file, sizeof(file), "%s/" APP_LAUNCHER, entry->d_name);
+            if (fstatat(dirfd(folder), file, &st, 0) != 0) continue;
+
+            source.script_mtime = stat_mtime(&st);
+            source.name = strdup(entry->d_name);
+            source.file = strdup(file);
+
+            snprintf(file, sizeof(file), "%s/" APP_LANGUAGE, entry->d_name);
+            if (fstatat(dirfd(folder), file, &st, 0) == 0) source.lang_mtime = stat_mtime(&st);
+        } else {
+            if (entry->d_type != DT_REG) continue;
+
+            size_t length = strlen(entry->d_name);
+            if (length <= extension_length ||
+                strcasecmp(entry->d_name + length - extension_length, SCRIPT_EXTENSION) != 0) {
+                continue;
+            }
+
+            if (fstatat(dirfd(folder), entry->d_name, &st, 0) != 0) continue;
+
+            source.script_mtime = stat_mtime(&st);
+            source.name = strndup(entry->d_name, length - extension_length);
+            source.file = strdup(entry->d_name);
+        }
+
+        manifest_source *resized = reserve(*sources, &capacity, *count + 1, sizeof(manifest_source));
+        if (!resized || !source.name || !source.file) {
+            free(source.name);
+            free(source.file);
+            if (resized) *sources = resized;
+
+            LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
+            closedir(folder);
+            free_sources(*sources, *count);
+
+            *sources = NULL;
+            *count = 0;
+            return false;
+        }
+
+        *sources = resized;
+        (*sources)[(*count)++] = source;
+    }
+
+    closedir(folder);
+
+    if (*count) qsort(*sources, *count, sizeof(manifest_source), source_compare);
+    return true;
+}
+
+static bool manifest_matches(const manifest *existing, const manifest_source *sources, size_t count) {
+    if (manifest_count(existing) != count) return false;
+
+    for (size_t i = 0; i < count; i++) {
+        const ManifestEntry *entry = &existing->entries[i];
+
+        if (entry->script_mtime != sources[i].script_mtime || entry->lang_mtime != sources[i].lang_mtime ||
+            strcmp(string_at(existing, entry->name), sources[i].name) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static uint32_t add_string(manifest_builder *builder, const char *str) {
+    if (!str || !str[0]) return 0;
+
+    size_t length = strlen(str) + 1;
+
+    if (builder->strings_size + length > UINT32_MAX) {
+        builder->failed = true;
+        return 0;
+    }
+
+    char *strings = reserve(builder->strings, &builder->strings_capacity, builder->strings_size + length, 1);
+    if (!strings) {
+        builder->failed = true;
+        return 0;
+    }
+
+    builder->strings = strings;
+
+    uint32_t offset = (uint32_t) builder->strings_size;
+    memcpy(builder->strings + offset, str, length);
+    builder->strings_size += length;
+
+    return offset;
+}
+
+static void add_text(manifest_builder *builder, manifest_text text, const char *language, const char *value) {
+    ManifestText *texts = reserve(builder->texts, &builder->text_capacity, builder->text_count + 1,
+                                  sizeof(ManifestText));
+    if (!texts) {
+        builder->failed = true;
+        return;
+    }
+
+    builder->texts = texts;
+    builder->texts[builder->text_count++] = (ManifestText) {
+            .text = text,
+            .language = add_string(builder, language),
+            .value = add_string(builder, value),
+    };
+}
+
+static ManifestEntry *add_entry(manifest_builder *builder, const manifest_source *source) {
+    ManifestEntry *entries = reserve(builder->entries, &builder->entry_capacity, builder->entry_count + 1,
+                                     sizeof(ManifestEntry));
+    if (!entries) {
+        builder->failed = true;
+        return NULL;
+    }
+
+    builder->entries = entries;
+
+    ManifestEntry *entry = &builder->entries[builder->entry_count++];
+    *entry = (ManifestEntry) {
+            .name = add_string(builder, source->name),
+            .first_text = (uint32_t) builder->text_count,
+            .script_mtime = source->script_mtime,
+            .lang_mtime = source->lang_mtime,
+    };
+
+    return entry;
+}
+
+static void copy_entry(manifest_builder *builder, const manifest *existing, const manifest_source *source,
+                       const manifest_item *item) {
+    const ManifestEntry *cached = &existing->entries[item->index];
+
+    // Every string goes in before the entry pointer is taken, the entry array can still move
+    uint32_t icon = add_string(builder, item->icon);
+    uint32_t grid = add_string(builder, item->grid);
+    uint32_t help = add_string(builder, item->help);
+
+    ManifestEntry *entry = add_entry(builder, source);
+    if (!entry) return;
+
+    entry->icon = icon;
+    entry->grid = grid;
+    entry->help = help;
+
+    size_t entry_index = builder->entry_count - 1;
+
+    for (uint32_t i = cached->first_text; i < cached->first_text + cached->text_count && !builder->failed; i++) {
+        add_text(builder, existing->texts[i].text, string_at(existing, existing->texts[i].language),
+                 string_at(existing, existing->texts[i].value));
+    }
+
+    builder->entries[entry_index].text_count = (uint32_t) (builder->text_count - builder->entries[entry_index].first_text);
+}
+
+// One pass over the script for every header, the way get_script_value finds a single one
+static void read_script_headers(const char *path, char values[][MAX_BUFFER_SIZE], const char *const keys[],
+                                size_t key_count) {
+    for (size_t i = 0; i < key_count; i++) values[i][0] = '\0';
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        LOG_WARN(mux_module, "%s: %s", lang.SYSTEM.FAIL_FILE_OPEN, path)
+        return;
+    }
+
+    char line[MAX_BUFFER_SIZE];
+    uint32_t found = 0;
+    uint32_t all = (1u << key_count) - 1;
+
+    while (found != all && fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "# ", 2) != 0) continue;
+
+        for (size_t i = 0; i < key_count; i++) {
+            size_t key_length = strlen(keys[i]);
+            if (found & (1u << i) || strncmp(line + 2, keys[i], key_length) != 0 ||
+                strncmp(line + 2 + key_length, ": ", 2) != 0) {
+                continue;
+            }
+
+            // Only the first line of a key counts, even when it is empty
+            snprintf(values[i], MAX_BUFFER_SIZE, "%s", line + 4 + key_length);
+            values[i][strcspn(values[i], "\n")] = '\0';
+
+            found |= 1u << i;
+            break;
+        }
+    }
+
+    fclose(file);
+}
+
+static void read_entry(manifest_builder *builder, const char *dir, manifest_kind kind,
+                       const manifest_source *source) {
+    enum {
+        HEADER_ICON, HEADER_GRID, HEADER_HELP, HEADER_COUNT
+    };
+
+    static const char *const header_keys[HEADER_COUNT] = {
+            [HEADER_ICON] = "ICON",
+            [HEADER_GRID] = "GRID",
+            [HEADER_HELP] = "HELP",
+    };
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, source->file);
+
+    char values[HEADER_COUNT][MAX_BUFFER_SIZE];
+    read_script_headers(path, values, header_keys, HEADER_COUNT);
+
+    uint32_t icon = add_string(builder, values[HEADER_ICON]);
+    uint32_t grid = add_string(builder, values[HEADER_GRID]);
+    uint32_t help = add_string(builder, values[HEADER_HELP]);
+
+    ManifestEntry *entry = add_entry(builder, source);
+    if (!entry) return;
+
+    entry->icon = icon;
+    entry->grid = grid;
+    entry->help = help;
+
+    size_t entry_index = builder->entry_count - 1;
+    builder->read++;
+
+    if (kind != MANIFEST_APPS || source->lang_mtime == MANIFEST_NO_LANGUAGE) return;
+
+    snprintf(path, sizeof(path), "%s/%s/" APP_LANGUAGE, dir, source->name);
+
+    mini_t *app_lang = mini_load(path);
+    if (!app_lang) return;
+
+    // Only the first section of a name counts, same as a lookup through mini
+    bool seen[MANIFEST_TEXT_COUNT] = {false};
+
+    for (mini_group_t *group = app_lang->head ? app_lang->head->next : NULL; group; group = group->next) {
+        for (size_t text = 0; text < MANIFEST_TEXT_COUNT; text++) {
+            if (seen[text] || strcmp(group->id, lang_sections[text]) != 0) continue;
+            seen[text] = true;
+
+            for (mini_value_t *value = group->head; value && !builder->failed; value = value->next) {
+                add_text(builder, (manifest_text) text, value->id, value->val);
+            }
+        }
+    }
+
+    mini_free(app_lang);
+
+    builder->entries[entry_index].text_count = (uint32_t) (builder->text_count - builder->entries[entry_index].first_text);
+}
+
+static manifest *manifest_build(const manifest_builder *builder, uint32_t dir, manifest_kind kind) {
+    size_t entries_size = builder->entry_count * sizeof(ManifestEntry);
+    size_t texts_size = builder->text_count * sizeof(ManifestText);
+    size_t length = sizeof(ManifestHeader) + entries_size + texts_size + builder->strings_size;
+
+    uint8_t *base = malloc(length);
+    if (!base) return NULL;
+
+    ManifestHeader header = {
+            .kind = kind,
+            .dir = dir,
+            .entry_count = (uint32_t) builder->entry_count,
+            .text_count = (uint32_t) builder->text_count,
+            .strings_size = (uint32_t) builder->strings_size,
+    };
+    memcpy(header.magic, MANIFEST_MAGIC, sizeof(header.magic));
+
+    uint8_t *at = base;
+    memcpy(at, &header, sizeof(header));
+    at += sizeof(header);
+
+    if (entries_size) memcpy(at, builder->entries, entries_size);
+    at += entries_size;
+
+    if (texts_size) memcpy(at, builder->texts, texts_size);
+    at += texts_size;
+
+    memcpy(at, builder->strings, builder->strings_size);
+
+    return manifest_wrap(base, length);
+}
+
+static void write_manifest(const char *path, const manifest *manifest) {
+    char temp_path[PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d", path, (int) getpid());
+
+    create_directories(MANIFEST_CACHE_PATH);
+
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        LOG_ERROR(mux_module, "%s: %s", lang.SYSTEM.FAIL_FILE_OPEN, temp_path)
+        return;
+    }
+
+    bool written = fwrite(manifest->base, 1, manifest->length, file) == manifest->length;
+
+    if (fclose(file) != 0 || !written || rename(temp_path, path) != 0) {
+        LOG_ERROR(mux_module, "Unable to write manifest: %s", path)
+        remove(temp_path);
+    }
+}
+
+manifest *manifest_load(const char *dir, manifest_kind kind) {
+    manifest_source *sources;
+    size_t source_count;
+
+    if (!list_sources(dir, kind, &sources, &source_count)) return NULL;
+
+    char path[PATH_MAX];
+    cache_path(dir, kind, path, sizeof(path));
+
+    manifest *existing = manifest_read(path, dir, kind);
+
+    if (existing && manifest_matches(existing, sources, source_count)) {
+        free_sources(sources, source_count);
+        return existing;
+    }
+
+    manifest_builder builder = {0};
+
+    // Offset 0 is the empty string every missing header points at
+    builder.strings = malloc(1);
+    if (builder.strings) {
+        builder.strings[0] = '\0';
+        builder.strings_size = builder.strings_capacity = 1;
+    } else {
+        builder.failed = true;
+    }
+
+    uint32_t dir_string = add_string(&builder, dir);
+
+    for (size_t i = 0; i < source_count && !builder.failed; i++) {
+        manifest_item cached;
+
+        if (existing && manifest_find(existing, sources[i].name, &cached) &&
+            existing->entries[cached.index].script_mtime == sources[i].script_mtime &&
+            existing->entries[cached.index].lang_mtime == sources[i].lang_mtime) {
+            copy_entry(&builder, existing, &sources[i], &cached);
+        } else {
+            read_entry(&builder, dir, kind, &sources[i]);
+        }
+    }
+
+    manifest *result = NULL;
+
+    if (builder.failed) {
+        LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
+    } else {
+        result = manifest_build(&builder, dir_string, kind);
+        if (result) {
+            write_manifest(path, result);
+            LOG_INFO(mux_module, "Manifest: %s (%zu of %zu read)", dir, builder.read, builder.entry_count)
+        }
+    }
+
+    manifest_free(existing);
+    free_sources(sources, source_count);
+
+    free(builder.entries);
+    free(builder.texts);
+    free(builder.strings);
+
+    return result;
+}
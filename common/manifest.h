@@ -0,0 +1,96 @@
+#pragma once
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MANIFEST_MAGIC "MUXMAN01"
+
+// Modification time of a translation file that is not there
+#define MANIFEST_NO_LANGUAGE (-1)
+
+typedef enum {
+    MANIFEST_APPS,    // One folder per application holding APP_LAUNCHER and optionally APP_LANGUAGE
+    MANIFEST_SCRIPTS, // Shell scripts directly inside the folder, as used by tasks
+} manifest_kind;
+
+typedef enum {
+    MANIFEST_FULL,
+    MANIFEST_GRID,
+    MANIFEST_HELP,
+    MANIFEST_TEXT_COUNT
+} manifest_text;
+
+/*
+ * Manifest layout as stored in MANIFEST_CACHE_PATH, one file per folder:
+ *   ManifestHeader
+ *   ManifestEntry[entry_count]  (sorted by name)
+ *   ManifestText[text_count]    (grouped by entry)
+ *   char strings[strings_size]  (nul terminated, offset 0 is "")
+ *
+ * Icon, grid and help are the "# KEY: value" headers of the script, empty
+ * when it has none. Texts are every language of the full, grid and help
+ * sections of an application's translation file.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t kind;
+    uint32_t dir;        // Folder the manifest was built from
+    uint32_t entry_count;
+    uint32_t text_count;
+    uint32_t strings_size;
+    uint32_t reserved;
+} ManifestHeader;
+
+typedef struct {
+    uint32_t name;
+    uint32_t icon;
+    uint32_t grid;
+    uint32_t help;
+    uint32_t first_text;
+    uint32_t text_count;
+    int64_t script_mtime;
+    int64_t lang_mtime;  // MANIFEST_NO_LANGUAGE without a translation file
+} ManifestEntry;
+
+typedef struct {
+    uint32_t text;
+    uint32_t language;
+    uint32_t value;
+} ManifestText;
+
+typedef struct manifest manifest;
+
+typedef struct {
+    size_t index;
+    const char *name;    // Application folder, or script name without its extension
+    const char *icon;
+    const char *grid;
+    const char *help;
+    bool translated;     // Has a translation file, even if it holds nothing for the current language
+} manifest_item;
+
+/*
+ * Lists dir and returns what its applications or scripts declare about
+ * themselves. Only the listing and a stat per script and translation file
+ * are needed when nothing changed, anything that did is read again and the
+ * cached manifest replaced. Returns NULL when dir cannot be read.
+ */
+manifest *manifest_load(const char *dir, manifest_kind kind);
+
+void manifest_free(manifest *manifest);
+
+size_t manifest_count(const manifest *manifest);
+
+bool manifest_item_at(const manifest *manifest, size_t index, manifest_item *item);
+
+bool manifest_find(const manifest *manifest, const char *name, manifest_item *item);
+
+// Text of a translation file section in language, NULL when the file has no such value
+const char *manifest_translation(const manifest *manifest, const manifest_item *item, manifest_text text,
+                                 const char *language);
+
+#endif
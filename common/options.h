@@ -53,6 +53,21 @@
 #define STORAGE_PATH "/mnt/union/ROMS"
 #define OPTION_SKIP  "/tmp/skip_opt"
 
+// Extracted content is kept on the SD card, tmpfs would hold it all in memory
+#define ARCHIVE_CACHE_PATH   RUN_STORAGE_PATH "cache/archive"
+#define ARCHIVE_CACHE_BUDGET (2ULL * 1024 * 1024 * 1024)
+#define ARCHIVE_LIST_PATH    RUN_STORAGE_PATH "cache/archive_list"
+#define ARCHIVE_PAGE_SIZE    256
+
+#define FRIENDLY_CACHE_PATH "/tmp/friendly_name"
+
+#define THUMBNAIL_CACHE_PATH   OPT_PATH "cache/thumbnail"
+#define THUMBNAIL_CACHE_BUDGET (256ULL * 1024 * 1024)
+
+#define MANIFEST_CACHE_PATH OPT_PATH "cache/manifest"
+
+#define GRADIENT_CACHE_PATH "/tmp/gradient"
+
 #define INTERNAL_THEME   OPT_PATH "share/theme/active"
 #define INTERNAL_OVERLAY OPT_PATH "share/overlay"
 
@@ -149,6 +164,7 @@
 #define VOLUME_PERC "/tmp/current_volume_percent"
 
 #define MUX_BLANK       "/tmp/mux_blank"
+#define HDMI_REFRESH    "/tmp/hdmi_do_refresh"
 #define PLAYTIME_DATA   "playtime_data.json"
 #define FRIENDLY_RESULT "/tmp/f_result.json"
 #define MANUAL_RA_LOAD  "/tmp/ra_no_load"
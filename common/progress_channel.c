@@ -0,0 +1,108 @@
+#include "progress_channel.h"
+#include "common.h"
+#include "log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static void channel_address(struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", PROGRESS_SOCKET);
+}
+
+int progress_channel_open(void) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_WARN(mux_module, "Progress channel unavailable, only legacy files will be watched")
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    channel_address(&addr);
+
+    // Left behind by a previous run that did not exit cleanly
+    unlink(PROGRESS_SOCKET);
+
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        LOG_WARN(mux_module, "Unable to bind '%s', only legacy files will be watched", PROGRESS_SOCKET)
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void progress_channel_close(int fd) {
+    if (fd < 0) return;
+
+    close(fd);
+    unlink(PROGRESS_SOCKET);
+}
+
+static int parse_record(char *data, progress_record *record) {
+    size_t length = strcspn(data, "\n");
+    data[length] = '\0';
+
+    char *arg = strchr(data, ' ');
+    if (arg) *arg++ = '\0';
+
+    if (strcasecmp(data, "progress") == 0 && arg) {
+        int value = safe_atoi(arg);
+
+        record->type = PROGRESS_VALUE;
+        record->value = value < 0 ? 0 : (value > 100 ? 100 : value);
+    } else if (strcasecmp(data, "message") == 0) {
+        record->type = PROGRESS_MESSAGE;
+        snprintf(record->message, sizeof(record->message), "%s", arg ? arg : "");
+    } else if (strcasecmp(data, "finish") == 0) {
+        record->type = PROGRESS_FINISH;
+    } else {
+        LOG_WARN(mux_module, "Unknown progress record: %s", data)
+        return 0;
+    }
+
+    return 1;
+}
+
+int progress_channel_read(int fd, progress_record *record) {
+    char buffer[PROGRESS_RECORD_SIZE + 1];
+
+    while (fd >= 0) {
+        ssize_t length = recv(fd, buffer, sizeof(buffer) - 1, 0);
+
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+
+        buffer[length] = '\0';
+        if (parse_record(buffer, record)) return 1;
+    }
+
+    return 0;
+}
+
+int progress_channel_send(const char *record) {
+    size_t length = strlen(record);
+    if (length > PROGRESS_RECORD_SIZE) length = PROGRESS_RECORD_SIZE;
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return 0;
+
+    struct sockaddr_un addr;
+    channel_address(&addr);
+
+    ssize_t sent;
+    do {
+        sent = sendto(fd, record, length, 0, (struct sockaddr *) &addr, sizeof(addr));
+    } while (sent < 0 && errno == EINTR);
+
+    close(fd);
+    return sent == (ssize_t) length;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef PROGRESS_CHANNEL_H
+#define PROGRESS_CHANNEL_H
+
+// Legacy files scripts write to, still honoured alongside the socket
+#define FINISH_FILE   "/tmp/msg_finish"
+#define PROGRESS_FILE "/tmp/msg_progress"
+
+#define PROGRESS_SOCKET "/tmp/msg_progress.sock"
+
+// Largest record, including the "message " keyword
+#define PROGRESS_RECORD_SIZE 1024
+
+typedef enum {
+    PROGRESS_NONE,
+    PROGRESS_VALUE,
+    PROGRESS_MESSAGE,
+    PROGRESS_FINISH
+} progress_type;
+
+typedef struct {
+    progress_type type;
+    int value;
+    char message[PROGRESS_RECORD_SIZE];
+} progress_record;
+
+/*
+ * muxmessage listens on a Unix datagram socket for records, one per datagram:
+ *   progress <0-100>
+ *   message <text>   (a literal \n starts a new line)
+ *   finish
+ * Each arrives as its own epoll event, so the screen updates as soon as a
+ * script reports rather than on the next poll of the legacy files.
+ *
+ * Returns a non-blocking descriptor, or -1 if the socket cannot be bound.
+ */
+int progress_channel_open(void);
+
+void progress_channel_close(int fd);
+
+// Reads the next pending record, returns 0 once nothing is left
+int progress_channel_read(int fd, progress_record *record);
+
+// Sends a single record, returns 0 if nothing is listening
+int progress_channel_send(const char *record);
+
+#endif
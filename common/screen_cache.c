@@ -0,0 +1,327 @@
+#include "../lvgl/lvgl.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "device.h"
+#include "log.h"
+#include "options.h"
+#include "theme.h"
+#include "image_prefetch.h"
+#include "screen_cache.h"
+#include "screen_preload.h"
+
+typedef enum {
+    ENTRY_LANGUAGE_FONT,
+    ENTRY_FONT_FILE,
+    ENTRY_IMAGE,
+    ENTRY_THEME
+} entry_kind;
+
+typedef struct {
+    entry_kind kind;
+    char *key;
+    uint32_t hash;
+    uint64_t stamp;       // Size and modification time of every file it was built from
+    size_t bytes;
+    uint64_t last_used;
+
+    lv_font_t *font;
+    lv_font_t *fallback;  // Borrowed from a language font entry, which must outlive this one
+    lv_img_dsc_t image;
+    struct theme_config *theme;
+} cache_entry;
+
+// Entries are allocated one by one, screens hold pointers into them
+static cache_entry **entries = NULL;
+static size_t entry_count = 0;
+static size_t entry_capacity = 0;
+static size_t entry_bytes = 0;
+static uint64_t use_counter = 0;
+
+static uint64_t stamp_mix(uint64_t stamp, uint64_t value) {
+    return (stamp ^ value) * 0x100000001b3ULL;
+}
+
+static bool file_stamp(const char *path, uint64_t *stamp) {
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+
+    *stamp = stamp_mix(*stamp, (uint64_t) st.st_size);
+    *stamp = stamp_mix(*stamp, (uint64_t) st.st_mtim.tv_sec * 1000000000 + (uint64_t) st.st_mtim.tv_nsec);
+
+    return true;
+}
+
+static cache_entry *entry_find(entry_kind kind, const char *key, uint64_t stamp, const lv_font_t *fallback) {
+    uint32_t hash = fnv1a_hash_str(key);
+
+    for (size_t i = 0; i < entry_count; i++) {
+        cache_entry *entry = entries[i];
+
+        if (entry->kind == kind && entry->hash == hash && entry->stamp == stamp &&
+            entry->fallback == fallback && strcmp(entry->key, key) == 0) {
+            entry->last_used = ++use_counter;
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static cache_entry *entry_add(entry_kind kind, const char *key, uint64_t stamp, size_t bytes) {
+    if (entry_count == entry_capacity) {
+        size_t capacity = entry_capacity ? entry_capacity * 2 : 32;
+
+        cache_entry **resized = realloc(entries, capacity * sizeof(cache_entry *));
+        if (!resized) return NULL;
+
+        entries = resized;
+        entry_capacity = capacity;
+    }
+
+    cache_entry *entry = calloc(1, sizeof(cache_entry));
+    if (!entry) return NULL;
+
+    entry->key = strdup(key);
+    if (!entry->key) {
+        free(entry);
+        return NULL;
+    }
+
+    entry->kind = kind;
+    entry->hash = fnv1a_hash_str(key);
+    entry->stamp = stamp;
+    entry->bytes = bytes;
+    entry->last_used = ++use_counter;
+
+    entries[entry_count++] = entry;
+    entry_bytes += bytes;
+
+    return entry;
+}
+
+static void entry_free(cache_entry *entry) {
+    switch (entry->kind) {
+        case ENTRY_LANGUAGE_FONT:
+            lv_tiny_ttf_destroy(entry->font);
+            break;
+        case ENTRY_FONT_FILE:
+            lv_font_free(entry->font);
+            break;
+        case ENTRY_IMAGE:
+            // LVGL keeps its own cache of opened images keyed on the descriptor
+            lv_img_cache_invalidate_src(&entry->image);
+            lv_mem_free((void *) entry->image.data);
+            break;
+        case ENTRY_THEME:
+            free(entry->theme);
+            break;
+    }
+
+    free(entry->key);
+    free(entry);
+}
+
+static void entry_remove(size_t index) {
+    cache_entry *entry = entries[index];
+
+    entries[index] = entries[--entry_count];
+    entry_bytes -= entry->bytes;
+
+    // Theme fonts fall back on a language font, so they go along with it
+    if (entry->kind == ENTRY_LANGUAGE_FONT) {
+        for (size_t i = 0; i < entry_count;) {
+            if (entries[i]->fallback == entry->font) {
+                entry_remove(i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    entry_free(entry);
+}
+
+lv_font_t *screen_cache_language_font(const char *language, int size) {
+    char key[MAX_BUFFER_SIZE];
+    snprintf(key, sizeof(key), "%s\n%d", language, size);
+
+    cache_entry *entry = entry_find(ENTRY_LANGUAGE_FONT, key, 0, NULL);
+    return entry ? entry->font : NULL;
+}
+
+void screen_cache_add_language_font(lv_font_t *font, const char *language, int size, size_t glyph_cache) {
+    if (!font) return;
+
+    char key[MAX_BUFFER_SIZE];
+    snprintf(key, sizeof(key), "%s\n%d", language, size);
+
+    cache_entry *entry = entry_add(ENTRY_LANGUAGE_FONT, key, 0, glyph_cache + sizeof(lv_font_t));
+    if (entry) {
+        entry->font = font;
+    } else {
+        LOG_WARN(mux_module, "Unable to cache language font: %s", language)
+    }
+}
+
+lv_font_t *screen_cache_font_file(const char *path, lv_font_t *fallback) {
+    uint64_t stamp = 0;
+    if (!file_stamp(path, &stamp)) return NULL;
+
+    cache_entry *entry = entry_find(ENTRY_FONT_FILE, path, stamp, fallback);
+    if (entry) return entry->font;
+
+    char font_src[PATH_MAX + 2];
+    snprintf(font_src, sizeof(font_src), "M:%s", path);
+
+    lv_font_t *font = lv_font_load(font_src);
+    if (!font) {
+        LOG_ERROR(mux_module, "Unable to load font: %s", path)
+        return NULL;
+    }
+
+    font->fallback = fallback;
+
+    struct stat st;
+    entry = entry_add(ENTRY_FONT_FILE, path, stamp, stat(path, &st) == 0 ? (size_t) st.st_size : 0);
+    if (!entry) return font;
+
+    entry->font = font;
+    entry->fallback = fallback;
+
+    return font;
+}
+
+void screen_cache_set_image(lv_obj_t *img, const char *src) {
+    const char *path = strncmp(src, "M:", 2) == 0 ? src + 2 : src;
+    const char *extension = strrchr(path, '.');
+
+    uint64_t stamp = 0;
+    if (!extension || strcasecmp(extension, ".png") != 0 || !file_stamp(path, &stamp)) {
+        lv_img_set_src(img, src);
+        return;
+    }
+
+    cache_entry *entry = entry_find(ENTRY_IMAGE, path, stamp, NULL);
+
+    if (!entry) {
+        lv_img_dsc_t image;
+        if (!screen_preload_take_image(path, &image) && !image_decode_png(path, &image)) {
+            lv_img_set_src(img, src);
+            return;
+        }
+
+        entry = entry_add(ENTRY_IMAGE, path, stamp, image.data_size);
+        if (!entry) {
+            lv_mem_free((void *) image.data);
+            lv_img_set_src(img, src);
+            return;
+        }
+
+        entry->image = image;
+    }
+
+    lv_img_set_src(img, &entry->image);
+}
+
+bool screen_cache_has_file(const char *path) {
+    uint64_t stamp = 0;
+    if (!file_stamp(path, &stamp)) return false;
+
+    uint32_t hash = fnv1a_hash_str(path);
+
+    for (size_t i = 0; i < entry_count; i++) {
+        const cache_entry *entry = entries[i];
+
+        if ((entry->kind == ENTRY_FONT_FILE || entry->kind == ENTRY_IMAGE) && entry->hash == hash &&
+            entry->stamp == stamp && strcmp(entry->key, path) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool theme_key(const char *const schemes[], size_t count, const struct mux_device *device,
+                      char *key, size_t key_size, uint64_t *stamp) {
+    size_t length = 0;
+    *stamp = stamp_mix(stamp_mix(0, (uint64_t) device->MUX.WIDTH), (uint64_t) device->MUX.HEIGHT);
+
+    key[0] = '\0';
+    for (size_t i = 0; i < count; i++) {
+        if (!file_stamp(schemes[i], stamp)) return false;
+
+        int written = snprintf(key + length, key_size - length, "%s\n", schemes[i]);
+        if (written < 0 || (size_t) written >= key_size - length) return false;
+
+        length += (size_t) written;
+    }
+
+    return true;
+}
+
+bool screen_cache_theme(const char *const schemes[], size_t count, const struct mux_device *device,
+                        struct theme_config *theme) {
+    char key[MAX_BUFFER_SIZE * 4];
+    uint64_t stamp;
+    if (!theme_key(schemes, count, device, key, sizeof(key), &stamp)) return false;
+
+    cache_entry *entry = entry_find(ENTRY_THEME, key, stamp, NULL);
+    if (!entry) return false;
+
+    memcpy(theme, entry->theme, sizeof(*theme));
+    return true;
+}
+
+void screen_cache_add_theme(const char *const schemes[], size_t count, const struct mux_device *device,
+                            const struct theme_config *theme) {
+    char key[MAX_BUFFER_SIZE * 4];
+    uint64_t stamp;
+    if (!theme_key(schemes, count, device, key, sizeof(key), &stamp)) return;
+
+    struct theme_config *copy = malloc(sizeof(*copy));
+    if (!copy) return;
+
+    cache_entry *entry = entry_add(ENTRY_THEME, key, stamp, sizeof(*copy));
+    if (!entry) {
+        free(copy);
+        return;
+    }
+
+    memcpy(copy, theme, sizeof(*copy));
+    entry->theme = copy;
+}
+
+void screen_cache_trim(void) {
+    // Anything rebuilt because its files changed leaves the old copy behind
+    for (size_t i = 0; i < entry_count; i++) {
+        for (size_t j = i + 1; j < entry_count; j++) {
+            // The same font over another fallback is a separate entry, not an older copy
+            if (entries[i]->kind != entries[j]->kind || entries[i]->hash != entries[j]->hash ||
+                entries[i]->fallback != entries[j]->fallback || entries[i]->stamp == entries[j]->stamp ||
+                strcmp(entries[i]->key, entries[j]->key) != 0) {
+                continue;
+            }
+
+            // Restart, removal can take dependent fonts out from anywhere in the list
+            entry_remove(entries[i]->last_used < entries[j]->last_used ? i : j);
+            i = (size_t) -1;
+            break;
+        }
+    }
+
+    while (entry_bytes > SCREEN_CACHE_BUDGET && entry_count) {
+        size_t oldest = 0;
+
+        for (size_t i = 1; i < entry_count; i++) {
+            if (entries[i]->last_used < entries[oldest]->last_used) oldest = i;
+        }
+
+        entry_remove(oldest);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef SCREEN_CACHE_H
+#define SCREEN_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "../lvgl/lvgl.h"
+
+// Fonts, wallpapers and themes kept between screens
+#define SCREEN_CACHE_BUDGET (16 * 1024 * 1024)
+
+struct theme_config;
+struct mux_device;
+
+/*
+ * Everything here is built by one screen and reused by the next one that asks
+ * for the same thing, instead of being loaded from storage again. A theme font
+ * or image is matched on its path and the file's size and modification time,
+ * so a theme change is picked up without any invalidation.
+ *
+ * Screens hold plain pointers to what they were given, so nothing is freed
+ * until screen_cache_trim is called with no screen alive.
+ */
+
+lv_font_t *screen_cache_language_font(const char *language, int size);
+
+// Takes ownership of a language font created by the caller after a miss above
+void screen_cache_add_language_font(lv_font_t *font, const char *language, int size, size_t glyph_cache);
+
+// Theme font from a binary font file with fallback for any glyph it lacks, NULL if it cannot be loaded
+lv_font_t *screen_cache_font_file(const char *path, lv_font_t *fallback);
+
+// Shows an LVGL image source, PNG files are decoded once and reused from then on
+void screen_cache_set_image(lv_obj_t *img, const char *src);
+
+// Whether a theme font or image at path is already loaded, without touching its place in the LRU order
+bool screen_cache_has_file(const char *path);
+
+// Copies the theme built from these scheme files in this order, false when it has not been built yet
+bool screen_cache_theme(const char *const schemes[], size_t count, const struct mux_device *device,
+                        struct theme_config *theme);
+
+void screen_cache_add_theme(const char *const schemes[], size_t count, const struct mux_device *device,
+                            const struct theme_config *theme);
+
+// Evicts the least recently used entries until the cache fits its budget, only ever between screens
+void screen_cache_trim(void);
+
+#endif
@@ -0,0 +1,555 @@
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "common_core.h"
+#include "catalogue_index.h"
+#include "config.h"
+#include "image_prefetch.h"
+#include "log.h"
+#include "options.h"
+#include "screen_cache.h"
+#include "text_file.h"
+#include "theme.h"
+#include "screen_preload.h"
+
+typedef enum {
+    STEP_LISTING,
+    STEP_INDEX,
+    STEP_ARTWORK,
+    STEP_WALLPAPER,
+    STEP_FONT,
+    STEP_COUNT
+} preload_step;
+
+#define STEPS_ALL ((1u << STEP_COUNT) - 1)
+
+typedef struct {
+    char module[MAX_BUFFER_SIZE];
+    char dir[PATH_MAX];        // Content folder, empty when the screen lists none
+    char meta_dir[PATH_MAX];   // Where the folder's core.cfg and per content cfg files live
+    char folder_names[PATH_MAX];
+    char wall[PATH_MAX];       // Empty unless a static PNG that is not cached already
+    char font[PATH_MAX];
+    bool root;                 // Top of the storage, folders take their artwork from the Folder catalogue
+    bool artwork;
+
+    unsigned done;             // Bit per preload_step
+    double step_ms[STEP_COUNT];
+} preload_target;
+
+typedef struct {
+    char *name;
+    bool is_dir;
+} preload_name;
+
+typedef struct {
+    char path[PATH_MAX];
+    struct stat st;
+    lv_img_dsc_t image;
+    double decode_ms;
+    bool ready;
+} preload_image;
+
+static preload_target target;
+static bool has_target = false;
+static unsigned target_id = 0;
+
+static preload_image wall_slot;
+
+static pthread_t preload_thread;
+static pthread_mutex_t preload_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t preload_cond = PTHREAD_COND_INITIALIZER;
+static int preload_running = 0;
+
+// Cancellation token, work stops as soon as it no longer matches the value it started with
+static atomic_uint generation;
+static atomic_llong last_input_ms;
+
+static unsigned stat_claims = 0;
+static unsigned stat_hits = 0;
+static unsigned stat_images = 0;
+static double stat_saved_ms = 0;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static double elapsed_ms(const struct timespec *start) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return (double) (end.tv_sec - start->tv_sec) * 1000.0 + (double) (end.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static bool cancelled(unsigned token) {
+    return atomic_load_explicit(&generation, memory_order_relaxed) != token;
+}
+
+static void slot_clear(void) {
+    if (wall_slot.ready) lv_mem_free((void *) wall_slot.image.data);
+    memset(&wall_slot, 0, sizeof(wall_slot));
+}
+
+// Pulls a file into the page cache, a missing one has nothing to warm
+static bool read_through(const char *path, unsigned token) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return true;
+
+    char buffer[16384];
+    while (!cancelled(token) && read(fd, buffer, sizeof(buffer)) > 0) {}
+
+    close(fd);
+    return !cancelled(token);
+}
+
+static void free_names(preload_name *names, size_t count) {
+    for (size_t i = 0; i < count; i++) free(names[i].name);
+    free(names);
+}
+
+static int name_compare(const void *a, const void *b) {
+    const preload_name *name_a = a;
+    const preload_name *name_b = b;
+
+    // Folders first then natural order, close enough to how the explorer sorts
+    if (name_a->is_dir != name_b->is_dir) return name_a->is_dir ? -1 : 1;
+
+    char lower_a[NAME_MAX + 1];
+    char lower_b[NAME_MAX + 1];
+    size_t i;
+
+    for (i = 0; name_a->name[i] && i < NAME_MAX; i++) lower_a[i] = (char) tolower((unsigned char) name_a->name[i]);
+    lower_a[i] = '\0';
+    for (i = 0; name_b->name[i] && i < NAME_MAX; i++) lower_b[i] = (char) tolower((unsigned char) name_b->name[i]);
+    lower_b[i] = '\0';
+
+    return strverscmp(lower_a, lower_b);
+}
+
+static void count_entries(const char *dir, const char *name) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    DIR *sub_dir = opendir(path);
+    if (!sub_dir) return;
+
+    while (readdir(sub_dir)) {}
+    closedir(sub_dir);
+}
+
+// The same reads the explorer makes, including opening every folder to see whether it is empty
+static bool warm_listing(const preload_target *work, unsigned token, preload_name **names, size_t *count) {
+    DIR *dir = opendir(work->dir);
+    if (!dir) return true;
+
+    size_t capacity = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) && !cancelled(token)) {
+        if (entry->d_name[0] == '.') continue;
+
+        bool is_dir = entry->d_type == DT_DIR;
+        if (!is_dir && entry->d_type != DT_REG) continue;
+
+        if (is_dir) count_entries(work->dir, entry->d_name);
+
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+
+            preload_name *resized = realloc(*names, capacity * sizeof(preload_name));
+            if (!resized) break;
+
+            *names = resized;
+        }
+
+        char *name = strdup(entry->d_name);
+        if (!name) break;
+
+        (*names)[(*count)++] = (preload_name) {.name = name, .is_dir = is_dir};
+    }
+
+    closedir(dir);
+    return !cancelled(token);
+}
+
+static bool warm_index(const preload_target *work, unsigned token, const preload_name *names, size_t count) {
+    char path[PATH_MAX];
+
+    if (work->folder_names[0] && !read_through(work->folder_names, token)) return false;
+    if (work->root) return !cancelled(token);
+
+    snprintf(path, sizeof(path), "%score.cfg", work->meta_dir);
+    text_file_release(text_file_acquire(path));
+
+    for (size_t i = 0; i < count && !cancelled(token); i++) {
+        if (names[i].is_dir) continue;
+
+        char *stripped_name = strip_ext(names[i].name);
+        snprintf(path, sizeof(path), "%s%s.cfg", work->meta_dir, stripped_name);
+        free(stripped_name);
+
+        file_exist(path);
+    }
+
+    return !cancelled(token);
+}
+
+// Resolves artwork the way the explorer does, the catalogue index keeps what it learns
+static bool warm_artwork(const preload_target *work, unsigned token, preload_name *names, size_t count) {
+    if (!work->artwork) return true;
+
+    qsort(names, count, sizeof(preload_name), name_compare);
+    if (count > SCREEN_PRELOAD_WINDOW) count = SCREEN_PRELOAD_WINDOW;
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", work->dir);
+
+    for (size_t i = 0; i < count && !cancelled(token); i++) {
+        char image[MAX_BUFFER_SIZE];
+        char core_artwork[MAX_BUFFER_SIZE];
+        char *file_name = strip_ext(names[i].name);
+        int found;
+
+        if (work->root) {
+            snprintf(image, sizeof(image), "%s/Folder/box/%s.png", INFO_CAT_PATH, names[i].name);
+            found = catalogue_index_file_exists(image);
+        } else if (names[i].is_dir) {
+            char *catalogue_name = get_catalogue_name_from_rom_path(dir, names[i].name);
+            found = load_image_catalogue("Folder", file_name, catalogue_name, "default",
+                                         mux_dimension, "box", image, sizeof(image));
+        } else {
+            get_catalogue_name(dir, names[i].name, core_artwork, sizeof(core_artwork));
+            found = strlen(core_artwork) > 1 &&
+                    load_image_catalogue(core_artwork, file_name, "", "default",
+                                         mux_dimension, "box", image, sizeof(image));
+        }
+
+        free(file_name);
+        if (found) read_through(image, token);
+    }
+
+    return !cancelled(token);
+}
+
+static bool warm_wallpaper(const preload_target *work, unsigned token, unsigned id) {
+    if (!work->wall[0]) return true;
+
+    pthread_mutex_lock(&preload_lock);
+    bool decoded = wall_slot.ready && strcmp(wall_slot.path, work->wall) == 0;
+    pthread_mutex_unlock(&preload_lock);
+    if (decoded) return true;
+
+    preload_image decode = {0};
+    snprintf(decode.path, sizeof(decode.path), "%s", work->wall);
+    if (stat(decode.path, &decode.st) != 0) return true;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (!image_decode_png(decode.path, &decode.image)) return true;
+
+    decode.decode_ms = elapsed_ms(&start);
+    decode.ready = true;
+
+    // Kept even when cancelled, it is whole and the same screen is still the likely one
+    pthread_mutex_lock(&preload_lock);
+    if (id == target_id) {
+        slot_clear();
+        wall_slot = decode;
+    } else {
+        lv_mem_free((void *) decode.image.data);
+    }
+    pthread_mutex_unlock(&preload_lock);
+
+    return !cancelled(token);
+}
+
+static void run_target(preload_target *work, unsigned token, unsigned id) {
+    preload_name *names = NULL;
+    size_t count = 0;
+
+    for (int step = 0; step < STEP_COUNT && !cancelled(token); step++) {
+        // The listing is needed again by the steps after it, only its first run is counted
+        if ((work->done & (1u << step)) && step != STEP_LISTING) continue;
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        bool complete = true;
+        switch ((preload_step) step) {
+            case STEP_LISTING:
+                complete = !work->dir[0] || warm_listing(work, token, &names, &count);
+                break;
+            case STEP_INDEX:
+                complete = !work->dir[0] || warm_index(work, token, names, count);
+                break;
+            case STEP_ARTWORK:
+                complete = !work->dir[0] || warm_artwork(work, token, names, count);
+                break;
+            case STEP_WALLPAPER:
+                complete = warm_wallpaper(work, token, id);
+                break;
+            case STEP_FONT:
+                complete = !work->font[0] || read_through(work->font, token);
+                break;
+            default:
+                break;
+        }
+
+        if (!complete) break;
+
+        // Decoding is counted when the wallpaper is handed over instead
+        if (!(work->done & (1u << step)) && step != STEP_WALLPAPER) work->step_ms[step] = elapsed_ms(&start);
+        work->done |= 1u << step;
+    }
+
+    free_names(names, count);
+}
+
+static void *preload_worker(void *arg) {
+    (void) arg;
+
+    pthread_mutex_lock(&preload_lock);
+
+    while (preload_running) {
+        if (!has_target || target.done == STEPS_ALL) {
+            pthread_cond_wait(&preload_cond, &preload_lock);
+            continue;
+        }
+
+        long long idle = now_ms() - atomic_load(&last_input_ms);
+        if (idle < SCREEN_PRELOAD_IDLE_MS) {
+            long long wait_ms = SCREEN_PRELOAD_IDLE_MS - idle;
+
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+
+            deadline.tv_sec += wait_ms / 1000;
+            deadline.tv_nsec += (wait_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+
+            pthread_cond_timedwait(&preload_cond, &preload_lock, &deadline);
+            continue;
+        }
+
+        preload_target *work = malloc(sizeof(preload_target));
+        if (!work) break;
+
+        *work = target;
+        unsigned id = target_id;
+        unsigned token = atomic_load(&generation);
+
+        pthread_mutex_unlock(&preload_lock);
+        run_target(work, token, id);
+        pthread_mutex_lock(&preload_lock);
+
+        // Whatever finished stays finished, a cancelled run resumes from there
+        if (id == target_id) {
+            target.done = work->done;
+            memcpy(target.step_ms, work->step_ms, sizeof(target.step_ms));
+        }
+
+        free(work);
+    }
+
+    pthread_mutex_unlock(&preload_lock);
+    return NULL;
+}
+
+void screen_preload_start(void) {
+    if (preload_running) return;
+
+    atomic_store(&last_input_ms, now_ms());
+    preload_running = 1;
+
+    if (pthread_create(&preload_thread, NULL, preload_worker, NULL) != 0) {
+        LOG_WARN(mux_module, "Screen preload unavailable")
+        preload_running = 0;
+    }
+}
+
+void screen_preload_stop(void) {
+    if (!preload_running) return;
+
+    pthread_mutex_lock(&preload_lock);
+    preload_running = 0;
+    has_target = false;
+    atomic_fetch_add(&generation, 1);
+    pthread_cond_broadcast(&preload_cond);
+    pthread_mutex_unlock(&preload_lock);
+
+    pthread_join(preload_thread, NULL);
+
+    slot_clear();
+}
+
+static void find_wallpaper(const char *module, char *wall, size_t wall_size) {
+    wall[0] = '\0';
+
+    // Animated and random backgrounds are not decoded through the screen cache
+    if (theme.MISC.ANIMATED_BACKGROUND || theme.MISC.RANDOM_BACKGROUND) return;
+
+    if (load_element_image_specifics(STORAGE_THEME, mux_dimension, module, "wall", "default", "default",
+                                     "png", wall, wall_size) ||
+        load_image_specifics(STORAGE_THEME, mux_dimension, module, "wall", "png", wall, wall_size) ||
+        load_image_specifics(STORAGE_THEME, "", module, "wall", "png", wall, wall_size)) {
+        if (!screen_cache_has_file(wall)) return;
+    }
+
+    wall[0] = '\0';
+}
+
+void screen_preload_schedule(const char *module, const char *dir) {
+    if (!preload_running) return;
+
+    preload_target *next = calloc(1, sizeof(preload_target));
+    if (!next) return;
+
+    if (module) {
+        snprintf(next->module, sizeof(next->module), "%s", module);
+
+        if (dir && dir[0]) {
+            snprintf(next->dir, sizeof(next->dir), "%s", dir);
+
+            const char *sub_path = dir;
+            if (strncasecmp(dir, STORAGE_PATH, strlen(STORAGE_PATH)) == 0) {
+                sub_path = dir + strlen(STORAGE_PATH);
+                while (*sub_path == '/') sub_path++;
+            }
+
+            next->root = sub_path[0] == '\0';
+            snprintf(next->meta_dir, sizeof(next->meta_dir), INFO_COR_PATH "/%s/", sub_path);
+
+            if (config.VISUAL.FRIENDLYFOLDER) {
+                snprintf(next->folder_names, sizeof(next->folder_names), INFO_NAM_PATH "/folder.json");
+            }
+
+            next->artwork = config.VISUAL.BOX_ART != 8;
+        }
+
+        find_wallpaper(module, next->wall, sizeof(next->wall));
+
+        if (get_theme_font_path(module, next->font, sizeof(next->font)) && screen_cache_has_file(next->font)) {
+            next->font[0] = '\0';
+        }
+    }
+
+    pthread_mutex_lock(&preload_lock);
+
+    // Still the same screen, keep what has been warmed so far
+    if (has_target && module && strcmp(target.module, next->module) == 0 && strcmp(target.dir, next->dir) == 0) {
+        pthread_mutex_unlock(&preload_lock);
+        free(next);
+        return;
+    }
+
+    target = *next;
+    has_target = module != NULL;
+    target_id++;
+    atomic_fetch_add(&generation, 1);
+
+    // Scheduled while the current screen is still settling, so give it the same grace as an input
+    atomic_store(&last_input_ms, now_ms());
+
+    if (wall_slot.ready && strcmp(wall_slot.path, target.wall) != 0) slot_clear();
+
+    pthread_cond_signal(&preload_cond);
+    pthread_mutex_unlock(&preload_lock);
+
+    free(next);
+}
+
+void screen_preload_cancel(void) {
+    atomic_store(&last_input_ms, now_ms());
+    atomic_fetch_add(&generation, 1);
+}
+
+void screen_preload_claim(const char *module, const char *dir) {
+    if (!preload_running) return;
+
+    pthread_mutex_lock(&preload_lock);
+
+    if (!has_target) {
+        pthread_mutex_unlock(&preload_lock);
+        return;
+    }
+
+    bool matched = strcmp(target.module, module) == 0 && strcmp(target.dir, dir ? dir : "") == 0;
+    bool warmed = matched && target.done == STEPS_ALL;
+
+    stat_claims++;
+    if (warmed) stat_hits++;
+
+    // Anything finished before a partial run was cut short was still read ahead of the screen
+    if (matched) {
+        for (int step = 0; step < STEP_COUNT; step++) {
+            if (target.done & (1u << step)) stat_saved_ms += target.step_ms[step];
+        }
+    }
+
+    char predicted[MAX_BUFFER_SIZE];
+    snprintf(predicted, sizeof(predicted), "%s", target.module);
+
+    has_target = false;
+    target_id++;
+    atomic_fetch_add(&generation, 1);
+
+    unsigned claims = stat_claims;
+    unsigned hits = stat_hits;
+    double saved_ms = stat_saved_ms;
+
+    pthread_mutex_unlock(&preload_lock);
+
+    LOG_INFO(mux_module, "Preload %s for %s (predicted %s): %u of %u screens warmed, %.1f ms saved",
+             warmed ? "hit" : (matched ? "partial" : "miss"), module, predicted, hits, claims, saved_ms)
+}
+
+bool screen_preload_take_image(const char *path, lv_img_dsc_t *image) {
+    if (!preload_running) return false;
+
+    pthread_mutex_lock(&preload_lock);
+
+    struct stat st;
+    if (!wall_slot.ready || strcmp(wall_slot.path, path) != 0 || stat(path, &st) != 0 ||
+        st.st_size != wall_slot.st.st_size ||
+        st.st_mtim.tv_sec != wall_slot.st.st_mtim.tv_sec || st.st_mtim.tv_nsec != wall_slot.st.st_mtim.tv_nsec) {
+        pthread_mutex_unlock(&preload_lock);
+        return false;
+    }
+
+    *image = wall_slot.image;
+    wall_slot.ready = false;
+
+    stat_images++;
+    stat_saved_ms += wall_slot.decode_ms;
+
+    unsigned images = stat_images;
+    double decode_ms = wall_slot.decode_ms;
+    double saved_ms = stat_saved_ms;
+
+    pthread_mutex_unlock(&preload_lock);
+
+    LOG_INFO(mux_module, "Preloaded wallpaper used (%u so far), %.1f ms decode skipped, %.1f ms saved",
+             images, decode_ms, saved_ms)
+
+    return true;
+}
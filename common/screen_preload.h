@@ -0,0 +1,42 @@
+#pragma once
+
+#ifndef SCREEN_PRELOAD_H
+#define SCREEN_PRELOAD_H
+
+#include <stdbool.h>
+#include "../lvgl/lvgl.h"
+
+// Quiet time after the last input before the next screen is warmed
+#define SCREEN_PRELOAD_IDLE_MS 400
+
+// Items at the top of the next listing whose artwork is looked up ahead of time
+#define SCREEN_PRELOAD_WINDOW 16
+
+/*
+ * Warms what the screen the user is most likely to open next will read, on a
+ * background thread while the current one sits idle: the content folder it
+ * lists and the metadata behind it, the catalogue artwork of the first items,
+ * its wallpaper decoded and ready to show, and its theme font.
+ *
+ * Every input cancels whatever is in flight, so the work never competes with
+ * navigation. It starts over once things are quiet again and picks up where
+ * it left off as the kernel and catalogue caches are still warm.
+ */
+
+void screen_preload_start(void);
+
+void screen_preload_stop(void);
+
+// Module of the predicted screen and the content folder it opens, NULL dir for none and NULL module to forget it
+void screen_preload_schedule(const char *module, const char *dir);
+
+// Safe to call from any thread, every input ends up here
+void screen_preload_cancel(void);
+
+// Called as a screen starts, counts a hit when it is the one that was warmed
+void screen_preload_claim(const char *module, const char *dir);
+
+// Hands over a wallpaper decoded ahead of time, the pixels then belong to the caller
+bool screen_preload_take_image(const char *path, lv_img_dsc_t *image);
+
+#endif
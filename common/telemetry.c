@@ -0,0 +1,654 @@
+#include "telemetry.h"
+#include "common.h"
+#include "device.h"
+#include "log.h"
+#include "text_file.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <net/if.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/nl80211.h>
+#include <linux/rtnetlink.h>
+
+#define NETLINK_BUFFER_SIZE 16384
+
+// A file kept open and re-read from the start with pread, reopened if it goes away
+typedef struct {
+    char path[PATH_MAX];
+    int fd;
+} telemetry_node;
+
+enum {
+    NODE_UPTIME,
+    NODE_MEMINFO,
+    NODE_CPU_FREQ,
+    NODE_GOVERNOR,
+    NODE_TEMP,
+    NODE_NET_STATE,
+    NODE_NET_MAC,
+    NODE_NET_RX,
+    NODE_NET_TX,
+    NODE_COUNT
+};
+
+static telemetry_node nodes[NODE_COUNT];
+
+static pthread_mutex_t sample_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sample_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t sample_thread;
+static int sampling = 0;
+static int sample_sources = 0;
+static telemetry_sample current;
+
+static int route_fd = -1;
+static int genl_fd = -1;
+static int nl80211_family = 0;
+static uint32_t netlink_seq = 0;
+static char netlink_buffer[NETLINK_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+static void node_open(int node, const char *path) {
+    snprintf(nodes[node].path, sizeof(nodes[node].path), "%s", path);
+    nodes[node].fd = -1;
+}
+
+static void node_close(int node) {
+    if (nodes[node].fd >= 0) close(nodes[node].fd);
+    nodes[node].fd = -1;
+}
+
+// Reads the whole node into buffer with trailing whitespace removed, returns the length or -1
+static ssize_t node_read(int node, char *buffer, size_t size) {
+    telemetry_node *n = &nodes[node];
+    if (!n->path[0]) return -1;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (n->fd < 0) n->fd = open(n->path, O_RDONLY | O_CLOEXEC);
+        if (n->fd < 0) return -1;
+
+        ssize_t length = pread(n->fd, buffer, size - 1, 0);
+        if (length >= 0) {
+            while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == ' ')) length--;
+            buffer[length] = '\0';
+            return length;
+        }
+
+        // Network nodes vanish when the driver is unloaded, try a fresh descriptor once
+        node_close(node);
+    }
+
+    return -1;
+}
+
+static long node_long(int node) {
+    char buffer[64];
+    if (node_read(node, buffer, sizeof(buffer)) <= 0) return -1;
+
+    char *end;
+    long value = strtol(buffer, &end, 10);
+
+    return end == buffer ? -1 : value;
+}
+
+static long meminfo_value(const char *meminfo, const char *key) {
+    const char *line = strstr(meminfo, key);
+    if (!line) return -1;
+
+    return strtol(line + strlen(key), NULL, 10);
+}
+
+static const struct {
+    unsigned part;
+    const char *name;
+} arm_parts[] = {
+        {0xc07, "Cortex-A7"},
+        {0xc08, "Cortex-A8"},
+        {0xc09, "Cortex-A9"},
+        {0xc0f, "Cortex-A15"},
+        {0xd03, "Cortex-A53"},
+        {0xd04, "Cortex-A35"},
+        {0xd05, "Cortex-A55"},
+        {0xd07, "Cortex-A57"},
+        {0xd08, "Cortex-A72"},
+        {0xd09, "Cortex-A73"},
+        {0xd0a, "Cortex-A75"},
+        {0xd0b, "Cortex-A76"},
+        {0xd0d, "Cortex-A77"},
+        {0xd41, "Cortex-A78"},
+        {0xd44, "Cortex-X1"},
+};
+
+// Same naming lscpu uses: ARM cores by part number, anything else by its model name
+static void read_cpu_model(telemetry_sample *sample) {
+    char *cpuinfo = text_file_read_all("/proc/cpuinfo");
+
+    if (cpuinfo) {
+        const char *part = strstr(cpuinfo, "CPU part");
+        const char *colon = part ? strchr(part, ':') : NULL;
+
+        if (colon) {
+            unsigned id = (unsigned) strtoul(colon + 1, NULL, 16);
+            for (size_t i = 0; i < A_SIZE(arm_parts); i++) {
+                if (arm_parts[i].part == id) {
+                    snprintf(sample->cpu_model, sizeof(sample->cpu_model), "%s", arm_parts[i].name);
+                    break;
+                }
+            }
+        }
+
+        const char *model = sample->cpu_model[0] ? NULL : strstr(cpuinfo, "model name");
+        colon = model ? strchr(model, ':') : NULL;
+
+        if (colon) {
+            colon++;
+            while (*colon == ' ' || *colon == '\t') colon++;
+
+            size_t length = strcspn(colon, "\n");
+            snprintf(sample->cpu_model, sizeof(sample->cpu_model), "%.*s", (int) length, colon);
+        }
+
+        free(cpuinfo);
+    }
+
+    // Counts every present core, including ones the governor scripts have taken offline
+    sample->cpu_count = 0;
+    char *present = text_file_read_all("/sys/devices/system/cpu/present");
+
+    if (present) {
+        char *save = NULL;
+        for (char *range = strtok_r(present, ",", &save); range; range = strtok_r(NULL, ",", &save)) {
+            int first, last;
+            int fields = sscanf(range, "%d-%d", &first, &last);
+
+            if (fields == 2) {
+                sample->cpu_count += last - first + 1;
+            } else if (fields == 1) {
+                sample->cpu_count++;
+            }
+        }
+
+        free(present);
+    }
+}
+
+static void sample_system(telemetry_sample *sample) {
+    char buffer[2048];
+
+    sample->uptime = node_read(NODE_UPTIME, buffer, sizeof(buffer)) > 0 ? strtod(buffer, NULL) : -1;
+    sample->cpu_freq_khz = node_long(NODE_CPU_FREQ);
+    sample->temp_millic = node_long(NODE_TEMP);
+
+    if (node_read(NODE_GOVERNOR, sample->governor, sizeof(sample->governor)) <= 0) sample->governor[0] = '\0';
+
+    sample->mem_total_kb = -1;
+    sample->mem_used_kb = -1;
+
+    if (node_read(NODE_MEMINFO, buffer, sizeof(buffer)) > 0) {
+        long total = meminfo_value(buffer, "MemTotal:");
+        long available = meminfo_value(buffer, "MemAvailable:");
+
+        // Kernels before 3.14 have no MemAvailable, count free memory and page cache instead
+        if (available < 0) {
+            long free_kb = meminfo_value(buffer, "MemFree:");
+            long buffers = meminfo_value(buffer, "Buffers:");
+            long cached = meminfo_value(buffer, "Cached:");
+
+            if (free_kb >= 0) available = free_kb + (buffers > 0 ? buffers : 0) + (cached > 0 ? cached : 0);
+        }
+
+        if (total > 0 && available >= 0) {
+            sample->mem_total_kb = total;
+            sample->mem_used_kb = total - available;
+        }
+    }
+}
+
+static int netlink_open(int protocol) {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, protocol);
+    if (fd < 0) return -1;
+
+    struct sockaddr_nl addr = {.nl_family = AF_NETLINK};
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    // Never wait forever on a kernel that does not answer
+    struct timeval timeout = {.tv_sec = 1};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    return fd;
+}
+
+typedef void (*netlink_handler)(struct nlmsghdr *msg, void *ctx);
+
+// Sends request and feeds every reply message to handler until the kernel is done
+static int netlink_query(int fd, struct nlmsghdr *request, netlink_handler handler, void *ctx) {
+    request->nlmsg_seq = ++netlink_seq;
+
+    if (send(fd, request, request->nlmsg_len, 0) < 0) return 0;
+
+    while (1) {
+        ssize_t length = recv(fd, netlink_buffer, sizeof(netlink_buffer), 0);
+        if (length < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+
+        for (struct nlmsghdr *msg = (struct nlmsghdr *) netlink_buffer;
+             NLMSG_OK(msg, (size_t) length); msg = NLMSG_NEXT(msg, length)) {
+            if (msg->nlmsg_seq != request->nlmsg_seq) continue;
+            if (msg->nlmsg_type == NLMSG_DONE) return 1;
+            if (msg->nlmsg_type == NLMSG_ERROR) {
+                struct nlmsgerr *err = NLMSG_DATA(msg);
+                return err->error == 0;
+            }
+
+            handler(msg, ctx);
+
+            if (!(msg->nlmsg_flags & NLM_F_MULTI)) return 1;
+        }
+    }
+}
+
+typedef struct {
+    int ifindex;
+    char *out;
+    size_t size;
+} route_query;
+
+static void handle_address(struct nlmsghdr *msg, void *ctx) {
+    route_query *query = ctx;
+    if (msg->nlmsg_type != RTM_NEWADDR || query->out[0]) return;
+
+    struct ifaddrmsg *ifa = NLMSG_DATA(msg);
+    if ((int) ifa->ifa_index != query->ifindex || ifa->ifa_family != AF_INET) return;
+
+    const void *address = NULL;
+    int length = IFA_PAYLOAD(msg);
+
+    for (struct rtattr *rta = IFA_RTA(ifa); RTA_OK(rta, length); rta = RTA_NEXT(rta, length)) {
+        // A point to point link reports the peer as IFA_ADDRESS, IFA_LOCAL is always ours
+        if (rta->rta_type == IFA_LOCAL || (rta->rta_type == IFA_ADDRESS && !address)) address = RTA_DATA(rta);
+    }
+
+    if (address) inet_ntop(AF_INET, address, query->out, (socklen_t) query->size);
+}
+
+static void handle_route(struct nlmsghdr *msg, void *ctx) {
+    route_query *query = ctx;
+    if (msg->nlmsg_type != RTM_NEWROUTE || query->out[0]) return;
+
+    struct rtmsg *rtm = NLMSG_DATA(msg);
+    if (rtm->rtm_family != AF_INET || rtm->rtm_dst_len != 0 || rtm->rtm_table != RT_TABLE_MAIN) return;
+
+    int length = RTM_PAYLOAD(msg);
+    for (struct rtattr *rta = RTM_RTA(rtm); RTA_OK(rta, length); rta = RTA_NEXT(rta, length)) {
+        if (rta->rta_type == RTA_GATEWAY) {
+            inet_ntop(AF_INET, RTA_DATA(rta), query->out, (socklen_t) query->size);
+            return;
+        }
+    }
+}
+
+static void route_dump(int type, size_t payload, int ifindex, netlink_handler handler, char *out, size_t size) {
+    out[0] = '\0';
+    if (route_fd < 0) return;
+
+    struct {
+        struct nlmsghdr header;
+        union {
+            struct ifaddrmsg ifa;
+            struct rtmsg rtm;
+        };
+    } request;
+
+    memset(&request, 0, sizeof(request));
+    request.header.nlmsg_len = NLMSG_LENGTH(payload);
+    request.header.nlmsg_type = (uint16_t) type;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+    // Both messages start with the address family
+    request.ifa.ifa_family = AF_INET;
+
+    route_query query = {.ifindex = ifindex, .out = out, .size = size};
+    netlink_query(route_fd, &request.header, handler, &query);
+}
+
+static struct nlattr *nla_next(struct nlattr *nla, int *remaining) {
+    int length = NLA_ALIGN(nla->nla_len);
+    *remaining -= length;
+    return (struct nlattr *) ((char *) nla + length);
+}
+
+static int nla_ok(const struct nlattr *nla, int remaining) {
+    return remaining >= (int) sizeof(*nla) && nla->nla_len >= sizeof(*nla) && nla->nla_len <= remaining;
+}
+
+#define NLA_DATA(nla) ((void *) ((char *) (nla) + NLA_HDRLEN))
+#define NLA_LEN(nla) ((int) (nla)->nla_len - NLA_HDRLEN)
+
+#define nla_for_each(pos, head, length, remaining) \
+    for (pos = (head), remaining = (length); nla_ok(pos, remaining); pos = nla_next(pos, &remaining))
+
+typedef struct {
+    struct nlmsghdr header;
+    struct genlmsghdr genl;
+    char attrs[64];
+} genl_request;
+
+static void genl_attr(genl_request *request, uint16_t type, const void *data, size_t length) {
+    struct nlattr *nla = (struct nlattr *) ((char *) request + NLMSG_ALIGN(request->header.nlmsg_len));
+
+    nla->nla_type = type;
+    nla->nla_len = (uint16_t) (NLA_HDRLEN + length);
+    memcpy(NLA_DATA(nla), data, length);
+
+    request->header.nlmsg_len = NLMSG_ALIGN(request->header.nlmsg_len) + NLA_ALIGN(nla->nla_len);
+}
+
+static void genl_init(genl_request *request, uint16_t family, uint8_t cmd, uint16_t flags) {
+    memset(request, 0, sizeof(*request));
+    request->header.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    request->header.nlmsg_type = family;
+    request->header.nlmsg_flags = NLM_F_REQUEST | flags;
+    request->genl.cmd = cmd;
+    request->genl.version = 1;
+}
+
+static void handle_family(struct nlmsghdr *msg, void *ctx) {
+    int *family = ctx;
+    struct nlattr *nla;
+    int remaining;
+
+    nla_for_each(nla, (struct nlattr *) ((char *) NLMSG_DATA(msg) + GENL_HDRLEN),
+                 (int) msg->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN), remaining) {
+        if (nla->nla_type == CTRL_ATTR_FAMILY_ID) *family = *(uint16_t *) NLA_DATA(nla);
+    }
+}
+
+static void resolve_nl80211(void) {
+    genl_fd = netlink_open(NETLINK_GENERIC);
+    if (genl_fd < 0) return;
+
+    genl_request request;
+    genl_init(&request, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 0);
+    genl_attr(&request, CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME, sizeof(NL80211_GENL_NAME));
+
+    netlink_query(genl_fd, &request.header, handle_family, &nl80211_family);
+
+    if (!nl80211_family) {
+        LOG_WARN(mux_module, "nl80211 unavailable, wireless details will not be shown")
+        close(genl_fd);
+        genl_fd = -1;
+    }
+}
+
+static void handle_bss(struct nlmsghdr *msg, void *ctx) {
+    telemetry_sample *sample = ctx;
+    struct nlattr *attr, *bss;
+    int remaining, bss_remaining;
+
+    nla_for_each(attr, (struct nlattr *) ((char *) NLMSG_DATA(msg) + GENL_HDRLEN),
+                 (int) msg->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN), remaining) {
+        if (attr->nla_type != NL80211_ATTR_BSS) continue;
+
+        int associated = 0;
+        int freq = 0;
+        const uint8_t *ies = NULL;
+        int ies_length = 0;
+
+        nla_for_each(bss, (struct nlattr *) NLA_DATA(attr), NLA_LEN(attr), bss_remaining) {
+            switch (bss->nla_type) {
+                case NL80211_BSS_STATUS: {
+                    uint32_t status = *(uint32_t *) NLA_DATA(bss);
+                    associated = status == NL80211_BSS_STATUS_ASSOCIATED ||
+                                 status == NL80211_BSS_STATUS_IBSS_JOINED;
+                    break;
+                }
+                case NL80211_BSS_FREQUENCY:
+                    freq = (int) *(uint32_t *) NLA_DATA(bss);
+                    break;
+                case NL80211_BSS_INFORMATION_ELEMENTS:
+                    ies = NLA_DATA(bss);
+                    ies_length = NLA_LEN(bss);
+                    break;
+            }
+        }
+
+        // Only the network we are on, the rest of the dump is the last scan
+        if (!associated) continue;
+
+        sample->freq_mhz = freq;
+
+        // The SSID is information element 0
+        while (ies && ies_length >= 2 && ies[1] + 2 <= ies_length) {
+            if (ies[0] == 0) {
+                snprintf(sample->ssid, sizeof(sample->ssid), "%.*s", ies[1], (const char *) ies + 2);
+                break;
+            }
+
+            ies_length -= ies[1] + 2;
+            ies += ies[1] + 2;
+        }
+    }
+}
+
+static void handle_station(struct nlmsghdr *msg, void *ctx) {
+    telemetry_sample *sample = ctx;
+    struct nlattr *attr, *info;
+    int remaining, info_remaining;
+
+    if (sample->has_signal) return;
+
+    nla_for_each(attr, (struct nlattr *) ((char *) NLMSG_DATA(msg) + GENL_HDRLEN),
+                 (int) msg->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN), remaining) {
+        if (attr->nla_type != NL80211_ATTR_STA_INFO) continue;
+
+        nla_for_each(info, (struct nlattr *) NLA_DATA(attr), NLA_LEN(attr), info_remaining) {
+            if (info->nla_type == NL80211_STA_INFO_SIGNAL) {
+                sample->signal_dbm = *(int8_t *) NLA_DATA(info);
+                sample->has_signal = 1;
+            }
+        }
+    }
+}
+
+static void sample_wireless(telemetry_sample *sample, int ifindex) {
+    if (genl_fd < 0) return;
+
+    uint32_t index = (uint32_t) ifindex;
+    genl_request request;
+
+    // What "iw dev link" reports: SSID and frequency of the associated BSS, signal of its station
+    genl_init(&request, (uint16_t) nl80211_family, NL80211_CMD_GET_SCAN, NLM_F_DUMP);
+    genl_attr(&request, NL80211_ATTR_IFINDEX, &index, sizeof(index));
+    netlink_query(genl_fd, &request.header, handle_bss, sample);
+
+    genl_init(&request, (uint16_t) nl80211_family, NL80211_CMD_GET_STATION, NLM_F_DUMP);
+    genl_attr(&request, NL80211_ATTR_IFINDEX, &index, sizeof(index));
+    netlink_query(genl_fd, &request.header, handle_station, sample);
+}
+
+static void read_dns(telemetry_sample *sample) {
+    // Opened each time as DHCP replaces resolv.conf rather than rewriting it
+    char *resolv = text_file_read_all("/etc/resolv.conf");
+    if (!resolv) return;
+
+    size_t used = 0;
+    char *save = NULL;
+
+    for (char *line = strtok_r(resolv, "\n", &save); line; line = strtok_r(NULL, "\n", &save)) {
+        char server[64];
+        if (sscanf(line, " nameserver %63s", server) != 1) continue;
+
+        int written = snprintf(sample->dns + used, sizeof(sample->dns) - used, "%s%s", used ? " " : "", server);
+        if (written < 0 || (size_t) written >= sizeof(sample->dns) - used) break;
+
+        used += (size_t) written;
+    }
+
+    free(resolv);
+}
+
+static void sample_network(telemetry_sample *sample) {
+    char state[32];
+    sample->connected = node_read(NODE_NET_STATE, state, sizeof(state)) > 0 && strcasecmp(state, "up") == 0;
+
+    if (node_read(NODE_NET_MAC, sample->mac, sizeof(sample->mac)) <= 0) sample->mac[0] = '\0';
+
+    sample->rx_bytes = node_long(NODE_NET_RX);
+    sample->tx_bytes = node_long(NODE_NET_TX);
+
+    sample->ip[0] = '\0';
+    sample->gateway[0] = '\0';
+    sample->dns[0] = '\0';
+    sample->ssid[0] = '\0';
+    sample->has_signal = 0;
+    sample->freq_mhz = 0;
+
+    if (!sample->connected) return;
+
+    // The interface index changes whenever the driver is reloaded
+    int ifindex = (int) if_nametoindex(device.NETWORK.INTERFACE);
+
+    if (ifindex > 0) {
+        route_dump(RTM_GETADDR, sizeof(struct ifaddrmsg), ifindex, handle_address, sample->ip, sizeof(sample->ip));
+        sample_wireless(sample, ifindex);
+    }
+
+    route_dump(RTM_GETROUTE, sizeof(struct rtmsg), 0, handle_route, sample->gateway, sizeof(sample->gateway));
+    read_dns(sample);
+}
+
+static void take_sample(void) {
+    telemetry_sample sample;
+
+    pthread_mutex_lock(&sample_lock);
+    sample = current;
+    pthread_mutex_unlock(&sample_lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &sample.taken);
+
+    if (sample_sources & TELEMETRY_SYSTEM) sample_system(&sample);
+    if (sample_sources & TELEMETRY_NETWORK) sample_network(&sample);
+
+    pthread_mutex_lock(&sample_lock);
+    current = sample;
+    pthread_mutex_unlock(&sample_lock);
+}
+
+static void *sample_worker(void *arg) {
+    (void) arg;
+
+    pthread_mutex_lock(&sample_lock);
+
+    while (sampling) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        deadline.tv_sec += TELEMETRY_INTERVAL_MS / 1000;
+        deadline.tv_nsec += (TELEMETRY_INTERVAL_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&sample_cond, &sample_lock, &deadline);
+        if (!sampling) break;
+
+        pthread_mutex_unlock(&sample_lock);
+        take_sample();
+        pthread_mutex_lock(&sample_lock);
+    }
+
+    pthread_mutex_unlock(&sample_lock);
+    return NULL;
+}
+
+void telemetry_start(int sources) {
+    if (sampling) telemetry_stop();
+
+    memset(&current, 0, sizeof(current));
+    current.uptime = -1;
+    current.cpu_freq_khz = -1;
+    current.mem_total_kb = -1;
+    current.mem_used_kb = -1;
+    current.temp_millic = -1;
+    current.rx_bytes = -1;
+    current.tx_bytes = -1;
+
+    for (int i = 0; i < NODE_COUNT; i++) node_open(i, "");
+
+    sample_sources = sources;
+
+    if (sources & TELEMETRY_SYSTEM) {
+        node_open(NODE_UPTIME, "/proc/uptime");
+        node_open(NODE_MEMINFO, "/proc/meminfo");
+        node_open(NODE_CPU_FREQ, "/sys/devices/system/cpu/cpufreq/policy0/cpuinfo_cur_freq");
+        node_open(NODE_GOVERNOR, device.CPU.GOVERNOR);
+        node_open(NODE_TEMP, "/sys/class/thermal/thermal_zone0/temp");
+
+        read_cpu_model(&current);
+    }
+
+    if (sources & TELEMETRY_NETWORK) {
+        char path[PATH_MAX];
+
+        node_open(NODE_NET_STATE, device.NETWORK.STATE);
+
+        snprintf(path, sizeof(path), "/sys/class/net/%s/address", device.NETWORK.INTERFACE);
+        node_open(NODE_NET_MAC, path);
+
+        snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/rx_bytes", device.NETWORK.INTERFACE);
+        node_open(NODE_NET_RX, path);
+
+        snprintf(path, sizeof(path), "/sys/class/net/%s/statistics/tx_bytes", device.NETWORK.INTERFACE);
+        node_open(NODE_NET_TX, path);
+
+        route_fd = netlink_open(NETLINK_ROUTE);
+        resolve_nl80211();
+    }
+
+    take_sample();
+
+    sampling = 1;
+    if (pthread_create(&sample_thread, NULL, sample_worker, NULL) != 0) {
+        LOG_WARN(mux_module, "Telemetry sampler unavailable, values will not refresh")
+        sampling = 0;
+    }
+}
+
+void telemetry_stop(void) {
+    if (sampling) {
+        pthread_mutex_lock(&sample_lock);
+        sampling = 0;
+        pthread_cond_signal(&sample_cond);
+        pthread_mutex_unlock(&sample_lock);
+
+        pthread_join(sample_thread, NULL);
+    }
+
+    for (int i = 0; i < NODE_COUNT; i++) node_close(i);
+
+    if (route_fd >= 0) close(route_fd);
+    if (genl_fd >= 0) close(genl_fd);
+
+    route_fd = -1;
+    genl_fd = -1;
+    nl80211_family = 0;
+}
+
+void telemetry_get(telemetry_sample *sample) {
+    pthread_mutex_lock(&sample_lock);
+    *sample = current;
+    pthread_mutex_unlock(&sample_lock);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <time.h>
+
+// How often the sampler thread refreshes its snapshot
+#define TELEMETRY_INTERVAL_MS 1000
+
+#define TELEMETRY_SYSTEM  (1 << 0)
+#define TELEMETRY_NETWORK (1 << 1)
+
+/*
+ * Snapshot of everything muxsysinfo and muxnetinfo display. Numbers that
+ * could not be read are negative and strings empty, so callers can fall back
+ * to their own "unknown" text.
+ */
+typedef struct {
+    struct timespec taken; // CLOCK_MONOTONIC
+
+    // TELEMETRY_SYSTEM
+    char cpu_model[48];
+    int cpu_count;
+    double uptime; // Seconds
+    long cpu_freq_khz;
+    char governor[64];
+    long mem_total_kb;
+    long mem_used_kb;
+    long temp_millic;
+
+    // TELEMETRY_NETWORK
+    int connected;
+    char mac[32];
+    char ip[64];
+    char gateway[64];
+    char dns[128];
+    char ssid[64];
+    int signal_dbm; // Only meaningful when has_signal is set
+    int has_signal;
+    int freq_mhz;
+    long long rx_bytes;
+    long long tx_bytes;
+} telemetry_sample;
+
+/*
+ * Takes a first sample straight away so the screen can be populated, then keeps
+ * sampling on a background thread. The UI timer only ever copies the latest
+ * snapshot, so no refresh blocks on the kernel or forks a shell.
+ */
+void telemetry_start(int sources);
+
+void telemetry_stop(void);
+
+void telemetry_get(telemetry_sample *sample);
+
+#endif
@@ -0,0 +1,264 @@
+#include "text_file.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static TextFile *cache[TEXT_FILE_CACHE_SIZE]; // most recently used first
+static size_t cache_count = 0;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void text_file_free(TextFile *tf) {
+    if (!tf) return;
+
+    free(tf->path);
+    free(tf->data);
+    free(tf->line_offsets);
+    free(tf);
+}
+
+static int index_lines(TextFile *tf) {
+    size_t capacity = 8;
+    tf->line_offsets = malloc(capacity * sizeof(size_t));
+    if (!tf->line_offsets) return 0;
+
+    size_t pos = 0;
+    while (pos < tf->length) {
+        if (tf->line_count == capacity) {
+            capacity *= 2;
+            size_t *grown = realloc(tf->line_offsets, capacity * sizeof(size_t));
+            if (!grown) return 0;
+            tf->line_offsets = grown;
+        }
+
+        tf->line_offsets[tf->line_count++] = pos;
+
+        const char *newline = memchr(tf->data + pos, '\n', tf->length - pos);
+        if (!newline) break;
+
+        pos = (size_t) (newline - tf->data) + 1;
+    }
+
+    return 1;
+}
+
+TextFile *text_file_load(const char *path) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    TextFile *tf = calloc(1, sizeof(TextFile));
+    if (!tf || fstat(fd, &st) != 0) goto fail;
+
+    tf->path = strdup(path);
+    if (!tf->path) goto fail;
+
+    tf->dev = st.st_dev;
+    tf->ino = st.st_ino;
+    tf->size = st.st_size;
+    tf->mtime = st.st_mtim;
+
+    // The size from stat is only a hint, pseudo files report 0 or a page
+    size_t capacity = st.st_size > 0 ? (size_t) st.st_size + 1 : 256;
+    tf->data = malloc(capacity);
+    if (!tf->data) goto fail;
+
+    for (;;) {
+        if (tf->length + 1 >= capacity) {
+            capacity *= 2;
+            char *grown = realloc(tf->data, capacity);
+            if (!grown) goto fail;
+            tf->data = grown;
+        }
+
+        ssize_t n = read(fd, tf->data + tf->length, capacity - tf->length - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) goto fail;
+        if (n == 0) break;
+
+        tf->length += (size_t) n;
+    }
+
+    tf->data[tf->length] = '\0';
+    if (!index_lines(tf)) goto fail;
+
+    close(fd);
+
+    tf->refs = 1;
+    return tf;
+
+    fail:
+    close(fd);
+    text_file_free(tf);
+
+    return NULL;
+}
+
+// Files under pseudo filesystems change without their mtime moving
+static int is_cacheable(const char *path, const struct stat *st) {
+    if (!S_ISREG(st->st_mode) || st->st_size > TEXT_FILE_CACHE_MAX_BYTES) return 0;
+
+    return strncmp(path, "/proc/", 6) != 0 &&
+           strncmp(path, "/sys/", 5) != 0 &&
+           strncmp(path, "/dev/", 5) != 0;
+}
+
+static int is_current(const TextFile *tf, const struct stat *st) {
+    return tf->dev == st->st_dev &&
+           tf->ino == st->st_ino &&
+           tf->size == st->st_size &&
+           tf->mtime.tv_sec == st->st_mtim.tv_sec &&
+           tf->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+// Expects cache_lock to be held
+static void cache_drop(size_t index) {
+    TextFile *tf = cache[index];
+
+    memmove(&cache[index], &cache[index + 1], (cache_count - index - 1) * sizeof(TextFile *));
+    cache_count--;
+
+    if (--tf->refs == 0) text_file_free(tf);
+}
+
+// Expects cache_lock to be held
+static void cache_insert(TextFile *tf) {
+    for (size_t i = 0; i < cache_count; i++) {
+        if (strcmp(cache[i]->path, tf->path) == 0) {
+            cache_drop(i);
+            break;
+        }
+    }
+
+    if (cache_count == TEXT_FILE_CACHE_SIZE) cache_drop(cache_count - 1);
+
+    memmove(&cache[1], &cache[0], cache_count * sizeof(TextFile *));
+    cache[0] = tf;
+    cache_count++;
+
+    tf->refs++;
+}
+
+TextFile *text_file_acquire(const char *path) {
+    struct stat st;
+    if (!path || stat(path, &st) != 0) return NULL;
+
+    if (!is_cacheable(path, &st)) return text_file_load(path);
+
+    pthread_mutex_lock(&cache_lock);
+    for (size_t i = 0; i < cache_count; i++) {
+        TextFile *tf = cache[i];
+        if (strcmp(tf->path, path) != 0) continue;
+
+        if (!is_current(tf, &st)) {
+            cache_drop(i);
+            break;
+        }
+
+        memmove(&cache[1], &cache[0], i * sizeof(TextFile *));
+        cache[0] = tf;
+        tf->refs++;
+
+        pthread_mutex_unlock(&cache_lock);
+        return tf;
+    }
+    pthread_mutex_unlock(&cache_lock);
+
+    // Parse outside of the lock, another thread may insert the same file
+    // in the meantime which is harmless as the newest copy wins
+    TextFile *tf = text_file_load(path);
+    if (!tf) return NULL;
+
+    pthread_mutex_lock(&cache_lock);
+    cache_insert(tf);
+    pthread_mutex_unlock(&cache_lock);
+
+    return tf;
+}
+
+void text_file_release(TextFile *tf) {
+    if (!tf) return;
+
+    pthread_mutex_lock(&cache_lock);
+    int refs = --tf->refs;
+    pthread_mutex_unlock(&cache_lock);
+
+    if (refs == 0) text_file_free(tf);
+}
+
+void text_file_invalidate(const char *path) {
+    if (!path) return;
+
+    pthread_mutex_lock(&cache_lock);
+    for (size_t i = 0; i < cache_count; i++) {
+        if (strcmp(cache[i]->path, path) == 0) {
+            cache_drop(i);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache_lock);
+}
+
+char *text_file_read_all(const char *path) {
+    TextFile *tf = text_file_acquire(path);
+    if (!tf) return NULL;
+
+    char *text = strndup(tf->data, tf->length);
+    text_file_release(tf);
+
+    return text;
+}
+
+bool text_file_line(const TextFile *tf, size_t line_number, TextLine *line) {
+    if (!tf || line_number == 0 || line_number > tf->line_count) return false;
+
+    size_t start = tf->line_offsets[line_number - 1];
+    size_t end = line_number < tf->line_count ? tf->line_offsets[line_number] : tf->length;
+
+    if (end > start && tf->data[end - 1] == '\n') end--;
+
+    line->data = tf->data + start;
+    line->length = end - start;
+
+    return true;
+}
+
+char *text_file_line_dup(const TextFile *tf, size_t line_number, size_t max_length) {
+    TextLine line;
+    if (!text_file_line(tf, line_number, &line)) return NULL;
+
+    size_t length = line.length;
+    if (max_length > 0 && length > max_length) length = max_length;
+
+    char *text = malloc(length + 1);
+    if (!text) return NULL;
+
+    memcpy(text, line.data, length);
+    text[length] = '\0';
+
+    return text;
+}
+
+int text_file_line_int(const TextFile *tf, size_t line_number, int fallback) {
+    TextLine line;
+    if (!text_file_line(tf, line_number, &line)) return fallback;
+
+    char buffer[32];
+    size_t length = line.length < sizeof(buffer) - 1 ? line.length : sizeof(buffer) - 1;
+
+    memcpy(buffer, line.data, length);
+    buffer[length] = '\0';
+
+    errno = 0;
+    long value = strtol(buffer, NULL, 10);
+    if (errno == ERANGE || value > INT_MAX || value < INT_MIN) return fallback;
+
+    return (int) value;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef TEXT_FILE_H
+#define TEXT_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+
+// How many parsed files are kept around per process
+#define TEXT_FILE_CACHE_SIZE 16
+
+// Files larger than this are parsed but never cached
+#define TEXT_FILE_CACHE_MAX_BYTES (64 * 1024)
+
+typedef struct {
+    const char *data;
+    size_t length;
+} TextLine;
+
+typedef struct {
+    char *path;
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+
+    char *data;
+    size_t length;
+
+    size_t *line_offsets;
+    size_t line_count;
+
+    int refs;
+} TextFile;
+
+TextFile *text_file_load(const char *path);
+
+TextFile *text_file_acquire(const char *path);
+
+void text_file_release(TextFile *tf);
+
+void text_file_invalidate(const char *path);
+
+// Whole file as a string the caller frees, NULL when it can't be read
+char *text_file_read_all(const char *path);
+
+bool text_file_line(const TextFile *tf, size_t line_number, TextLine *line);
+
+char *text_file_line_dup(const TextFile *tf, size_t line_number, size_t max_length);
+
+int text_file_line_int(const TextFile *tf, size_t line_number, int fallback);
+
+#endif
@@ -5,6 +5,7 @@
 #include "config.h"
 #include "device.h"
 #include "log.h"
+#include "screen_cache.h"
 #include "mini/mini.h"
 
 static lv_style_t style_list_panel_default;
@@ -1096,38 +1097,25 @@ void load_theme(struct theme_config *theme, struct mux_config *config, struct mu
         LOG_INFO("muxfrontend", "Loading Theme Resolution: %dx%d", device->MUX.WIDTH, device->MUX.HEIGHT)
     }
 
-    init_theme_config(theme, device);
-    const char *schemes[] = {"global", "default", mux_module};
-    int scheme_loaded = 0;
+    // Every scheme that applies in the order it is layered: global, default, module, alternate and override
+    char scheme_paths[5][MAX_BUFFER_SIZE];
+    const char *scheme_list[A_SIZE(scheme_paths)];
+    size_t scheme_count = 0;
 
-    if (theme_compat()) {
-        for (size_t i = 0; i < A_SIZE(schemes); i++) {
-            if (load_scheme(STORAGE_THEME, mux_dimension, schemes[i], scheme, sizeof(scheme))) {
-                LOG_INFO("muxfrontend", "Loading STORAGE Theme Scheme: %s", scheme)
-                scheme_loaded = 1;
-                load_theme_from_scheme(scheme, theme, device);
-            }
-        }
-        if (scheme_loaded) {
-            char alternate_scheme_path[MAX_BUFFER_SIZE];
-            if (get_alt_scheme_path(alternate_scheme_path, sizeof(alternate_scheme_path))) {
-                load_theme_from_scheme(alternate_scheme_path, theme, device);
-            }
-        }
-    }
+    const char *schemes[] = {"global", "default", mux_module};
+    const char *theme_bases[] = {STORAGE_THEME, INTERNAL_THEME};
 
-    if (!scheme_loaded) {
+    for (size_t b = theme_compat() ? 0 : 1; b < A_SIZE(theme_bases) && !scheme_count; b++) {
         for (size_t i = 0; i < A_SIZE(schemes); i++) {
-            if (load_scheme(INTERNAL_THEME, mux_dimension, schemes[i], scheme, sizeof(scheme))) {
-                LOG_INFO("muxfrontend", "Loading INTERNAL Theme Scheme: %s", scheme)
-                scheme_loaded = 1;
-                load_theme_from_scheme(scheme, theme, device);
+            if (load_scheme(theme_bases[b], mux_dimension, schemes[i], scheme, sizeof(scheme))) {
+                LOG_INFO("muxfrontend", "Loading %s Theme Scheme: %s", b ? "INTERNAL" : "STORAGE", scheme)
+                snprintf(scheme_paths[scheme_count++], MAX_BUFFER_SIZE, "%s", scheme);
             }
         }
-        if (scheme_loaded) {
+        if (scheme_count) {
             char alternate_scheme_path[MAX_BUFFER_SIZE];
             if (get_alt_scheme_path(alternate_scheme_path, sizeof(alternate_scheme_path))) {
-                load_theme_from_scheme(alternate_scheme_path, theme, device);
+                snprintf(scheme_paths[scheme_count++], MAX_BUFFER_SIZE, "%s", alternate_scheme_path);
             }
         }
     }
@@ -1136,7 +1124,17 @@ void load_theme(struct theme_config *theme, struct mux_config *config, struct mu
     snprintf(scheme_override, sizeof(scheme_override), RUN_STORAGE_PATH "theme/override/%s.ini",
              mux_module);
     if (file_exist(scheme_override)) {
-        load_theme_from_scheme(scheme_override, theme, device);
+        snprintf(scheme_paths[scheme_count++], MAX_BUFFER_SIZE, "%s", scheme_override);
+    }
+
+    for (size_t i = 0; i < scheme_count; i++) scheme_list[i] = scheme_paths[i];
+
+    // Going back to a screen finds its schemes unchanged, so skip parsing them all again
+    if (!screen_cache_theme(scheme_list, scheme_count, device, theme)) {
+        init_theme_config(theme, device);
+        for (size_t i = 0; i < scheme_count; i++) load_theme_from_scheme(scheme_list[i], theme, device);
+
+        screen_cache_add_theme(scheme_list, scheme_count, device, theme);
     }
 
     theme->GRID.ENABLED = (theme->GRID.COLUMN_COUNT > 0 && theme->GRID.ROW_COUNT > 0);
@@ -0,0 +1,728 @@
+#include "../lvgl/lvgl.h"
+#include "../lvgl/src/extra/libs/png/lodepng.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "common.h"
+#include "log.h"
+#include "options.h"
+#include "thumbnail.h"
+
+#define THUMBNAIL_MAX_DIMENSION 2047 // lv_img_header_t stores 11 bit sizes
+#define THUMBNAIL_SRC_PREFIX "M:" THUMBNAIL_CACHE_PATH "/"
+#define THUMBNAIL_NAME_LENGTH 12 // %08x.bin
+
+typedef struct {
+    char source[PATH_MAX];
+    int width;
+    int height;
+} thumbnail_job;
+
+typedef struct {
+    char name[48]; // <width>x<height>/%08x.bin
+    time_t last_used;
+    uint64_t size;
+} thumbnail_entry;
+
+static pthread_mutex_t builder_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t builder_cond = PTHREAD_COND_INITIALIZER;
+static bool builder_started = false;
+
+static thumbnail_job queue[THUMBNAIL_QUEUE_SIZE];
+static int queue_head = 0;
+static int queue_count = 0;
+
+// Bytes on the SD card, unknown until the builder has walked the cache once
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static int64_t cache_bytes = -1;
+
+static size_t source_offset(void) {
+    return sizeof(ThumbnailHeader);
+}
+
+static size_t pixel_offset(uint32_t source_length) {
+    return (sizeof(ThumbnailHeader) + source_length + 3) & ~(size_t) 3;
+}
+
+static bool is_png(const char *path) {
+    const char *ext = strrchr(path, '.');
+    return ext && strcasecmp(ext, ".png") == 0;
+}
+
+static void size_dir(int max_width, int max_height, char *dir, size_t dir_size) {
+    snprintf(dir, dir_size, "%s/%dx%d", THUMBNAIL_CACHE_PATH, max_width, max_height);
+}
+
+static void cache_path(const char *source, int max_width, int max_height, char *path, size_t path_size) {
+    char dir[PATH_MAX];
+    size_dir(max_width, max_height, dir, sizeof(dir));
+
+    snprintf(path, path_size, "%s/%08x.bin", dir, fnv1a_hash_str(source));
+}
+
+static bool read_full(int fd, void *buffer, size_t length, off_t offset) {
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t n = pread(fd, (uint8_t *) buffer + done, length - done, offset + (off_t) done);
+        if (n <= 0) return false;
+        done += (size_t) n;
+    }
+
+    return true;
+}
+
+static bool read_header(int fd, ThumbnailHeader *header) {
+    return read_full(fd, header, sizeof(ThumbnailHeader), 0) &&
+           memcmp(header->magic, THUMBNAIL_MAGIC, sizeof(header->magic)) == 0 &&
+           header->image.cf == LV_IMG_CF_TRUE_COLOR_ALPHA &&
+           header->source_length < PATH_MAX;
+}
+
+/*
+ * A thumbnail is only used when it was built from this exact version of the
+ * source. Its modification time doubles as when it was last used, bumped only
+ * once it is a day out so scrolling a list does not turn into SD card writes.
+ */
+static bool is_current(const char *path, const char *source, const struct stat *source_st) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    ThumbnailHeader header;
+    char stored[PATH_MAX];
+    size_t source_length = strlen(source);
+
+    bool current = read_header(fd, &header) &&
+                   header.source_size == (uint64_t) source_st->st_size &&
+                   header.source_mtime_sec == (int64_t) source_st->st_mtim.tv_sec &&
+                   header.source_mtime_nsec == (int64_t) source_st->st_mtim.tv_nsec &&
+                   header.source_length == source_length &&
+                   read_full(fd, stored, source_length, (off_t) source_offset()) &&
+                   memcmp(stored, source, source_length) == 0;
+
+    struct stat st;
+    if (current && fstat(fd, &st) == 0 && st.st_mtime < time(NULL) - THUMBNAIL_TOUCH_AGE) futimens(fd, NULL);
+
+    close(fd);
+    return current;
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    uint8_t *data = malloc((size_t) st.st_size);
+    if (data && !read_full(fd, data, (size_t) st.st_size, 0)) {
+        free(data);
+        data = NULL;
+    }
+
+    close(fd);
+
+    *size = (size_t) st.st_size;
+    return data;
+}
+
+// Straight RGBA in, alpha weighted so transparent edges do not bleed dark fringes
+static void box_pixel(const uint8_t *src, unsigned src_width, unsigned x0, unsigned x1,
+                      unsigned y0, unsigned y1, uint8_t *out) {
+    uint64_t sum_r = 0, sum_g = 0, sum_b = 0, sum_a = 0;
+
+    for (unsigned y = y0; y < y1; y++) {
+        const uint8_t *px = src + ((size_t) y * src_width + x0) * 4;
+        for (unsigned x = x0; x < x1; x++, px += 4) {
+            sum_r += (uint64_t) px[0] * px[3];
+            sum_g += (uint64_t) px[1] * px[3];
+            sum_b += (uint64_t) px[2] * px[3];
+            sum_a += px[3];
+        }
+    }
+
+    uint64_t count = (uint64_t) (x1 - x0) * (y1 - y0);
+    if (sum_a == 0) {
+        memset(out, 0, 4);
+        return;
+    }
+
+    out[0] = (uint8_t) (sum_b / sum_a);
+    out[1] = (uint8_t) (sum_g / sum_a);
+    out[2] = (uint8_t) (sum_r / sum_a);
+    out[3] = (uint8_t) (sum_a / count);
+}
+
+static void bilinear_pixel(const uint8_t *src, unsigned src_width, unsigned src_height,
+                           uint32_t fx, uint32_t fy, uint8_t *out) {
+    unsigned x0 = fx >> 16;
+    unsigned y0 = fy >> 16;
+    unsigned x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+    unsigned y1 = y0 + 1 < src_height ? y0 + 1 : y0;
+    uint32_t wx = fx & 0xFFFF;
+    uint32_t wy = fy & 0xFFFF;
+
+    const uint8_t *p00 = src + ((size_t) y0 * src_width + x0) * 4;
+    const uint8_t *p01 = src + ((size_t) y0 * src_width + x1) * 4;
+    const uint8_t *p10 = src + ((size_t) y1 * src_width + x0) * 4;
+    const uint8_t *p11 = src + ((size_t) y1 * src_width + x1) * 4;
+
+    uint8_t rgba[4];
+    for (int c = 0; c < 4; c++) {
+        uint64_t top = (uint64_t) p00[c] * (0x10000 - wx) + (uint64_t) p01[c] * wx;
+        uint64_t bottom = (uint64_t) p10[c] * (0x10000 - wx) + (uint64_t) p11[c] * wx;
+        rgba[c] = (uint8_t) ((top * (0x10000 - wy) + bottom * wy) >> 32);
+    }
+
+    out[0] = rgba[2];
+    out[1] = rgba[1];
+    out[2] = rgba[0];
+    out[3] = rgba[3];
+}
+
+/*
+ * Scales straight RGBA from lodepng into the 32 bit lv_color_t layout (BGRA in
+ * memory). Shrinking averages every covered source pixel, which is what the
+ * runtime zoom could never do, and growing falls back to bilinear.
+ */
+static void scale_pixels(const uint8_t *src, unsigned src_width, unsigned src_height,
+                         uint8_t *dst, unsigned dst_width, unsigned dst_height) {
+    bool shrink = dst_width <= src_width && dst_height <= src_height;
+
+    for (unsigned dy = 0; dy < dst_height; dy++) {
+        for (unsigned dx = 0; dx < dst_width; dx++) {
+            uint8_t *out = dst + ((size_t) dy * dst_width + dx) * 4;
+
+            if (shrink) {
+                unsigned x0 = (unsigned) ((uint64_t) dx * src_width / dst_width);
+                unsigned x1 = (unsigned) ((uint64_t) (dx + 1) * src_width / dst_width);
+                unsigned y0 = (unsigned) ((uint64_t) dy * src_height / dst_height);
+                unsigned y1 = (unsigned) ((uint64_t) (dy + 1) * src_height / dst_height);
+
+                box_pixel(src, src_width, x0, x1 > x0 ? x1 : x0 + 1, y0, y1 > y0 ? y1 : y0 + 1, out);
+            } else {
+                int64_t fx = (((int64_t) dx * 2 + 1) * src_width * 0x8000) / dst_width - 0x8000;
+                int64_t fy = (((int64_t) dy * 2 + 1) * src_height * 0x8000) / dst_height - 0x8000;
+
+                if (fx < 0) fx = 0;
+                if (fy < 0) fy = 0;
+
+                bilinear_pixel(src, src_width, src_height, (uint32_t) fx, (uint32_t) fy, out);
+            }
+        }
+    }
+}
+
+static void fit_size(unsigned width, unsigned height, int max_width, int max_height,
+                     unsigned *fit_width, unsigned *fit_height) {
+    // Same ratio update_image used to hand to lv_img_set_zoom
+    float width_ratio = (float) max_width / (float) width;
+    float height_ratio = (float) max_height / (float) height;
+    float ratio = (width_ratio < height_ratio) ? width_ratio : height_ratio;
+
+    *fit_width = (unsigned) ((float) width * ratio + 0.5f);
+    *fit_height = (unsigned) ((float) height * ratio + 0.5f);
+
+    if (*fit_width < 1) *fit_width = 1;
+    if (*fit_height < 1) *fit_height = 1;
+}
+
+static bool write_thumbnail(const char *path, const ThumbnailHeader *header, const char *source,
+                            const uint8_t *pixels, size_t pixels_size) {
+    char temp_path[PATH_MAX + 32];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d.%ld", path, (int) getpid(), (long) syscall(SYS_gettid));
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    static const uint8_t padding[4] = {0};
+    size_t padding_size = pixel_offset(header->source_length) - source_offset() - header->source_length;
+
+    struct {
+        const void *data;
+        size_t length;
+    } parts[] = {
+            {header,  sizeof(ThumbnailHeader)},
+            {source,  header->source_length},
+            {padding, padding_size},
+            {pixels,  pixels_size},
+    };
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < A_SIZE(parts); i++) {
+        size_t written = 0;
+        while (written < parts[i].length) {
+            ssize_t n = write(fd, (const uint8_t *) parts[i].data + written, parts[i].length - written);
+            if (n <= 0) {
+                ok = false;
+                break;
+            }
+            written += (size_t) n;
+        }
+    }
+
+    close(fd);
+
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+
+    return true;
+}
+
+// Only the signature and IHDR chunk are read, enough to know whether the image needs scaling at all
+static bool needs_scaling(const char *source, int max_width, int max_height) {
+    int fd = open(source, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    uint8_t head[33];
+    bool ok = read_full(fd, head, sizeof(head), 0);
+    close(fd);
+
+    if (!ok) return false;
+
+    LodePNGState state;
+    lodepng_state_init(&state);
+
+    unsigned width = 0;
+    unsigned height = 0;
+    ok = lodepng_inspect(&width, &height, &state, head, sizeof(head)) == 0 && width && height;
+
+    lodepng_state_cleanup(&state);
+    if (!ok) return false;
+
+    unsigned fit_width, fit_height;
+    fit_size(width, height, max_width, max_height, &fit_width, &fit_height);
+
+    return fit_width != width || fit_height != height;
+}
+
+static void cache_account(int64_t bytes) {
+    pthread_mutex_lock(&cache_lock);
+    if (cache_bytes >= 0) cache_bytes += bytes;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+static bool build_thumbnail(const char *source, const struct stat *source_st,
+                            int max_width, int max_height, const char *path) {
+    if (!needs_scaling(source, max_width, max_height)) return false;
+
+    size_t png_size = 0;
+    uint8_t *png_data = read_file(source, &png_size);
+    if (!png_data) return false;
+
+    unsigned char *img_data = NULL;
+    unsigned width = 0;
+    unsigned height = 0;
+
+    unsigned error = lodepng_decode32(&img_data, &width, &height, png_data, png_size);
+    free(png_data);
+
+    if (error || width == 0 || height == 0) {
+        if (img_data) lv_mem_free(img_data);
+        return false;
+    }
+
+    unsigned fit_width, fit_height;
+    fit_size(width, height, max_width, max_height, &fit_width, &fit_height);
+
+    if (fit_width > THUMBNAIL_MAX_DIMENSION || fit_height > THUMBNAIL_MAX_DIMENSION) {
+        lv_mem_free(img_data);
+        return false;
+    }
+
+    size_t pixels_size = (size_t) fit_width * fit_height * LV_IMG_PX_SIZE_ALPHA_BYTE;
+    uint8_t *pixels = malloc(pixels_size);
+    if (!pixels) {
+        lv_mem_free(img_data);
+        return false;
+    }
+
+    scale_pixels(img_data, width, height, pixels, fit_width, fit_height);
+    lv_mem_free(img_data);
+
+    ThumbnailHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, THUMBNAIL_MAGIC, sizeof(header.magic));
+    header.source_size = (uint64_t) source_st->st_size;
+    header.source_mtime_sec = (int64_t) source_st->st_mtim.tv_sec;
+    header.source_mtime_nsec = (int64_t) source_st->st_mtim.tv_nsec;
+    header.source_length = (uint32_t) strlen(source);
+    header.image.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+    header.image.w = fit_width;
+    header.image.h = fit_height;
+
+    char dir[PATH_MAX];
+    size_dir(max_width, max_height, dir, sizeof(dir));
+    create_directories(dir);
+
+    bool ok = write_thumbnail(path, &header, source, pixels, pixels_size);
+    free(pixels);
+
+    // A rebuilt thumbnail is counted twice until the next trim walks the cache again
+    if (ok) cache_account((int64_t) (pixel_offset(header.source_length) + pixels_size));
+
+    return ok;
+}
+
+static bool stat_source(const char *source, struct stat *st) {
+    return is_png(source) && stat(source, st) == 0 && S_ISREG(st->st_mode);
+}
+
+static bool ensure_thumbnail(const char *source, int max_width, int max_height, char *path, size_t path_size) {
+    struct stat st;
+    if (!stat_source(source, &st)) return false;
+
+    cache_path(source, max_width, max_height, path, path_size);
+    if (is_current(path, source, &st)) return true;
+
+    return build_thumbnail(source, &st, max_width, max_height, path);
+}
+
+static int compare_name(const void *a, const void *b) {
+    return strcasecmp(*(char *const *) a, *(char *const *) b);
+}
+
+static void free_names(char **names, size_t count) {
+    for (size_t i = 0; i < count; i++) free(names[i]);
+    free(names);
+}
+
+// Lists join catalogue artwork up by name, so the images after the source are the ones coming into view
+static void build_window(const thumbnail_job *job) {
+    char *dir_path = strip_dir((char *) job->source);
+    const char *anchor = strrchr(job->source, '/');
+    anchor = anchor ? anchor + 1 : job->source;
+
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        free(dir_path);
+        return;
+    }
+
+    char **names = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN) continue;
+        if (!is_png(entry->d_name)) continue;
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char **grown = realloc(names, capacity * sizeof(char *));
+            if (!grown) break;
+            names = grown;
+        }
+
+        names[count] = strdup(entry->d_name);
+        if (names[count]) count++;
+    }
+
+    closedir(dir);
+
+    if (count) qsort(names, count, sizeof(char *), compare_name);
+
+    size_t first = count;
+    for (size_t i = 0; i < count; i++) {
+        if (strcasecmp(names[i], anchor) > 0) {
+            first = i;
+            break;
+        }
+    }
+
+    int built = 0;
+    for (size_t i = first; i < count && i < first + THUMBNAIL_WINDOW; i++) {
+        char source[PATH_MAX];
+        char path[PATH_MAX];
+        snprintf(source, sizeof(source), "%s/%s", dir_path, names[i]);
+
+        if (ensure_thumbnail(source, job->width, job->height, path, sizeof(path))) built++;
+    }
+
+    LOG_INFO(mux_module, "Thumbnails Ready (%dx%d): %s (%d)", job->width, job->height, dir_path, built)
+
+    free_names(names, count);
+    free(dir_path);
+}
+
+static int compare_last_used(const void *a, const void *b) {
+    const thumbnail_entry *entry_a = a;
+    const thumbnail_entry *entry_b = b;
+
+    if (entry_a->last_used < entry_b->last_used) return -1;
+    if (entry_a->last_used > entry_b->last_used) return 1;
+
+    return 0;
+}
+
+static void collect_size_dir(const char *size_name, thumbnail_entry **entries, size_t *count,
+                             size_t *capacity, uint64_t *total) {
+    char dir_path[PATH_MAX];
+    snprintf(dir_path, sizeof(dir_path), "%s/%s", THUMBNAIL_CACHE_PATH, size_name);
+
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        // Anything else is a write that never finished or was never ours
+        if (strlen(ent->d_name) != THUMBNAIL_NAME_LENGTH) continue;
+
+        struct stat st;
+        if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        if (*count == *capacity) {
+            size_t grown_capacity = *capacity ? *capacity * 2 : 256;
+            thumbnail_entry *grown = realloc(*entries, grown_capacity * sizeof(thumbnail_entry));
+            if (!grown) break;
+
+            *entries = grown;
+            *capacity = grown_capacity;
+        }
+
+        thumbnail_entry *entry = &(*entries)[(*count)++];
+        snprintf(entry->name, sizeof(entry->name), "%s/%s", size_name, ent->d_name);
+        entry->last_used = st.st_mtime;
+        entry->size = (uint64_t) st.st_size;
+        *total += entry->size;
+    }
+
+    closedir(dir);
+}
+
+/*
+ * Walks every size folder and removes the least recently used thumbnails
+ * until the cache is comfortably under budget again, so a trim is not due
+ * again after the very next build.
+ */
+static void trim_cache(void) {
+    DIR *dir = opendir(THUMBNAIL_CACHE_PATH);
+    if (!dir) {
+        pthread_mutex_lock(&cache_lock);
+        cache_bytes = 0;
+        pthread_mutex_unlock(&cache_lock);
+        return;
+    }
+
+    thumbnail_entry *entries = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    uint64_t total = 0;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        if (ent->d_name[0] == '.') continue;
+        collect_size_dir(ent->d_name, &entries, &count, &capacity, &total);
+    }
+
+    closedir(dir);
+
+    if (total > THUMBNAIL_CACHE_BUDGET) {
+        uint64_t target = THUMBNAIL_CACHE_BUDGET / 100 * THUMBNAIL_TRIM_PERCENT;
+        size_t removed = 0;
+
+        qsort(entries, count, sizeof(thumbnail_entry), compare_last_used);
+
+        for (size_t i = 0; i < count && total > target; i++) {
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", THUMBNAIL_CACHE_PATH, entries[i].name);
+
+            if (remove(path) == 0) {
+                total -= entries[i].size;
+                removed++;
+            }
+        }
+
+        LOG_INFO(mux_module, "Thumbnail Cache Trimmed: %zu removed (%llu bytes left)",
+                 removed, (unsigned long long) total)
+    }
+
+    free(entries);
+
+    pthread_mutex_lock(&cache_lock);
+    cache_bytes = (int64_t) total;
+    pthread_mutex_unlock(&cache_lock);
+}
+
+static bool cache_needs_trim(void) {
+    pthread_mutex_lock(&cache_lock);
+    bool needs_trim = cache_bytes < 0 || (uint64_t) cache_bytes > THUMBNAIL_CACHE_BUDGET;
+    pthread_mutex_unlock(&cache_lock);
+
+    return needs_trim;
+}
+
+static void *builder_worker(void *arg) {
+    (void) arg;
+
+    // Thumbnails are a nice to have, never let them compete with the UI
+    setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), 10);
+
+    pthread_mutex_lock(&builder_lock);
+    for (;;) {
+        while (queue_count == 0) pthread_cond_wait(&builder_cond, &builder_lock);
+
+        thumbnail_job job = queue[queue_head];
+        queue_head = (queue_head + 1) % THUMBNAIL_QUEUE_SIZE;
+        queue_count--;
+
+        pthread_mutex_unlock(&builder_lock);
+        build_window(&job);
+        if (cache_needs_trim()) trim_cache();
+        pthread_mutex_lock(&builder_lock);
+    }
+
+    return NULL;
+}
+
+static bool same_dir(const char *a, const char *b) {
+    const char *slash_a = strrchr(a, '/');
+    const char *slash_b = strrchr(b, '/');
+
+    return slash_a && slash_b && slash_a - a == slash_b - b && strncmp(a, b, (size_t) (slash_a - a)) == 0;
+}
+
+void thumbnail_build_after(const char *source, int max_width, int max_height) {
+    pthread_mutex_lock(&builder_lock);
+
+    // Still waiting on the same folder, the user has simply scrolled on so move its window along
+    for (int i = 0; i < queue_count; i++) {
+        thumbnail_job *job = &queue[(queue_head + i) % THUMBNAIL_QUEUE_SIZE];
+
+        if (job->width == max_width && job->height == max_height && same_dir(job->source, source)) {
+            snprintf(job->source, sizeof(job->source), "%s", source);
+            pthread_mutex_unlock(&builder_lock);
+            return;
+        }
+    }
+
+    if (queue_count == THUMBNAIL_QUEUE_SIZE) {
+        pthread_mutex_unlock(&builder_lock);
+        return;
+    }
+
+    if (!builder_started) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, builder_worker, NULL) != 0) {
+            LOG_WARN(mux_module, "Thumbnail builder unavailable")
+            pthread_mutex_unlock(&builder_lock);
+            return;
+        }
+
+        pthread_detach(thread);
+        builder_started = true;
+    }
+
+    thumbnail_job *job = &queue[(queue_head + queue_count) % THUMBNAIL_QUEUE_SIZE];
+    snprintf(job->source, sizeof(job->source), "%s", source);
+    job->width = max_width;
+    job->height = max_height;
+    queue_count++;
+
+    pthread_cond_signal(&builder_cond);
+    pthread_mutex_unlock(&builder_lock);
+}
+
+int thumbnail_get(const char *source, int max_width, int max_height, char *thumbnail, size_t thumbnail_size) {
+    if (max_width <= 0 || max_height <= 0) return 0;
+
+    char path[PATH_MAX];
+    struct stat st;
+
+    if (!stat_source(source, &st)) return 0;
+
+    cache_path(source, max_width, max_height, path, sizeof(path));
+
+    if (!is_current(path, source, &st)) {
+        if (!build_thumbnail(source, &st, max_width, max_height, path)) return 0;
+
+        // The next page of the list is likely to be asked for next
+        thumbnail_build_after(source, max_width, max_height);
+    }
+
+    snprintf(thumbnail, thumbnail_size, "%s", path);
+    return 1;
+}
+
+static bool is_thumbnail_src(const void *src) {
+    return lv_img_src_get_type(src) == LV_IMG_SRC_FILE &&
+           strncmp(src, THUMBNAIL_SRC_PREFIX, strlen(THUMBNAIL_SRC_PREFIX)) == 0;
+}
+
+static lv_res_t decoder_info(lv_img_decoder_t *decoder, const void *src, lv_img_header_t *header) {
+    (void) decoder;
+
+    if (!is_thumbnail_src(src)) return LV_RES_INV;
+
+    int fd = open((const char *) src + 2, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return LV_RES_INV;
+
+    ThumbnailHeader thumbnail;
+    bool ok = read_header(fd, &thumbnail);
+    close(fd);
+
+    if (!ok) return LV_RES_INV;
+
+    *header = thumbnail.image;
+    return LV_RES_OK;
+}
+
+// The whole file is the decoded image, so opening it is a single read
+static lv_res_t decoder_open(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc) {
+    (void) decoder;
+
+    if (!is_thumbnail_src(dsc->src)) return LV_RES_INV;
+
+    size_t size = 0;
+    uint8_t *data = read_file((const char *) dsc->src + 2, &size);
+    if (!data) return LV_RES_INV;
+
+    const ThumbnailHeader *header = (const ThumbnailHeader *) data;
+    size_t offset = size >= sizeof(ThumbnailHeader) && header->source_length < PATH_MAX
+                    ? pixel_offset(header->source_length) : SIZE_MAX;
+
+    if (offset > size || memcmp(header->magic, THUMBNAIL_MAGIC, sizeof(header->magic)) != 0 ||
+        size - offset < (size_t) header->image.w * header->image.h * LV_IMG_PX_SIZE_ALPHA_BYTE) {
+        free(data);
+        return LV_RES_INV;
+    }
+
+    dsc->img_data = data + offset;
+    dsc->user_data = data;
+
+    return LV_RES_OK;
+}
+
+static void decoder_close(lv_img_decoder_t *decoder, lv_img_decoder_dsc_t *dsc) {
+    (void) decoder;
+
+    free(dsc->user_data);
+    dsc->user_data = NULL;
+    dsc->img_data = NULL;
+}
+
+void thumbnail_init(void) {
+    lv_img_decoder_t *decoder = lv_img_decoder_create();
+
+    lv_img_decoder_set_info_cb(decoder, decoder_info);
+    lv_img_decoder_set_open_cb(decoder, decoder_open);
+    lv_img_decoder_set_close_cb(decoder, decoder_close);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../lvgl/lvgl.h"
+
+#define THUMBNAIL_MAGIC "MUXTHB01"
+
+// Catalogue folders waiting for the background builder
+#define THUMBNAIL_QUEUE_SIZE 16
+
+// Images after the one just shown that are built ahead, roughly the next page of a list
+#define THUMBNAIL_WINDOW 16
+
+// Trimming stops once the cache is back under this share of THUMBNAIL_CACHE_BUDGET
+#define THUMBNAIL_TRIM_PERCENT 75
+
+// A used thumbnail has its modification time bumped at most this often, sparing SD card writes
+#define THUMBNAIL_TOUCH_AGE (24 * 60 * 60)
+
+/*
+ * Thumbnail layout as stored in THUMBNAIL_CACHE_PATH/<width>x<height>:
+ *   ThumbnailHeader
+ *   char source[source_length]  (not nul terminated, padded to 4 bytes)
+ *   lv_color32_t pixels[image.w * image.h]
+ *
+ * Only images that actually get scaled are stored. The modification time of a
+ * thumbnail is when it was last used, the oldest go first once the cache grows
+ * past THUMBNAIL_CACHE_BUDGET.
+ */
+typedef struct {
+    char magic[8];
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint32_t source_length;
+    lv_img_header_t image;
+} ThumbnailHeader;
+
+void thumbnail_init(void);
+
+int thumbnail_get(const char *source, int max_width, int max_height, char *thumbnail, size_t thumbnail_size);
+
+// Builds the images that follow source in its folder on a background thread
+void thumbnail_build_after(const char *source, int max_width, int max_height);
+
+#endif
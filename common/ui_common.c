@@ -1,4 +1,11 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "img/nothing.h"
 #include "common.h"
 #include "options.h"
@@ -7,7 +14,9 @@
 #include "input.h"
 #include "theme.h"
 #include "device.h"
+#include "event_bus.h"
 #include "ui_common.h"
+#include "gradient.h"
 #include "log.h"
 
 lv_obj_t *ui_screen_container;
@@ -88,155 +97,177 @@ static int volume_changed = 0;
 static int last_brightness = -1;
 static int last_volume = -1;
 
-// Global buffer for the canvas
+#define GRADIENT_MAGIC "MUXGRD01"
+
+// Everything the rendered background gradient depends on
+typedef struct {
+    uint32_t background;
+    uint32_t gradient_color;
+    int32_t start;
+    int32_t stop;
+    int32_t direction;
+    int32_t dither;
+    int32_t blur;
+    int32_t width;
+    int32_t height;
+    int32_t color_depth;
+} gradient_key;
+
+typedef struct {
+    char magic[8];
+    gradient_key key;
+} gradient_header;
+
+/*
+ * The gradient buffer is shared by every screen built with the same theme, so
+ * it outlives the canvas it was last attached to. It is either a read only
+ * mapping of the GRADIENT_CACHE_PATH file or the buffer it was rendered into.
+ */
+static gradient_key cbuf_key;
 static lv_color_t *cbuf;
+static void *cbuf_map;
+static size_t cbuf_map_size;
 
-// 4x4 Bayer Ordered Dithering Matrix (Normalized to 0-16)
-const int bayerMatrix[4][4] = {
-        {0,  8,  2,  10},
-        {12, 4,  14, 6},
-        {3,  11, 1,  9},
-        {15, 7,  13, 5}
-};
-
-// Improved dithering function using Bayer matrix
-static lv_color_t dither_color(lv_color_t color, int x, int y) {
-    // Get matrix value (normalized to range -4 to +4)
-    int bayerValue = bayerMatrix[y % 4][x % 4] - 7;
-
-    int r = LV_COLOR_GET_R(color) + bayerValue;
-    int g = LV_COLOR_GET_G(color) + bayerValue;
-    int b = LV_COLOR_GET_B(color) + bayerValue;
-
-    // Clamp values
-    r = LV_CLAMP(0, r, 255);
-    g = LV_CLAMP(0, g, 255);
-    b = LV_CLAMP(0, b, 255);
-
-    return lv_color_make(r, g, b);
+static void gradient_cache_path(const gradient_key *key, char *path, size_t path_size) {
+    char key_text[MAX_BUFFER_SIZE];
+    snprintf(key_text, sizeof(key_text), "%08x_%08x_%d_%d_%d_%d_%d_%dx%d_%d",
+             key->background, key->gradient_color, key->start, key->stop, key->direction,
+             key->dither, key->blur, key->width, key->height, key->color_depth);
+
+    snprintf(path, path_size, "%s/%08x.raw", GRADIENT_CACHE_PATH, fnv1a_hash_str(key_text));
 }
 
-void blur_gradient(lv_color_t *buf, int width, int height, int blur_strength) {
-    for (int pass = 0; pass < blur_strength; pass++) {
-        for (int y = 1; y < height - 1; y++) {
-            for (int x = 1; x < width - 1; x++) {
-                // Use a 3×3 box blur (increases smoothness)
-                int r = (
-                                LV_COLOR_GET_R(buf[(y - 1) * width + (x - 1)]) +
-                                LV_COLOR_GET_R(buf[(y - 1) * width + x]) +
-                                LV_COLOR_GET_R(buf[(y - 1) * width + (x + 1)]) +
-                                LV_COLOR_GET_R(buf[y * width + (x - 1)]) +
-                                LV_COLOR_GET_R(buf[y * width + x]) +
-                                LV_COLOR_GET_R(buf[y * width + (x + 1)]) +
-                                LV_COLOR_GET_R(buf[(y + 1) * width + (x - 1)]) +
-                                LV_COLOR_GET_R(buf[(y + 1) * width + x]) +
-                                LV_COLOR_GET_R(buf[(y + 1) * width + (x + 1)])
-                        ) / 9;  // Average 9 surrounding pixels
-
-                int g = (
-                                LV_COLOR_GET_G(buf[(y - 1) * width + (x - 1)]) +
-                                LV_COLOR_GET_G(buf[(y - 1) * width + x]) +
-                                LV_COLOR_GET_G(buf[(y - 1) * width + (x + 1)]) +
-                                LV_COLOR_GET_G(buf[y * width + (x - 1)]) +
-                                LV_COLOR_GET_G(buf[y * width + x]) +
-                                LV_COLOR_GET_G(buf[y * width + (x + 1)]) +
-                                LV_COLOR_GET_G(buf[(y + 1) * width + (x - 1)]) +
-                                LV_COLOR_GET_G(buf[(y + 1) * width + x]) +
-                                LV_COLOR_GET_G(buf[(y + 1) * width + (x + 1)])
-                        ) / 9;
-
-                int b = (
-                                LV_COLOR_GET_B(buf[(y - 1) * width + (x - 1)]) +
-                                LV_COLOR_GET_B(buf[(y - 1) * width + x]) +
-                                LV_COLOR_GET_B(buf[(y - 1) * width + (x + 1)]) +
-                                LV_COLOR_GET_B(buf[y * width + (x - 1)]) +
-                                LV_COLOR_GET_B(buf[y * width + x]) +
-                                LV_COLOR_GET_B(buf[y * width + (x + 1)]) +
-                                LV_COLOR_GET_B(buf[(y + 1) * width + (x - 1)]) +
-                                LV_COLOR_GET_B(buf[(y + 1) * width + x]) +
-                                LV_COLOR_GET_B(buf[(y + 1) * width + (x + 1)])
-                        ) / 9;
-
-                buf[y * width + x] = lv_color_make(r, g, b);
-            }
-        }
+static void gradient_release(void) {
+    if (cbuf_map) {
+        munmap(cbuf_map, cbuf_map_size);
+    } else if (cbuf) {
+        lv_mem_free(cbuf);
     }
+
+    cbuf = NULL;
+    cbuf_map = NULL;
+    cbuf_map_size = 0;
 }
 
-void generate_gradient_with_bayer_dither(lv_color_t *buf, int width, int height,
-                                         lv_color_t start_color, lv_color_t end_color,
-                                         bool apply_dither, bool vertical,
-                                         uint8_t main_stop, uint8_t grad_stop) {
-    // Convert gradient stop values (0-255) to pixel positions
-    int start_pos = (int) round(main_stop / 255.0) * (vertical ? height : width);
-    int end_pos = (int) round(grad_stop / 255.0) * (vertical ? height : width);
-
-    // Prevent invalid cases where start is beyond end
-    if (start_pos >= end_pos) {
-        start_pos = 0;
-        end_pos = vertical ? height : width;
+static bool gradient_map(const gradient_key *key, const char *path) {
+    size_t pixels_size = (size_t) key->width * key->height * sizeof(lv_color_t);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size != sizeof(gradient_header) + pixels_size) {
+        close(fd);
+        return false;
     }
 
-    // Iterate over each pixel
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            // Determine pixel position in gradient
-            int pos = vertical ? y : x;
+    void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
 
-            // Normalize position within gradient stops
-            float ratio = (float) (pos - start_pos) / (float) (end_pos - start_pos);
-            ratio = LV_CLAMP(0.0f, ratio, 1.0f); // Ensure within valid range
+    if (map == MAP_FAILED) return false;
 
-            // Compute interpolated color values
-            uint8_t r = (uint8_t) ((1.0f - ratio) * LV_COLOR_GET_R(start_color) + ratio * LV_COLOR_GET_R(end_color));
-            uint8_t g = (uint8_t) ((1.0f - ratio) * LV_COLOR_GET_G(start_color) + ratio * LV_COLOR_GET_G(end_color));
-            uint8_t b = (uint8_t) ((1.0f - ratio) * LV_COLOR_GET_B(start_color) + ratio * LV_COLOR_GET_B(end_color));
+    const gradient_header *header = map;
+    if (memcmp(header->magic, GRADIENT_MAGIC, sizeof(header->magic)) != 0 ||
+        memcmp(&header->key, key, sizeof(gradient_key)) != 0) {
+        munmap(map, (size_t) st.st_size);
+        return false;
+    }
 
-            // Ensure valid LVGL color format
-            lv_color_t final_color = lv_color_make(r, g, b);
+    cbuf_map = map;
+    cbuf_map_size = (size_t) st.st_size;
+    cbuf = (lv_color_t *) ((uint8_t *) map + sizeof(gradient_header));
 
-            // Apply Bayer dithering if enabled
-            if (apply_dither) {
-                final_color = dither_color(final_color, x, y);
-            }
+    return true;
+}
 
-            // Assign the final color to the buffer
-            buf[y * width + x] = final_color;
-        }
+static void gradient_store(const gradient_key *key, const char *path) {
+    char temp_path[PATH_MAX + 16];
+    snprintf(temp_path, sizeof(temp_path), "%s.%d", path, (int) getpid());
+
+    create_directories(GRADIENT_CACHE_PATH);
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+
+    gradient_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRADIENT_MAGIC, sizeof(header.magic));
+    header.key = *key;
+
+    size_t pixels_size = (size_t) key->width * key->height * sizeof(lv_color_t);
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t) sizeof(header);
+
+    for (size_t written = 0; ok && written < pixels_size;) {
+        ssize_t n = write(fd, (uint8_t *) cbuf + written, pixels_size - written);
+        if (n <= 0) ok = false;
+        else written += (size_t) n;
     }
+
+    close(fd);
+
+    if (!ok || rename(temp_path, path) != 0) remove(temp_path);
+}
+
+static bool gradient_render(const gradient_key *key, struct theme_config *theme) {
+    cbuf = lv_mem_alloc((size_t) key->width * key->height * sizeof(lv_color_t));
+    if (!cbuf) return false;
+
+    lv_color_t start_color = lv_color_hex(theme->SYSTEM.BACKGROUND);
+    lv_color_t end_color = lv_color_hex(theme->SYSTEM.BACKGROUND_GRADIENT_COLOR);
+
+    generate_gradient_with_bayer_dither(cbuf, key->width, key->height, start_color, end_color,
+                                        theme->SYSTEM.BACKGROUND_GRADIENT_DITHER == 1,
+                                        theme->SYSTEM.BACKGROUND_GRADIENT_DIRECTION == LV_GRAD_DIR_VER,
+                                        theme->SYSTEM.BACKGROUND_GRADIENT_START,
+                                        theme->SYSTEM.BACKGROUND_GRADIENT_STOP);
+    blur_gradient(cbuf, key->width, key->height, theme->SYSTEM.BACKGROUND_GRADIENT_BLUR);
+
+    return true;
 }
 
 void apply_gradient_to_ui_screen(lv_obj_t *ui_screen, struct theme_config *theme, struct mux_device *device) {
     if (theme->SYSTEM.BACKGROUND_GRADIENT_DIRECTION == LV_GRAD_DIR_NONE) return;
 
-    // Allocate memory for the canvas buffer
-    cbuf = lv_mem_alloc(device->MUX.WIDTH * device->MUX.HEIGHT * sizeof(lv_color_t));
+    gradient_key key;
+    memset(&key, 0, sizeof(key));
+    key.background = theme->SYSTEM.BACKGROUND;
+    key.gradient_color = theme->SYSTEM.BACKGROUND_GRADIENT_COLOR;
+    key.start = theme->SYSTEM.BACKGROUND_GRADIENT_START;
+    key.stop = theme->SYSTEM.BACKGROUND_GRADIENT_STOP;
+    key.direction = theme->SYSTEM.BACKGROUND_GRADIENT_DIRECTION;
+    key.dither = theme->SYSTEM.BACKGROUND_GRADIENT_DITHER;
+    key.blur = theme->SYSTEM.BACKGROUND_GRADIENT_BLUR;
+    key.width = device->MUX.WIDTH;
+    key.height = device->MUX.HEIGHT;
+    key.color_depth = LV_COLOR_DEPTH;
+
+    // The previous screen and its canvas are gone by now, so the buffer can be replaced
+    if (!cbuf || memcmp(&key, &cbuf_key, sizeof(gradient_key)) != 0) {
+        char path[PATH_MAX];
+        gradient_cache_path(&key, path, sizeof(path));
+
+        gradient_release();
+
+        if (!gradient_map(&key, path)) {
+            if (!gradient_render(&key, theme)) {
+                LV_LOG_ERROR("Failed to allocate memory for canvas buffer!");
+                return;
+            }
 
-    if (!cbuf) {
-        LV_LOG_ERROR("Failed to allocate memory for canvas buffer!");
-        return;
+            gradient_store(&key, path);
+        }
+
+        cbuf_key = key;
     }
 
-    // Create a canvas
+    // Create a canvas, the buffer is only ever read from
     lv_obj_t *canvas = lv_canvas_create(ui_screen);
-    lv_canvas_set_buffer(canvas, cbuf, device->MUX.WIDTH, device->MUX.HEIGHT, LV_IMG_CF_TRUE_COLOR);
+    lv_canvas_set_buffer(canvas, cbuf, key.width, key.height, LV_IMG_CF_TRUE_COLOR);
 
     // Set size and position to cover the full screen
-    lv_obj_set_size(canvas, device->MUX.WIDTH, device->MUX.HEIGHT);
+    lv_obj_set_size(canvas, key.width, key.height);
     lv_obj_align(canvas, LV_ALIGN_CENTER, 0, 0);  // Center on the screen
 
-    // Define gradient colors
-    lv_color_t start_color = lv_color_hex(theme->SYSTEM.BACKGROUND); // Black
-    lv_color_t end_color = lv_color_hex(theme->SYSTEM.BACKGROUND_GRADIENT_COLOR);   // Dark Gray
-
-    // Generate the gradient with dithering
-    generate_gradient_with_bayer_dither(cbuf, device->MUX.WIDTH, device->MUX.HEIGHT, start_color, end_color,
-                                        theme->SYSTEM.BACKGROUND_GRADIENT_DITHER == 1,
-                                        theme->SYSTEM.BACKGROUND_GRADIENT_DIRECTION == LV_GRAD_DIR_VER,
-                                        theme->SYSTEM.BACKGROUND_GRADIENT_START,
-                                        theme->SYSTEM.BACKGROUND_GRADIENT_STOP);
-    blur_gradient(cbuf, device->MUX.WIDTH, device->MUX.HEIGHT, theme->SYSTEM.BACKGROUND_GRADIENT_BLUR);
-
     // Refresh the canvas
     lv_obj_invalidate(canvas);
 }
@@ -889,8 +920,20 @@ void init_ui_item_counter(struct theme_config *theme) {
     }
 }
 
+static int blank_flag = -1;
+static int hdmi_refresh_flag = -1;
+
+static void watch_idle_flags(void) {
+    if (blank_flag != -1) return;
+
+    blank_flag = event_bus_watch(MUX_BLANK);
+    hdmi_refresh_flag = event_bus_watch(HDMI_REFRESH);
+}
+
 static int blank_check(void) {
-    if (file_exist(MUX_BLANK)) {
+    watch_idle_flags();
+
+    if (event_bus_exists(blank_flag)) {
         is_blank = 1;
 
         lv_obj_set_style_bg_opa(ui_blank, LV_OPA_COVER, MU_OBJ_MAIN_DEFAULT);
@@ -1011,9 +1054,9 @@ void ui_common_handle_idle(void) {
         return;
     }
 
-    if (file_exist("/tmp/hdmi_do_refresh")) {
-        remove("/tmp/hdmi_do_refresh");
+    watch_idle_flags();
 
+    if (event_bus_consume(hdmi_refresh_flag)) {
         lv_obj_invalidate(ui_pnlHeader);
         lv_obj_invalidate(ui_pnlContent);
         lv_obj_invalidate(ui_pnlFooter);
@@ -1022,7 +1065,7 @@ void ui_common_handle_idle(void) {
         lv_refr_now(NULL);
     }
 
-    if (!file_exist(MUX_BLANK) && lv_obj_get_style_bg_opa(ui_blank, MU_OBJ_MAIN_DEFAULT) > LV_OPA_TRANSP) {
+    if (!event_bus_exists(blank_flag) && lv_obj_get_style_bg_opa(ui_blank, MU_OBJ_MAIN_DEFAULT) > LV_OPA_TRANSP) {
         blank_check();
     }
 
@@ -1509,18 +1552,12 @@ void create_grid_item(struct theme_config *theme, lv_obj_t *cell_pnl, lv_obj_t *
     } else {
         lv_obj_align(cell_image, LV_ALIGN_TOP_MID, 0, theme->GRID.CELL.IMAGE_PADDING_TOP);
     }
-    if (file_exist(item_image_path)) {
-        char grid_image[MAX_BUFFER_SIZE];
-        snprintf(grid_image, sizeof(grid_image), "M:%s", item_image_path);
-        lv_img_set_src(cell_image, grid_image);
-    }
+    if (file_exist(item_image_path)) set_grid_image_src(cell_image, item_image_path);
 
-    char grid_image_focused[MAX_BUFFER_SIZE];
-    snprintf(grid_image_focused, sizeof(grid_image_focused), "M:%s", item_image_focused_path);
     lv_obj_t *cell_image_focused = lv_img_create(cell_pnl);
 
     if (file_exist(item_image_focused_path)) {
-        lv_img_set_src(cell_image_focused, grid_image_focused);
+        set_grid_image_src(cell_image_focused, item_image_focused_path);
     } else {
         lv_img_set_src(cell_image_focused, &ui_image_Nothing);
     }
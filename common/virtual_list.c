@@ -0,0 +1,160 @@
+#include "../lvgl/lvgl.h"
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "options.h"
+#include "theme.h"
+#include "virtual_list.h"
+
+static void create_row(virtual_list *list, virtual_list_row *row) {
+    row->panel = lv_obj_create(list->container);
+    row->label = lv_label_create(row->panel);
+    row->glyph = lv_img_create(row->panel);
+
+    lv_group_add_obj(list->group, row->label);
+    lv_group_add_obj(list->group_glyph, row->glyph);
+    lv_group_add_obj(list->group_panel, row->panel);
+
+    apply_theme_list_panel(row->panel);
+    apply_theme_list_item(&theme, row->label, "");
+    apply_theme_list_glyph(&theme, row->glyph, list->module, list->glyph);
+
+    row->item_index = -1;
+    row->glyph_module = list->module;
+    row->glyph_name = list->glyph;
+}
+
+static void bind_glyph(virtual_list *list, virtual_list_row *row, content_item *item, int item_index) {
+    if (theme.LIST_DEFAULT.GLYPH_ALPHA == 0 && theme.LIST_FOCUS.GLYPH_ALPHA == 0) return;
+
+    if (!item->glyph_icon && list->resolve_glyph) item->glyph_icon = list->resolve_glyph(item_index);
+
+    const char *module = item->use_module ? item->use_module : list->module;
+    const char *glyph = item->glyph_icon ? item->glyph_icon : list->glyph;
+
+    // Most rows share a glyph, so skip the theme lookup when it has not changed
+    if (strcmp(row->glyph_module, module) == 0 && strcmp(row->glyph_name, glyph) == 0) return;
+
+    char glyph_image_embed[MAX_BUFFER_SIZE];
+    if (get_glyph_path(module, glyph, glyph_image_embed, sizeof(glyph_image_embed))) {
+        lv_img_set_src(row->glyph, glyph_image_embed);
+    }
+
+    row->glyph_module = module;
+    row->glyph_name = glyph;
+}
+
+static void bind_row(virtual_list *list, virtual_list_row *row, int item_index) {
+    if (row->item_index == item_index) return;
+
+    content_item *item = &list->items[item_index];
+    row->item_index = item_index;
+
+    lv_label_set_text(row->label, item->display_name);
+    bind_glyph(list, row, item, item_index);
+
+    apply_size_to_content(&theme, list->container, row->label, row->glyph, item->display_name);
+    apply_text_long_dot(&theme, list->container, row->label);
+}
+
+static void reverse_rows(virtual_list_row *rows, int from, int to) {
+    for (to--; from < to; from++, to--) {
+        virtual_list_row row = rows[from];
+        rows[from] = rows[to];
+        rows[to] = row;
+    }
+}
+
+/*
+ * Moves the rows scrolled out of view to the other end of the list, so when
+ * the window moves by a few items only those rows are rebound and the rest
+ * keep their text and glyph.
+ */
+static void rotate_rows(virtual_list *list, int shift) {
+    int count = list->row_count;
+    int amount = ((shift % count) + count) % count;
+    if (amount == 0) return;
+
+    reverse_rows(list->rows, 0, amount);
+    reverse_rows(list->rows, amount, count);
+    reverse_rows(list->rows, 0, count);
+
+    for (int i = 0; i < count; i++) {
+        lv_obj_move_to_index(list->rows[i].panel, list->child_base + i);
+    }
+}
+
+// Keep the selection centred the same way update_scroll_position does
+static int window_start(const virtual_list *list, int item_index) {
+    int items_before_selected = (theme.MUX.ITEM.COUNT - theme.MUX.ITEM.COUNT % 2) / 2;
+    int start = item_index - items_before_selected;
+
+    if (start > list->item_count - list->row_count) start = list->item_count - list->row_count;
+    if (start < 0) start = 0;
+
+    return start;
+}
+
+int virtual_list_init(virtual_list *list, lv_obj_t *container, lv_group_t *group, lv_group_t *group_glyph,
+                      lv_group_t *group_panel, content_item *items, int item_count,
+                      const char *module, const char *glyph, virtual_list_glyph_resolver resolve_glyph) {
+    memset(list, 0, sizeof(virtual_list));
+
+    list->container = container;
+    list->group = group;
+    list->group_glyph = group_glyph;
+    list->group_panel = group_panel;
+    list->items = items;
+    list->item_count = item_count;
+    list->module = module;
+    list->glyph = glyph;
+    list->resolve_glyph = resolve_glyph;
+
+    if (item_count <= 0) return 0;
+
+    int row_count = LV_MIN(item_count, LV_MAX(theme.MUX.ITEM.COUNT, 1));
+    list->rows = calloc(row_count, sizeof(virtual_list_row));
+    if (!list->rows) return 0;
+
+    list->child_base = (int) lv_obj_get_child_cnt(container);
+    list->row_count = row_count;
+
+    for (int i = 0; i < row_count; i++) {
+        create_row(list, &list->rows[i]);
+        bind_row(list, &list->rows[i], i);
+    }
+
+    return row_count;
+}
+
+void virtual_list_focus(virtual_list *list, int item_index) {
+    if (!list->row_count) return;
+
+    if (item_index < 0) item_index = 0;
+    if (item_index >= list->item_count) item_index = list->item_count - 1;
+
+    int start = window_start(list, item_index);
+    int shift = start - list->first_index;
+
+    if (shift != 0 && abs(shift) < list->row_count) rotate_rows(list, shift);
+    list->first_index = start;
+
+    for (int i = 0; i < list->row_count; i++) bind_row(list, &list->rows[i], start + i);
+
+    virtual_list_row *row = &list->rows[item_index - start];
+    lv_group_focus_obj(row->label);
+    lv_group_focus_obj(row->glyph);
+    lv_group_focus_obj(row->panel);
+
+    // Only the window is ever on screen, so the scroll is relative to it
+    update_scroll_position(theme.MUX.ITEM.COUNT, theme.MUX.ITEM.PANEL, list->row_count,
+                           item_index - start, list->container);
+}
+
+void virtual_list_free(virtual_list *list) {
+    // Rows belong to the container and are deleted along with the screen
+    free(list->rows);
+
+    list->rows = NULL;
+    list->row_count = 0;
+}
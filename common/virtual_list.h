@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef VIRTUAL_LIST_H
+#define VIRTUAL_LIST_H
+
+#include "../lvgl/lvgl.h"
+#include "collection.h"
+
+typedef struct {
+    lv_obj_t *panel;
+    lv_obj_t *label;
+    lv_obj_t *glyph;
+
+    int item_index; // -1 until the row is bound
+    const char *glyph_module;
+    const char *glyph_name;
+} virtual_list_row;
+
+// Glyph of an item that has none yet, only asked for once the item comes into view
+typedef char *(*virtual_list_glyph_resolver)(int item_index);
+
+/*
+ * A list that only ever creates enough rows to fill the visible window
+ * (theme.MUX.ITEM.COUNT) and rebinds them from the item array as the
+ * selection moves, so a list of thousands of items costs the same number
+ * of LVGL objects as a list of ten.
+ *
+ * Row labels are the only objects in the label/glyph/panel groups, so the
+ * focused label always shows the selected item and the usual
+ * lv_group_get_focused(ui_group) lookups keep working.
+ */
+typedef struct {
+    lv_obj_t *container;
+    lv_group_t *group;
+    lv_group_t *group_glyph;
+    lv_group_t *group_panel;
+
+    content_item *items;
+    int item_count;
+
+    const char *module;
+    const char *glyph;
+    virtual_list_glyph_resolver resolve_glyph;
+
+    virtual_list_row *rows;
+    int row_count;
+    int child_base;
+    int first_index;
+} virtual_list;
+
+int virtual_list_init(virtual_list *list, lv_obj_t *container, lv_group_t *group, lv_group_t *group_glyph,
+                      lv_group_t *group_panel, content_item *items, int item_count,
+                      const char *module, const char *glyph, virtual_list_glyph_resolver resolve_glyph);
+
+void virtual_list_focus(virtual_list *list, int item_index);
+
+void virtual_list_free(virtual_list *list);
+
+#endif
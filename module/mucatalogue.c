@@ -0,0 +1,207 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/common.h"
+#include "../common/config.h"
+#include "../common/device.h"
+#include "../common/init.h"
+#include "../common/log.h"
+#include "../common/content_catalogue.h"
+
+// Held for as long as a watcher runs, a new frontend's watcher waits for the old one to leave
+#define CATALOGUE_LOCK "/tmp/mucatalogue.lock"
+
+#define WATCH_CONTENT (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR)
+#define WATCH_INFO    (WATCH_CONTENT | IN_CLOSE_WRITE)
+
+static volatile sig_atomic_t running = 1;
+
+static char rom_roots[3][MAX_BUFFER_SIZE];
+static const char *roots[3];
+
+static int watch_fd = -1;
+static int watch_full = 0;
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [watch [pid]]\n", name);
+}
+
+static void handle_signal(int sig) {
+    (void) sig;
+    running = 0;
+}
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
+
+static int roots_present(void) {
+    int present = 0;
+
+    for (size_t i = 0; i < A_SIZE(roots); i++) {
+        if (directory_exist((char *) roots[i])) present |= 1 << i;
+    }
+
+    return present;
+}
+
+static int update(void) {
+    // Hidden content and skip.ini can both change between updates
+    load_config(&config);
+    load_skip_patterns();
+
+    return content_catalogue_update(roots, A_SIZE(roots));
+}
+
+static void add_watch(const char *path, uint32_t mask) {
+    if (watch_full || inotify_add_watch(watch_fd, path, mask) >= 0) return;
+
+    if (errno == ENOSPC) {
+        LOG_WARN(mux_module, "Out of inotify watches, rescanning every %d seconds instead",
+                 CONTENT_CATALOGUE_RESCAN_MS / 1000)
+        watch_full = 1;
+    }
+}
+
+// Rebuilt from scratch after every update so watches never outlive the folders they were for
+static void rewatch(void) {
+    if (watch_fd >= 0) close(watch_fd);
+
+    watch_full = 0;
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (watch_fd < 0) {
+        LOG_ERROR(mux_module, "Unable to start inotify: %s", strerror(errno))
+        watch_full = 1;
+        return;
+    }
+
+    add_watch(INFO_NAM_PATH, WATCH_INFO);
+
+    content_catalogue *catalogue = content_catalogue_open();
+    if (!catalogue) return;
+
+    for (size_t i = 0; i < content_catalogue_folder_count(catalogue) && !watch_full; i++) {
+        const char *dir;
+        const char *rel;
+        if (!content_catalogue_folder_at(catalogue, i, &dir, &rel)) continue;
+
+        add_watch(dir, WATCH_CONTENT);
+
+        // Folder and individual assignments, the ROMS root uses the top of the core info
+        char core_dir[PATH_MAX];
+        snprintf(core_dir, sizeof(core_dir), INFO_COR_PATH "/%s", rel);
+        add_watch(core_dir, WATCH_INFO);
+    }
+
+    content_catalogue_close(catalogue);
+}
+
+// Anything at all means another look, the update itself works out what changed
+static int drain_events(void) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int seen = 0;
+
+    for (;;) {
+        ssize_t length = read(watch_fd, buffer, sizeof(buffer));
+        if (length <= 0) break;
+        seen = 1;
+    }
+
+    return seen;
+}
+
+static int watch(pid_t parent) {
+    int lock_fd = open(CATALOGUE_LOCK, O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0) {
+        LOG_ERROR(mux_module, "Unable to lock %s", CATALOGUE_LOCK)
+        return 1;
+    }
+
+    update();
+    rewatch();
+
+    int present = roots_present();
+    int dirty = 0;
+    uint64_t last_update = now_ms();
+
+    while (running) {
+        struct pollfd pfd = {.fd = watch_fd, .events = POLLIN};
+        int ready = poll(&pfd, watch_fd >= 0 ? 1 : 0, dirty ? CONTENT_CATALOGUE_SETTLE_MS : CONTENT_CATALOGUE_CHECK_MS);
+
+        if (ready < 0 && errno != EINTR) break;
+
+        // Events keep pushing the update back until storage has been quiet for a while
+        if (ready > 0 && drain_events()) {
+            dirty = 1;
+            continue;
+        }
+
+        if (parent > 0 && kill(parent, 0) != 0 && errno == ESRCH) break;
+
+        int now_present = roots_present();
+        if (now_present != present) {
+            present = now_present;
+            dirty = 1;
+        }
+
+        if (watch_full && now_ms() - last_update >= CONTENT_CATALOGUE_RESCAN_MS) dirty = 1;
+
+        if (!dirty || !running) continue;
+
+        update();
+        rewatch();
+
+        dirty = 0;
+        last_update = now_ms();
+    }
+
+    if (watch_fd >= 0) close(watch_fd);
+    close(lock_fd);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int watching = argc > 1 && strcasecmp(argv[1], "watch") == 0;
+
+    if (argc > 1 && !watching) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct sigaction sa = {.sa_handler = handle_signal};
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    init_module("mucatalogue");
+    load_device(&device);
+
+    const char *mounts[] = {device.STORAGE.ROM.MOUNT, device.STORAGE.SDCARD.MOUNT, device.STORAGE.USB.MOUNT};
+    for (size_t i = 0; i < A_SIZE(roots); i++) {
+        snprintf(rom_roots[i], sizeof(rom_roots[i]), "%s/ROMS", mounts[i]);
+        roots[i] = rom_roots[i];
+    }
+
+    if (!watching) return update() ? 0 : 1;
+
+    // Storage is shared with whatever the user launches, so stay out of its way
+    errno = 0;
+    if (nice(10) == -1 && errno) LOG_WARN(mux_module, "Unable to lower priority")
+
+    return watch(argc > 2 ? (pid_t) safe_atoi(argv[2]) : 0);
+}
@@ -14,10 +14,12 @@
 #include "../common/language.h"
 #include "../common/config.h"
 #include "../common/device.h"
+#include "../common/event_bus.h"
+#include "../common/exec_broker.h"
+#include "../common/input_match.h"
 #include "../common/theme.h"
 #include "../common/json/json.h"
 
-#define MAX_SEQUENCE 12
 #define SAFE_BIT(i) ((uint64_t)1 << ((i) & 63))
 #define SEQUENCE_WIN (400 + 150 * seq_buf.count)
 
@@ -49,7 +51,7 @@ typedef struct {
     int is_handheld_mode;
     int is_normal_mode;
     uint64_t type_mask;
-    int sequence_inputs[MAX_SEQUENCE];
+    int sequence_inputs[INPUT_SEQUENCE_MAX];
     int sequence_length;
     uint32_t max_interval;
     char *exec_cmd;
@@ -61,6 +63,8 @@ static struct {
     int count;
 } seq_buf = {0};
 
+static input_sequence_trie sequence_trie;
+
 static const char *input_name[MUX_INPUT_COUNT] = {
         // Gamepad buttons:
         [MUX_INPUT_A] = "A",
@@ -129,6 +133,10 @@ static int last_combo_index = 0;
 static int verbose = 0;
 static uint32_t global_tick = 0;
 
+static int idle_inhibit_flag = -1;
+static uint32_t idle_inhibit_generation = 0;
+static int idle_inhibit = IDLE_INHIBIT_NONE;
+
 static idle_timer idle_display = {.idle_name = "IDLE_DISPLAY", .active_name = "IDLE_ACTIVE"};
 static idle_timer idle_sleep = {.idle_name = "IDLE_SLEEP"};
 
@@ -240,6 +248,16 @@ static void check_idle(idle_timer *timer, uint32_t timeout_ms) {
     }
 }
 
+// Builds the sequence trie from the (already sorted) combo table. Must be rerun if combos change.
+static void compile_sequences(void) {
+    input_sequence_init(&sequence_trie);
+
+    for (int i = 0; i < combo_count; ++i) {
+        const combo_config *c = &combo[i];
+        if (c->is_sequence) input_sequence_add(&sequence_trie, i, c->sequence_inputs, c->sequence_length, c->max_interval);
+    }
+}
+
 static void handle_input(mux_input_type type, mux_input_action action) {
     global_tick = mux_input_tick();
     if (verbose) printf("[%s %s]\n", input_name[type], action_name[action]);
@@ -247,38 +265,11 @@ static void handle_input(mux_input_type type, mux_input_action action) {
     if (action == MUX_INPUT_PRESS) {
         record_sequence(type);
 
-        for (int i = 0; i < combo_count; ++i) {
-            combo_config *c = &combo[i];
-            if (!c->is_sequence) continue;
-            if (c->sequence_length > seq_buf.count) continue;
-
-            int match = 1;
-            uint32_t prev_time = 0;
-
-            for (int j = 0; j < c->sequence_length; ++j) {
-                int idx = seq_buf.count - c->sequence_length + j;
-
-                if (seq_buf.inputs[idx] != c->sequence_inputs[j]) {
-                    match = 0;
-                    break;
-                }
-
-                if (c->max_interval && j > 0) {
-                    uint32_t delta = seq_buf.time[idx] - prev_time;
-                    if (delta > c->max_interval) {
-                        match = 0;
-                        break;
-                    }
-                }
-                prev_time = seq_buf.time[idx];
-            }
-
-            if (match) {
-                printf("%s\n", c->name);
-                seq_buf.count = 0; // reset after successful sequence match
-                run_command(c);
-                break;
-            }
+        int match = input_sequence_match(&sequence_trie, seq_buf.inputs, seq_buf.time, seq_buf.count);
+        if (match != -1) {
+            printf("%s\n", combo[match].name);
+            seq_buf.count = 0; // reset after successful sequence match
+            run_command(&combo[match]);
         }
     }
 
@@ -286,16 +277,29 @@ static void handle_input(mux_input_type type, mux_input_action action) {
     idle_sleep.tick = global_tick;
 }
 
+static int read_idle_inhibit(void) {
+    // The file is only read again after the event bus sees it rewritten, so an unchanged
+    // idle_inhibit costs nothing no matter how often the idle handler runs.
+    uint32_t generation = event_bus_generation(idle_inhibit_flag);
+
+    if (generation != idle_inhibit_generation) {
+        idle_inhibit_generation = generation;
+        idle_inhibit = read_line_int_from((CONF_CONFIG_PATH "system/idle_inhibit"), 1);
+    }
+
+    return idle_inhibit;
+}
+
 static void handle_idle(void) {
     // If we handled input on this iteration of the event loop, we're already in the active state
-    // and don't need to read the idle_inhibit file. That helps performance since the idle handler
-    // is effectively called in a tight loop for continuous input (e.g., spinning a control stick).
+    // and don't need to check idle_inhibit. That helps performance since the idle handler is
+    // effectively called in a tight loop for continuous input (e.g., spinning a control stick).
     global_tick = mux_input_tick();
 
     if (idle_display.tick != global_tick) {
         // Allow the shell scripts to temporarily inhibit idle detection. (We could check those
         // conditions here, but it's more flexible to leave that externally controllable.)
-        switch (read_line_int_from((CONF_CONFIG_PATH "system/idle_inhibit"), 1)) {
+        switch (read_idle_inhibit()) {
             case IDLE_INHIBIT_BOTH:
                 idle_display.tick = global_tick;
                 // fallthrough
@@ -375,8 +379,8 @@ static void parse_sequence_array(struct json array, combo_config *c) {
     int count = 0;
 
     for (struct json input = json_first(array); json_exists(input); input = json_next(input)) {
-        if (count >= MAX_SEQUENCE) {
-            LOG_ERROR("input", "Input sequence '%s' too long (max %d", c->name, MAX_SEQUENCE)
+        if (count >= INPUT_SEQUENCE_MAX) {
+            LOG_ERROR("input", "Input sequence '%s' too long (max %d", c->name, INPUT_SEQUENCE_MAX)
             exit(1);
         }
 
@@ -612,6 +616,9 @@ int main(int argc, char *argv[]) {
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
 
+    // Hotkey commands are launched through the broker rather than forking the daemon each time
+    exec_broker_start();
+
     // Read config and open input devices.
     load_device(&device);
     load_config(&config);
@@ -685,6 +692,8 @@ int main(int argc, char *argv[]) {
         input_opts.combo[i].type_mask = 0;
     }
 
+    compile_sequences();
+
     if (verbose) {
         LOG_INFO("input", "====================================")
         LOG_INFO("input", "Final Sorted Combo Order")
@@ -711,6 +720,8 @@ int main(int argc, char *argv[]) {
     global_tick = mux_tick();
     idle_display.tick = idle_sleep.tick = global_tick;
 
+    idle_inhibit_flag = event_bus_watch(CONF_CONFIG_PATH "system/idle_inhibit");
+
     // Process input and respond to combos indefinitely.
     LOG_INFO("input", "Hotkey daemon ready! Monitoring input events...")
     mux_input_task(&input_opts);
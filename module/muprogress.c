@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "../common/common.h"
+#include "../common/progress_channel.h"
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s progress <0-100> | message <text> | finish\n", name);
+}
+
+// Older muxmessage builds only know the files, so fall back to them when nobody is listening
+static int write_legacy(const char *type, const char *arg) {
+    FILE *file;
+
+    if (strcasecmp(type, "progress") == 0) {
+        file = fopen(PROGRESS_FILE, "w");
+        if (!file) return 0;
+
+        fprintf(file, "%d\n", safe_atoi(arg));
+    } else if (strcasecmp(type, "finish") == 0) {
+        file = fopen(FINISH_FILE, "w");
+        if (!file) return 0;
+    } else {
+        return 0;
+    }
+
+    fclose(file);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const char *type = argv[1];
+    int needs_arg = strcasecmp(type, "progress") == 0 || strcasecmp(type, "message") == 0;
+
+    if ((!needs_arg && strcasecmp(type, "finish") != 0) || (needs_arg && argc < 3)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Everything after the keyword is the message, so scripts do not have to quote it
+    char record[PROGRESS_RECORD_SIZE];
+    size_t used = (size_t) snprintf(record, sizeof(record), "%s", type);
+
+    for (int i = 2; i < argc && used < sizeof(record); i++) {
+        used += (size_t) snprintf(record + used, sizeof(record) - used, " %s", argv[i]);
+    }
+
+    if (progress_channel_send(record)) return 0;
+
+    return write_legacy(type, argc > 2 ? argv[2] : "") ? 0 : 1;
+}
@@ -1,4 +1,5 @@
 #include "muxshare.h"
+#include "../common/manifest.h"
 
 typedef struct {
     char *name;
@@ -22,7 +23,8 @@ static mux_apps app[] = {
         {"Task Toolkit",    "task",    "Toolkit", "", flag_task},
 };
 
-const char *app_paths[3];
+static char app_bases[3][MAX_BUFFER_SIZE];
+static manifest *app_manifests[3];
 
 static inline mux_apps *get_mux_app(const char *name) {
     if (!name) return NULL;
@@ -34,29 +36,44 @@ static inline mux_apps *get_mux_app(const char *name) {
     return NULL;
 }
 
-static int get_app_base(char *out_base, const char *app_name) {
-    for (size_t ab = 0; ab < 3; ab++) {
+static void load_app_manifests(void) {
+    const char *app_paths[] = {OPT_SHARE_PATH "application", device.STORAGE.SDCARD.MOUNT, device.STORAGE.ROM.MOUNT};
+
+    for (size_t ab = 0; ab < A_SIZE(app_paths); ab++) {
+        app_bases[ab][0] = '\0';
         if (!app_paths[ab] || app_paths[ab][0] == '\0') continue;
 
-        char app_base[MAX_BUFFER_SIZE];
         if (!ab) {
-            snprintf(app_base, sizeof(app_base), "%s",
+            snprintf(app_bases[ab], sizeof(app_bases[ab]), "%s",
                      app_paths[ab]);
         } else {
-            snprintf(app_base, sizeof(app_base), "%s/%s",
+            snprintf(app_bases[ab], sizeof(app_bases[ab]), "%s/%s",
                      app_paths[ab], MUOS_APPS_PATH);
         }
 
-        char launcher[MAX_BUFFER_SIZE];
-        snprintf(launcher, sizeof(launcher), "%s/%s/" APP_LAUNCHER, app_base, app_name);
+        app_manifests[ab] = manifest_load(app_bases[ab], MANIFEST_APPS);
+    }
+}
+
+static void free_app_manifests(void) {
+    for (size_t ab = 0; ab < A_SIZE(app_manifests); ab++) {
+        manifest_free(app_manifests[ab]);
+        app_manifests[ab] = NULL;
+    }
+}
 
-        if (access(launcher, F_OK) == 0) {
-            snprintf(out_base, MAX_BUFFER_SIZE, "%s", app_base);
+// The first application base with a launcher wins, same order the folders are listed in
+static int get_app_base(char *out_base, const char *app_name, const manifest **out_manifest, manifest_item *item) {
+    for (size_t ab = 0; ab < A_SIZE(app_manifests); ab++) {
+        if (manifest_find(app_manifests[ab], app_name, item)) {
+            snprintf(out_base, MAX_BUFFER_SIZE, "%s", app_bases[ab]);
+            *out_manifest = app_manifests[ab];
             return 0;
         }
     }
 
     snprintf(out_base, MAX_BUFFER_SIZE, "%s/%s", device.STORAGE.ROM.MOUNT, MUOS_APPS_PATH);
+    *out_manifest = NULL;
     return -1;
 }
 
@@ -70,27 +87,21 @@ static void show_help(void) {
                  mux_app->help);
         show_info_box(TS(items[current_item_index].name), TS(message), 0);
     } else {
-        char app_lang_file[FILENAME_MAX];
-        snprintf(app_lang_file, sizeof(app_lang_file), "%s/" APP_LANGUAGE, items[current_item_index].extra_data);
-
-        char app_help[MAX_BUFFER_SIZE];
-        if (file_exist(app_lang_file)) {
-            LOG_SUCCESS(mux_module, "Loading Application Translation: %s", app_lang_file)
-
-            mini_t *app_lang = mini_load(app_lang_file);
-
-            strncpy(app_help, get_ini_string(app_lang, "help", config.SETTINGS.GENERAL.LANGUAGE,
-                                             TS(lang.GENERIC.NO_HELP)), sizeof(app_help));
-            app_help[sizeof(app_help) - 1] = '\0';
+        char app_base[MAX_BUFFER_SIZE];
+        const manifest *app_manifest;
+        manifest_item app_item;
 
-            mini_free(app_lang);
+        const char *app_help = NULL;
+        if (get_app_base(app_base, item_name, &app_manifest, &app_item) == 0 && app_item.translated) {
+            app_help = manifest_translation(app_manifest, &app_item, MANIFEST_HELP, config.SETTINGS.GENERAL.LANGUAGE);
+            if (!app_help) app_help = TS(lang.GENERIC.NO_HELP);
         } else {
-            LOG_WARN(mux_module, "No Application Translation Found: %s", app_lang_file)
-            snprintf(app_help, sizeof(app_help), "%s",
-                     lang.GENERIC.NO_HELP);
+            LOG_WARN(mux_module, "No Application Translation Found: %s/" APP_LANGUAGE,
+                     items[current_item_index].extra_data)
+            app_help = lang.GENERIC.NO_HELP;
         }
 
-        show_info_box(TS(items[current_item_index].name), app_help, 0);
+        show_info_box(TS(items[current_item_index].name), (char *) app_help, 0);
     }
 }
 
@@ -145,47 +156,20 @@ static int append_mux_app(char ***arr, size_t *count, const char *name) {
 }
 
 static void create_app_items(void) {
-    struct dirent *entry;
-
     char **dir_names = NULL;
     size_t dir_count = 0;
 
-    app_paths[0] = OPT_SHARE_PATH "application";
-    app_paths[1] = device.STORAGE.SDCARD.MOUNT;
-    app_paths[2] = device.STORAGE.ROM.MOUNT;
+    load_app_manifests();
 
-    for (size_t ap = 0; ap < 3; ap++) {
-        if (!app_paths[ap] || app_paths[ap][0] == '\0') continue;
+    for (size_t ab = 0; ab < A_SIZE(app_manifests); ab++) {
+        manifest_item app_item;
 
-        char apps_base[MAX_BUFFER_SIZE];
-        if (!ap) {
-            snprintf(apps_base, sizeof(apps_base), "%s",
-                     app_paths[ap]);
-        } else {
-            snprintf(apps_base, sizeof(apps_base), "%s/%s",
-                     app_paths[ap], MUOS_APPS_PATH);
-        }
-
-        DIR *app_dir = opendir(apps_base);
-        if (!app_dir) continue;
-
-        while ((entry = readdir(app_dir))) {
-            if (entry->d_type != DT_DIR) continue;
-            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
-
-            char launch_script[MAX_BUFFER_SIZE];
-            snprintf(launch_script, sizeof(launch_script), "%s/%s/" APP_LAUNCHER,
-                     apps_base, entry->d_name);
-
-            if (access(launch_script, F_OK) == 0) {
-                if (append_mux_app(&dir_names, &dir_count, entry->d_name) < 0) {
-                    LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
-                    closedir(app_dir);
-                    goto clean_up;
-                }
+        for (size_t i = 0; manifest_item_at(app_manifests[ab], i, &app_item); i++) {
+            if (append_mux_app(&dir_names, &dir_count, app_item.name) < 0) {
+                LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
+                goto clean_up;
             }
         }
-        closedir(app_dir);
     }
 
     for (size_t i = 0; i < A_SIZE(app); i++) {
@@ -205,15 +189,13 @@ static void create_app_items(void) {
         if (!dir_names[i]) continue;
 
         char resolved_base[MAX_BUFFER_SIZE];
-        get_app_base(resolved_base, dir_names[i]);
+        const manifest *app_manifest;
+        manifest_item app_item;
+        bool has_launcher = get_app_base(resolved_base, dir_names[i], &app_manifest, &app_item) == 0;
 
         char app_folder[MAX_BUFFER_SIZE];
         snprintf(app_folder, sizeof(app_folder), "%s/%s", resolved_base, dir_names[i]);
 
-        char app_launcher[MAX_BUFFER_SIZE];
-        snprintf(app_launcher, sizeof(app_launcher), "%s/%s/" APP_LAUNCHER,
-                 resolved_base, dir_names[i]);
-
         mux_apps *mux_app = get_mux_app(dir_names[i]);
 
         char full_app_name[MAX_BUFFER_SIZE];
@@ -221,36 +203,24 @@ static void create_app_items(void) {
         if (mux_app && mux_app->grid) {
             snprintf(full_app_name, sizeof(full_app_name), "%s", TS(dir_names[i]));
             snprintf(grid_app_name, sizeof(grid_app_name), "%s", TS(mux_app->grid));
+        } else if (has_launcher && app_item.translated) {
+            const char *language = config.SETTINGS.GENERAL.LANGUAGE;
+            const char *full = manifest_translation(app_manifest, &app_item, MANIFEST_FULL, language);
+            const char *grid = manifest_translation(app_manifest, &app_item, MANIFEST_GRID, language);
+
+            snprintf(full_app_name, sizeof(full_app_name), "%s", full ? full : TS(dir_names[i]));
+            snprintf(grid_app_name, sizeof(grid_app_name), "%s", grid ? grid : TS(dir_names[i]));
         } else {
-            char app_lang_file[FILENAME_MAX];
-            snprintf(app_lang_file, sizeof(app_lang_file), "%s/%s/" APP_LANGUAGE,
-                     resolved_base, dir_names[i]);
-
-            if (file_exist(app_lang_file)) {
-                LOG_SUCCESS(mux_module, "Loading Application Translation: %s", app_lang_file)
-
-                mini_t *app_lang = mini_load(app_lang_file);
-                snprintf(full_app_name, sizeof(full_app_name), "%s",
-                         get_ini_string(app_lang, "full", config.SETTINGS.GENERAL.LANGUAGE, TS(dir_names[i])));
-                snprintf(grid_app_name, sizeof(grid_app_name), "%s",
-                         get_ini_string(app_lang, "grid", config.SETTINGS.GENERAL.LANGUAGE, TS(dir_names[i])));
-
-                mini_free(app_lang);
-            } else {
-                LOG_WARN(mux_module, "No Application Translation Found: %s", app_lang_file)
-                snprintf(full_app_name, sizeof(full_app_name), "%s", TS(dir_names[i]));
-                char *from_script = get_script_value(app_launcher, "GRID", dir_names[i]);
-                snprintf(grid_app_name, sizeof(grid_app_name), "%s", from_script ? from_script : dir_names[i]);
-            }
+            snprintf(full_app_name, sizeof(full_app_name), "%s", TS(dir_names[i]));
+            snprintf(grid_app_name, sizeof(grid_app_name), "%s",
+                     has_launcher && app_item.grid[0] ? app_item.grid : dir_names[i]);
         }
 
-        const char *glyph_name = NULL;
+        const char *glyph_name = "app";
         if (mux_app && mux_app->icon) {
             glyph_name = mux_app->icon;
-        } else {
-            char app_launcher_icon[MAX_BUFFER_SIZE];
-            snprintf(app_launcher_icon, sizeof(app_launcher_icon), "%s/" APP_LAUNCHER, app_folder);
-            glyph_name = get_script_value(app_launcher_icon, "ICON", "app");
+        } else if (has_launcher && app_item.icon[0]) {
+            glyph_name = app_item.icon;
         }
 
         content_item *new_item = add_item(&items, &item_count, full_app_name,
@@ -543,6 +513,7 @@ int muxapp_main(void) {
     mux_input_task(&input_opts);
 
     free_items(&items, &item_count);
+    free_app_manifests();
 
     return 0;
 }
@@ -1,5 +1,9 @@
 #include "muxshare.h"
 #include "ui/ui_muxcollect.h"
+#include "../common/virtual_list.h"
+#include "../common/friendly_name.h"
+#include "../common/image_prefetch.h"
+#include "../common/catalogue_index.h"
 
 static lv_obj_t *ui_imgSplash;
 static lv_obj_t *ui_viewport_objects[7];
@@ -14,6 +18,7 @@ static int file_count = 0;
 static int dir_count = 0;
 static int starter_image = 0;
 static int splash_valid = 0;
+static virtual_list collection_list;
 
 static char current_meta_text[MAX_BUFFER_SIZE];
 static char current_content_label[MAX_BUFFER_SIZE];
@@ -49,44 +54,71 @@ static char *load_content_description(void) {
     return lang.GENERIC.NO_INFO;
 }
 
-static void image_refresh(char *image_type) {
-    if (strcasecmp(image_type, "box") == 0 && config.VISUAL.BOX_ART == 8) return;
-
-    char *item_dir = strip_dir(items[current_item_index].extra_data);
-    char *item_file_name = get_last_dir(strdup(items[current_item_index].extra_data));
+static void resolve_image(int index, const char *image_type, char *image, size_t image_size,
+                          char *core_artwork, size_t core_artwork_size, char *file_name, size_t file_name_size) {
+    char *item_dir = strip_dir(items[index].extra_data);
+    char *item_file_name = strdup(items[index].extra_data);
 
     char core_desc[MAX_BUFFER_SIZE];
-    get_catalogue_name(item_dir, item_file_name, core_desc, sizeof(core_desc));
+    get_catalogue_name(item_dir, get_last_dir(item_file_name), core_desc, sizeof(core_desc));
 
-    char image[MAX_BUFFER_SIZE];
-    char image_path[MAX_BUFFER_SIZE];
-
-    char *h_file_name = items[current_item_index].content_type == FOLDER
-                        ? items[current_item_index].name
-                        : strip_ext(item_file_name);
+    if (items[index].content_type == FOLDER) {
+        snprintf(file_name, file_name_size, "%s", items[index].name);
+        snprintf(core_artwork, core_artwork_size, "Collection");
+    } else {
+        char *stripped_name = strip_ext(get_last_dir(item_file_name));
+        snprintf(file_name, file_name_size, "%s", stripped_name);
+        snprintf(core_artwork, core_artwork_size, "%s", core_desc);
+        free(stripped_name);
+    }
 
-    char *h_core_artwork = items[current_item_index].content_type == FOLDER
-                           ? "Collection"
-                           : core_desc;
+    image[0] = '\0';
 
-    if (strlen(h_core_artwork) <= 1) {
-        snprintf(image, sizeof(image), "%s/%simage/none_%s.png",
+    if (strlen(core_artwork) <= 1) {
+        snprintf(image, image_size, "%s/%simage/none_%s.png",
                  STORAGE_THEME, mux_dimension, image_type);
-        if (!file_exist(image)) {
-            snprintf(image, sizeof(image), "%s/image/none_%s.png",
+        if (!catalogue_index_file_exists(image)) {
+            snprintf(image, image_size, "%s/image/none_%s.png",
                      STORAGE_THEME, image_type);
         }
     } else {
         if (strcasecmp(image_type, "box") != 0 || !grid_mode_enabled || !config.VISUAL.BOX_ART_HIDE) {
-            load_image_catalogue(h_core_artwork, h_file_name, "", "default",
-                                 mux_dimension, image_type, image, sizeof(image));
+            load_image_catalogue(core_artwork, file_name, "", "default",
+                                 mux_dimension, image_type, image, image_size);
         }
 
         if (strcasecmp(image_type, "splash") == 0 && !file_exist(image)) {
-            load_splash_image_fallback(mux_dimension, image, sizeof(image));
+            load_splash_image_fallback(mux_dimension, image, image_size);
         }
     }
 
+    free(item_file_name);
+    free(item_dir);
+}
+
+// Called from the artwork prefetch thread, only reads the item list
+static int resolve_artwork(int index, const char *image_type, char *image, size_t image_size) {
+    if (strcasecmp(image_type, "box") == 0 && config.VISUAL.BOX_ART == 8) return 0;
+
+    char core_artwork[MAX_BUFFER_SIZE];
+    char file_name[MAX_BUFFER_SIZE];
+    resolve_image(index, image_type, image, image_size, core_artwork, sizeof(core_artwork),
+                  file_name, sizeof(file_name));
+
+    return image[0] != '\0';
+}
+
+static void image_refresh(char *image_type) {
+    if (strcasecmp(image_type, "box") == 0 && config.VISUAL.BOX_ART == 8) return;
+
+    char image[MAX_BUFFER_SIZE];
+    char image_path[MAX_BUFFER_SIZE];
+    char h_core_artwork[MAX_BUFFER_SIZE];
+    char h_file_name[MAX_BUFFER_SIZE];
+
+    resolve_image(current_item_index, image_type, image, sizeof(image), h_core_artwork, sizeof(h_core_artwork),
+                  h_file_name, sizeof(h_file_name));
+
     LOG_INFO(mux_module, "Loading '%s' Artwork: %s", image_type, image)
 
     if (strcasecmp(image_type, "preview") == 0) {
@@ -134,10 +166,10 @@ static void image_refresh(char *image_type) {
             } else {
                 if (file_exist(image)) {
                     starter_image = 1;
-                    snprintf(image_path, sizeof(image_path), "M:%s", image);
-                    lv_img_set_src(ui_imgBox, image_path);
+                    image_prefetch_set_src(ui_imgBox, image);
                     snprintf(box_image_previous_path, sizeof(box_image_previous_path), "%s", image);
                 } else {
+                    image_prefetch_release(ui_imgBox);
                     lv_img_set_src(ui_imgBox, &ui_image_Nothing);
                     snprintf(box_image_previous_path, sizeof(box_image_previous_path), " ");
                 }
@@ -223,35 +255,10 @@ static void gen_item(int file_count, char **file_names, char **last_dirs) {
         snprintf(init_meta_dir, sizeof(init_meta_dir), INFO_COR_PATH "/%s/", sub_path);
         create_directories(init_meta_dir);
 
-        char custom_lookup[MAX_BUFFER_SIZE];
-        snprintf(custom_lookup, sizeof(custom_lookup), INFO_NAM_PATH "/%s.json", last_dirs[i]);
-        if (!file_exist(custom_lookup)) snprintf(custom_lookup, sizeof(custom_lookup), INFO_NAM_PATH "/global.json");
-
-        int fn_valid = 0;
-        struct json fn_json;
-
-        if (file_exist(custom_lookup)) {
-            char *lookup_content = read_all_char_from(custom_lookup);
-
-            if (lookup_content && json_valid(lookup_content)) {
-                fn_valid = 1;
-                fn_json = json_parse(read_all_char_from(custom_lookup));
-                LOG_SUCCESS(mux_module, "Using Friendly Name: %s", custom_lookup)
-            } else {
-                LOG_WARN(mux_module, "Invalid Friendly Name: %s", custom_lookup)
-            }
-
-            free(lookup_content);
-        } else {
-            LOG_WARN(mux_module, "Friendly Name does not exist: %s", custom_lookup)
-        }
-
-        if (fn_valid) {
-            struct json custom_lookup_json = json_object_get(fn_json, str_tolower(stripped_name));
-            if (json_exists(custom_lookup_json)) {
-                json_string_copy(custom_lookup_json, fn_name, sizeof(fn_name));
-                has_custom_name = 1;
-            }
+        const char *friendly_name = friendly_name_lookup(last_dirs[i], stripped_name);
+        if (friendly_name) {
+            snprintf(fn_name, sizeof(fn_name), "%s", friendly_name);
+            has_custom_name = 1;
         }
 
         int lookup_line = CONTENT_LOOKUP;
@@ -279,10 +286,11 @@ static void gen_item(int file_count, char **file_names, char **last_dirs) {
     if (grid_mode_enabled) return;
 
     for (size_t i = 0; i < item_count; i++) {
-        if (items[i].content_type == ITEM) {
-            gen_label(mux_module, "collection", items[i].display_name);
-        }
+        items[i].glyph_icon = (items[i].content_type == FOLDER) ? "folder" : "collection";
     }
+
+    virtual_list_init(&collection_list, ui_pnlContent, ui_group, ui_group_glyph, ui_group_panel,
+                      items, (int) item_count, mux_module, "collection", NULL);
 }
 
 static void init_navigation_group_grid(void) {
@@ -372,7 +380,6 @@ static void create_collection_items(void) {
                             );
         if (!grid_mode_enabled) {
             for (int i = 0; i < dir_count; i++) {
-                gen_label(mux_module, "folder", items[i].display_name);
                 if (strcasecmp(items[i].name, prev_dir) == 0) sys_index = i;
             }
         }
@@ -411,24 +418,24 @@ static void list_nav_move(int steps, int direction) {
             current_item_index = (current_item_index == ui_count - 1) ? 0 : current_item_index + 1;
         }
 
-        if (!is_carousel_grid_mode()) {
-            nav_move(ui_group, direction);
-            nav_move(ui_group_glyph, direction);
-            nav_move(ui_group_panel, direction);
-        }
+        if (grid_mode_enabled) {
+            if (!is_carousel_grid_mode()) {
+                nav_move(ui_group, direction);
+                nav_move(ui_group_glyph, direction);
+                nav_move(ui_group_panel, direction);
+            }
 
-        if (grid_mode_enabled) update_grid(direction);
+            update_grid(direction);
+        }
     }
 
-    if (!grid_mode_enabled) {
-        update_scroll_position(theme.MUX.ITEM.COUNT, theme.MUX.ITEM.PANEL, ui_count,
-                               current_item_index, ui_pnlContent);
-    }
+    if (!grid_mode_enabled) virtual_list_focus(&collection_list, current_item_index);
 
     if (!grid_mode_enabled) set_label_long_mode(&theme, lv_group_get_focused(ui_group));
     lv_label_set_text(ui_lblGridCurrentItem, items[current_item_index].display_name);
 
     image_refresh("box");
+    image_prefetch_around(current_item_index, ui_count, "box");
     update_footer_glyph();
     nav_moved = 1;
 }
@@ -917,6 +924,7 @@ int muxcollect_main(int add, char *dir, int last_index) {
 
     create_collection_items();
     init_elements();
+    image_prefetch_start(resolve_artwork);
 
     ui_count = (int) item_count;
 
@@ -931,6 +939,7 @@ int muxcollect_main(int add, char *dir, int last_index) {
             list_nav_move(sys_index, +1);
         } else {
             image_refresh("box");
+            image_prefetch_around(current_item_index, ui_count, "box");
         }
         nav_moved = 1;
     } else {
@@ -1047,6 +1056,8 @@ int muxcollect_main(int add, char *dir, int last_index) {
     register_key_event_callback(on_key_event);
     mux_input_task(&input_opts);
 
+    image_prefetch_stop();
+    virtual_list_free(&collection_list);
     free_items(&items, &item_count);
 
     return exit_status;
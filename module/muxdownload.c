@@ -32,19 +32,20 @@ static void create_content_items(void) {
 
     struct json fn_json = json_parse(json_str);
 
-    size_t count = json_array_count(fn_json);
+    static const char *const item_keys[] = {"name", "url", "help"};
+    struct json item_values[A_SIZE(item_keys)];
 
-    for (int i = 0; i < count; i++) {
-        struct json item = json_array_get(fn_json, i);
+    json_array_each(item, fn_json) {
+        json_object_pick(item, item_keys, item_values, A_SIZE(item_keys));
 
         char name[MAX_BUFFER_SIZE];
-        json_string_copy(json_object_get(item, "name"), name, sizeof(name));
+        json_string_copy(item_values[0], name, sizeof(name));
 
         char url[MAX_BUFFER_SIZE];
-        json_string_copy(json_object_get(item, "url"), url, sizeof(url));
+        json_string_copy(item_values[1], url, sizeof(url));
 
         char help[MAX_BUFFER_SIZE];
-        json_string_copy(json_object_get(item, "help"), help, sizeof(help));
+        json_string_copy(item_values[2], help, sizeof(help));
 
         content_item *new_item = add_item(&items, &item_count, name, name, url, ITEM);
         new_item->help = strdup(help);
@@ -2,11 +2,18 @@
 #include <sys/prctl.h>
 
 #include "muxshare.h"
+#include "../common/event_bus.h"
+#include "../common/exec_broker.h"
+#include "../common/screen_cache.h"
+#include "../common/screen_preload.h"
+#include "../common/text_file.h"
 #include "../lvgl/src/drivers/display/sdl.h"
 
 static volatile sig_atomic_t quit_signal = 0;
 static volatile sig_atomic_t shutting_down = 0;
 
+static int safe_quit_flag = -1;
+
 int first_boot = 1;
 
 static int last_index = 0;
@@ -33,6 +40,7 @@ typedef struct {
 
 static void on_signal(int sig) {
     quit_signal = sig ? sig : 1;
+    event_bus_wake();
 }
 
 static void install_signal_handlers(void) {
@@ -65,6 +73,9 @@ static void cleanup_screen(void) {
         ui_screen_container = NULL;
     }
 
+    // Nothing on screen holds a font, wallpaper or theme now so the cache can shrink back to its budget
+    screen_cache_trim();
+
     current_item_index = 0;
     first_open = 1;
     key_curr = 0;
@@ -84,7 +95,7 @@ static void quit_watchdog(lv_timer_t *t) {
 
     if (shutting_down) return;
 
-    if (file_exist(SAFE_QUIT) || quit_signal) {
+    if (quit_signal || event_bus_exists(safe_quit_flag)) {
         LOG_DEBUG("muxfrontend", "Signal %d received, requesting safe quit...", (int) quit_signal)
         shutting_down = 1;
 
@@ -95,15 +106,25 @@ static void quit_watchdog(lv_timer_t *t) {
     }
 }
 
+static void copy_action_line(const TextFile *tf, size_t line_number, char *dest, size_t dest_size) {
+    TextLine line;
+    if (!text_file_line(tf, line_number, &line)) line = (TextLine) {"", 0};
+
+    snprintf(dest, dest_size, "%.*s", (int) line.length, line.data);
+}
+
 static void process_action(char *action, char *module) {
-    if (!file_exist(action)) return;
+    TextFile *tf = text_file_load(action);
+    if (!tf) return;
+
+    copy_action_line(tf, 1, rom_name, sizeof(rom_name));
+    copy_action_line(tf, 2, rom_dir, sizeof(rom_dir));
+    copy_action_line(tf, 3, rom_sys, sizeof(rom_sys));
 
-    snprintf(rom_name, sizeof(rom_name), "%s", read_line_char_from(action, 1));
-    snprintf(rom_dir, sizeof(rom_dir), "%s", read_line_char_from(action, 2));
-    snprintf(rom_sys, sizeof(rom_sys), "%s", read_line_char_from(action, 3));
+    forced_flag = text_file_line_int(tf, 4, 0);
+    is_app = text_file_line_int(tf, 5, 0);
 
-    forced_flag = read_line_int_from(action, 4);
-    is_app = read_line_int_from(action, 5);
+    text_file_release(tf);
 
     remove(action);
     if (!is_app) load_mux(forced_flag ? "option" : module);
@@ -146,9 +167,19 @@ static int set_alert_image_path(void) {
     return 0;
 }
 
+static void preload_explore(void) {
+    char *explore_dir = file_exist(EXPLORE_DIR) ? read_line_char_from(EXPLORE_DIR, 1) : "";
+    screen_preload_schedule("muxplore", strcmp(explore_dir, "") == 0 ? STORAGE_PATH : explore_dir);
+}
+
 static void exec_mux(char *goback, char *module, int (*func_to_exec)(void)) {
     LOG_DEBUG("muxfrontend", "GOBACK: %s | MODULE: %s", goback, module)
 
+    screen_preload_claim(module, NULL);
+
+    // The launcher almost always leads into explore
+    if (strcmp(module, "muxlaunch") == 0) preload_explore();
+
     load_mux(goback);
     func_to_exec();
     set_previous_module(module);
@@ -185,6 +216,8 @@ static void module_explore(void) {
     last_index_check();
 
     char *explore_dir = read_line_char_from(EXPLORE_DIR, 1);
+    screen_preload_claim("muxplore", strcmp(explore_dir, "") == 0 ? STORAGE_PATH : explore_dir);
+
     muxassign_main(1, rom_name, explore_dir, "none", 0);
     muxgov_main(1, rom_name, explore_dir, "none", 0);
     muxcontrol_main(1, rom_name, explore_dir, "none", 0);
@@ -470,17 +503,30 @@ int main(void) {
     // Close the stupid race where the parent already died before the prctl call or we get a segfault...
     if (getppid() == 1) raise(SIGTERM);
 
+    // Started while the process is still small, everything run_exec launches goes through it
+    exec_broker_start();
+
     load_device(&device);
     load_config(&config);
     load_kiosk(&kiosk);
 
     LOG_SUCCESS("hello", "Welcome to the %s - %s (%s)", MUX_CALLER, get_version(), get_build())
 
+    // Keeps the content catalogue current for search and random play, it leaves once we are gone
+    char frontend_pid[16];
+    snprintf(frontend_pid, sizeof(frontend_pid), "%d", (int) getpid());
+
+    const char *catalogue_args[] = {OPT_PATH "frontend/mucatalogue", "watch", frontend_pid, NULL};
+    run_exec(catalogue_args, A_SIZE(catalogue_args), 1, 0, NULL, NULL);
+
     // For future reference we need to initialise the theme before we do the display
     // as we call upon the theme variables for specific settings within display init
     init_theme(0, 0);
     init_display(0);
 
+    screen_preload_start();
+
+    safe_quit_flag = event_bus_watch(SAFE_QUIT);
     lv_timer_create(quit_watchdog, 100, NULL);
 
     reset_alert();
@@ -503,7 +549,8 @@ int main(void) {
     }
 
     while (1) {
-        if (file_exist(SAFE_QUIT)) {
+        event_bus_poll();
+        if (event_bus_exists(safe_quit_flag)) {
             LOG_DEBUG("muxfrontend", "Safe Quit Detected... exiting!")
             break;
         }
@@ -554,8 +601,10 @@ int main(void) {
             }
 
             int go_mux = 0;
+            char *action = read_line_char_from(MUOS_ACT_LOAD, 1);
+
             for (size_t i = 0; modules[i].action != NULL; ++i) {
-                if (strcmp(read_line_char_from(MUOS_ACT_LOAD, 1), modules[i].action) == 0) {
+                if (strcmp(action, modules[i].action) == 0) {
                     modules[i].mux_func
                     ? modules[i].mux_func()
                     : exec_mux(modules[i].goback, modules[i].module, modules[i].mux_main);
@@ -573,6 +622,7 @@ int main(void) {
     }
 
     cleanup_screen();
+    screen_preload_stop();
     sdl_cleanup();
 
     return 0;
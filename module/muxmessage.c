@@ -1,13 +1,21 @@
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include "muxshare.h"
 #include "ui/ui_muxmessage.h"
 #include "../lvgl/src/drivers/display/sdl.h"
-
-#define FINISH_FILE   "/tmp/msg_finish"
-#define PROGRESS_FILE "/tmp/msg_progress"
+#include "../common/event_bus.h"
+#include "../common/progress_channel.h"
 
 char **messages = NULL;
 int message_count = 0;
 
+static int epoll_fd = -1;
+static int channel_fd = -1;
+static int timer_fd = -1;
+
+static int progress_flag = -1;
+static uint32_t progress_generation = 0;
+
 char *parse_newline(const char *input) {
     static char buffer[MAX_BUFFER_SIZE];
     size_t j = 0;
@@ -61,6 +69,103 @@ void load_messages(const char *filename) {
     fclose(file);
 }
 
+static void init_updates(int delay) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    channel_fd = progress_channel_open();
+    progress_flag = event_bus_watch(PROGRESS_FILE);
+
+    if (delay > 0) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+        if (timer_fd >= 0) {
+            struct itimerspec interval = {
+                    .it_interval = {.tv_sec = delay},
+                    .it_value = {.tv_sec = delay},
+            };
+            timerfd_settime(timer_fd, 0, &interval, NULL);
+        }
+    }
+
+    if (epoll_fd < 0) return;
+
+    int fds[] = {channel_fd, event_bus_fd(), timer_fd};
+    for (size_t i = 0; i < A_SIZE(fds); i++) {
+        if (fds[i] < 0) continue;
+
+        struct epoll_event ev = {.events = EPOLLIN, .data.fd = fds[i]};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fds[i], &ev);
+    }
+}
+
+static void free_updates(void) {
+    progress_channel_close(channel_fd);
+
+    if (timer_fd >= 0) close(timer_fd);
+    if (epoll_fd >= 0) close(epoll_fd);
+}
+
+// Blocks until a script reports something, returns 1 once the message rotation is due
+static int wait_for_update(int flag, int delay) {
+    // Anything inotify cannot see is polled once a second as it always was
+    int timeout = event_bus_watched(flag) && event_bus_watched(progress_flag) ? -1 : 1000;
+    if (delay > 0 && timer_fd < 0) timeout = delay * 1000;
+
+    if (epoll_fd < 0) {
+        sleep(timeout < 0 ? 1 : timeout / 1000);
+        return delay > 0;
+    }
+
+    struct epoll_event events[4];
+    int count = epoll_wait(epoll_fd, events, A_SIZE(events), timeout);
+
+    if (count == 0) return delay > 0 && timer_fd < 0;
+
+    int rotate = 0;
+    for (int i = 0; i < count; i++) {
+        if (events[i].data.fd == event_bus_fd()) {
+            event_bus_dispatch();
+        } else if (events[i].data.fd == timer_fd) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) > 0) rotate = 1;
+        }
+    }
+
+    return rotate;
+}
+
+static void update_progress_file(void) {
+    uint32_t generation = event_bus_generation(progress_flag);
+    if (generation == progress_generation) return;
+
+    progress_generation = generation;
+
+    if (event_bus_exists(progress_flag)) {
+        lv_bar_set_value(ui_barProgress, read_line_int_from(PROGRESS_FILE, 1), LV_ANIM_OFF);
+    }
+}
+
+// Applies everything queued on the progress channel, returns 0 once a script has finished
+static int update_progress_channel(void) {
+    progress_record record;
+
+    while (progress_channel_read(channel_fd, &record)) {
+        switch (record.type) {
+            case PROGRESS_VALUE:
+                lv_bar_set_value(ui_barProgress, record.value, LV_ANIM_OFF);
+                break;
+            case PROGRESS_MESSAGE:
+                lv_label_set_text(ui_lblMessage, parse_newline(record.message));
+                break;
+            case PROGRESS_FINISH:
+                return 0;
+            default:
+                break;
+        }
+    }
+
+    return 1;
+}
+
 int main(int argc, char *argv[]) {
     char *default_message = NULL;
     char *live_file = NULL;
@@ -130,37 +235,53 @@ int main(int argc, char *argv[]) {
     free(ext);
 
     if (live_file) {
-        while (file_exist(live_file)) {
-            struct stat st;
+        init_updates(0);
 
-            if (stat(live_file, &st) == 0) {
-                lv_label_set_text_fmt(ui_lblMessage, "%s",
-                                      parse_newline(read_line_char_from(live_file, 1)));
-            }
+        int live_flag = event_bus_watch(live_file);
+        uint32_t live_generation = 0;
+
+        while (event_bus_exists(live_flag)) {
+            uint32_t generation = event_bus_generation(live_flag);
+
+            if (generation != live_generation) {
+                live_generation = generation;
 
-            if (file_exist(PROGRESS_FILE)) {
-                lv_bar_set_value(ui_barProgress, read_line_int_from(PROGRESS_FILE, 1), LV_ANIM_OFF);
+                const char *line = read_line_char_from(live_file, 1);
+                if (line) lv_label_set_text_fmt(ui_lblMessage, "%s", parse_newline(line));
             }
 
+            update_progress_file();
+            if (!update_progress_channel()) break;
+
             refresh_screen(ui_scrMessage);
-            sleep(1);
+            wait_for_update(live_flag, 0);
         }
+
+        free_updates();
     } else if (is_message_file && delay > 0) {
         load_messages(default_message);
         srandom((unsigned int) (time(NULL)));
 
-        while (!file_exist(FINISH_FILE)) {
-            int index = (int) (1 + (random() % (message_count - 1)));
-            lv_label_set_text_fmt(ui_lblMessage, "%s\n\n%s", messages[0], messages[index]);
+        init_updates(delay);
+
+        int finish_flag = event_bus_watch(FINISH_FILE);
+        int rotate = 1;
 
-            if (file_exist(PROGRESS_FILE)) {
-                lv_bar_set_value(ui_barProgress, read_line_int_from(PROGRESS_FILE, 1), LV_ANIM_OFF);
+        while (!event_bus_exists(finish_flag)) {
+            if (rotate) {
+                int index = (int) (1 + (random() % (message_count - 1)));
+                lv_label_set_text_fmt(ui_lblMessage, "%s\n\n%s", messages[0], messages[index]);
             }
 
+            update_progress_file();
+            if (!update_progress_channel()) break;
+
             refresh_screen(ui_scrMessage);
-            sleep(delay);
+            rotate = wait_for_update(finish_flag, delay);
         }
 
+        free_updates();
+
         for (int i = 0; i < message_count; i++) free(messages[i]);
         free(messages);
     } else {
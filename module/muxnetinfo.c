@@ -33,14 +33,10 @@ static const char *get_hostname(void) {
 }
 
 static const char *get_mac_address(void) {
-    char path[128];
-    snprintf(path, sizeof(path), "/sys/class/net/%s/address", device.NETWORK.INTERFACE);
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    char cmd[256];
-    snprintf(cmd, sizeof(cmd), "cat %s", path);
-
-    const char *result = get_execute_result(cmd);
-    if (!result || strlen(result) == 0) {
+    if (strlen(sample.mac) == 0) {
         char *big_mac = (CONF_CONFIG_PATH "network/mac");
         if (file_exist(big_mac)) return read_line_char_from(big_mac, 1);
 
@@ -48,67 +44,68 @@ static const char *get_mac_address(void) {
     }
 
     static char mac[32];
-    snprintf(mac, sizeof(mac), "%s", result);
+    snprintf(mac, sizeof(mac), "%s", sample.mac);
 
     return mac;
 }
 
 static const char *get_ip_address(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
-
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "ip addr show %s | awk '/inet / {print $2}' | cut -d/ -f1", device.NETWORK.INTERFACE);
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    const char *result = get_execute_result(cmd);
-    if (!result || strlen(result) == 0) return lang.GENERIC.UNKNOWN;
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
+    if (strlen(sample.ip) == 0) return lang.GENERIC.UNKNOWN;
 
     static char ip[64];
-    snprintf(ip, sizeof(ip), "%s", result);
+    snprintf(ip, sizeof(ip), "%s", sample.ip);
 
     return ip;
 }
 
 static const char *get_ssid(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "iw dev %s link | awk -F': ' '/SSID/ {print $2}'", device.NETWORK.INTERFACE);
-
-    const char *result = get_execute_result(cmd);
-    if (!result || strlen(result) == 0) return lang.GENERIC.UNKNOWN;
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
+    if (strlen(sample.ssid) == 0) return lang.GENERIC.UNKNOWN;
 
     static char ssid[64];
-    snprintf(ssid, sizeof(ssid), "%s", result);
+    snprintf(ssid, sizeof(ssid), "%s", sample.ssid);
 
     return ssid;
 }
 
 static const char *get_gateway(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    const char *result = get_execute_result("ip route | awk '/default/ {print $3}'");
-    if (!result || strlen(result) == 0) return lang.GENERIC.UNKNOWN;
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
+    if (strlen(sample.gateway) == 0) return lang.GENERIC.UNKNOWN;
 
     static char gw[64];
-    snprintf(gw, sizeof(gw), "%s", result);
+    snprintf(gw, sizeof(gw), "%s", sample.gateway);
 
     return gw;
 }
 
 static const char *get_dns_servers(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    const char *result = get_execute_result("awk '/nameserver/ {print $2}' /etc/resolv.conf | xargs");
-    if (!result || strlen(result) == 0) return lang.GENERIC.UNKNOWN;
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
+    if (strlen(sample.dns) == 0) return lang.GENERIC.UNKNOWN;
 
     static char dns[128];
-    snprintf(dns, sizeof(dns), "%s", result);
+    snprintf(dns, sizeof(dns), "%s", sample.dns);
 
     return dns;
 }
 
 static const char *get_signal_strength(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
+    telemetry_sample sample;
+    telemetry_get(&sample);
+
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
 
     // I think these values are correct?
     // https://www.intuitibits.com/2016/03/23/dbm-to-percent-conversion/
@@ -126,13 +123,9 @@ static const char *get_signal_strength(void) {
             100
     };
 
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "iw dev %s link | awk '/signal/ {print $2}'", device.NETWORK.INTERFACE);
-
-    const char *result = get_execute_result(cmd);
-    if (!result || strlen(result) == 0) return lang.GENERIC.UNKNOWN;
+    if (!sample.has_signal) return lang.GENERIC.UNKNOWN;
 
-    int dbm = safe_atoi(result);
+    int dbm = sample.signal_dbm;
     int index = dbm <= -100 ? 0 : (dbm >= 0 ? 100 : -dbm);
     int percent = dbm_perc[index];
 
@@ -143,15 +136,13 @@ static const char *get_signal_strength(void) {
 }
 
 static const char *get_channel_info(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    char cmd[128];
-    snprintf(cmd, sizeof(cmd), "iw dev %s link | awk '/freq:/ {print $2}'", device.NETWORK.INTERFACE);
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
+    if (sample.freq_mhz <= 0) return lang.GENERIC.UNKNOWN;
 
-    const char *result = get_execute_result(cmd);
-    if (!result || strlen(result) == 0) return lang.GENERIC.UNKNOWN;
-
-    int freq = safe_atoi(result);
+    int freq = sample.freq_mhz;
 
     static const struct {
         int freq;
@@ -218,14 +209,13 @@ static const char *get_channel_info(void) {
 }
 
 static const char *get_ac_traffic(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    char rx_path[128], tx_path[128];
-    snprintf(rx_path, sizeof(rx_path), "/sys/class/net/%s/statistics/rx_bytes", device.NETWORK.INTERFACE);
-    snprintf(tx_path, sizeof(tx_path), "/sys/class/net/%s/statistics/tx_bytes", device.NETWORK.INTERFACE);
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
 
-    unsigned long long rx = read_all_long_from(rx_path);
-    unsigned long long tx = read_all_long_from(tx_path);
+    unsigned long long rx = sample.rx_bytes > 0 ? (unsigned long long) sample.rx_bytes : 0;
+    unsigned long long tx = sample.tx_bytes > 0 ? (unsigned long long) sample.tx_bytes : 0;
 
     static char ac_traffic[64];
     snprintf(ac_traffic, sizeof(ac_traffic), "RX: %.1f MB TX: %.1f MB",
@@ -236,23 +226,28 @@ static const char *get_ac_traffic(void) {
 }
 
 static const char *get_tp_traffic(void) {
-    if (!is_network_connected()) return lang.GENERIC.NOT_CONNECTED;
+    static char tp_traffic[64];
+
+    telemetry_sample sample;
+    telemetry_get(&sample);
+
+    if (!sample.connected) return lang.GENERIC.NOT_CONNECTED;
 
     static unsigned long long last_rx = 0, last_tx = 0;
-    static time_t last_time = 0;
+    static struct timespec last_time = {0, 0};
     double rx_rate = 0, tx_rate = 0;
 
-    char rx_path[128], tx_path[128];
-    snprintf(rx_path, sizeof(rx_path), "/sys/class/net/%s/statistics/rx_bytes", device.NETWORK.INTERFACE);
-    snprintf(tx_path, sizeof(tx_path), "/sys/class/net/%s/statistics/tx_bytes", device.NETWORK.INTERFACE);
+    unsigned long long rx = sample.rx_bytes > 0 ? (unsigned long long) sample.rx_bytes : 0;
+    unsigned long long tx = sample.tx_bytes > 0 ? (unsigned long long) sample.tx_bytes : 0;
 
-    unsigned long long rx = read_all_long_from(rx_path);
-    unsigned long long tx = read_all_long_from(tx_path);
+    // The rate is measured between samples, not between refreshes of the screen
+    if (last_time.tv_sec > 0 || last_time.tv_nsec > 0) {
+        double delta = (double) (sample.taken.tv_sec - last_time.tv_sec) +
+                       (double) (sample.taken.tv_nsec - last_time.tv_nsec) / 1000000000.0;
 
-    time_t now = time(NULL);
-    if (last_time > 0) {
-        double delta = difftime(now, last_time);
-        if (delta > 0) {
+        if (delta <= 0 && tp_traffic[0]) return tp_traffic;
+
+        if (delta > 0 && rx >= last_rx && tx >= last_tx) {
             rx_rate = (double) (rx - last_rx) / delta;
             tx_rate = (double) (tx - last_tx) / delta;
         }
@@ -261,9 +256,8 @@ static const char *get_tp_traffic(void) {
     last_rx = rx;
     last_tx = tx;
 
-    last_time = now;
+    last_time = sample.taken;
 
-    static char tp_traffic[64];
     snprintf(tp_traffic, sizeof(tp_traffic), "RX: %.1f KB/s TX: %.1f KB/s",
              rx_rate / 1024.0, tx_rate / 1024.0);
 
@@ -588,6 +582,8 @@ int muxnetinfo_main(void) {
     load_wallpaper(ui_screen, NULL, ui_pnlWall, ui_imgWall, GENERAL);
 
     init_fonts();
+
+    telemetry_start(TELEMETRY_NETWORK);
     init_navigation_group();
 
     init_osk(ui_pnlEntry_netinfo, ui_txtEntry_netinfo, false);
@@ -628,5 +624,7 @@ int muxnetinfo_main(void) {
     register_key_event_callback(on_key_event);
     mux_input_task(&input_opts);
 
+    telemetry_stop();
+
     return 0;
 }
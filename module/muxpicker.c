@@ -1,8 +1,11 @@
 #include "muxshare.h"
+#include "../common/virtual_list.h"
+#include "../common/catalogue_index.h"
 
 static char base_dir[PATH_MAX];
 static char picker_type[32];
 static char *picker_extension;
+static virtual_list picker_list;
 
 #define TEMP_PREVIEW "preview.png"
 #define TEMP_VERSION "version.txt"
@@ -142,28 +145,17 @@ static void create_picker_items(void) {
     ui_group_panel = lv_group_create();
 
     for (size_t i = 0; i < item_count; i++) {
-        ui_count++;
-
-        lv_obj_t *ui_pnlPicker = lv_obj_create(ui_pnlContent);
-        apply_theme_list_panel(ui_pnlPicker);
-
-        lv_obj_t *ui_lblPickerItem = lv_label_create(ui_pnlPicker);
-        apply_theme_list_item(&theme, ui_lblPickerItem, items[i].display_name);
-
-        lv_obj_t *ui_lblPickerItemGlyph = lv_img_create(ui_pnlPicker);
-        apply_theme_list_glyph(&theme, ui_lblPickerItemGlyph, mux_module,
-                               items[i].content_type == MENU ? "download" :
-                               items[i].content_type == FOLDER ? "folder" :
-                               get_last_subdir(picker_type, '/', 1));
-
-        lv_group_add_obj(ui_group, ui_lblPickerItem);
-        lv_group_add_obj(ui_group_glyph, ui_lblPickerItemGlyph);
-        lv_group_add_obj(ui_group_panel, ui_pnlPicker);
-
-        apply_size_to_content(&theme, ui_pnlContent, ui_lblPickerItem, ui_lblPickerItemGlyph, items[i].display_name);
-        apply_text_long_dot(&theme, ui_pnlContent, ui_lblPickerItem);
+        if (items[i].content_type == MENU) {
+            items[i].glyph_icon = "download";
+        } else if (items[i].content_type == FOLDER) {
+            items[i].glyph_icon = "folder";
+        }
     }
 
+    ui_count = (int) item_count;
+    virtual_list_init(&picker_list, ui_pnlContent, ui_group, ui_group_glyph, ui_group_panel,
+                      items, ui_count, mux_module, get_last_subdir(picker_type, '/', 1), NULL);
+
     if (ui_count > 0) lv_obj_update_layout(ui_pnlContent);
 }
 
@@ -171,21 +163,17 @@ static void list_nav_move(int steps, int direction) {
     if (!ui_count) return;
     first_open ? (first_open = 0) : play_sound(SND_NAVIGATE);
 
-    for (int step = 0; step < steps; ++step) {
-        apply_text_long_dot(&theme, ui_pnlContent, lv_group_get_focused(ui_group));
+    apply_text_long_dot(&theme, ui_pnlContent, lv_group_get_focused(ui_group));
 
+    for (int step = 0; step < steps; ++step) {
         if (direction < 0) {
             current_item_index = (current_item_index == 0) ? ui_count - 1 : current_item_index - 1;
         } else {
             current_item_index = (current_item_index == ui_count - 1) ? 0 : current_item_index + 1;
         }
-
-        nav_move(ui_group, direction);
-        nav_move(ui_group_glyph, direction);
-        nav_move(ui_group_panel, direction);
     }
 
-    update_scroll_position(theme.MUX.ITEM.COUNT, theme.MUX.ITEM.PANEL, ui_count, current_item_index, ui_pnlContent);
+    virtual_list_focus(&picker_list, current_item_index);
     set_label_long_mode(&theme, lv_group_get_focused(ui_group));
     nav_moved = 1;
 }
@@ -265,6 +253,9 @@ static void handle_a(void) {
             if (config.SETTINGS.GENERAL.BGM == 2 && strcasecmp(picker_type, "/theme") == 0) play_silence_bgm();
 
             run_exec(exec, exec_count, 0, 1, NULL, NULL);
+
+            // A package can replace a catalogue within the same second it was last listed
+            catalogue_index_invalidate();
         }
         free(exec);
     }
@@ -555,6 +546,7 @@ int muxpicker_main(char *type, char *ex_dir) {
     init_input(&input_opts, true);
     mux_input_task(&input_opts);
 
+    virtual_list_free(&picker_list);
     free_items(&items, &item_count);
 
     return 0;
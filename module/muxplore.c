@@ -1,6 +1,12 @@
 #include "muxshare.h"
 #include "../common/skip_list.h"
 #include "../common/archive.h"
+#include "../common/archive_cache.h"
+#include "../common/friendly_name.h"
+#include "../common/image_prefetch.h"
+#include "../common/catalogue_index.h"
+#include "../common/content_catalogue.h"
+#include "../common/screen_preload.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -10,6 +16,11 @@ static lv_obj_t *ui_viewport_objects[7];
 static char prev_dir[PATH_MAX];
 static char current_archive[PATH_MAX] = "";
 
+// Archives are listed a page at a time, only the one on screen is built
+static int archive_page = 0;
+static int archive_pages = 1;
+static int archive_total = 0;
+
 static int exit_status = 0;
 static int sys_index = -1;
 static int file_count = 0;
@@ -63,46 +74,66 @@ static char *load_content_description(void) {
     return lang.GENERIC.NO_INFO;
 }
 
-static void image_refresh(char *image_type) {
-    if (strcasecmp(image_type, "box") == 0 && config.VISUAL.BOX_ART == 8) return;
+static void resolve_image(int index, const char *image_type, char *image, size_t image_size,
+                          char *core_artwork, size_t core_artwork_size) {
+    char *content_label = items[index].name;
 
-    char image[MAX_BUFFER_SIZE];
-    char image_path[MAX_BUFFER_SIZE];
-    char core_artwork[MAX_BUFFER_SIZE];
-
-    char *content_label = items[current_item_index].name;
+    image[0] = '\0';
+    core_artwork[0] = '\0';
 
     if (strcasecmp(get_last_subdir(sys_dir, '/', 4), strip_dir(STORAGE_PATH)) == 0) {
-        snprintf(image, sizeof(image), "%s/Folder/%s/%s.png",
+        snprintf(image, image_size, "%s/Folder/%s/%s.png",
                  INFO_CAT_PATH, image_type, content_label);
     } else {
-        char *file_name = strip_ext(items[current_item_index].name);
+        char *file_name = strip_ext(items[index].name);
 
-        get_catalogue_name(sys_dir, content_label, core_artwork, sizeof(core_artwork));
+        get_catalogue_name(sys_dir, content_label, core_artwork, core_artwork_size);
 
-        if (strlen(core_artwork) <= 1 && items[current_item_index].content_type == ITEM) {
-            snprintf(image, sizeof(image), "%s/%simage/none_%s.png",
+        if (strlen(core_artwork) <= 1 && items[index].content_type == ITEM) {
+            snprintf(image, image_size, "%s/%simage/none_%s.png",
                      STORAGE_THEME, mux_dimension, image_type);
-            if (!file_exist(image)) {
-                snprintf(image, sizeof(image), "%s/image/none_%s.png",
+            if (!catalogue_index_file_exists(image)) {
+                snprintf(image, image_size, "%s/image/none_%s.png",
                          STORAGE_THEME, image_type);
             }
         } else {
             if (strcasecmp(image_type, "box") != 0 || !grid_mode_enabled || !config.VISUAL.BOX_ART_HIDE) {
-                if (items[current_item_index].content_type == FOLDER) {
-                    char *catalogue_name = get_catalogue_name_from_rom_path(sys_dir, items[current_item_index].name);
+                if (items[index].content_type == FOLDER) {
+                    char *catalogue_name = get_catalogue_name_from_rom_path(sys_dir, items[index].name);
                     load_image_catalogue("Folder", file_name, catalogue_name, "default",
-                                         mux_dimension, image_type, image, sizeof(image));
+                                         mux_dimension, image_type, image, image_size);
                 } else {
                     load_image_catalogue(core_artwork, file_name, "", "default", mux_dimension,
-                                         image_type, image, sizeof(image));
+                                         image_type, image, image_size);
                 }
             }
             if (strcasecmp(image_type, "splash") == 0 && !file_exist(image)) {
-                load_splash_image_fallback(mux_dimension, image, sizeof(image));
+                load_splash_image_fallback(mux_dimension, image, image_size);
             }
         }
+
+        free(file_name);
     }
+}
+
+// Called from the artwork prefetch thread, only reads the item list
+static int resolve_artwork(int index, const char *image_type, char *image, size_t image_size) {
+    if (strcasecmp(image_type, "box") == 0 && config.VISUAL.BOX_ART == 8) return 0;
+
+    char core_artwork[MAX_BUFFER_SIZE];
+    resolve_image(index, image_type, image, image_size, core_artwork, sizeof(core_artwork));
+
+    return image[0] != '\0';
+}
+
+static void image_refresh(char *image_type) {
+    if (strcasecmp(image_type, "box") == 0 && config.VISUAL.BOX_ART == 8) return;
+
+    char image[MAX_BUFFER_SIZE];
+    char image_path[MAX_BUFFER_SIZE];
+    char core_artwork[MAX_BUFFER_SIZE];
+
+    resolve_image(current_item_index, image_type, image, sizeof(image), core_artwork, sizeof(core_artwork));
 
     LOG_INFO(mux_module, "Loading '%s' Artwork: %s", image_type, image)
 
@@ -155,10 +186,10 @@ static void image_refresh(char *image_type) {
             } else {
                 if (file_exist(image)) {
                     starter_image = 1;
-                    snprintf(image_path, sizeof(image_path), "M:%s", image);
-                    lv_img_set_src(ui_imgBox, image_path);
+                    image_prefetch_set_src(ui_imgBox, image);
                     snprintf(box_image_previous_path, sizeof(box_image_previous_path), "%s", image);
                 } else {
+                    image_prefetch_release(ui_imgBox);
                     lv_img_set_src(ui_imgBox, &ui_image_Nothing);
                     snprintf(box_image_previous_path, sizeof(box_image_previous_path), " ");
                 }
@@ -251,29 +282,6 @@ static void gen_item(char **file_names, int file_count) {
     const char *last_dir = str_tolower(get_last_dir(sub_path));
     if (strlen(last_dir) < 1) last_dir = str_tolower(sub_path);
 
-    char custom_lookup[MAX_BUFFER_SIZE];
-    snprintf(custom_lookup, sizeof(custom_lookup), INFO_NAM_PATH "/%s.json", last_dir);
-    if (!file_exist(custom_lookup)) snprintf(custom_lookup, sizeof(custom_lookup), INFO_NAM_PATH "/global.json");
-
-    int fn_valid = 0;
-    struct json fn_json;
-
-    if (file_exist(custom_lookup)) {
-        char *lookup_content = read_all_char_from(custom_lookup);
-
-        if (lookup_content && json_valid(lookup_content)) {
-            fn_valid = 1;
-            fn_json = json_parse(read_all_char_from(custom_lookup));
-            LOG_SUCCESS(mux_module, "Using Friendly Name: %s", custom_lookup)
-        } else {
-            LOG_WARN(mux_module, "Invalid Friendly Name: %s", custom_lookup)
-        }
-
-        free(lookup_content);
-    } else {
-        LOG_WARN(mux_module, "Friendly Name does not exist: %s", custom_lookup)
-    }
-
     SkipList skiplist;
     init_skiplist(&skiplist);
     for (int i = 0; i < file_count; i++) {
@@ -303,12 +311,10 @@ static void gen_item(char **file_names, int file_count) {
                 char fn_name[MAX_BUFFER_SIZE];
                 char *stripped_name = strip_ext(file_names[i]);
 
-                if (fn_valid) {
-                    struct json custom_lookup_json = json_object_get(fn_json, str_tolower(stripped_name));
-                    if (json_exists(custom_lookup_json)) {
-                        json_string_copy(custom_lookup_json, fn_name, sizeof(fn_name));
-                        has_custom_name = 1;
-                    }
+                const char *friendly_name = friendly_name_lookup(last_dir, stripped_name);
+                if (friendly_name) {
+                    snprintf(fn_name, sizeof(fn_name), "%s", friendly_name);
+                    has_custom_name = 1;
                 }
 
                 int lookup_line = CONTENT_LOOKUP;
@@ -420,18 +426,35 @@ static void create_content_items(void) {
 
         update_title(current_archive, 0, (struct json){0}, lang.MUXPLORE.TITLE, STORAGE_PATH);
 
-        ArchiveEntry* archive_entries = archive_list_contents(current_archive, &file_count);
+        int page_count = 0;
+        file_count = 0;
+
+        ArchiveEntry *archive_entries = archive_list_page(current_archive, archive_page * ARCHIVE_PAGE_SIZE,
+                                                          ARCHIVE_PAGE_SIZE, &page_count, &archive_total);
+        if (!archive_entries && archive_page > 0) {
+            //The archive shrank since the page was picked, start over from the top
+            archive_page = 0;
+            archive_entries = archive_list_page(current_archive, 0, ARCHIVE_PAGE_SIZE, &page_count, &archive_total);
+        }
+
         if (archive_entries) {
-            for (int i = 0; i < file_count; i++) {
+            for (int i = 0; i < page_count; i++) {
                 content_item *new_item = add_item(&items, &item_count, archive_entries[i].path, archive_entries[i].path, "", ITEM);
                 new_item->archive_index = archive_entries[i].index;
-            }
-
-            for (int i = 0; i < file_count; i++) {
                 free(archive_entries[i].path);
             }
+
             free(archive_entries);
+            file_count = page_count;
+        }
+
+        archive_pages = archive_total > ARCHIVE_PAGE_SIZE ? (archive_total + ARCHIVE_PAGE_SIZE - 1) / ARCHIVE_PAGE_SIZE : 1;
+        if (archive_pages > 1) {
+            char title[PATH_MAX];
+            snprintf(title, sizeof(title), "%s (%d/%d)", lv_label_get_text(ui_lblTitle), archive_page + 1, archive_pages);
+            lv_label_set_text(ui_lblTitle, title);
         }
+
         dir_count = 0; //Directories not supported in archives
         sort_items(items, item_count);
 
@@ -552,6 +575,28 @@ static void update_list_items(int start_index) {
     }
 }
 
+// Warms whichever screen A or B would lead to from the focused item
+static void preload_next_screen(void) {
+    if (!ui_count || strlen(current_archive) > 0) {
+        screen_preload_schedule(NULL, NULL);
+    } else if (items[current_item_index].content_type == FOLDER) {
+        char n_dir[MAX_BUFFER_SIZE];
+        snprintf(n_dir, sizeof(n_dir), "%s/%s", sys_dir, items[current_item_index].name);
+
+        screen_preload_schedule("muxplore", n_dir);
+    } else if (at_base(sys_dir, "ROMS")) {
+        screen_preload_schedule("muxlaunch", NULL);
+    } else {
+        char *base_dir = strrchr(sys_dir, '/');
+        if (!base_dir) return;
+
+        char p_dir[MAX_BUFFER_SIZE];
+        snprintf(p_dir, sizeof(p_dir), "%.*s", (int) (base_dir - sys_dir), sys_dir);
+
+        screen_preload_schedule("muxplore", p_dir);
+    }
+}
+
 static void list_nav_move(int steps, int direction) {
     if (!ui_count) return;
     first_open ? (first_open = 0) : play_sound(SND_NAVIGATE);
@@ -612,14 +657,40 @@ static void list_nav_move(int steps, int direction) {
     lv_label_set_text(ui_lblGridCurrentItem, items[current_item_index].display_name);
 
     image_refresh("box");
+    image_prefetch_around(current_item_index, ui_count, "box");
+    preload_next_screen();
     nav_moved = 1;
 }
 
+/*Moving past either end of an archive page turns to the neighbouring one,
+which is built on its own by reloading the screen.*/
+static int turn_archive_page(int steps, int direction) {
+    if (first_open || !strlen(current_archive) || archive_pages < 2 || steps <= 0) return 0;
+
+    if (direction < 0 ? current_item_index - steps >= 0 : current_item_index + steps < ui_count) return 0;
+
+    archive_page = (archive_page + direction + archive_pages) % archive_pages;
+
+    // Going back lands on the last item of the page before
+    int page_items = LV_MIN(ARCHIVE_PAGE_SIZE, archive_total - archive_page * ARCHIVE_PAGE_SIZE);
+    write_text_to_file(MUOS_IDX_LOAD, "w", INT, direction < 0 ? LV_MAX(page_items - 1, 0) : 0);
+
+    play_sound(SND_NAVIGATE);
+    load_mux("explore");
+
+    close_input();
+    mux_input_stop();
+
+    return 1;
+}
+
 static void list_nav_prev(int steps) {
+    if (turn_archive_page(steps, -1)) return;
     list_nav_move(steps, -1);
 }
 
 static void list_nav_next(int steps) {
+    if (turn_archive_page(steps, +1)) return;
     list_nav_move(steps, +1);
 }
 
@@ -663,24 +734,10 @@ static void process_load(int from_start) {
     if(strlen(current_archive) > 0) {
         int file_index_to_extract = items[current_item_index].archive_index;
 
-        char target_path[PATH_MAX];
-        snprintf(target_path, sizeof(target_path), "/tmp/%s", items[current_item_index].name);
-
-        if (file_exist(target_path)) {
-            LOG_WARN(mux_module, "Pre-existing file found at %s. Attempting to remove.", target_path);
-
-            if (remove(target_path) != 0) {
-                LOG_ERROR(mux_module, "Failed to remove existing file: %s. Aborting launch.", target_path);
-                perror("remove");
-                load_mux("explore");
-                close_input();
-                mux_input_stop();
-                return;
-            }
-            LOG_SUCCESS(mux_module, "Successfully removed old file.");
-        }
-
-        char* extracted_path = archive_extract_file(current_archive, items[current_item_index].name, file_index_to_extract, "/tmp");
+        // Relaunching the same content reuses the previous extraction
+        char* extracted_path = archive_cache_extract(current_archive, items[current_item_index].name,
+                                                     file_index_to_extract, ARCHIVE_CACHE_PATH,
+                                                     ARCHIVE_CACHE_BUDGET);
         if (extracted_path != NULL && strlen(extracted_path) > 0){
             char* extracted_dir = strip_dir(extracted_path);
             char* extracted_filename = get_last_dir(extracted_path);
@@ -709,6 +766,7 @@ static void process_load(int from_start) {
         } else if (items[current_item_index].content_type == ARC) {
             load_message = 1;
             snprintf(current_archive, sizeof(current_archive), "%s/%s", sys_dir, items[current_item_index].name);
+            archive_page = 0;
         } else {
             write_text_to_file(MUOS_IDX_LOAD, "w", INT, current_item_index);
 
@@ -792,6 +850,7 @@ static void handle_b(void) {
 
     if (strlen(current_archive) > 0){
         current_archive[0] = '\0';
+        archive_page = 0;
         load_mux("explore");
     } else {
         if (at_base(sys_dir, "ROMS")) {
@@ -908,8 +967,51 @@ static void handle_menu(void) {
     show_info_box(items[current_item_index].display_name, load_content_description(), 1);
 }
 
+// Nothing but folders here, so pick from everything underneath and open the folder it lives in
+static int random_from_catalogue(void) {
+    const char *scope = content_catalogue_scope(sys_dir);
+    if (!scope) return 0;
+
+    content_catalogue *catalogue = content_catalogue_open();
+    if (!catalogue) return 0;
+
+    content_catalogue_item item;
+    int picked = content_catalogue_random(catalogue, scope, &item);
+
+    if (picked) {
+        char n_dir[MAX_BUFFER_SIZE];
+        snprintf(n_dir, sizeof(n_dir), "%s%s%s", STORAGE_PATH, item.rel[0] ? "/" : "", item.rel);
+
+        write_text_to_file(EXPLORE_DIR, "w", CHAR, n_dir);
+        write_text_to_file(EXPLORE_NAME, "w", CHAR, item.file);
+    }
+
+    content_catalogue_close(catalogue);
+    return picked;
+}
+
+static int has_content_items(void) {
+    for (size_t i = 0; i < item_count; i++) {
+        if (items[i].content_type == ITEM) return 1;
+    }
+
+    return 0;
+}
+
 static void handle_random_select(void) {
-    if (msgbox_active || ui_count < 2 || hold_call || !config.VISUAL.SHUFFLE) return;
+    if (msgbox_active || hold_call || !config.VISUAL.SHUFFLE) return;
+
+    if (!has_content_items() && !strlen(current_archive) && random_from_catalogue()) {
+        play_sound(SND_CONFIRM);
+
+        load_mux("explore");
+
+        close_input();
+        mux_input_stop();
+        return;
+    }
+
+    if (ui_count < 2) return;
 
     int dir, target;
     shuffle_index(current_item_index, &dir, &target);
@@ -1019,6 +1121,7 @@ int muxplore_main(int index, char *dir) {
     init_module("muxplore");
 
     register_all_archive_handlers();
+    archive_set_listing_cache_dir(ARCHIVE_LIST_PATH);
 
     init_theme(1, 1);
 
@@ -1053,6 +1156,7 @@ int muxplore_main(int index, char *dir) {
     create_content_items();
     ui_count = (int) item_count;
     init_elements();
+    image_prefetch_start(resolve_artwork);
 
     write_text_to_file(MUOS_PDI_LOAD, "w", CHAR, get_last_dir(sys_dir));
     if (strcasecmp(read_all_char_from(MUOS_PDI_LOAD), "ROMS") == 0) {
@@ -1068,6 +1172,8 @@ int muxplore_main(int index, char *dir) {
             list_nav_next(sys_index);
         } else {
             image_refresh("box");
+            image_prefetch_around(current_item_index, ui_count, "box");
+            preload_next_screen();
         }
         nav_moved = 1;
         collect_vis = items[current_item_index].content_type == ITEM ? 1 : 0;
@@ -1145,6 +1251,7 @@ int muxplore_main(int index, char *dir) {
     init_input(&input_opts, true);
     mux_input_task(&input_opts);
 
+    image_prefetch_stop();
     free_items(&items, &item_count);
 
     return exit_status;
@@ -1,6 +1,9 @@
 #include "muxshare.h"
 #include "ui/ui_muxsearch.h"
 #include "../common/skip_list.h"
+#include "../common/friendly_name.h"
+#include "../common/content_search.h"
+#include "../common/content_catalogue.h"
 
 #define UI_COUNT 3
 
@@ -20,6 +23,16 @@ content_item *all_items = NULL;
 
 static lv_obj_t *ui_viewport_objects[7];
 
+static content_search *active_search = NULL;
+static content_search_result *search_hits = NULL;
+static size_t search_hit_count = 0;
+static size_t search_hit_capacity = 0;
+static size_t search_shown = 0;
+
+static char search_query[MAX_BUFFER_SIZE];
+static const char *search_roots[3];
+static size_t search_root_count = 0;
+
 static void show_help(lv_obj_t *element_focused) {
     struct help_msg help_messages[] = {
             {ui_lblLookup_search,       lang.MUXSEARCH.HELP.LOOKUP},
@@ -142,27 +155,10 @@ static void gen_result(char *item_glyph, char *item_text, char *item_data, char
     lv_obj_set_user_data(ui_lblResultItem, item_data);
 
     if (strcasecmp(item_data, "content") == 0) {
-        if (file_exist(FRIENDLY_RESULT)) {
-            LOG_INFO(mux_module, "Reading Friendly Name Set: %s", FRIENDLY_RESULT)
-
-            int fn_valid = 0;
-            struct json fn_json;
-
-            if (json_valid(read_all_char_from(FRIENDLY_RESULT))) {
-                fn_valid = 1;
-                fn_json = json_parse(read_all_char_from(FRIENDLY_RESULT));
-            }
-
-            if (fn_valid) {
-                char fn_name[MAX_BUFFER_SIZE];
-                struct json good_name_json = json_object_get(fn_json, strip_ext(item_text));
-
-                if (json_exists(good_name_json)) {
-                    json_string_copy(good_name_json, fn_name, sizeof(fn_name));
-                    lv_label_set_text(ui_lblResultItem, fn_name);
-                }
-            }
-        }
+        char *stripped_name = strip_ext(item_text);
+        const char *friendly_name = friendly_name_lookup(FRIENDLY_RESULT, stripped_name);
+        if (friendly_name) lv_label_set_text(ui_lblResultItem, friendly_name);
+        free(stripped_name);
 
         lv_group_add_obj(ui_group, ui_lblResultItem);
         lv_group_add_obj(ui_group_value, ui_lblResultItemValue);
@@ -230,28 +226,33 @@ static void process_results(const char *json_results) {
 
     struct json root = json_parse(json_results);
 
-    struct json lookup = json_object_get(root, "lookup");
+    static const char *const root_keys[] = {"lookup", "directories", "folders"};
+    struct json root_values[A_SIZE(root_keys)];
+    json_object_pick(root, root_keys, root_values, A_SIZE(root_keys));
+
+    struct json lookup = root_values[0];
     if (json_exists(lookup) && json_type(lookup) == JSON_STRING) {
         json_string_copy(lookup, lookup_value, sizeof(lookup_value));
     }
 
-    struct json directories = json_object_get(root, "directories");
+    struct json directories = root_values[1];
     if (json_exists(directories) && json_type(directories) == JSON_ARRAY) {
-        if (json_array_count(directories) > 0) {
-            list_nav_move(json_array_count(directories) == 1 ? 1 : 2, +1);
+        size_t directory_count = json_array_count(directories);
+        if (directory_count > 0) {
+            list_nav_move(directory_count == 1 ? 1 : 2, +1);
         }
     }
 
-    struct json search_folders = json_object_get(root, "folders");
+    struct json search_folders = root_values[2];
     if (!json_exists(search_folders) || json_type(search_folders) != JSON_OBJECT) return;
 
     size_t t_all_item_count = 0;
     content_item *t_all_items = NULL;
 
-    struct json key = json_first(search_folders);
-    while (json_exists(key)) {
-        struct json val = json_next(key);
-        if (!json_exists(val)) break;
+    json_pair folder;
+    for (bool more = json_pair_first(search_folders, &folder); more; more = json_pair_next(&folder)) {
+        struct json key = folder.key;
+        struct json val = folder.value;
 
         char folder_name[MAX_BUFFER_SIZE];
         if (json_type(key) == JSON_STRING) {
@@ -278,10 +279,7 @@ static void process_results(const char *json_results) {
             }
         }
 
-        if (strcasecmp(storage_name_short, "UNION") == 0) {
-            key = json_next(val);
-            continue;
-        }
+        if (strcasecmp(storage_name_short, "UNION") == 0) continue;
 
         char folder_name_short[MAX_BUFFER_SIZE];
         char *modified_name = NULL;
@@ -300,20 +298,21 @@ static void process_results(const char *json_results) {
         }
 
         struct json content = json_object_get(val, "content");
-        if (!json_exists(content) || json_type(content) != JSON_ARRAY) {
-            key = json_next(val);
-            continue;
-        }
+        if (!json_exists(content) || json_type(content) != JSON_ARRAY) continue;
 
         size_t folder_item_count = 0;
         content_item *folder_items = NULL;
 
-        for (size_t i = 0; i < json_array_count(content); i++) {
-            struct json item = json_array_get(content, i);
+        static const char *const item_keys[] = {"file", "name"};
+        struct json item_values[A_SIZE(item_keys)];
+
+        json_array_each(item, content) {
             if (json_type(item) != JSON_OBJECT) continue;
 
-            struct json file_json = json_object_get(item, "file");
-            struct json name_json = json_object_get(item, "name");
+            json_object_pick(item, item_keys, item_values, A_SIZE(item_keys));
+
+            struct json file_json = item_values[0];
+            struct json name_json = item_values[1];
             if (!json_exists(file_json) || !json_exists(name_json)) continue;
 
             char file_name[MAX_BUFFER_SIZE];
@@ -365,13 +364,13 @@ static void process_results(const char *json_results) {
 
         free_skiplist(&skiplist);
         free_items(&folder_items, &folder_item_count);
-        key = json_next(val);
     }
 
     // We are done with the friendly results JSON
     if (file_exist(FRIENDLY_RESULT)) {
         remove(FRIENDLY_RESULT);
     }
+    friendly_name_invalidate(FRIENDLY_RESULT);
 
     // Add the three top labels - lookup, local, and global
     add_item(&all_items, &all_item_count, "", "", "", FOLDER);
@@ -393,11 +392,198 @@ static void process_results(const char *json_results) {
     free_items(&t_all_items, &t_all_item_count);
 }
 
+static void collect_search_hit(const content_search_result *result, void *ctx) {
+    (void) ctx;
+
+    if (search_hit_count == search_hit_capacity) {
+        size_t capacity = search_hit_capacity ? search_hit_capacity * 2 : 128;
+        content_search_result *hits = realloc(search_hits, capacity * sizeof(content_search_result));
+        if (!hits) return;
+
+        search_hits = hits;
+        search_hit_capacity = capacity;
+    }
+
+    search_hits[search_hit_count++] = (content_search_result) {
+            .dir = strdup(result->dir),
+            .file = strdup(result->file),
+            .name = strdup(result->name),
+    };
+}
+
+static void free_search_hits(void) {
+    for (size_t i = 0; i < search_hit_count; i++) {
+        free(search_hits[i].dir);
+        free(search_hits[i].file);
+        free(search_hits[i].name);
+    }
+
+    free(search_hits);
+    search_hits = NULL;
+    search_hit_count = 0;
+    search_hit_capacity = 0;
+}
+
+static int compare_search_hit(const void *a, const void *b) {
+    const content_search_result *hit_a = a;
+    const content_search_result *hit_b = b;
+
+    int cmp = strcmp(hit_a->dir, hit_b->dir);
+    return cmp ? cmp : strcasecmp(hit_a->file, hit_b->file);
+}
+
+static void write_json_string(FILE *file, const char *str) {
+    char escaped[MAX_BUFFER_SIZE * 2];
+    size_t length = json_escape(str, escaped, sizeof(escaped));
+
+    if (length < sizeof(escaped)) {
+        fputs(escaped, file);
+        return;
+    }
+
+    char *large = malloc(length + 1);
+    if (!large) {
+        fputs("\"\"", file);
+        return;
+    }
+
+    json_escape(str, large, length + 1);
+    fputs(large, file);
+    free(large);
+}
+
+// Same layout find.sh produced, so a relaunch of the module reads it back through process_results
+static void write_search_results(void) {
+    qsort(search_hits, search_hit_count, sizeof(content_search_result), compare_search_hit);
+
+    char temp_result[MAX_BUFFER_SIZE + 8];
+    snprintf(temp_result, sizeof(temp_result), "%s.tmp", search_result);
+
+    FILE *file = fopen(temp_result, "w");
+    if (!file) {
+        LOG_ERROR(mux_module, "%s: %s", lang.SYSTEM.FAIL_FILE_OPEN, temp_result)
+        return;
+    }
+
+    fputs("{\"lookup\":", file);
+    write_json_string(file, search_query);
+
+    fputs(",\"directories\":[", file);
+    for (size_t i = 0; i < search_root_count; i++) {
+        if (i) fputc(',', file);
+        write_json_string(file, search_roots[i]);
+    }
+
+    fputs("],\"folders\":{", file);
+    for (size_t i = 0; i < search_hit_count; i++) {
+        int new_folder = i == 0 || strcmp(search_hits[i].dir, search_hits[i - 1].dir) != 0;
+
+        if (new_folder) {
+            if (i) fputs("]},", file);
+            write_json_string(file, search_hits[i].dir);
+            fputs(":{\"content\":[", file);
+        } else {
+            fputc(',', file);
+        }
+
+        fputs("{\"file\":", file);
+        write_json_string(file, search_hits[i].file);
+        fputs(",\"name\":", file);
+        write_json_string(file, search_hits[i].name);
+        fputc('}', file);
+    }
+    if (search_hit_count) fputs("]}", file);
+    fputs("}}\n", file);
+
+    if (fclose(file) != 0 || rename(temp_result, search_result) != 0) {
+        LOG_ERROR(mux_module, "Unable to write search results: %s", search_result)
+        remove(temp_result);
+    }
+}
+
+static void cancel_search(void) {
+    if (!active_search) return;
+
+    content_search_stop(active_search);
+    active_search = NULL;
+    free_search_hits();
+
+    lv_obj_add_flag(ui_pnlMessage, LV_OBJ_FLAG_HIDDEN);
+}
+
+static void finish_search(void) {
+    write_search_results();
+    free_search_hits();
+
+    if (file_exist(MUOS_RES_LOAD)) remove(MUOS_RES_LOAD);
+
+    load_mux("search");
+
+    close_input();
+    mux_input_stop();
+}
+
+// Answered from the catalogue when mucatalogue has built one covering scope, false to walk instead
+static bool search_catalogue(const char *scope) {
+    content_catalogue *catalogue = content_catalogue_open();
+    if (!catalogue) return false;
+
+    bool covered = content_catalogue_covers(catalogue, scope);
+    if (covered) content_catalogue_search(catalogue, search_query, scope, lookup, collect_search_hit, NULL);
+
+    content_catalogue_close(catalogue);
+    if (!covered) return false;
+
+    finish_search();
+    return true;
+}
+
+static void start_search(const char *query, const char *scope, const char *const roots[], size_t root_count) {
+    cancel_search();
+
+    snprintf(search_query, sizeof(search_query), "%s", query);
+
+    search_root_count = root_count < A_SIZE(search_roots) ? root_count : A_SIZE(search_roots);
+    for (size_t i = 0; i < search_root_count; i++) search_roots[i] = roots[i];
+
+    if (scope && search_catalogue(scope)) return;
+
+    search_shown = 0;
+    active_search = content_search_start(search_query, search_roots, search_root_count, lookup);
+
+    if (!active_search) toast_message(lang.MUXSEARCH.ERROR, SHORT);
+}
+
+// Runs on the refresh timer, collecting whatever the search threads have found so far
+static void poll_search(void) {
+    if (!active_search) return;
+
+    bool running = content_search_drain(active_search, collect_search_hit, NULL);
+
+    if (search_hit_count != search_shown) {
+        search_shown = search_hit_count;
+
+        char progress[MAX_BUFFER_SIZE];
+        snprintf(progress, sizeof(progress), "%s (%zu)", lang.MUXSEARCH.SEARCH, search_hit_count);
+        toast_message(progress, FOREVER);
+    }
+
+    if (running) return;
+
+    content_search_stop(active_search);
+    active_search = NULL;
+
+    finish_search();
+}
+
 static void handle_keyboard_OK_press(void) {
     key_show = 0;
     struct _lv_obj_t *element_focused = lv_group_get_focused(ui_group);
 
     if (element_focused == ui_lblLookup_search) {
+        // Whatever was being searched for is no longer what the user wants
+        cancel_search();
+
         lv_label_set_text(ui_lblLookupValue_search,
                           lv_textarea_get_text(ui_txtEntry_search));
     }
@@ -456,27 +642,17 @@ static void handle_confirm(void) {
         }
 
         toast_message(lang.MUXSEARCH.SEARCH, FOREVER);
-        refresh_screen(ui_screen);
 
+        // Answered straight from the catalogue when there is one, otherwise results trickle in through
+        // poll_search, which relaunches the module once the walk is done
         if (element_focused == ui_lblSearchLocal_search) {
-            const char *args[] = {(OPT_PATH "script/mux/find.sh"),
-                                  str_trim(lookup_value), rom_dir,
-                                  NULL};
-            run_exec(args, A_SIZE(args), 0, 1, NULL, NULL);
+            const char *roots[] = {rom_dir};
+            start_search(str_trim(lookup_value), content_catalogue_scope(rom_dir), roots, A_SIZE(roots));
         } else {
-            const char *args[] = {(OPT_PATH "script/mux/find.sh"),
-                                  str_trim(lookup_value), SD1, SD2, E_USB,
-                                  NULL};
-            run_exec(args, A_SIZE(args), 0, 1, NULL, NULL);
+            const char *roots[] = {SD1, SD2, E_USB};
+            start_search(str_trim(lookup_value), "", roots, A_SIZE(roots));
         }
 
-        if (file_exist(MUOS_RES_LOAD)) remove(MUOS_RES_LOAD);
-
-        load_mux("search");
-
-        close_input();
-        mux_input_stop();
-
         return;
     }
 
@@ -546,6 +722,12 @@ static void handle_b(void) {
         return;
     }
 
+    if (active_search) {
+        play_sound(SND_BACK);
+        cancel_search();
+        return;
+    }
+
     handle_back();
 }
 
@@ -677,6 +859,8 @@ static void init_elements(void) {
 }
 
 static void ui_refresh_task() {
+    poll_search();
+
     if (nav_moved) {
         starter_image = adjust_wallpaper_element(ui_group, starter_image, GENERAL);
         adjust_panels();
@@ -791,6 +975,12 @@ int muxsearch_main(char *dir) {
     register_key_event_callback(on_key_event);
     mux_input_task(&input_opts);
 
+    if (active_search) {
+        content_search_stop(active_search);
+        active_search = NULL;
+    }
+    free_search_hits();
+
     free_items(&all_items, &all_item_count);
 
     return 0;
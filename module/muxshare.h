@@ -37,9 +37,11 @@
 #include "../common/collection.h"
 #include "../common/passcode.h"
 #include "../common/timezone.h"
+#include "../common/telemetry.h"
 #include "../common/img/nothing.h"
 #include "../common/input/list_nav.h"
 #include "../common/json/json.h"
+#include "../common/json_index.h"
 #include "../font/notosans_big.h"
 #include "../font/notosans_big_hd.h"
 #include "../lookup/lookup.h"
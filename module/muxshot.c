@@ -1,7 +1,9 @@
 #include "muxshare.h"
+#include "../common/virtual_list.h"
 
 lv_obj_t *ui_imgScreenshot;
 static int is_fullscreen = 0;
+static virtual_list screenshot_list;
 
 static void show_help(void) {
     show_info_box(TS(lv_label_get_text(lv_group_get_focused(ui_group))), lang.MUXSHOT.HELP, 0);
@@ -56,26 +58,9 @@ static void create_screenshot_items(void) {
     ui_group_glyph = lv_group_create();
     ui_group_panel = lv_group_create();
 
-    for (size_t i = 0; i < item_count; i++) {
-        ui_count++;
-
-        lv_obj_t *ui_pnlScreenshot = lv_obj_create(ui_pnlContent);
-        apply_theme_list_panel(ui_pnlScreenshot);
-
-        lv_obj_t *ui_lblScreenshotItem = lv_label_create(ui_pnlScreenshot);
-        apply_theme_list_item(&theme, ui_lblScreenshotItem, items[i].display_name);
-
-        lv_obj_t *ui_lblScreenshotItemGlyph = lv_img_create(ui_pnlScreenshot);
-        apply_theme_list_glyph(&theme, ui_lblScreenshotItemGlyph, mux_module, "screenshot");
-
-        lv_group_add_obj(ui_group, ui_lblScreenshotItem);
-        lv_group_add_obj(ui_group_glyph, ui_lblScreenshotItemGlyph);
-        lv_group_add_obj(ui_group_panel, ui_pnlScreenshot);
-
-        apply_size_to_content(&theme, ui_pnlContent, ui_lblScreenshotItem, ui_lblScreenshotItemGlyph,
-                              items[i].display_name);
-        apply_text_long_dot(&theme, ui_pnlContent, ui_lblScreenshotItem);
-    }
+    ui_count = (int) item_count;
+    virtual_list_init(&screenshot_list, ui_pnlContent, ui_group, ui_group_glyph, ui_group_panel,
+                      items, ui_count, mux_module, "screenshot", NULL);
 
     if (ui_count > 0) lv_obj_update_layout(ui_pnlContent);
 }
@@ -84,21 +69,17 @@ static void list_nav_move(int steps, int direction) {
     if (!ui_count) return;
     first_open ? (first_open = 0) : play_sound(SND_NAVIGATE);
 
-    for (int step = 0; step < steps; ++step) {
-        apply_text_long_dot(&theme, ui_pnlContent, lv_group_get_focused(ui_group));
+    apply_text_long_dot(&theme, ui_pnlContent, lv_group_get_focused(ui_group));
 
+    for (int step = 0; step < steps; ++step) {
         if (direction < 0) {
             current_item_index = (current_item_index == 0) ? ui_count - 1 : current_item_index - 1;
         } else {
             current_item_index = (current_item_index == ui_count - 1) ? 0 : current_item_index + 1;
         }
-
-        nav_move(ui_group, direction);
-        nav_move(ui_group_glyph, direction);
-        nav_move(ui_group_panel, direction);
     }
 
-    update_scroll_position(theme.MUX.ITEM.COUNT, theme.MUX.ITEM.PANEL, ui_count, current_item_index, ui_pnlContent);
+    virtual_list_focus(&screenshot_list, current_item_index);
     image_refresh();
     set_label_long_mode(&theme, lv_group_get_focused(ui_group));
     nav_moved = 1;
@@ -278,6 +259,7 @@ int muxshot_main(void) {
     init_input(&input_opts, true);
     mux_input_task(&input_opts);
 
+    virtual_list_free(&screenshot_list);
     free_items(&items, &item_count);
 
     return 0;
@@ -28,24 +28,16 @@ static void show_help(lv_obj_t *element_focused) {
 }
 
 const char *get_cpu_model(void) {
-    static char cpu_model[48];
-    snprintf(cpu_model, sizeof(cpu_model), "%s",
-             get_execute_result("lscpu | grep 'Model name:' | awk -F: '{print $2}'"));
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    static char cpu_cores[6];
-    snprintf(cpu_cores, sizeof(cpu_cores), "%s",
-             get_execute_result("lscpu | grep '^CPU(s):' | awk '{print $2}'"));
-
-    str_remchar(cpu_model, ' ');
-    str_remchar(cpu_cores, ' ');
-
-    if (strlen(cpu_model) == 0) return lang.GENERIC.UNKNOWN;
+    if (strlen(sample.cpu_model) == 0) return lang.GENERIC.UNKNOWN;
 
     static char result[MAX_BUFFER_SIZE];
-    if (strlen(cpu_cores) > 0) {
-        snprintf(result, sizeof(result), "%s (%s)", cpu_model, cpu_cores);
+    if (sample.cpu_count > 0) {
+        snprintf(result, sizeof(result), "%s (%d)", sample.cpu_model, sample.cpu_count);
     } else {
-        snprintf(result, sizeof(result), "%s", cpu_model);
+        snprintf(result, sizeof(result), "%s", sample.cpu_model);
     }
 
     return result;
@@ -53,80 +45,66 @@ const char *get_cpu_model(void) {
 
 const char *get_current_frequency(void) {
     static char buffer[32];
-    char *freq_str = read_all_char_from("/sys/devices/system/cpu/cpufreq/policy0/cpuinfo_cur_freq");
-
-    if (!freq_str || freq_str[0] == '\0') {
-        snprintf(buffer, sizeof(buffer), "%s", lang.GENERIC.UNKNOWN);
-        free(freq_str);
-        return buffer;
-    }
 
-    char *end;
-    double frequency = strtod(freq_str, &end);
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    errno = 0;
-    if (errno != 0 || end == freq_str || *end != '\0') {
+    if (sample.cpu_freq_khz < 0) {
         snprintf(buffer, sizeof(buffer), "%s", lang.GENERIC.UNKNOWN);
     } else {
-        snprintf(buffer, sizeof(buffer), "%.2f MHz", frequency / 1000.0);
+        snprintf(buffer, sizeof(buffer), "%.2f MHz", (double) sample.cpu_freq_khz / 1000.0);
     }
 
-    free(freq_str);
     return buffer;
 }
 
 const char *get_scaling_governor(void) {
     static char buffer[MAX_BUFFER_SIZE];
-    char *governor_str = read_all_char_from(device.CPU.GOVERNOR);
 
-    if (!governor_str || governor_str[0] == '\0') {
-        snprintf(buffer, sizeof(buffer), "%s", lang.GENERIC.UNKNOWN);
-        free(governor_str);
-        return buffer;
-    }
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    snprintf(buffer, sizeof(buffer), "%s", governor_str);
-    free(governor_str);
+    snprintf(buffer, sizeof(buffer), "%s", sample.governor[0] ? sample.governor : lang.GENERIC.UNKNOWN);
     return buffer;
 }
 
 const char *get_memory_usage(void) {
-    char *result = get_execute_result("free -m | awk '/^Mem:/ {printf \"%.2f MB / %.2f MB\", $3, $2}'");
-    if (!result || strlen(result) == 0) return lang.GENERIC.UNKNOWN;
+    static char buffer[64];
 
-    return result;
+    telemetry_sample sample;
+    telemetry_get(&sample);
+
+    if (sample.mem_total_kb < 0) return lang.GENERIC.UNKNOWN;
+
+    // Whole megabytes as "free -m" reported them
+    snprintf(buffer, sizeof(buffer), "%.2f MB / %.2f MB",
+             (double) (sample.mem_used_kb / 1024), (double) (sample.mem_total_kb / 1024));
+    return buffer;
 }
 
 const char *get_temperature(void) {
     static char buffer[32];
-    char *temp_str = read_all_char_from("/sys/class/thermal/thermal_zone0/temp");
-
-    if (!temp_str || temp_str[0] == '\0') {
-        snprintf(buffer, sizeof(buffer), "%s", lang.GENERIC.UNKNOWN);
-        free(temp_str);
-        return buffer;
-    }
 
-    char *end;
-    double temperature = strtod(temp_str, &end);
+    telemetry_sample sample;
+    telemetry_get(&sample);
 
-    errno = 0;
-    if (errno != 0 || end == temp_str || *end != '\0') {
+    if (sample.temp_millic < 0) {
         snprintf(buffer, sizeof(buffer), "%s", lang.GENERIC.UNKNOWN);
     } else {
-        snprintf(buffer, sizeof(buffer), "%.2f°C", temperature / 1000.0);
+        snprintf(buffer, sizeof(buffer), "%.2f°C", (double) sample.temp_millic / 1000.0);
     }
 
-    free(temp_str);
     return buffer;
 }
 
 const char *get_uptime(void) {
     static char formatted_uptime[MAX_BUFFER_SIZE];
-    struct sysinfo info;
 
-    if (sysinfo(&info) == 0) {
-        long total_minutes = info.uptime / 60;
+    telemetry_sample sample;
+    telemetry_get(&sample);
+
+    if (sample.uptime >= 0) {
+        long total_minutes = (long) sample.uptime / 60;
         long days = total_minutes / (24 * 60);
         long hours = (total_minutes % (24 * 60)) / 60;
         long minutes = total_minutes % 60;
@@ -492,6 +470,8 @@ int muxsysinfo_main(void) {
     load_wallpaper(ui_screen, NULL, ui_pnlWall, ui_imgWall, GENERAL);
 
     init_fonts();
+
+    telemetry_start(TELEMETRY_SYSTEM);
     init_navigation_group();
 
     init_timer(ui_refresh_task, update_system_info);
@@ -560,5 +540,7 @@ int muxsysinfo_main(void) {
     init_input(&input_opts, false);
     mux_input_task(&input_opts);
 
+    telemetry_stop();
+
     return 0;
 }
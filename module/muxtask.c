@@ -1,16 +1,23 @@
 #include "muxshare.h"
+#include "../common/manifest.h"
 
 static char base_dir[PATH_MAX];
+static manifest *task_manifest;
 
 static void show_help(void) {
     char *title = items[current_item_index].name;
 
-    char help_info[MAX_BUFFER_SIZE];
-    snprintf(help_info, sizeof(help_info), OPT_SHARE_PATH "task/%s.sh",
-             title);
+    manifest_item task_item;
+    const char *message = manifest_find(task_manifest, title, &task_item) && task_item.help[0]
+                          ? task_item.help : lang.GENERIC.NO_HELP;
 
-    char *message = get_script_value(help_info, "HELP", lang.GENERIC.NO_HELP);
-    show_info_box(TS(title), TS(message), 0);
+    show_info_box(TS(title), TS((char *) message), 0);
+}
+
+// Tasks without an icon of their own, and anything the manifest could not read
+static const char *task_icon(const char *name) {
+    manifest_item task_item;
+    return manifest_find(task_manifest, name, &task_item) && task_item.icon[0] ? task_item.icon : "task";
 }
 
 static void create_task_items(void) {
@@ -38,6 +45,8 @@ static void create_task_items(void) {
     closedir(td);
     sort_items(items, item_count);
 
+    task_manifest = manifest_load(sys_dir, MANIFEST_SCRIPTS);
+
     ui_group = lv_group_create();
     ui_group_glyph = lv_group_create();
     ui_group_panel = lv_group_create();
@@ -54,7 +63,7 @@ static void create_task_items(void) {
         lv_obj_t *ui_lblTaskItemGlyph = lv_img_create(ui_pnlTask);
         apply_theme_list_glyph(&theme, ui_lblTaskItemGlyph, mux_module,
                                items[i].content_type == FOLDER ? "folder" :
-                               get_script_value(items[i].extra_data, "ICON", "task"));
+                               task_icon(items[i].name));
 
         lv_group_add_obj(ui_group, ui_lblTaskItem);
         lv_group_add_obj(ui_group_glyph, ui_lblTaskItemGlyph);
@@ -289,5 +298,8 @@ int muxtask_main(char *ex_dir) {
 
     free_items(&items, &item_count);
 
+    manifest_free(task_manifest);
+    task_manifest = NULL;
+
     return 0;
 }
@@ -3,7 +3,8 @@
 #include "../common/download.h"
 
 static char theme_data_local_path[MAX_BUFFER_SIZE];
-static theme_item *theme_items = NULL;
+static const theme_item **theme_items = NULL; // Filtered view into the cached theme catalogue
+static bool *theme_downloaded = NULL;
 static size_t theme_item_count = 0;
 static char *preview_zip_path = "/tmp/theme_catalogue.muxzip";
 
@@ -12,7 +13,7 @@ static int starter_image = 0;
 
 static void show_help(void) {
     char text_path[MAX_BUFFER_SIZE];
-    snprintf(text_path, sizeof(text_path), "%s/theme/text/%s.txt", INFO_CAT_PATH, theme_items[current_item_index].name);
+    snprintf(text_path, sizeof(text_path), "%s/theme/text/%s.txt", INFO_CAT_PATH, theme_items[current_item_index]->name);
 
     char credits[MAX_BUFFER_SIZE];
     if (file_exist(text_path)) {
@@ -25,10 +26,11 @@ static void show_help(void) {
 }
 
 static bool is_downloaded(int index) {
-    char theme_path[MAX_BUFFER_SIZE];
-    snprintf(theme_path, sizeof(theme_path), "%stheme/%s.muxthm",
-             RUN_STORAGE_PATH, theme_items[index].name);
-    return (file_exist(theme_path));
+    return theme_downloaded[index];
+}
+
+static void theme_path(int index, char *path, size_t path_size) {
+    snprintf(path, path_size, "%stheme/%s.muxthm", RUN_STORAGE_PATH, theme_items[index]->name);
 }
 
 static void image_refresh() {
@@ -38,11 +40,11 @@ static void image_refresh() {
     char *core_artwork = "theme";
     char *image_type = "box";
 
-    load_image_catalogue(core_artwork, theme_items[current_item_index].name, "", "default", mux_dimension,
+    load_image_catalogue(core_artwork, theme_items[current_item_index]->name, "", "default", mux_dimension,
                          image_type,
                          image, sizeof(image));
     if (!file_exist(image)) {
-        load_image_catalogue(core_artwork, theme_items[current_item_index].name, "", "default", "640x480/",
+        load_image_catalogue(core_artwork, theme_items[current_item_index]->name, "", "default", "640x480/",
                              image_type,
                              image, sizeof(image));
     }
@@ -86,72 +88,64 @@ static void image_refresh() {
     }
 }
 
-static bool skip_theme_item(const char *name, bool grid_enabled, bool hdmi_enabled, bool language_enabled,
-                            bool resolution640x480, bool resolution720x480, bool resolution720x720,
-                            bool resolution1024x768, bool resolution1280x720) {
-    return (
-            (config.THEME.FILTER.RESOLUTION_640x480 && !resolution640x480) ||
-            (config.THEME.FILTER.RESOLUTION_720x480 && !resolution720x480) ||
-            (config.THEME.FILTER.RESOLUTION_720x720 && !resolution720x720) ||
-            (config.THEME.FILTER.RESOLUTION_1024x768 && !resolution1024x768) ||
-            (config.THEME.FILTER.RESOLUTION_1280x720 && !resolution1280x720) ||
-            (config.THEME.FILTER.GRID && !grid_enabled) ||
-            (config.THEME.FILTER.HDMI && !hdmi_enabled) ||
-            (config.THEME.FILTER.LANGUAGE && !language_enabled) ||
-            (config.THEME.FILTER.LOOKUP[0] != '\0' && strcasestr(name, config.THEME.FILTER.LOOKUP) == NULL)
-    );
+static uint32_t required_features(void) {
+    return (config.THEME.FILTER.GRID ? THEME_FEATURE_GRID : 0) |
+           (config.THEME.FILTER.HDMI ? THEME_FEATURE_HDMI : 0) |
+           (config.THEME.FILTER.LANGUAGE ? THEME_FEATURE_LANGUAGE : 0) |
+           (config.THEME.FILTER.RESOLUTION_640x480 ? THEME_FEATURE_640X480 : 0) |
+           (config.THEME.FILTER.RESOLUTION_720x480 ? THEME_FEATURE_720X480 : 0) |
+           (config.THEME.FILTER.RESOLUTION_720x720 ? THEME_FEATURE_720X720 : 0) |
+           (config.THEME.FILTER.RESOLUTION_1024x768 ? THEME_FEATURE_1024X768 : 0) |
+           (config.THEME.FILTER.RESOLUTION_1280x720 ? THEME_FEATURE_1280X720 : 0);
 }
 
 static void create_content_items(void) {
-    if (!file_exist(theme_data_local_path)) {
+    const theme_catalogue *catalogue = theme_catalogue_load(theme_data_local_path);
+    if (!catalogue) {
         LOG_WARN(mux_module, "Theme Data Not Found At: %s", theme_data_local_path)
         return;
     } else {
         LOG_SUCCESS(mux_module, "Found Theme Data At: %s", theme_data_local_path)
     }
 
-    char *json_str = read_all_char_from(theme_data_local_path);
-    if (!json_valid(json_str)) return;
-
-    struct json fn_json = json_parse(json_str);
-
-    size_t theme_count = json_array_count(fn_json);
-
-    for (int i = 0; i < theme_count; i++) {
-        struct json theme_item = json_array_get(fn_json, i);
-
-        bool grid_enabled = json_bool(json_object_get(theme_item, "grid"));
-        bool hdmi = json_bool(json_object_get(theme_item, "hdmi"));
-        bool language = json_bool(json_object_get(theme_item, "language"));
-        bool resolution640x480 = json_bool(json_object_get(theme_item, "resolution640x480"));
-        bool resolution720x480 = json_bool(json_object_get(theme_item, "resolution720x480"));
-        bool resolution720x720 = json_bool(json_object_get(theme_item, "resolution720x720"));
-        bool resolution1024x768 = json_bool(json_object_get(theme_item, "resolution1024x768"));
-        bool resolution1280x720 = json_bool(json_object_get(theme_item, "resolution1280x720"));
-        char theme_name[MAX_BUFFER_SIZE];
-        json_string_copy(json_object_get(theme_item, "name"), theme_name, sizeof(theme_name));
-        char theme_url[MAX_BUFFER_SIZE];
-        json_string_copy(json_object_get(theme_item, "url"), theme_url, sizeof(theme_url));
-
-        if (!skip_theme_item(theme_name, grid_enabled, hdmi, language,
-                             resolution640x480, resolution720x480, resolution720x720, resolution1024x768,
-                             resolution1280x720)) {
-            add_theme_item(&theme_items, &theme_item_count, theme_name, theme_url, grid_enabled, hdmi, language,
-                           resolution640x480, resolution720x480, resolution720x720, resolution1024x768,
-                           resolution1280x720);
-        }
+    if (!catalogue->count) return;
+
+    theme_items = malloc(catalogue->count * sizeof(*theme_items));
+    theme_downloaded = malloc(catalogue->count * sizeof(*theme_downloaded));
+
+    if (!theme_items || !theme_downloaded) {
+        LOG_ERROR(mux_module, "%s", lang.SYSTEM.FAIL_ALLOCATE_MEM)
+        free(theme_items);
+        free(theme_downloaded);
+        theme_items = NULL;
+        theme_downloaded = NULL;
+        return;
+    }
+
+    // The catalogue is already sorted, so filtering keeps the order
+    uint32_t required = required_features();
+    const char *lookup = config.THEME.FILTER.LOOKUP;
+
+    for (size_t i = 0; i < catalogue->count; i++) {
+        const theme_item *item = &catalogue->items[i];
+
+        if ((item->features & required) != required) continue;
+        if (lookup[0] != '\0' && strcasestr(item->name, lookup) == NULL) continue;
+
+        theme_items[theme_item_count++] = item;
     }
-    sort_theme_items(theme_items, theme_item_count);
+
+    theme_catalogue_downloaded(theme_items, theme_item_count, RUN_STORAGE_PATH "theme", theme_downloaded);
 
     for (int i = 0; i < theme_item_count; i++) {
         if (lv_obj_get_child_cnt(ui_pnlContent) >= theme.MUX.ITEM.COUNT) break;
 
-        gen_label(mux_module, is_downloaded(i) ? "theme_down" : "theme", theme_items[i].name);
+        gen_label(mux_module, is_downloaded(i) ? "theme_down" : "theme", theme_items[i]->name);
     }
 }
 
 static void update_list_item(lv_obj_t *ui_lblItem, lv_obj_t *ui_lblItemGlyph, int index) {
-    lv_label_set_text(ui_lblItem, theme_items[index].name);
+    lv_label_set_text(ui_lblItem, theme_items[index]->name);
 
     char glyph_image_embed[MAX_BUFFER_SIZE];
     if (theme.LIST_DEFAULT.GLYPH_ALPHA > 0 && theme.LIST_FOCUS.GLYPH_ALPHA > 0) {
@@ -160,7 +154,7 @@ static void update_list_item(lv_obj_t *ui_lblItem, lv_obj_t *ui_lblItemGlyph, in
         lv_img_set_src(ui_lblItemGlyph, glyph_image_embed);
     }
 
-    apply_size_to_content(&theme, ui_pnlContent, ui_lblItem, ui_lblItemGlyph, theme_items[index].name);
+    apply_size_to_content(&theme, ui_pnlContent, ui_lblItem, ui_lblItemGlyph, theme_items[index]->name);
     apply_text_long_dot(&theme, ui_pnlContent, ui_lblItem);
 }
 
@@ -241,6 +235,10 @@ static void list_nav_next(int steps) {
 }
 
 static void theme_download_finished() {
+    char path[MAX_BUFFER_SIZE];
+    theme_path(current_item_index, path, sizeof(path));
+    theme_downloaded[current_item_index] = file_exist(path);
+
     update_list_item(lv_group_get_focused(ui_group), lv_group_get_focused(ui_group_glyph), current_item_index);
     lv_label_set_text(ui_lblNavA, is_downloaded(current_item_index) ? lang.MUXTHEMEDOWN.REMOVE
                                                                     : lang.MUXTHEMEDOWN.DOWNLOAD);
@@ -282,16 +280,16 @@ static void handle_a(void) {
 
     play_sound(SND_CONFIRM);
 
-    char theme_path[MAX_BUFFER_SIZE];
-    snprintf(theme_path, sizeof(theme_path), "%stheme/%s.muxthm",
-             RUN_STORAGE_PATH, theme_items[current_item_index].name);
-    if (file_exist(theme_path)) {
-        remove(theme_path);
+    char path[MAX_BUFFER_SIZE];
+    theme_path(current_item_index, path, sizeof(path));
+
+    if (is_downloaded(current_item_index)) {
+        remove(path);
         theme_download_finished();
         toast_message(lang.MUXTHEMEDOWN.THEME_REMOVED, SHORT);
     } else {
         set_download_callbacks(theme_download_finished);
-        initiate_download(theme_items[current_item_index].url, theme_path, true,
+        initiate_download(theme_items[current_item_index]->url, path, true,
                           lang.MUXTHEMEDOWN.DOWN.THEME);
     }
 }
@@ -311,12 +309,12 @@ static void handle_b(void) {
 
     if (download_in_progress) {
         cancel_download = true;
-        char theme_path[MAX_BUFFER_SIZE];
-        snprintf(theme_path, sizeof(theme_path), "%stheme/%s.muxthm",
-                 RUN_STORAGE_PATH, theme_items[current_item_index].name);
-        if (file_exist(theme_path)) {
-            remove(theme_path);
+        char path[MAX_BUFFER_SIZE];
+        theme_path(current_item_index, path, sizeof(path));
+        if (file_exist(path)) {
+            remove(path);
         }
+        theme_downloaded[current_item_index] = false;
     } else {
         write_text_to_file(MUOS_PDI_LOAD, "w", CHAR, "theme");
         write_text_to_file(MUOS_PIK_LOAD, "w", CHAR, "/theme");
@@ -484,7 +482,12 @@ int muxthemedown_main(void) {
     init_input(&input_opts, true);
     mux_input_task(&input_opts);
 
-    if (ui_count > 0) free_theme_items(&theme_items, &theme_item_count);
+    // The catalogue itself stays cached for the next visit
+    free(theme_items);
+    free(theme_downloaded);
+    theme_items = NULL;
+    theme_downloaded = NULL;
+    theme_item_count = 0;
 
     return exit_status;
 }